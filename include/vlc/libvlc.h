@@ -449,6 +449,19 @@ LIBVLC_API void libvlc_log_set( libvlc_instance_t *,
  */
 LIBVLC_API void libvlc_log_set_file( libvlc_instance_t *, FILE *stream );
 
+/**
+ * Writes the trace events recorded so far to a file, in the Chrome/Perfetto
+ * trace event JSON format. Tracing must have been enabled when creating the
+ * instance, with the "--trace" or "--trace-file" option.
+ *
+ * \param p_instance libvlc instance
+ * \param psz_path file path to write to
+ * \return 0 on success, -1 on error or if tracing is not enabled
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int libvlc_trace_export( libvlc_instance_t *p_instance,
+                                    const char *psz_path );
+
 /**
  * Always returns minus one.
  * This function is only provided for backward compatibility.
@@ -226,6 +226,29 @@ LIBVLC_API int libvlc_media_player_is_playing ( libvlc_media_player_t *p_mi );
  */
 LIBVLC_API int libvlc_media_player_play ( libvlc_media_player_t *p_mi );
 
+/**
+ * Pre-join media, so that switching to them is fast
+ *
+ * Each medium is opened and demuxed in the background, but not decoded: the
+ * start of its latest group of pictures is kept. Once it is set with
+ * libvlc_media_player_set_media(), libvlc_media_player_play() starts it from
+ * that data instead of waiting for the next random access point. This is
+ * meant for the neighbouring channels of live streams, such as multicast
+ * MPEG-TS; each pre-joined medium takes a network access and some memory.
+ *
+ * The media pre-joined previously and not listed any more are closed. The
+ * medium being played is skipped.
+ *
+ * \param p_mi the Media Player
+ * \param pp_md the media to pre-join
+ * \param i_md the number of media in pp_md (0 closes all of them)
+ * \return 0 if all the media were pre-joined, -1 on error
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API int libvlc_media_player_set_prejoined_media( libvlc_media_player_t *p_mi,
+                                                         libvlc_media_t *const *pp_md,
+                                                         unsigned i_md );
+
 /**
  * Pause or resume (no effect if there is no media)
  *
@@ -840,6 +863,70 @@ LIBVLC_API int libvlc_media_player_can_pause( libvlc_media_player_t *p_mi );
  */
 LIBVLC_API int libvlc_media_player_program_scrambled( libvlc_media_player_t *p_mi );
 
+/** Number of bins of the clock jitter histogram */
+#define LIBVLC_CLOCK_JITTER_BINS 8
+
+/**
+ * Clock statistics of one track
+ */
+typedef struct libvlc_clock_track_stats_t
+{
+    int                 i_id;
+    libvlc_track_type_t i_type;
+
+    uint64_t i_late;        /**< frames or samples dropped for being late */
+    uint64_t i_early;       /**< frames or samples rejected as too early */
+    uint64_t i_resamplings; /**< audio resampling adjustments */
+    int64_t  i_decoder_delay; /**< stream queued ahead of the decoder
+                                   (microseconds) */
+    int64_t  i_output_delay;  /**< advance of the decoded data on their
+                                   date when reaching the output
+                                   (microseconds) */
+} libvlc_clock_track_stats_t;
+
+/**
+ * Clock statistics of the current program
+ */
+typedef struct libvlc_clock_stats_t
+{
+    uint64_t i_references;  /**< clock references received */
+
+    /** Clock references by arrival jitter: bin 0 counts those under 1 ms,
+     * bin n those in [2^(n-1), 2^n) ms, and the last bin the larger ones */
+    uint64_t pi_jitter[LIBVLC_CLOCK_JITTER_BINS];
+    int64_t  i_jitter_max;  /**< largest jitter (microseconds) */
+
+    double   f_drift;       /**< estimated drift of the stream clock against
+                                 the system clock (ppm, positive if slower) */
+    int64_t  i_pts_delay;   /**< current buffering delay (microseconds) */
+    uint64_t i_resamplings; /**< audio resampling adjustments */
+
+    unsigned                    i_tracks;
+    libvlc_clock_track_stats_t *p_tracks;
+} libvlc_clock_stats_t;
+
+/**
+ * Get the clock statistics of the current program.
+ *
+ * The statistics are only gathered if the "stats" option is enabled.
+ *
+ * \param p_mi the media player
+ * \return the statistics, to be released with libvlc_clock_stats_release(),
+ *         or NULL on error
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API libvlc_clock_stats_t *
+libvlc_media_player_get_clock_stats( libvlc_media_player_t *p_mi );
+
+/**
+ * Release the clock statistics returned by
+ * libvlc_media_player_get_clock_stats().
+ *
+ * \param p_stats the statistics to release
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API void libvlc_clock_stats_release( libvlc_clock_stats_t *p_stats );
+
 /**
  * Display the next frame (if supported)
  *
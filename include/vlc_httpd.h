@@ -117,6 +117,7 @@ VLC_API void httpd_UrlDelete( httpd_url_t * );
 
 VLC_API char* httpd_ClientIP( const httpd_client_t *cl, char *, int * );
 VLC_API char* httpd_ServerIP( const httpd_client_t *cl, char *, int * );
+VLC_API void httpd_ClientModeStream( httpd_client_t *cl );
 
 /* High level */
 
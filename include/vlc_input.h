@@ -394,6 +394,48 @@ typedef enum input_event_type_e
 
 } input_event_type_e;
 
+/**
+ * Number of bins of the clock reference jitter histogram
+ */
+#define INPUT_CLOCK_JITTER_BINS 8
+
+/**
+ * Clock statistics of an elementary stream
+ */
+typedef struct
+{
+    int      i_id;          /**< ES id */
+    int      i_cat;         /**< ES category */
+    uint64_t i_late;        /**< Blocks dropped as too late */
+    uint64_t i_early;       /**< Blocks dropped as too early */
+    uint64_t i_resamplings; /**< Audio resampling adjustments */
+    mtime_t  i_decoder_delay; /**< Stream queued ahead of the decoder */
+    mtime_t  i_output_delay;  /**< Advance of the decoded data on their date
+                                   when reaching the output */
+} input_clock_es_stats_t;
+
+/**
+ * Clock statistics of an input, returned by INPUT_GET_CLOCK_STATS
+ *
+ * They are only gathered when the "stats" option is set.
+ */
+typedef struct
+{
+    uint64_t i_references;  /**< Clock references received */
+    /** Deviations of the clock references from their expected dates: bin 0
+     * counts those under 1 ms, bin n those in [2^(n-1), 2^n) ms, and the
+     * last bin all the larger ones */
+    uint64_t pi_jitter[INPUT_CLOCK_JITTER_BINS];
+    mtime_t  i_jitter_max;  /**< Largest deviation */
+    double   f_drift;       /**< Drift in ppm, positive if the stream clock
+                                 is slower than the system one */
+    mtime_t  i_pts_delay;   /**< Current pts delay */
+    uint64_t i_resamplings; /**< Audio resampling adjustments */
+
+    int                     i_es;
+    input_clock_es_stats_t *p_es;
+} input_clock_stats_t;
+
 /**
  * Input queries
  */
@@ -478,6 +520,12 @@ enum input_query_e
     /* External clock managments */
     INPUT_GET_PCR_SYSTEM,   /* arg1=mtime_t *, arg2=mtime_t *       res=can fail */
     INPUT_MODIFY_PCR_SYSTEM,/* arg1=int absolute, arg2=mtime_t      res=can fail */
+
+    /* Clock statistics, to be released with free() */
+    INPUT_GET_CLOCK_STATS,  /* arg1=input_clock_stats_t **          res=can fail */
+
+    /* Pre-joined input */
+    INPUT_JOIN,             /* res=cannot fail */
 };
 
 /** @}*/
@@ -492,6 +540,9 @@ VLC_API input_thread_t * input_Create( vlc_object_t *p_parent, input_item_t *, c
 VLC_API input_thread_t * input_CreateAndStart( vlc_object_t *p_parent, input_item_t *, const char *psz_log ) VLC_USED;
 #define input_CreateAndStart(a,b,c) input_CreateAndStart(VLC_OBJECT(a),b,c)
 
+VLC_API input_thread_t * input_CreatePrejoined( vlc_object_t *p_parent, input_item_t *, const char *psz_log, input_resource_t * ) VLC_USED;
+#define input_CreatePrejoined(a,b,c,d) input_CreatePrejoined(VLC_OBJECT(a),b,c,d)
+
 VLC_API int input_Start( input_thread_t * );
 
 VLC_API void input_Stop( input_thread_t * );
@@ -124,6 +124,8 @@ typedef void (*vlc_log_cb) (void *data, int type, const vlc_log_t *item,
 
 VLC_API void vlc_LogSet(libvlc_int_t *, vlc_log_cb cb, void *data);
 
+VLC_API int vlc_trace_Export(libvlc_int_t *, const char *path);
+
 /*@}*/
 
 #if defined( _WIN32 ) && !VLC_WINSTORE_APP
@@ -105,6 +105,13 @@ enum stream_query_e
      * FIXME find a way to avoid it */
     STREAM_UPDATE_SIZE,
 
+    /* The range will be read soon: it may be fetched now, with the ranges
+     * around, in a single request */
+    STREAM_HINT_RANGE,          /**< arg1= uint64_t offset, arg2= uint64_t length res=can fail */
+    /* The ranges hinted so far may not be read: they need not be kept
+     * anymore. Sent before each new batch of hints */
+    STREAM_CLEAR_HINTS,         /**< res=can fail */
+
     /* */
     STREAM_GET_PTS_DELAY = 0x101,/**< arg1= int64_t* res=cannot fail */
     STREAM_GET_TITLE_INFO, /**< arg1=input_title_t*** arg2=int* res=can fail */
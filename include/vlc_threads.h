@@ -322,6 +322,72 @@ VLC_API void vlc_timer_destroy(vlc_timer_t);
 VLC_API void vlc_timer_schedule(vlc_timer_t, bool, mtime_t, mtime_t);
 VLC_API unsigned vlc_timer_getoverrun(vlc_timer_t) VLC_USED;
 
+/**
+ * \defgroup executor Thread pool
+ * Runs short tasks on a bounded set of worker threads, instead of creating
+ * one thread per subsystem. Worker threads are created on demand and exit
+ * after some idle time.
+ * @{
+ */
+typedef struct vlc_executor vlc_executor_t;
+
+enum vlc_task_priority
+{
+    VLC_TASK_PRIORITY_LOW,
+    VLC_TASK_PRIORITY_NORMAL,
+    VLC_TASK_PRIORITY_HIGH,
+};
+#define VLC_TASK_PRIORITY_COUNT 3
+
+/**
+ * Task descriptor. The storage is owned by the caller, typically embedded in
+ * the object the task works on, and must remain valid until the task has
+ * completed or has been canceled.
+ *
+ * If the task owns its storage, it must free it from the release callback,
+ * not from the task procedure: the executor still accesses the descriptor
+ * after the procedure returns.
+ */
+typedef struct vlc_task
+{
+    void (*run)(void *opaque); /**< Task procedure */
+    void (*release)(void *opaque); /**< Called once the executor no longer
+                                        accesses the task, after it ran or
+                                        when it is discarded (or NULL) */
+    void *opaque; /**< Task procedure data */
+
+    /* Private executor data */
+    struct vlc_task *next;
+    mtime_t date;
+    unsigned char priority;
+    unsigned running;
+    bool queued;
+    bool canceled;
+} vlc_task_t;
+
+/**
+ * Initializes a task descriptor.
+ */
+static inline void vlc_task_Init(vlc_task_t *task, void (*run)(void *),
+                                 void *opaque)
+{
+    task->run = run;
+    task->release = NULL;
+    task->opaque = opaque;
+    task->next = NULL;
+    task->running = 0;
+    task->queued = task->canceled = false;
+}
+
+VLC_API vlc_executor_t *vlc_executor_New(unsigned max_threads) VLC_USED;
+VLC_API void vlc_executor_Delete(vlc_executor_t *);
+VLC_API int vlc_executor_Submit(vlc_executor_t *, vlc_task_t *, int priority,
+                                mtime_t date);
+VLC_API bool vlc_executor_Cancel(vlc_executor_t *, vlc_task_t *);
+VLC_API bool vlc_task_IsCanceled(vlc_executor_t *, const vlc_task_t *)
+VLC_USED;
+/** @} */
+
 VLC_API unsigned vlc_GetCPUCount(void);
 
 VLC_API int vlc_savecancel(void);
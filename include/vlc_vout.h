@@ -136,6 +136,9 @@ static inline void vout_CloseAndRelease( vout_thread_t *p_vout )
  *
  * pp_image will hold an encoded picture in psz_format format.
  *
+ * The picture returned in pp_picture may be shared with other snapshot
+ * requests: it must be treated as read-only, and copied before any change.
+ *
  * i_timeout specifies the time the function will wait for a snapshot to be
  * available.
  *
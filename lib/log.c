@@ -108,6 +108,11 @@ void libvlc_log_set_file (libvlc_instance_t *inst, FILE *stream)
     libvlc_log_set (inst, libvlc_log_file, stream);
 }
 
+int libvlc_trace_export (libvlc_instance_t *inst, const char *path)
+{
+    return vlc_trace_Export (inst->p_libvlc_int, path);
+}
+
 /*** Stubs for the old interface ***/
 unsigned libvlc_get_log_verbosity( const libvlc_instance_t *p_instance )
 {
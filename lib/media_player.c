@@ -148,6 +148,54 @@ static void release_input_thread( libvlc_media_player_t *p_mi )
     input_Close( p_input_thread );
 }
 
+/*
+ * Pre-joined inputs. The input lock must be held.
+ */
+static void release_prejoined( libvlc_media_player_t *p_mi )
+{
+    for( unsigned i = 0; i < p_mi->input.i_prejoined; i++ )
+    {
+        input_thread_t *p_input_thread = p_mi->input.pp_prejoined[i];
+
+        if( p_input_thread )
+        {
+            input_Stop( p_input_thread );
+            input_Close( p_input_thread );
+        }
+        libvlc_media_release( p_mi->input.pp_prejoined_md[i] );
+    }
+    free( p_mi->input.pp_prejoined );
+    free( p_mi->input.pp_prejoined_md );
+    p_mi->input.pp_prejoined = NULL;
+    p_mi->input.pp_prejoined_md = NULL;
+    p_mi->input.i_prejoined = 0;
+}
+
+/* Takes the pre-joined input of p_md out of the list, if it is still
+ * running: the caller owns it */
+static input_thread_t *take_prejoined( libvlc_media_player_t *p_mi,
+                                       libvlc_media_t *p_md )
+{
+    for( unsigned i = 0; i < p_mi->input.i_prejoined; i++ )
+    {
+        input_thread_t *p_input_thread = p_mi->input.pp_prejoined[i];
+
+        if( p_mi->input.pp_prejoined_md[i] != p_md || !p_input_thread )
+            continue;
+        p_mi->input.pp_prejoined[i] = NULL;
+
+        const int state = var_GetInteger( p_input_thread, "state" );
+        if( state == ERROR_S || state == END_S )
+        {
+            input_Stop( p_input_thread );
+            input_Close( p_input_thread );
+            return NULL;
+        }
+        return p_input_thread;
+    }
+    return NULL;
+}
+
 /*
  * Retrieve the input thread. Be sure to release the object
  * once you are done with it. (libvlc Internal)
@@ -589,6 +637,9 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     mp->state = libvlc_NothingSpecial;
     mp->p_libvlc_instance = instance;
     mp->input.p_thread = NULL;
+    mp->input.pp_prejoined_md = NULL;
+    mp->input.pp_prejoined = NULL;
+    mp->input.i_prejoined = 0;
     mp->input.p_resource = input_resource_New(VLC_OBJECT(mp));
     if (unlikely(mp->input.p_resource == NULL))
     {
@@ -686,6 +737,7 @@ static void libvlc_media_player_destroy( libvlc_media_player_t *p_mi )
     /* No need for lock_input() because no other threads knows us anymore */
     if( p_mi->input.p_thread )
         release_input_thread(p_mi);
+    release_prejoined( p_mi );
     input_resource_Terminate( p_mi->input.p_resource );
     input_resource_Release( p_mi->input.p_resource );
     vlc_mutex_destroy( &p_mi->input.lock );
@@ -847,8 +899,11 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
         return -1;
     }
 
-    p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
-                                   p_mi->input.p_resource );
+    p_input_thread = take_prejoined( p_mi, p_mi->p_md );
+    const bool b_prejoined = p_input_thread != NULL;
+    if( !b_prejoined )
+        p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
+                                       p_mi->input.p_resource );
     unlock(p_mi);
     if( !p_input_thread )
     {
@@ -863,7 +918,15 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
     var_AddCallback( p_input_thread, "intf-event", input_event_changed, p_mi );
     add_es_callbacks( p_input_thread, p_mi );
 
-    if( input_Start( p_input_thread ) )
+    if( b_prejoined )
+    {
+        input_Control( p_input_thread, INPUT_JOIN );
+        /* Report the state reached before the callbacks were added */
+        input_event_changed( VLC_OBJECT(p_input_thread), "intf-event",
+                             (vlc_value_t){ .i_int = 0 },
+                             (vlc_value_t){ .i_int = INPUT_EVENT_STATE }, p_mi );
+    }
+    else if( input_Start( p_input_thread ) )
     {
         unlock_input(p_mi);
         del_es_callbacks( p_input_thread, p_mi );
@@ -880,6 +943,73 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
     return 0;
 }
 
+int libvlc_media_player_set_prejoined_media( libvlc_media_player_t *p_mi,
+                                             libvlc_media_t *const *pp_md,
+                                             unsigned i_md )
+{
+    libvlc_media_t **pp_new_md = NULL;
+    input_thread_t **pp_new = NULL;
+    unsigned i_new = 0;
+    int i_ret = 0;
+
+    if( i_md > 0 )
+    {
+        pp_new_md = malloc( i_md * sizeof( *pp_new_md ) );
+        pp_new = malloc( i_md * sizeof( *pp_new ) );
+        if( !pp_new_md || !pp_new )
+        {
+            free( pp_new_md );
+            free( pp_new );
+            libvlc_printerr( "Not enough memory" );
+            return -1;
+        }
+    }
+
+    lock_input( p_mi );
+    for( unsigned i = 0; i < i_md; i++ )
+    {
+        /* The media being played needs no pre-joining */
+        lock( p_mi );
+        const bool b_current = p_mi->input.p_thread && p_mi->p_md == pp_md[i];
+        unlock( p_mi );
+        if( b_current )
+            continue;
+
+        /* Keep the inputs already pre-joined */
+        input_thread_t *p_input_thread = take_prejoined( p_mi, pp_md[i] );
+        if( !p_input_thread )
+        {
+            p_input_thread = input_CreatePrejoined( p_mi,
+                                                    pp_md[i]->p_input_item,
+                                                    NULL,
+                                                    p_mi->input.p_resource );
+            if( p_input_thread && input_Start( p_input_thread ) )
+            {
+                vlc_object_release( p_input_thread );
+                p_input_thread = NULL;
+            }
+            if( !p_input_thread )
+            {
+                libvlc_printerr( "Input initialization failure" );
+                i_ret = -1;
+                continue;
+            }
+        }
+        libvlc_media_retain( pp_md[i] );
+        pp_new_md[i_new] = pp_md[i];
+        pp_new[i_new] = p_input_thread;
+        i_new++;
+    }
+
+    /* Close the ones no longer listed */
+    release_prejoined( p_mi );
+    p_mi->input.pp_prejoined_md = pp_new_md;
+    p_mi->input.pp_prejoined = pp_new;
+    p_mi->input.i_prejoined = i_new;
+    unlock_input( p_mi );
+    return i_ret;
+}
+
 void libvlc_media_player_set_pause( libvlc_media_player_t *p_mi, int paused )
 {
     input_thread_t * p_input_thread = libvlc_get_input_thread( p_mi );
@@ -1552,6 +1682,79 @@ int libvlc_media_player_program_scrambled( libvlc_media_player_t *p_mi )
     return b_program_scrambled;
 }
 
+libvlc_clock_stats_t *
+libvlc_media_player_get_clock_stats( libvlc_media_player_t *p_mi )
+{
+    input_thread_t *p_input_thread = libvlc_get_input_thread( p_mi );
+    if( !p_input_thread )
+        return NULL;
+
+    input_clock_stats_t *p_in;
+    int i_ret = input_Control( p_input_thread, INPUT_GET_CLOCK_STATS, &p_in );
+    vlc_object_release( p_input_thread );
+    if( i_ret )
+    {
+        libvlc_printerr( "Clock statistics not available" );
+        return NULL;
+    }
+
+    static_assert( LIBVLC_CLOCK_JITTER_BINS == INPUT_CLOCK_JITTER_BINS,
+                   "Mismatched jitter histograms" );
+
+    libvlc_clock_stats_t *p_stats =
+        malloc( sizeof( *p_stats ) + p_in->i_es * sizeof( *p_stats->p_tracks ) );
+    if( unlikely(p_stats == NULL) )
+    {
+        free( p_in );
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    p_stats->i_references = p_in->i_references;
+    memcpy( p_stats->pi_jitter, p_in->pi_jitter, sizeof( p_stats->pi_jitter ) );
+    p_stats->i_jitter_max = p_in->i_jitter_max;
+    p_stats->f_drift = p_in->f_drift;
+    p_stats->i_pts_delay = p_in->i_pts_delay;
+    p_stats->i_resamplings = p_in->i_resamplings;
+    p_stats->i_tracks = p_in->i_es;
+    p_stats->p_tracks = (libvlc_clock_track_stats_t *)&p_stats[1];
+
+    for( int i = 0; i < p_in->i_es; i++ )
+    {
+        const input_clock_es_stats_t *p_es = &p_in->p_es[i];
+        libvlc_clock_track_stats_t *p_track = &p_stats->p_tracks[i];
+
+        p_track->i_id = p_es->i_id;
+        switch( p_es->i_cat )
+        {
+            case AUDIO_ES:
+                p_track->i_type = libvlc_track_audio;
+                break;
+            case VIDEO_ES:
+                p_track->i_type = libvlc_track_video;
+                break;
+            case SPU_ES:
+                p_track->i_type = libvlc_track_text;
+                break;
+            default:
+                p_track->i_type = libvlc_track_unknown;
+                break;
+        }
+        p_track->i_late = p_es->i_late;
+        p_track->i_early = p_es->i_early;
+        p_track->i_resamplings = p_es->i_resamplings;
+        p_track->i_decoder_delay = p_es->i_decoder_delay;
+        p_track->i_output_delay = p_es->i_output_delay;
+    }
+    free( p_in );
+    return p_stats;
+}
+
+void libvlc_clock_stats_release( libvlc_clock_stats_t *p_stats )
+{
+    free( p_stats );
+}
+
 void libvlc_media_player_next_frame( libvlc_media_player_t *p_mi )
 {
     input_thread_t *p_input_thread = libvlc_get_input_thread ( p_mi );
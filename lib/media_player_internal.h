@@ -48,6 +48,11 @@ struct libvlc_media_player_t
         input_thread_t   *p_thread;
         input_resource_t *p_resource;
         vlc_mutex_t       lock;
+
+        /* Pre-joined media, demuxed but not decoded */
+        libvlc_media_t  **pp_prejoined_md;
+        input_thread_t  **pp_prejoined;
+        unsigned          i_prejoined;
     } input;
 
     struct libvlc_instance_t * p_libvlc_instance; /* Parent instance */
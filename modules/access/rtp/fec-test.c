@@ -0,0 +1,177 @@
+/*
+ * SMPTE 2022-1 FEC recovery test
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "fec.h"
+
+#define L 4 /* columns */
+#define D 3 /* rows */
+#define BASE 65530 /* wraps around */
+
+static block_t *media[L * D];
+static bool lost[L * D];
+
+static uint16_t seq_of (unsigned i)
+{
+    return BASE + i;
+}
+
+static const block_t *get (void *opaque, uint16_t seq)
+{
+    unsigned i = (uint16_t)(seq - BASE);
+    (void) opaque;
+    if (i >= L * D || lost[i])
+        return NULL;
+    return media[i];
+}
+
+static block_t *make_media (unsigned i)
+{
+    size_t len = 100 + 17 * i; /* different lengths */
+    block_t *block = block_Alloc (12 + len);
+    assert (block != NULL);
+
+    uint8_t *p = block->p_buffer;
+    p[0] = 0x80;
+    p[1] = 33 | ((i % 5 == 0) ? 0x80 : 0); /* MP2T, some markers */
+    SetWBE (p + 2, seq_of (i));
+    SetDWBE (p + 4, 90000 + 3003 * i);
+    SetDWBE (p + 8, 0xdeadbeef);
+    for (size_t j = 0; j < len; j++)
+        p[12 + j] = i * 31 + j;
+    return block;
+}
+
+/* Protects count packets from first, offset apart */
+static block_t *make_fec (unsigned first, unsigned offset, unsigned count)
+{
+    size_t len = 0;
+    for (unsigned k = 0; k < count; k++)
+    {
+        const block_t *m = media[first + k * offset];
+        if (m->i_buffer - 12 > len)
+            len = m->i_buffer - 12;
+    }
+
+    block_t *block = block_Alloc (12 + 16 + len);
+    assert (block != NULL);
+    uint8_t *p = block->p_buffer;
+    memset (p, 0, block->i_buffer);
+
+    uint16_t length = 0;
+    uint8_t pt = 0;
+    uint32_t ts = 0;
+    for (unsigned k = 0; k < count; k++)
+    {
+        const block_t *m = media[first + k * offset];
+        p[0] ^= m->p_buffer[0] & 0x3F;
+        p[1] ^= m->p_buffer[1] & 0x80;
+        pt ^= m->p_buffer[1] & 0x7F;
+        ts ^= GetDWBE (m->p_buffer + 4);
+        length ^= m->i_buffer - 12;
+        for (size_t j = 12; j < m->i_buffer; j++)
+            p[16 + j] ^= m->p_buffer[j];
+    }
+    p[0] |= 0x80;
+    p[1] |= 96;
+
+    uint8_t *h = p + 12;
+    SetWBE (h, seq_of (first));
+    SetWBE (h + 2, length);
+    h[4] = 0x80 | pt;
+    SetDWBE (h + 8, ts);
+    h[12] = (offset == 1) ? 0x40 : 0x00; /* D */
+    h[13] = offset;
+    h[14] = count;
+    return block;
+}
+
+static void check (rtp_fec_t *fec, unsigned i, bool recoverable)
+{
+    block_t *block = rtp_fec_recover (fec, seq_of (i), get, NULL);
+    if (!recoverable)
+    {
+        assert (block == NULL);
+        return;
+    }
+    assert (block != NULL);
+    assert (block->i_buffer == media[i]->i_buffer);
+    assert (!memcmp (block->p_buffer, media[i]->p_buffer, block->i_buffer));
+    block_Release (block);
+    lost[i] = false;
+}
+
+int main (void)
+{
+    for (unsigned i = 0; i < L * D; i++)
+        media[i] = make_media (i);
+
+    rtp_fec_t *fec = rtp_fec_create ();
+    assert (fec != NULL);
+    assert (rtp_fec_span (fec) == 0);
+
+    /* Invalid packet */
+    block_t *bad = block_Alloc (20);
+    memset (bad->p_buffer, 0, 20);
+    assert (rtp_fec_queue (fec, bad) != 0);
+
+    /* Columns, then rows */
+    for (unsigned c = 0; c < L; c++)
+        assert (rtp_fec_queue (fec, make_fec (c, L, D)) == 0);
+    for (unsigned r = 0; r < D; r++)
+        assert (rtp_fec_queue (fec, make_fec (r * L, 1, L)) == 0);
+    assert (rtp_fec_span (fec) == 2 * L * D);
+
+    /* Single loss */
+    lost[5] = true;
+    check (fec, 5, true);
+
+    /* Burst loss of a whole row: the columns recover it */
+    for (unsigned c = 0; c < L; c++)
+        lost[L + c] = true;
+    for (unsigned c = 0; c < L; c++)
+        check (fec, L + c, true);
+
+    /* Loss of a column but one: the rows recover it */
+    for (unsigned r = 0; r < D - 1; r++)
+        lost[r * L + 2] = true;
+    for (unsigned r = 0; r < D - 1; r++)
+        check (fec, r * L + 2, true);
+
+    /* Square loss: neither rows nor columns can recover it */
+    lost[0] = lost[1] = lost[L] = lost[L + 1] = true;
+    check (fec, 0, false);
+    check (fec, L + 1, false);
+
+    rtp_fec_destroy (fec);
+    for (unsigned i = 0; i < L * D; i++)
+        block_Release (media[i]);
+    return 0;
+}
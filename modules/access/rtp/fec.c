@@ -0,0 +1,219 @@
+/**
+ * @file fec.c
+ * @brief SMPTE 2022-1 forward error correction
+ */
+/*****************************************************************************
+ * Copyright © 2016 VLC authors and VideoLAN
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "fec.h"
+
+/* The FEC packets carry the XOR of the RTP packets they protect (RFC 2733),
+ * those of a column of the L x D matrix of media packets (offset L, count D)
+ * or of a row (offset 1, count L). A single missing packet among them can be
+ * recovered. */
+
+#define RTP_FEC_MAX 64 /* FEC packets kept, enough for two 20x20 matrices */
+#define FEC_HEADER  (12 + 16) /* RTP and FEC headers */
+
+typedef struct
+{
+    block_t *block; /* the whole FEC packet */
+    uint32_t ts_recovery;
+    uint16_t base;
+    uint16_t length_recovery;
+    uint8_t  pt_recovery;
+    uint8_t  offset;
+    uint8_t  count;
+} rtp_fec_packet_t;
+
+struct rtp_fec_t
+{
+    rtp_fec_packet_t packets[RTP_FEC_MAX];
+    unsigned         next; /* oldest, replaced first */
+    uint16_t         span;
+};
+
+rtp_fec_t *rtp_fec_create (void)
+{
+    rtp_fec_t *fec = calloc (1, sizeof (*fec));
+    return fec;
+}
+
+void rtp_fec_destroy (rtp_fec_t *fec)
+{
+    for (unsigned i = 0; i < RTP_FEC_MAX; i++)
+        if (fec->packets[i].block != NULL)
+            block_Release (fec->packets[i].block);
+    free (fec);
+}
+
+/**
+ * Stores a FEC packet (including its RTP header).
+ * @return 0 on success, EINVAL if the packet is invalid (it is released)
+ */
+int rtp_fec_queue (rtp_fec_t *fec, block_t *block)
+{
+    const uint8_t *p = block->p_buffer;
+
+    /* The P, X, CC and M bits of the FEC packet protect those of the media
+     * packets: there is neither CSRC nor header extension. */
+    if (block->i_buffer < FEC_HEADER || (p[0] >> 6) != 2)
+        goto drop;
+
+    const uint8_t *h = p + 12;
+    if (!(h[4] & 0x80) /* E: the SMPTE 2022-1 extension is required */
+     || (h[12] & 0x80) /* X: no further extension is defined */
+     || ((h[12] >> 3) & 7) != 0 /* type: XOR */
+     || h[13] == 0 || h[14] == 0)
+        goto drop;
+
+    rtp_fec_packet_t *f = &fec->packets[fec->next];
+    if (f->block != NULL)
+        block_Release (f->block);
+
+    f->block = block;
+    f->base = GetWBE (h);
+    f->length_recovery = GetWBE (h + 2);
+    f->pt_recovery = h[4] & 0x7F;
+    f->ts_recovery = GetDWBE (h + 8);
+    f->offset = h[13];
+    f->count = h[14];
+    fec->next = (fec->next + 1) % RTP_FEC_MAX;
+
+    /* How far after a packet its FEC packets may come: they are sent
+     * along the next matrix at the latest. */
+    uint16_t span = 2 * f->offset * f->count;
+    if (span > fec->span)
+        fec->span = span;
+    return 0;
+
+drop:
+    block_Release (block);
+    return EINVAL;
+}
+
+/**
+ * @return how many media packets after a missing one its FEC packets may
+ * arrive, 0 if no FEC packets were received yet
+ */
+uint16_t rtp_fec_span (const rtp_fec_t *fec)
+{
+    return fec->span;
+}
+
+static bool rtp_fec_covers (const rtp_fec_packet_t *f, uint16_t seq)
+{
+    uint16_t delta = seq - f->base;
+    return (delta % f->offset) == 0 && (delta / f->offset) < f->count;
+}
+
+static block_t *rtp_fec_apply (const rtp_fec_packet_t *f, uint16_t seq,
+                               const block_t *(*get) (void *, uint16_t),
+                               void *opaque)
+{
+    /* All the other protected packets are required */
+    const block_t *ref = NULL;
+    uint16_t length = f->length_recovery;
+    for (unsigned i = 0; i < f->count; i++)
+    {
+        uint16_t s = f->base + i * f->offset;
+        if (s == seq)
+            continue;
+
+        const block_t *media = get (opaque, s);
+        if (media == NULL)
+            return NULL;
+        length ^= media->i_buffer - 12;
+        ref = media;
+    }
+
+    if (ref == NULL || length > f->block->i_buffer - FEC_HEADER)
+        return NULL;
+
+    block_t *block = block_Alloc (12 + length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    uint8_t *p = block->p_buffer;
+    const uint8_t *fp = f->block->p_buffer;
+    p[0] = fp[0] & 0x3F; /* P, X, CC */
+    p[1] = (fp[1] & 0x80) | f->pt_recovery; /* M, PT */
+    SetWBE (p + 2, seq);
+    SetDWBE (p + 4, f->ts_recovery);
+    memcpy (p + 8, ref->p_buffer + 8, 4); /* SSRC */
+    memcpy (p + 12, fp + FEC_HEADER, length);
+
+    for (unsigned i = 0; i < f->count; i++)
+    {
+        uint16_t s = f->base + i * f->offset;
+        if (s == seq)
+            continue;
+
+        const block_t *media = get (opaque, s);
+        const uint8_t *mp = media->p_buffer;
+        size_t len = media->i_buffer - 12;
+        if (len > length)
+            len = length;
+
+        p[0] ^= mp[0] & 0x3F;
+        p[1] ^= mp[1];
+        for (unsigned j = 4; j < 8; j++)
+            p[j] ^= mp[j];
+        for (size_t j = 0; j < len; j++)
+            p[12 + j] ^= mp[12 + j];
+    }
+    p[0] |= 0x80; /* version 2 */
+    return block;
+}
+
+/**
+ * Recovers a missing media packet.
+ * @param seq sequence number of the missing packet
+ * @param get callback returning the received RTP packet of a sequence
+ * number, or NULL if it is missing
+ * @return the recovered RTP packet, or NULL if it cannot be recovered yet
+ */
+block_t *rtp_fec_recover (rtp_fec_t *fec, uint16_t seq,
+                          const block_t *(*get) (void *, uint16_t),
+                          void *opaque)
+{
+    for (unsigned i = 0; i < RTP_FEC_MAX; i++)
+    {
+        const rtp_fec_packet_t *f = &fec->packets[i];
+
+        if (f->block == NULL || !rtp_fec_covers (f, seq))
+            continue;
+
+        block_t *block = rtp_fec_apply (f, seq, get, opaque);
+        if (block != NULL)
+            return block;
+    }
+    return NULL;
+}
@@ -32,6 +32,7 @@
 #include <vlc_demux.h>
 
 #include "rtp.h"
+#include "fec.h"
 
 typedef struct rtp_source_t rtp_source_t;
 
@@ -42,14 +43,18 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+    rtp_fec_t     *fec; /* created with the first FEC packet */
+    uint64_t       recovered; /* packets recovered with FEC */
+    uint64_t       lost; /* packets neither received nor recovered */
 };
 
 static rtp_source_t *
 rtp_source_create (demux_t *, const rtp_session_t *, uint32_t, uint16_t);
 static void
 rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_source_flush (rtp_source_t *);
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_decode (demux_t *, rtp_session_t *, rtp_source_t *);
 
 /**
  * Creates a new RTP session.
@@ -65,6 +70,9 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    session->fec = NULL;
+    session->recovered = 0;
+    session->lost = 0;
 
     (void)demux;
     return session;
@@ -79,6 +87,10 @@ void rtp_session_destroy (demux_t *demux, rtp_session_t *session)
     for (unsigned i = 0; i < session->srcc; i++)
         rtp_source_destroy (demux, session, session->srcv[i]);
 
+    msg_Dbg (demux, "%"PRIu64" packet(s) recovered with FEC, %"PRIu64" lost",
+             session->recovered, session->lost);
+    if (session->fec != NULL)
+        rtp_fec_destroy (session->fec);
     free (session->srcv);
     free (session->ptv);
     free (session);
@@ -138,6 +150,7 @@ struct rtp_source_t
 {
     uint32_t ssrc;
     uint32_t jitter;  /* interarrival delay jitter estimate */
+    mtime_t  interval; /* average interarrival time */
     mtime_t  last_rx; /* last received packet local timestamp */
     uint32_t last_ts; /* last received packet RTP timestamp */
 
@@ -147,8 +160,12 @@ struct rtp_source_t
     uint16_t bad_seq; /* tentatively next expected sequence for resync */
     uint16_t max_seq; /* next expected sequence */
 
-    uint16_t last_seq; /* sequence of the next dequeued packet */
-    block_t *blocks; /* re-ordered blocks queue */
+    uint16_t last_seq; /* sequence of the last dequeued packet */
+    uint16_t ring_mask;
+    unsigned pending; /* queued packets, after last_seq */
+    /* Packets by sequence number: the re-ordering queue after last_seq,
+     * and the last dequeued ones before, for FEC. */
+    block_t **ring;
     void    *opaque[]; /* Per-source private payload data */
 };
 
@@ -167,12 +184,26 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
 
     source->ssrc = ssrc;
     source->jitter = 0;
+    source->interval = 0;
     source->ref_rtp = 0;
     /* TODO: use VLC_TS_0, but VLC does not like negative PTS at the moment */
     source->ref_ntp = UINT64_C (1) << 62;
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
-    source->blocks = NULL;
+    source->pending = 0;
+
+    /* Large enough for any accepted sequence number */
+    const demux_sys_t *sys = demux->p_sys;
+    unsigned size = 64;
+    while (size <= (unsigned)sys->max_dropout + sys->max_misorder)
+        size *= 2;
+    source->ring_mask = size - 1;
+    source->ring = calloc (size, sizeof (*source->ring));
+    if (source->ring == NULL)
+    {
+        free (source);
+        return NULL;
+    }
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
@@ -194,7 +225,8 @@ rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
-    block_ChainRelease (source->blocks);
+    rtp_source_flush (source);
+    free (source->ring);
     free (source);
 }
 
@@ -210,6 +242,57 @@ static inline uint32_t rtp_timestamp (const block_t *block)
     return GetDWBE (block->p_buffer + 4);
 }
 
+/**
+ * @return the queued or recently dequeued packet of a sequence number,
+ * NULL if missing
+ */
+static const block_t *rtp_source_get (void *opaque, uint16_t seq)
+{
+    const rtp_source_t *src = opaque;
+    const block_t *block = src->ring[seq & src->ring_mask];
+
+    if (block == NULL || rtp_seq (block) != seq)
+        return NULL;
+    return block;
+}
+
+/**
+ * @return the slot of the first queued packet, NULL if the queue is empty
+ */
+static block_t **rtp_source_first (rtp_source_t *src)
+{
+    if (src->pending == 0)
+        return NULL;
+
+    for (uint16_t seq = src->last_seq + 1;; seq++)
+    {
+        block_t **slot = &src->ring[seq & src->ring_mask];
+        if (*slot != NULL && rtp_seq (*slot) == seq)
+            return slot;
+    }
+}
+
+static void rtp_source_flush (rtp_source_t *src)
+{
+    for (unsigned i = 0; i <= src->ring_mask; i++)
+        if (src->ring[i] != NULL)
+        {
+            block_Release (src->ring[i]);
+            src->ring[i] = NULL;
+        }
+    src->pending = 0;
+}
+
+static void rtp_source_insert (rtp_source_t *src, block_t *block)
+{
+    block_t **slot = &src->ring[rtp_seq (block) & src->ring_mask];
+
+    if (*slot != NULL) /* dequeued long ago */
+        block_Release (*slot);
+    *slot = block;
+    src->pending++;
+}
+
 static const struct rtp_pt_t *
 rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
                 const block_t *block, void **pt_data)
@@ -246,16 +329,6 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     if ((block->p_buffer[0] >> 6 ) != 2) /* RTP version number */
         goto drop;
 
-    /* Remove padding if present */
-    if (block->p_buffer[0] & 0x20)
-    {
-        uint8_t padding = block->p_buffer[block->i_buffer - 1];
-        if ((padding == 0) || (block->i_buffer < (12u + padding)))
-            goto drop; /* illegal value */
-
-        block->i_buffer -= padding;
-    }
-
     mtime_t        now = mdate ();
     rtp_source_t  *src  = NULL;
     const uint16_t seq  = rtp_seq (block);
@@ -318,6 +391,9 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
             if (d < 0) d = -d;
             src->jitter += ((d - src->jitter) + 8) >> 4;
         }
+
+        /* The packet duration, for a constant packet rate */
+        src->interval += ((now - src->last_rx) - src->interval) / 16;
     }
     src->last_rx = now;
     block->i_pts = now; /* store reception time until dequeued */
@@ -335,10 +411,10 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (seq == src->bad_seq)
         {
             src->max_seq = src->bad_seq = seq + 1;
-            src->last_seq = seq - 0x7fffe; /* hack for rtp_decode() */
+            src->last_seq = seq - 1;
             msg_Warn (demux, "sequence resynchronized");
-            block_ChainRelease (src->blocks);
-            src->blocks = NULL;
+            rtp_source_flush (src);
+            block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
         else
         {
@@ -350,23 +426,35 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     if (delta_seq >= 0)
         src->max_seq = seq + 1;
 
-    /* Queues the block in sequence order,
+    /* Queues the block by sequence number,
      * hence there is a single queue for all payload types. */
-    block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    if ((int16_t)(seq - (src->last_seq + 1)) < 0)
+    {   /* Trash too late packets (and PIM Assert duplicates) */
+        msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")", seq);
+        goto drop;
+    }
+    if (rtp_source_get (src, seq) != NULL)
     {
-        int16_t delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
-            break;
-        if (delta_seq == 0)
+        msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+        goto drop; /* duplicate */
+    }
+
+    /* Give up on the oldest packets if the queue is too long */
+    while ((uint16_t)(seq - (src->last_seq + 1)) > src->ring_mask)
+    {
+        if (src->pending == 0)
         {
-            msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
-            goto drop; /* duplicate */
+            uint16_t lost = seq - (src->last_seq + 1);
+            msg_Warn (demux, "%"PRIu16" packet(s) lost", lost);
+            session->lost += lost;
+            var_SetInteger (demux, "rtp-lost", session->lost);
+            src->last_seq = seq - 1;
+            block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            break;
         }
-        pp = &prev->p_next;
+        rtp_decode (demux, session, src);
     }
-    block->p_next = *pp;
-    *pp = block;
+    rtp_source_insert (src, block);
 
     /*rtp_decode (demux, session, src);*/
     return;
@@ -375,8 +463,51 @@ drop:
     block_Release (block);
 }
 
+/**
+ * Receives a SMPTE 2022-1 FEC packet. Not a cancellation point.
+ *
+ * @param demux VLC demux object
+ * @param session RTP session receiving the packet
+ * @param block FEC packet including the RTP header
+ */
+void rtp_queue_fec (demux_t *demux, rtp_session_t *session, block_t *block)
+{
+    if (session->fec == NULL)
+    {
+        session->fec = rtp_fec_create ();
+        if (session->fec == NULL)
+        {
+            block_Release (block);
+            return;
+        }
+        msg_Dbg (demux, "FEC enabled");
+    }
+
+    if (rtp_fec_queue (session->fec, block))
+        msg_Dbg (demux, "invalid FEC packet");
+}
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+/**
+ * Recovers the next packet of a source with FEC.
+ */
+static bool rtp_recover (demux_t *demux, rtp_session_t *session,
+                         rtp_source_t *src, mtime_t now)
+{
+    if (session->fec == NULL)
+        return false;
+
+    uint16_t seq = src->last_seq + 1;
+    block_t *block = rtp_fec_recover (session->fec, seq, rtp_source_get, src);
+    if (block == NULL)
+        return false;
+
+    msg_Dbg (demux, "recovered packet (sequence: %"PRIu16")", seq);
+    block->i_pts = now;
+    rtp_source_insert (src, block);
+    session->recovered++;
+    var_SetInteger (demux, "rtp-recovered", session->recovered);
+    return true;
+}
 
 /**
  * Dequeues RTP packets and pass them to decoder. Not cancellation-safe(?).
@@ -390,7 +521,7 @@ static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
  * @return true if the buffer is not empty, false otherwise.
  * In the later case, *deadlinep is undefined.
  */
-bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
+bool rtp_dequeue (demux_t *demux, rtp_session_t *session,
                   mtime_t *restrict deadlinep)
 {
     mtime_t now = mdate ();
@@ -401,7 +532,6 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
         /* Because of IP packet delay variation (IPDV), we need to guesstimate
          * how long to wait for a missing packet in the RTP sequence
@@ -419,14 +549,17 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
          * LibVLC E/S-out clock synchronization. Here, we need to bother about
          * re-ordering packets, as decoders can't cope with mis-ordered data.
          */
-        while (((block = src->blocks)) != NULL)
+        while (src->pending > 0)
         {
-            if ((int16_t)(rtp_seq (block) - (src->last_seq + 1)) <= 0)
-            {   /* Next (or earlier) block ready, no need to wait */
+            if (rtp_source_get (src, src->last_seq + 1) != NULL
+             || rtp_recover (demux, session, src, now))
+            {   /* Next block ready, no need to wait */
                 rtp_decode (demux, session, src);
                 continue;
             }
 
+            const block_t *block = *rtp_source_first (src);
+
             /* Wait for 3 times the inter-arrival delay variance (about 99.7%
              * match for random gaussian jitter).
              */
@@ -441,6 +574,16 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
             if (deadline < (CLOCK_FREQ / 40))
                 deadline = CLOCK_FREQ / 40;
 
+            /* Wait longer while the FEC packets can still come: they are
+             * sent at most span packets after the missing one */
+            if (session->fec != NULL)
+            {
+                uint16_t span = rtp_fec_span (session->fec);
+
+                if ((uint16_t)(src->max_seq - (src->last_seq + 1)) <= span)
+                    deadline += span * src->interval;
+            }
+
             /* Additionnaly, we implicitly wait for the packetization time
              * multiplied by the number of missing packets. block is the first
              * non-missing packet (lowest sequence number). We have no better
@@ -465,45 +608,77 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
  * Dequeues all RTP packets and pass them to decoder. Not cancellation-safe(?).
  * This function can be used when the packet source is known not to reorder.
  */
-void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
+void rtp_dequeue_force (demux_t *demux, rtp_session_t *session)
 {
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
-        while (((block = src->blocks)) != NULL)
+        while (src->pending > 0)
             rtp_decode (demux, session, src);
     }
 }
 
 /**
- * Decodes one RTP packet.
+ * Decodes the first queued RTP packet.
  */
 static void
-rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
+rtp_decode (demux_t *demux, rtp_session_t *session, rtp_source_t *src)
 {
-    block_t *block = src->blocks;
-
-    assert (block);
-    src->blocks = block->p_next;
-    block->p_next = NULL;
+    block_t **slot = rtp_source_first (src);
+
+    assert (slot != NULL);
+    block_t *block = *slot;
+    src->pending--;
+    *slot = NULL;
+    /* Keep a reference for FEC recovery of the next packets */
+    if (session->fec != NULL)
+    {
+        block = block_Shareable (block);
+        if (unlikely(block == NULL))
+            return;
+        *slot = block_Share (block);
+    }
 
     /* Discontinuity detection */
     uint16_t delta_seq = rtp_seq (block) - (src->last_seq + 1);
     if (delta_seq != 0)
     {
-        if (delta_seq >= 0x8000)
-        {   /* Trash too late packets (and PIM Assert duplicates) */
-            msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
-                      rtp_seq (block));
-            goto drop;
-        }
         msg_Warn (demux, "%"PRIu16" packet(s) lost", delta_seq);
+        session->lost += delta_seq;
+        var_SetInteger (demux, "rtp-lost", session->lost);
         block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
     }
+
+    /* Release the copies that no FEC packet can refer to anymore */
+    if (session->fec != NULL)
+    {
+        uint16_t span = rtp_fec_span (session->fec);
+
+        for (uint16_t seq = src->last_seq - span;
+             seq != (uint16_t)(rtp_seq (block) - span); )
+        {
+            seq++;
+            block_t **old = &src->ring[seq & src->ring_mask];
+            if (*old != NULL && *old != *slot && rtp_seq (*old) == seq)
+            {
+                block_Release (*old);
+                *old = NULL;
+            }
+        }
+    }
     src->last_seq = rtp_seq (block);
 
+    /* Remove padding if present (FEC protects it, so it is kept until now) */
+    if (block->p_buffer[0] & 0x20)
+    {
+        uint8_t padding = block->p_buffer[block->i_buffer - 1];
+        if ((padding == 0) || (block->i_buffer < (12u + padding)))
+            goto drop; /* illegal value */
+
+        block->i_buffer -= padding;
+    }
+
     /* Match the payload type */
     void *pt_data;
     const rtp_pt_t *pt = rtp_find_ptype (session, src, block, &pt_data);
@@ -34,6 +34,7 @@
 #include <time.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 
 #include <vlc_common.h>
@@ -43,6 +44,8 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
+#include <vlc_mime.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -57,6 +60,10 @@
 
 #define MAX_RENAME_RETRIES        10
 
+/* Longest hold of a blocking index reload. It must stay below the inactivity
+ * timeout of the HTTP server clients (10 s), as nothing is sent meanwhile. */
+#define MAX_RELOAD_HOLD           (INT64_C(8) * CLOCK_FREQ)
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -105,6 +112,19 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define MEMORY_TEXT N_("Serve from memory")
+#define MEMORY_LONGTEXT N_("Keep the segments in memory and serve them and " \
+                           "the index with the HTTP server (see --http-host " \
+                           "and --http-port) instead of writing files. The " \
+                           "destination and the index are then URL paths. " \
+                           "Playlist reloads can block until the next " \
+                           "segment or part is available.")
+
+#define PARTLEN_TEXT N_("Part length (ms)")
+#define PARTLEN_LONGTEXT N_("When serving from memory, publish the segments " \
+                            "by parts of this length as they are written, " \
+                            "for low latency clients. 0 disables parts.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +155,10 @@ vlc_module_begin ()
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "memory", false,
+              MEMORY_TEXT, MEMORY_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "partlen", 0,
+                 PARTLEN_TEXT, PARTLEN_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,6 +180,8 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "memory",
+    "partlen",
     NULL
 };
 
@@ -163,6 +189,13 @@ static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
+typedef struct
+{
+    size_t  i_end;        /* offset of the end of the part in the segment */
+    mtime_t i_duration;
+    bool    b_independent;
+} output_part_t;
+
 typedef struct output_segment
 {
     char *psz_filename;
@@ -172,6 +205,17 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+
+    /* When serving from memory, data and parts are protected by the lock of
+     * the access */
+    sout_access_out_sys_t *p_sys;
+    httpd_url_t *p_url;
+    uint8_t *p_data;
+    size_t i_data;
+    size_t i_alloc;
+    output_part_t *p_parts;
+    unsigned i_parts;
+    bool b_complete;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -183,6 +227,7 @@ struct sout_access_out_sys_t
     mtime_t i_keyfile_modification;
     mtime_t i_opendts;
     mtime_t i_dts_offset;
+    mtime_t i_last_dts;
     mtime_t  i_seglenm;
     uint32_t i_segment;
     size_t  i_seglen;
@@ -203,6 +248,24 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t *segments_t;
+
+    /* Serving from memory */
+    httpd_host_t *p_httpd_host;
+    httpd_url_t *p_index_url;
+    output_segment_t *p_curseg;
+    mtime_t i_partlen;
+    mtime_t i_part_dts;
+    mtime_t i_part_end;
+    bool b_part_started;
+    bool b_part_independent;
+
+    /* Published state, read by the HTTP server */
+    vlc_mutex_t lock;
+    char *psz_playlist;
+    size_t i_playlist;
+    uint32_t i_pub_segment; /* last complete segment in the playlist */
+    unsigned i_pub_parts;   /* parts of the following segment */
+    bool b_pub_ended;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -210,6 +273,14 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static int MemoryOpen( sout_access_out_t *p_access );
+static ssize_t memoryWrite( sout_access_out_sys_t *p_sys, const uint8_t *p_data, size_t i_data );
+static void partUpdate( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, const block_t *p_block );
+static void partClose( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_publish );
+static void publishIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                          uint32_t i_firstseg, unsigned i_index_offset, bool b_isend );
+static int SegmentCallback( httpd_callback_sys_t *, httpd_client_t *,
+                            httpd_message_t *, const httpd_message_t * );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -218,6 +289,7 @@ static int Open( vlc_object_t *p_this )
     sout_access_out_t   *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t *p_sys;
     char *psz_idx;
+    bool b_memory;
 
     config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
 
@@ -243,6 +315,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_caching = var_GetBool( p_access, SOUT_CFG_PREFIX "caching") ;
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
     p_sys->b_segment_has_data = false;
+    b_memory = var_GetBool( p_access, SOUT_CFG_PREFIX "memory" );
 
     p_sys->segments_t = vlc_array_new();
 
@@ -252,7 +325,9 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->psz_indexPath = NULL;
     psz_idx = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index" );
-    if ( psz_idx )
+    if ( psz_idx && b_memory )
+        free( psz_idx ); /* an URL path, see MemoryOpen() */
+    else if ( psz_idx )
     {
         char *psz_tmp;
         psz_tmp = str_format_time( psz_idx );
@@ -295,6 +370,22 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
 
+    vlc_mutex_init( &p_sys->lock );
+    if( b_memory && MemoryOpen( p_access ) != VLC_SUCCESS )
+    {
+        vlc_mutex_destroy( &p_sys->lock );
+        if( p_sys->key_uri )
+        {
+            gcry_cipher_close( p_sys->aes_ctx );
+            free( p_sys->key_uri );
+        }
+        vlc_array_destroy( p_sys->segments_t );
+        free( p_sys->psz_keyfile );
+        free( p_sys->psz_indexUrl );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
     p_access->pf_write = Write;
     p_access->pf_seek  = Seek;
     p_access->pf_control = Control;
@@ -504,6 +595,10 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg, bool b_sanitize
 
 static void destroySegment( output_segment_t *segment )
 {
+    if( segment->p_url )
+        httpd_UrlDelete( segment->p_url );
+    free( segment->p_data );
+    free( segment->p_parts );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -554,26 +649,158 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
 }
 
 /************************************************************************
- * updateIndexAndDel: If necessary, update index file & delete old segments
+ * indexFirstSegment: number of the first segment to put in the index,
+ * and its offset in the segment array
  ************************************************************************/
-static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static uint32_t indexFirstSegment( sout_access_out_sys_t *p_sys, unsigned *pi_index_offset )
 {
-
-    uint32_t i_firstseg;
-    unsigned i_index_offset = 0;
+    *pi_index_offset = 0;
 
     if ( p_sys->i_numsegs == 0 ||
          p_sys->i_segment < ( p_sys->i_numsegs + p_sys->i_initial_segment ) )
+        return p_sys->i_initial_segment;
+
+    unsigned numsegs = segmentAmountNeeded( p_sys );
+    *pi_index_offset = vlc_array_count( p_sys->segments_t ) - numsegs;
+    return ( p_sys->i_segment - numsegs ) + 1;
+}
+
+/* Durations of the parts are written in milliseconds, whatever the locale */
+static int printDuration( FILE *fp, mtime_t i_duration )
+{
+    i_duration = ( i_duration + 500 ) / 1000;
+    return fprintf( fp, "%"PRId64".%03u", i_duration / 1000,
+                    (unsigned)( i_duration % 1000 ) );
+}
+
+/************************************************************************
+ * writeParts: write the parts of a segment served from memory
+ ************************************************************************/
+static int writeParts( sout_access_out_sys_t *p_sys, FILE *fp,
+                       const output_segment_t *segment )
+{
+    for( unsigned i = 0; i < segment->i_parts; i++ )
     {
-        i_firstseg = p_sys->i_initial_segment;
+        if( fputs( "#EXT-X-PART:DURATION=", fp ) < 0 ||
+            printDuration( fp, segment->p_parts[i].i_duration ) < 0 ||
+            fprintf( fp, ",URI=\"%s?part=%u\"%s\n", segment->psz_uri, i,
+                     segment->p_parts[i].b_independent ? ",INDEPENDENT=YES" : "" ) < 0 )
+            return -1;
     }
-    else
+    /* Only the segment being written announces its next part */
+    if( segment == p_sys->p_curseg &&
+        fprintf( fp, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s?part=%u\"\n",
+                 segment->psz_uri, segment->i_parts ) < 0 )
+        return -1;
+    return 0;
+}
+
+/************************************************************************
+ * writeIndex: write the index of the segments from i_firstseg
+ ************************************************************************/
+static int writeIndex( sout_access_out_sys_t *p_sys, FILE *fp,
+                       uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    int val;
+
+    if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+                      "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                      p_sys->b_caching ? "YES" : "NO",
+                      p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
+                      i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
+                      ) < 0 )
+        return -1;
+
+    if( p_sys->p_httpd_host )
     {
-        unsigned numsegs = segmentAmountNeeded( p_sys );
-        i_firstseg = ( p_sys->i_segment - numsegs ) + 1;
-        i_index_offset = vlc_array_count( p_sys->segments_t ) - numsegs;
+        /* Clients are expected to stay 3 parts away from the live edge */
+        if( fputs( "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES", fp ) < 0 ||
+            ( p_sys->i_partlen > 0 &&
+              ( fputs( ",PART-HOLD-BACK=", fp ) < 0 ||
+                printDuration( fp, 3 * p_sys->i_partlen ) < 0 ||
+                fputs( "\n#EXT-X-PART-INF:PART-TARGET=", fp ) < 0 ||
+                printDuration( fp, p_sys->i_partlen ) < 0 ) ) ||
+            fputc( '\n', fp ) == EOF )
+            return -1;
     }
 
+    char *psz_current_uri=NULL;
+
+    for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
+    {
+        //scale to i_index_offset..numsegs + i_index_offset
+        uint32_t index = i - i_firstseg + i_index_offset;
+
+        output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
+        if( p_sys->key_uri &&
+            ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
+          )
+        {
+            int ret = 0;
+            free( psz_current_uri );
+            psz_current_uri = strdup( segment->psz_key_uri );
+            if( p_sys->b_generate_iv )
+            {
+                unsigned long long iv_hi = segment->aes_ivs[0];
+                unsigned long long iv_lo = segment->aes_ivs[8];
+                for( unsigned short i = 1; i < 8; i++ )
+                {
+                    iv_hi <<= 8;
+                    iv_hi |= segment->aes_ivs[i] & 0xff;
+                    iv_lo <<= 8;
+                    iv_lo |= segment->aes_ivs[8+i] & 0xff;
+                }
+                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                               segment->psz_key_uri, iv_hi, iv_lo );
+
+            } else {
+                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
+            }
+            if( ret < 0 )
+            {
+                free( psz_current_uri );
+                return -1;
+            }
+        }
+
+        /* Parts are only listed for the last segments */
+        if( p_sys->i_partlen > 0 && i + 2 >= p_sys->i_segment &&
+            writeParts( p_sys, fp, segment ) < 0 )
+        {
+            free( psz_current_uri );
+            return -1;
+        }
+
+        /* The segment being written has no duration yet */
+        if( !segment->psz_duration )
+            continue;
+
+        val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
+        if ( val < 0 )
+        {
+            free( psz_current_uri );
+            return -1;
+        }
+    }
+    free( psz_current_uri );
+
+    if ( b_isend && fputs ( STR_ENDLIST, fp ) < 0 )
+        return -1;
+
+    return 0;
+}
+
+/************************************************************************
+ * updateIndexAndDel: If necessary, update index file & delete old segments
+ ************************************************************************/
+static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+
+    uint32_t i_firstseg;
+    unsigned i_index_offset;
+
+    i_firstseg = indexFirstSegment( p_sys, &i_index_offset );
+
     // First update index
     if ( p_sys->psz_indexPath )
     {
@@ -591,80 +818,12 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             return -1;
         }
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
-                          p_sys->b_caching ? "YES" : "NO",
-                          p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
+        if ( writeIndex( p_sys, fp, i_firstseg, i_index_offset, b_isend ) < 0 )
         {
             free( psz_idxTmp );
             fclose( fp );
             return -1;
         }
-        char *psz_current_uri=NULL;
-
-
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            //scale to i_index_offset..numsegs + i_index_offset
-            uint32_t index = i - i_firstseg + i_index_offset;
-
-            output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
-            if( p_sys->key_uri &&
-                ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
-              )
-            {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
-                if( p_sys->b_generate_iv )
-                {
-                    unsigned long long iv_hi = segment->aes_ivs[0];
-                    unsigned long long iv_lo = segment->aes_ivs[8];
-                    for( unsigned short i = 1; i < 8; i++ )
-                    {
-                        iv_hi <<= 8;
-                        iv_hi |= segment->aes_ivs[i] & 0xff;
-                        iv_lo <<= 8;
-                        iv_lo |= segment->aes_ivs[8+i] & 0xff;
-                    }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
-
-                } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
-                }
-                if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
-                }
-            }
-
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-        }
-        free( psz_current_uri );
-
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
-
-        }
         fclose( fp );
 
         val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
@@ -679,6 +838,8 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
 
         free( psz_idxTmp );
     }
+    else if ( p_sys->p_httpd_host )
+        publishIndex( p_access, p_sys, i_firstseg, i_index_offset, b_isend );
 
     // Then take care of deletion
     // Try to follow pantos draft 11 section 6.2.2
@@ -690,7 +851,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
          msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
+         if ( segment->psz_filename && !p_sys->p_httpd_host )
          {
              vlc_unlink( segment->psz_filename );
          }
@@ -703,12 +864,24 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+static inline bool segmentIsOpen( const sout_access_out_sys_t *p_sys )
+{
+    return p_sys->i_handle >= 0 || p_sys->p_curseg != NULL;
+}
+
+static ssize_t segmentWrite( sout_access_out_sys_t *p_sys, const uint8_t *p_data, size_t i_data )
+{
+    if( p_sys->p_curseg )
+        return memoryWrite( p_sys, p_data, i_data );
+    return write( p_sys->i_handle, p_data, i_data );
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( segmentIsOpen( p_sys ) )
     {
         output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, vlc_array_count( p_sys->segments_t ) - 1 );
 
@@ -721,7 +894,7 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
             if( err ) {
                msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
             } else {
-            int ret = write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
+            int ret = segmentWrite( p_sys, p_sys->stuffing_bytes, 16 );
             if( ret != 16 )
                 msg_Err( p_access, "Couldn't write 16 bytes" );
             }
@@ -729,8 +902,21 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
         }
 
 
-        close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        if( p_sys->p_curseg )
+        {
+            if( p_sys->b_part_started )
+                partClose( p_access, p_sys, false );
+
+            vlc_mutex_lock( &p_sys->lock );
+            p_sys->p_curseg->b_complete = true;
+            vlc_mutex_unlock( &p_sys->lock );
+            p_sys->p_curseg = NULL;
+        }
+        else
+        {
+            close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
 
         if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
         {
@@ -808,7 +994,8 @@ static void Close( vlc_object_t * p_this )
     {
         output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t, 0 );
         vlc_array_remove( p_sys->segments_t, 0 );
-        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename )
+        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename &&
+            !p_sys->p_httpd_host )
         {
             msg_Dbg( p_access, "Removing segment number %d name %s", segment->i_segment_number, segment->psz_filename );
             vlc_unlink( segment->psz_filename );
@@ -818,6 +1005,15 @@ static void Close( vlc_object_t * p_this )
     }
     vlc_array_destroy( p_sys->segments_t );
 
+    if( p_sys->p_httpd_host )
+    {
+        httpd_UrlDelete( p_sys->p_index_url );
+        httpd_HostDelete( p_sys->p_httpd_host );
+    }
+    free( p_sys->psz_playlist );
+    vlc_mutex_destroy( &p_sys->lock );
+
+    free( p_sys->psz_keyfile );
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -850,7 +1046,7 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
  *****************************************************************************/
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
 {
-    int fd;
+    int fd = 0;
 
     uint32_t i_newseg = p_sys->i_segment + 1;
 
@@ -860,7 +1056,8 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
 
     segment->i_segment_number = i_newseg;
-    segment->psz_filename = formatSegmentPath( p_access->psz_path, i_newseg, true );
+    segment->psz_filename = formatSegmentPath( p_access->psz_path, i_newseg,
+                                               !p_sys->p_httpd_host );
     char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
     segment->psz_uri = formatSegmentPath( psz_idxFormat , i_newseg, false );
 
@@ -871,8 +1068,25 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
+    if( p_sys->p_httpd_host )
+    {
+        segment->p_sys = p_sys;
+        segment->p_url = httpd_UrlNew( p_sys->p_httpd_host,
+                                       segment->psz_filename, NULL, NULL );
+        if( !segment->p_url )
+        {
+            msg_Err( p_access, "cannot add segment `%s'", segment->psz_filename );
+            destroySegment( segment );
+            return -1;
+        }
+        httpd_UrlCatch( segment->p_url, HTTPD_MSG_GET, SegmentCallback,
+                        (httpd_callback_sys_t *)segment );
+        httpd_UrlCatch( segment->p_url, HTTPD_MSG_HEAD, SegmentCallback,
+                        (httpd_callback_sys_t *)segment );
+    }
+    else
+        fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
+                         O_TRUNC, 0666 );
     if ( fd == -1 )
     {
         msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
@@ -898,7 +1112,13 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     msg_Dbg( p_access, "Successfully opened livehttp file: %s (%"PRIu32")" , segment->psz_filename, i_newseg );
 
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
-    p_sys->i_handle = fd;
+    if( p_sys->p_httpd_host )
+    {
+        p_sys->p_curseg = segment;
+        p_sys->b_part_started = false;
+    }
+    else
+        p_sys->i_handle = fd;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
     return fd;
@@ -915,22 +1135,27 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
      * better count of actual duration */
     if( unlikely( p_buffer->i_dts < p_sys->i_opendts ) )
     {
+        mtime_t i_last_dts = p_sys->i_last_dts;
         block_t *last_buffer = p_sys->block_buffer;
-        while( last_buffer->p_next )
-            last_buffer = last_buffer->p_next;
-        p_sys->i_dts_offset += last_buffer->i_dts - p_sys->i_opendts;
+        if( last_buffer )
+        {
+            while( last_buffer->p_next )
+                last_buffer = last_buffer->p_next;
+            i_last_dts = last_buffer->i_dts;
+        }
+        p_sys->i_dts_offset += i_last_dts - p_sys->i_opendts;
         p_sys->i_opendts    = p_buffer->i_dts;
         msg_Dbg( p_access, "dts offset %"PRId64, p_sys->i_dts_offset );
     }
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
+    if( segmentIsOpen( p_sys ) && p_sys->b_segment_has_data &&
        (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts +
           p_sys->i_dts_offset ) >= p_sys->i_seglenm ) )
     {
         closeCurrentSegment( p_access, p_sys, false );
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    if ( unlikely( !segmentIsOpen( p_sys ) ) )
     {
         p_sys->i_dts_offset = 0;
         p_sys->i_opendts = output ? output->i_dts : p_buffer->i_dts;
@@ -948,7 +1173,9 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
 static ssize_t writeSegment( sout_access_out_t *p_access )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    block_t *output = p_sys->block_buffer ? block_ChainGather( p_sys->block_buffer ) : NULL;
+    /* Parts are cut between the blocks of the muxer */
+    block_t *output = p_sys->block_buffer && p_sys->i_partlen == 0 ?
+                      block_ChainGather( p_sys->block_buffer ) : p_sys->block_buffer;
     p_sys->block_buffer = NULL;
     ssize_t i_write=0;
     bool crypted = false;
@@ -984,7 +1211,7 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
             crypted=true;
 
         }
-        ssize_t val = write( p_sys->i_handle, output->p_buffer, output->i_buffer );
+        ssize_t val = segmentWrite( p_sys, output->p_buffer, output->i_buffer );
         if ( val == -1 )
         {
            if ( errno == EINTR )
@@ -999,6 +1226,9 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
         if ( (size_t)val >= output->i_buffer )
         {
            block_t *p_next = output->p_next;
+           p_sys->i_last_dts = output->i_dts;
+           if( p_sys->i_partlen > 0 )
+               partUpdate( p_access, p_sys, output );
            block_Release (output);
            output = p_next;
            crypted=false;
@@ -1045,6 +1275,18 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         p_buffer->p_next = NULL;
         block_ChainAppend( &p_sys->block_buffer, p_buffer );
         p_buffer = p_temp;
+
+        /* Publish the data as soon as it comes when serving from memory */
+        if( p_sys->p_curseg )
+        {
+            ssize_t writevalue = writeSegment( p_access );
+            if( unlikely( writevalue < 0 ) )
+            {
+                block_ChainRelease ( p_buffer );
+                return -1;
+            }
+            i_write += writevalue;
+        }
     }
 
     return i_write;
@@ -1059,3 +1301,439 @@ static int Seek( sout_access_out_t *p_access, off_t i_pos )
     msg_Err( p_access, "livehttp sout access cannot seek" );
     return -1;
 }
+
+/*****************************************************************************
+ * Serving from memory
+ *****************************************************************************
+ * The segments are kept in memory while they are in the index and are
+ * served by the HTTP server with the index. The segment being written is
+ * sent to the clients as its data comes (chunked), and it is also published
+ * by parts of about partlen for the low latency clients. The index reloads
+ * can ask for a segment or part not published yet, and then wait for it.
+ *****************************************************************************/
+static ssize_t memoryWrite( sout_access_out_sys_t *p_sys, const uint8_t *p_data, size_t i_data )
+{
+    output_segment_t *segment = p_sys->p_curseg;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( segment->i_data + i_data > segment->i_alloc )
+    {
+        size_t i_alloc = __MAX( 2 * segment->i_alloc, segment->i_data + i_data );
+        uint8_t *p_realloc = realloc( segment->p_data, i_alloc );
+        if( unlikely( p_realloc == NULL ) )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            errno = ENOMEM;
+            return -1;
+        }
+        segment->p_data = p_realloc;
+        segment->i_alloc = i_alloc;
+    }
+    memcpy( &segment->p_data[segment->i_data], p_data, i_data );
+    segment->i_data += i_data;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_data;
+}
+
+/*****************************************************************************
+ * partUpdate: account a block written to the current part
+ *****************************************************************************/
+static void partUpdate( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, const block_t *p_block )
+{
+    if( !p_sys->p_curseg || p_block->i_dts <= VLC_TS_INVALID )
+        return;
+
+    if( !p_sys->b_part_started )
+    {
+        p_sys->b_part_started = true;
+        p_sys->b_part_independent = p_sys->b_splitanywhere ||
+                                    ( p_block->i_flags & BLOCK_FLAG_HEADER );
+        p_sys->i_part_dts = p_block->i_dts;
+        p_sys->i_part_end = p_block->i_dts;
+    }
+    p_sys->i_part_end = __MAX( p_sys->i_part_end, p_block->i_dts + p_block->i_length );
+
+    if( p_sys->i_part_end - p_sys->i_part_dts >= p_sys->i_partlen )
+        partClose( p_access, p_sys, true );
+}
+
+/*****************************************************************************
+ * partClose: publish the current part
+ *****************************************************************************/
+static void partClose( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_publish )
+{
+    output_segment_t *segment = p_sys->p_curseg;
+    output_part_t part = {
+        .i_end = segment->i_data,
+        .i_duration = p_sys->i_part_end - p_sys->i_part_dts,
+        .b_independent = p_sys->b_part_independent,
+    };
+
+    p_sys->b_part_started = false;
+
+    vlc_mutex_lock( &p_sys->lock );
+    output_part_t *p_parts = realloc( segment->p_parts,
+                                      ( segment->i_parts + 1 ) * sizeof( *p_parts ) );
+    if( likely( p_parts != NULL ) )
+    {
+        p_parts[segment->i_parts++] = part;
+        segment->p_parts = p_parts;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    if( likely( p_parts != NULL ) && b_publish )
+    {
+        unsigned i_index_offset;
+        uint32_t i_firstseg = indexFirstSegment( p_sys, &i_index_offset );
+        publishIndex( p_access, p_sys, i_firstseg, i_index_offset, false );
+    }
+}
+
+/*****************************************************************************
+ * publishIndex: replace the index served by the HTTP server
+ *****************************************************************************/
+static void publishIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                          uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    char *psz_playlist = NULL;
+    size_t i_playlist = 0;
+    int i_ret;
+
+#ifdef HAVE_OPEN_MEMSTREAM
+    FILE *fp = open_memstream( &psz_playlist, &i_playlist );
+    if( fp == NULL )
+        return;
+    i_ret = writeIndex( p_sys, fp, i_firstseg, i_index_offset, b_isend );
+    if( fclose( fp ) )
+        return;
+#else
+    FILE *fp = tmpfile();
+    if( fp == NULL )
+        return;
+    i_ret = writeIndex( p_sys, fp, i_firstseg, i_index_offset, b_isend );
+    long i_len = ftell( fp );
+    if( i_ret == 0 && i_len >= 0 &&
+        ( psz_playlist = malloc( i_len + 1 ) ) != NULL )
+    {
+        rewind( fp );
+        i_playlist = fread( psz_playlist, 1, i_len, fp );
+        psz_playlist[i_playlist] = '\0';
+    }
+    fclose( fp );
+#endif
+    if( i_ret < 0 || psz_playlist == NULL )
+    {
+        msg_Err( p_access, "cannot write index" );
+        free( psz_playlist );
+        return;
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+    char *psz_old = p_sys->psz_playlist;
+    p_sys->psz_playlist = psz_playlist;
+    p_sys->i_playlist = i_playlist;
+    if( p_sys->p_curseg )
+    {
+        p_sys->i_pub_segment = p_sys->p_curseg->i_segment_number - 1;
+        p_sys->i_pub_parts = p_sys->p_curseg->i_parts;
+    }
+    else
+    {
+        p_sys->i_pub_segment = p_sys->i_segment;
+        p_sys->i_pub_parts = 0;
+    }
+    p_sys->b_pub_ended = b_isend;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    free( psz_old );
+}
+
+/* Sets the body of an answer sent while its data comes */
+static void answerChunk( httpd_message_t *answer, bool b_chunked,
+                         const uint8_t *p_data, size_t i_data, bool b_last )
+{
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    if( !b_chunked )
+    {
+        answer->i_body = i_data;
+        answer->p_body = i_data > 0 ? xmalloc( i_data ) : NULL;
+        if( i_data > 0 )
+            memcpy( answer->p_body, p_data, i_data );
+        return;
+    }
+
+    /* size line, data, CRLF and the last chunk */
+    uint8_t *p = xmalloc( 18 + i_data + 2 + 5 );
+    size_t i_len = 0;
+    if( i_data > 0 )
+    {
+        i_len = sprintf( (char *)p, "%zx\r\n", i_data );
+        memcpy( &p[i_len], p_data, i_data );
+        i_len += i_data;
+        memcpy( &p[i_len], "\r\n", 2 );
+        i_len += 2;
+    }
+    if( b_last )
+    {
+        memcpy( &p[i_len], "0\r\n\r\n", 5 );
+        i_len += 5;
+    }
+    answer->p_body = p;
+    answer->i_body = i_len;
+}
+
+static void answerStatus( httpd_message_t *answer, int i_status )
+{
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = i_status;
+    answer->i_body   = 0;
+    answer->p_body   = NULL;
+    httpd_MsgAdd( answer, "Content-Length", "0" );
+}
+
+/*****************************************************************************
+ * SegmentCallback: serve a segment, or one of its parts
+ *****************************************************************************
+ * answer->i_body_offset is 1 + the position of the next data to send while
+ * the segment is being written.
+ *****************************************************************************/
+static int SegmentCallback( httpd_callback_sys_t *p_cbsys, httpd_client_t *cl,
+                            httpd_message_t *answer, const httpd_message_t *query )
+{
+    output_segment_t *segment = (output_segment_t *)p_cbsys;
+    sout_access_out_sys_t *p_sys = segment->p_sys;
+
+    if( answer == NULL || query == NULL || cl == NULL )
+        return VLC_SUCCESS;
+
+    bool b_new = answer->i_body_offset == 0;
+    bool b_chunked = query->i_version > 0;
+    unsigned i_part = UINT_MAX;
+    if( query->psz_args )
+        sscanf( (const char *)query->psz_args, "part=%u", &i_part );
+
+    vlc_mutex_lock( &p_sys->lock );
+    size_t i_start = 0, i_end = segment->i_data;
+    bool b_complete = segment->b_complete;
+    if( i_part != UINT_MAX )
+    {
+        /* Only the published parts and the next one exist */
+        if( i_part > segment->i_parts ||
+            ( i_part == segment->i_parts && b_complete ) )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            if( b_new )
+                answerStatus( answer, 404 );
+            else /* the hinted part was never written */
+            {
+                answerChunk( answer, b_chunked, NULL, 0, true );
+                answer->i_body_offset = 0;
+            }
+            return VLC_SUCCESS;
+        }
+        if( i_part > 0 )
+            i_start = segment->p_parts[i_part - 1].i_end;
+        if( i_part < segment->i_parts )
+        {
+            i_end = segment->p_parts[i_part].i_end;
+            b_complete = true;
+        }
+    }
+
+    if( b_new )
+    {
+        answer->i_proto  = HTTPD_PROTO_HTTP;
+        answer->i_version= 1;
+        answer->i_type   = HTTPD_MSG_ANSWER;
+        answer->i_status = 200;
+        httpd_MsgAdd( answer, "Content-Type", "%s",
+                      vlc_mime_Ext2Mime( segment->psz_filename ) );
+
+        if( b_complete )
+        {
+            httpd_MsgAdd( answer, "Content-Length", "%zu", i_end - i_start );
+            if( query->i_type != HTTPD_MSG_HEAD )
+                answerChunk( answer, false, &segment->p_data[i_start],
+                             i_end - i_start, true );
+            vlc_mutex_unlock( &p_sys->lock );
+            return VLC_SUCCESS;
+        }
+        if( query->i_type == HTTPD_MSG_HEAD )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            return VLC_SUCCESS;
+        }
+
+        httpd_ClientModeStream( cl );
+        if( b_chunked )
+            httpd_MsgAdd( answer, "Transfer-Encoding", "chunked" );
+        else
+            httpd_MsgAdd( answer, "Connection", "close" );
+        answer->i_body_offset = 1 + i_start;
+    }
+
+    size_t i_pos = answer->i_body_offset - 1;
+    if( i_pos >= i_end && !b_complete )
+    {
+        /* Wait for more data */
+        vlc_mutex_unlock( &p_sys->lock );
+        return b_new ? VLC_SUCCESS : VLC_EGENERIC;
+    }
+
+    answerChunk( answer, b_chunked, &segment->p_data[i_pos], i_end - i_pos,
+                 b_complete );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    answer->i_body_offset = b_complete ? 0 : 1 + i_end;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * PlaylistCallback: serve the index, blocking reloads until it is updated
+ *****************************************************************************/
+static int PlaylistCallback( httpd_callback_sys_t *p_cbsys, httpd_client_t *cl,
+                             httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)p_cbsys;
+
+    if( answer == NULL || query == NULL || cl == NULL )
+        return VLC_SUCCESS;
+
+    bool b_chunked = query->i_version > 0;
+    int64_t i_msn = -1, i_part = -1;
+    if( query->psz_args && query->i_type != HTTPD_MSG_HEAD )
+    {
+        const char *psz_args = (const char *)query->psz_args;
+        const char *psz = strstr( psz_args, "_HLS_msn=" );
+        if( psz )
+            i_msn = strtoll( psz + 9, NULL, 10 );
+        psz = strstr( psz_args, "_HLS_part=" );
+        if( psz )
+            i_part = strtoll( psz + 10, NULL, 10 );
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_ready = i_msn < 0 || p_sys->b_pub_ended ||
+                   i_msn <= p_sys->i_pub_segment ||
+                   ( i_msn == p_sys->i_pub_segment + 1 && i_part >= 0 &&
+                     i_part < p_sys->i_pub_parts );
+
+    if( answer->i_body_offset == 0 )
+    {
+        if( b_ready && p_sys->psz_playlist == NULL )
+            answerStatus( answer, 404 );
+        else if( !b_ready && i_msn > p_sys->i_pub_segment + 2 )
+            answerStatus( answer, 400 );
+        else
+        {
+            answer->i_proto  = HTTPD_PROTO_HTTP;
+            answer->i_version= 1;
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_status = 200;
+            httpd_MsgAdd( answer, "Content-Type", "application/vnd.apple.mpegurl" );
+            httpd_MsgAdd( answer, "Cache-Control", "no-cache" );
+            if( b_ready )
+            {
+                httpd_MsgAdd( answer, "Content-Length", "%zu", p_sys->i_playlist );
+                if( query->i_type != HTTPD_MSG_HEAD )
+                    answerChunk( answer, false, (uint8_t *)p_sys->psz_playlist,
+                                 p_sys->i_playlist, true );
+            }
+            else
+            {
+                /* Hold the request, at most 3 target durations, with the
+                 * deadline as offset, but not until the client times out */
+                httpd_ClientModeStream( cl );
+                if( b_chunked )
+                    httpd_MsgAdd( answer, "Transfer-Encoding", "chunked" );
+                else
+                    httpd_MsgAdd( answer, "Connection", "close" );
+                answer->i_body_offset = mdate() +
+                    __MIN( 3 * p_sys->i_seglenm, MAX_RELOAD_HOLD );
+            }
+        }
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_SUCCESS;
+    }
+
+    if( !b_ready && mdate() < answer->i_body_offset )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_EGENERIC;
+    }
+
+    answerChunk( answer, b_chunked, (uint8_t *)p_sys->psz_playlist,
+                 p_sys->i_playlist, true );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    answer->i_body_offset = 0;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * MemoryOpen: set up the serving of the segments from memory
+ *****************************************************************************/
+static int MemoryOpen( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_access->psz_path[0] != '/' )
+    {
+        msg_Err( p_access, "segment URL path must start with /" );
+        return VLC_EGENERIC;
+    }
+
+    char *psz_index = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index" );
+    if( psz_index == NULL || psz_index[0] != '/' )
+    {
+        msg_Err( p_access, "an index URL path is needed to serve from memory" );
+        free( psz_index );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( p_sys->p_httpd_host == NULL )
+    {
+        msg_Err( p_access, "cannot start HTTP server" );
+        free( psz_index );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_index_url = httpd_UrlNew( p_sys->p_httpd_host, psz_index, NULL, NULL );
+    if( p_sys->p_index_url == NULL )
+    {
+        msg_Err( p_access, "cannot add index `%s'", psz_index );
+        free( psz_index );
+        httpd_HostDelete( p_sys->p_httpd_host );
+        p_sys->p_httpd_host = NULL;
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_access, "serving index %s from memory", psz_index );
+    free( psz_index );
+
+    httpd_UrlCatch( p_sys->p_index_url, HTTPD_MSG_GET, PlaylistCallback,
+                    (httpd_callback_sys_t *)p_sys );
+    httpd_UrlCatch( p_sys->p_index_url, HTTPD_MSG_HEAD, PlaylistCallback,
+                    (httpd_callback_sys_t *)p_sys );
+
+    /* Memory is given back as the segments leave the index */
+    if( p_sys->i_numsegs == 0 )
+        p_sys->i_numsegs = 3;
+    p_sys->b_delsegs = true;
+
+    p_sys->i_partlen = 1000 * var_GetInteger( p_access, SOUT_CFG_PREFIX "partlen" );
+    if( p_sys->i_partlen > 0 && ( p_sys->key_uri || p_sys->psz_keyfile ) )
+    {
+        msg_Warn( p_access, "parts are not available with encryption" );
+        p_sys->i_partlen = 0;
+    }
+    p_sys->i_pub_segment = p_sys->i_initial_segment - 1;
+
+    return VLC_SUCCESS;
+}
@@ -51,6 +51,9 @@
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Flags the buffers queued as they were written, which are not recycled */
+#define BLOCK_FLAG_UDP_DIRECT (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -109,6 +112,7 @@ static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
+static void RecycleUDPPacket( sout_access_out_t *, block_t * );
 
 struct sout_access_out_sys_t
 {
@@ -303,6 +307,27 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         }
 
         i_len += p_buffer->i_buffer;
+
+        /* A buffer filling more than half a datagram (such as the groups of
+         * TS packets of the TS muxer) could not be grouped with another one
+         * of its size: it is queued without copy */
+        if( p_sys->p_buffer == NULL && p_buffer->i_buffer <= p_sys->i_mtu &&
+            p_buffer->i_buffer * 2 > p_sys->i_mtu )
+        {
+            if( p_buffer->i_dts + p_sys->i_caching < now )
+            {
+                msg_Dbg( p_access, "late packet for udp input (%"PRId64 ")",
+                         now - p_buffer->i_dts - p_sys->i_caching );
+            }
+            p_next = p_buffer->p_next;
+            p_buffer->p_next = NULL;
+            p_buffer->i_flags = ( p_buffer->i_flags & ~BLOCK_FLAG_PRIVATE_MASK )
+                              | BLOCK_FLAG_UDP_DIRECT;
+            block_FifoPut( p_sys->p_fifo, p_buffer );
+            p_buffer = p_next;
+            continue;
+        }
+
         while( p_buffer->i_buffer )
         {
             size_t i_payload_size = p_sys->i_mtu;
@@ -392,6 +417,19 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * RecycleUDPPacket: keep a sent packet for NewUDPPacket
+ *****************************************************************************/
+static void RecycleUDPPacket( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_buffer->i_flags & BLOCK_FLAG_UDP_DIRECT )
+        block_Release( p_buffer );
+    else
+        block_FifoPut( p_sys->p_empty_blocks, p_buffer );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -419,7 +457,7 @@ static void* ThreadWrite( void *data )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                RecycleUDPPacket( p_access, p_pk );
 
                 i_date_last = i_date;
                 i_dropped_packets++;
@@ -459,7 +497,7 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+        RecycleUDPPacket( p_access, p_pk );
 
         i_date_last = i_date;
     }
@@ -841,6 +841,16 @@ int OpenEncoder( vlc_object_t *p_this )
         options = vlc_av_get_options(psz_opts);
     free(psz_opts);
 
+    /* Fixed GOP, so that streams encoded from the same pictures get their
+     * key frames at the same time */
+    if( p_enc->fmt_in.i_cat == VIDEO_ES && p_enc->i_iframes > 0 )
+    {
+        p_context->gop_size = p_enc->i_iframes;
+        p_context->keyint_min = p_enc->i_iframes;
+        p_context->flags |= CODEC_FLAG_CLOSED_GOP;
+        av_dict_set( &options, "sc_threshold", "1000000000", 0 );
+    }
+
     vlc_avcodec_lock();
     ret = avcodec_open2( p_context, p_codec, options ? &options : NULL );
     vlc_avcodec_unlock();
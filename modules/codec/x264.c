@@ -1397,6 +1397,19 @@ static int  Open ( vlc_object_t *p_this )
     }
     free(psz_opts);
 
+    /* Fixed GOP, so that streams encoded from the same pictures get their
+     * key frames at the same time */
+    if( p_enc->i_iframes > 0 )
+    {
+        p_sys->param.i_keyint_max = p_enc->i_iframes;
+        p_sys->param.i_keyint_min = p_enc->i_iframes;
+        p_sys->param.i_scenecut_threshold = 0;
+#if X264_BUILD >= 115
+        p_sys->param.b_open_gop = false;
+#endif
+        p_sys->param.b_intra_refresh = false;
+    }
+
     /* Open the encoder */
     p_sys->h = x264_encoder_open( &p_sys->param );
 
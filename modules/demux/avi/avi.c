@@ -30,6 +30,7 @@
 #endif
 #include <assert.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -42,6 +43,7 @@
 #include <vlc_codecs.h>
 #include <vlc_charset.h>
 #include <vlc_memory.h>
+#include <vlc_fs.h>
 
 #include "libavi.h"
 #include "../rawdv.h"
@@ -57,6 +59,16 @@
     "Recreate a index for the AVI file. Use this if your AVI file is damaged "\
     "or incomplete (not seekable)." )
 
+#define INDEX_BACKGROUND_TEXT N_("Fix index in the background")
+#define INDEX_BACKGROUND_LONGTEXT N_( \
+    "Recreate the index while playing instead of before starting playback. " \
+    "Seeking becomes precise as the index gets recreated." )
+
+#define INDEX_FILE_TEXT N_("Save fixed index")
+#define INDEX_FILE_LONGTEXT N_( \
+    "Save the recreated index next to the file (.aviindex) and reuse it " \
+    "as long as the file is not modified." )
+
 #define BI_RAWRGB 0x00
 #define BI_RGBBITFIELDS 0x03
 
@@ -82,6 +94,10 @@ vlc_module_begin ()
     add_integer( "avi-index", 0,
               INDEX_TEXT, INDEX_LONGTEXT, false )
         change_integer_list( pi_index, ppsz_indexes )
+    add_bool( "avi-index-background", true,
+              INDEX_BACKGROUND_TEXT, INDEX_BACKGROUND_LONGTEXT, true )
+    add_bool( "avi-index-file", false,
+              INDEX_FILE_TEXT, INDEX_FILE_LONGTEXT, true )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -137,6 +153,11 @@ static void avi_index_Init( avi_index_t * );
 static void avi_index_Clean( avi_index_t * );
 static void avi_index_Append( avi_index_t *, off_t *, avi_entry_t * );
 
+typedef struct avi_indexer_t avi_indexer_t;
+
+/* Stream numbers are two decimal digits (00dc, 01wb...) */
+#define AVI_TRACK_MAX 100
+
 typedef struct
 {
     bool            b_activated;
@@ -195,6 +216,9 @@ struct demux_sys_t
 
     unsigned int       i_attachment;
     input_attachment_t **attachment;
+
+    /* index recreated in the background */
+    avi_indexer_t *p_indexer;
 };
 
 static inline off_t __EVEN( off_t i )
@@ -217,13 +241,20 @@ static int AVI_StreamBytesSet ( demux_t *,
 vlc_fourcc_t AVI_FourccGetCodec( unsigned int i_cat, vlc_fourcc_t );
 static int   AVI_GetKeyFlag    ( vlc_fourcc_t , uint8_t * );
 
-static int AVI_PacketGetHeader( demux_t *, avi_packet_t *p_pk );
-static int AVI_PacketNext     ( demux_t * );
+static int AVI_PacketGetHeader( stream_t *, avi_packet_t *p_pk );
+static int AVI_PacketNext     ( stream_t * );
 static int AVI_PacketRead     ( demux_t *, avi_packet_t *, block_t **);
-static int AVI_PacketSearch   ( demux_t * );
+static int AVI_PacketSearch   ( stream_t *, unsigned int i_track,
+                                bool (*pf_continue)( void *, off_t ),
+                                void *p_data );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static int  AVI_IndexFileLoad( demux_t * );
+
+static void AVI_IndexerStart ( demux_t * );
+static void AVI_IndexerMerge ( demux_t * );
+static void AVI_IndexerStop  ( avi_indexer_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -363,6 +394,12 @@ static int Open( vlc_object_t * p_this )
         msg_Err( p_demux, "no stream defined!" );
         goto error;
     }
+    if( i_track > AVI_TRACK_MAX )
+    {
+        msg_Warn( p_demux, "only the first %d streams are used",
+                  AVI_TRACK_MAX );
+        i_track = AVI_TRACK_MAX;
+    }
 
     /* print information on streams */
     msg_Dbg( p_demux, "AVIH: %d stream, flags %s%s%s%s ",
@@ -684,10 +721,22 @@ static int Open( vlc_object_t * p_this )
     }
 
     i_do_index = var_InheritInteger( p_demux, "avi-index" );
-    if( i_do_index == 1 ) /* Always fix */
+    if( i_do_index != 2 && AVI_IndexFileLoad( p_demux ) == VLC_SUCCESS )
+    {
+        b_index = true; /* fixed when opened previously */
+    }
+    else if( i_do_index == 1 ) /* Always fix */
     {
 aviindex:
-        if( p_sys->b_fastseekable )
+        if( p_sys->b_fastseekable &&
+            var_InheritBool( p_demux, "avi-index-background" ) )
+        {
+            /* Play with what the file provides until the index is ready */
+            if( !b_index )
+                AVI_IndexLoad( p_demux );
+            AVI_IndexerStart( p_demux );
+        }
+        else if( p_sys->b_fastseekable )
         {
             AVI_IndexCreate( p_demux );
         }
@@ -827,6 +876,9 @@ static void Close ( vlc_object_t * p_this )
     demux_t *    p_demux = (demux_t *)p_this;
     demux_sys_t *p_sys = p_demux->p_sys  ;
 
+    if( p_sys->p_indexer )
+        AVI_IndexerStop( p_sys->p_indexer );
+
     for( unsigned int i = 0; i < p_sys->i_track; i++ )
     {
         if( p_sys->track[i] )
@@ -950,8 +1002,7 @@ static int Demux_Seekable( demux_t *p_demux )
 
     unsigned int i_track_count = 0;
     unsigned int i_track;
-    /* cannot be more than 100 stream (dcXX or wbXX) */
-    avi_track_toread_t toread[100];
+    avi_track_toread_t toread[AVI_TRACK_MAX];
 
 
     /* detect new selected/unselected streams */
@@ -1090,7 +1141,7 @@ static int Demux_Seekable( demux_t *p_demux )
             if( p_sys->b_seekable && p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
             {
                 stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return( AVI_TrackStopFinishedStreams( p_demux ) ? 0 : 1 );
                 }
@@ -1104,7 +1155,7 @@ static int Demux_Seekable( demux_t *p_demux )
             {
                 avi_packet_t avi_pk;
 
-                if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+                if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
                 {
                     msg_Warn( p_demux,
                              "cannot get packet header, track disabled" );
@@ -1113,7 +1164,7 @@ static int Demux_Seekable( demux_t *p_demux )
                 if( avi_pk.i_stream >= p_sys->i_track ||
                     ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
                 {
-                    if( AVI_PacketNext( p_demux ) )
+                    if( AVI_PacketNext( p_demux->s ) )
                     {
                         msg_Warn( p_demux,
                                   "cannot skip packet, track disabled" );
@@ -1154,7 +1205,7 @@ static int Demux_Seekable( demux_t *p_demux )
                     }
                     else
                     {
-                        if( AVI_PacketNext( p_demux ) )
+                        if( AVI_PacketNext( p_demux->s ) )
                         {
                             msg_Warn( p_demux,
                                       "cannot skip packet, track disabled" );
@@ -1334,7 +1385,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
 
         avi_packet_t    avi_pk;
 
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             return( 0 );
         }
@@ -1351,17 +1402,18 @@ static int Demux_UnSeekable( demux_t *p_demux )
                 case AVIFOURCC_JUNK:
                 case AVIFOURCC_LIST:
                 case AVIFOURCC_RIFF:
-                    return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                    return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                 case AVIFOURCC_idx1:
                     if( p_sys->b_odml )
                     {
-                        return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                        return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                     }
                     return( 0 );    /* eof */
                 default:
                     msg_Warn( p_demux,
                               "seems to have lost position, resync" );
-                    if( AVI_PacketSearch( p_demux ) )
+                    if( AVI_PacketSearch( p_demux->s, p_sys->i_track,
+                                          NULL, NULL ) )
                     {
                         msg_Err( p_demux, "resync failed" );
                         return( -1 );
@@ -1396,7 +1448,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
             }
             else
             {
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return( 0 );
                 }
@@ -1458,6 +1510,8 @@ static int Seek( demux_t *p_demux, mtime_t i_date, int i_percent )
             p_sys->b_indexloaded = true; /* we don't want to try each time */
         }
 
+        AVI_IndexerMerge( p_demux );
+
         if( !p_sys->i_length )
         {
             avi_track_t *p_stream = NULL;
@@ -1595,6 +1649,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             }
             else
             {
+                AVI_IndexerMerge( p_demux );
                 i64 = (mtime_t)(f * CLOCK_FREQ * p_sys->i_length);
                 return Seek( p_demux, i64, (int)(f * 100) );
             }
@@ -1613,7 +1668,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             {
                 return VLC_EGENERIC;
             }
-            else if( p_sys->i_length > 0 )
+            AVI_IndexerMerge( p_demux );
+            if( p_sys->i_length > 0 )
             {
                 i_percent = 100 * i64 / (p_sys->i_length*CLOCK_FREQ);
             }
@@ -1625,6 +1681,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return Seek( p_demux, i64, i_percent );
         }
         case DEMUX_GET_LENGTH:
+            AVI_IndexerMerge( p_demux );
             pi64 = (int64_t*)va_arg( args, int64_t * );
             *pi64 = p_sys->i_length * (mtime_t)CLOCK_FREQ;
             return VLC_SUCCESS;
@@ -1759,7 +1816,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
     if( p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
     {
         stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-        if( AVI_PacketNext( p_demux ) )
+        if( AVI_PacketNext( p_demux->s ) )
         {
             return VLC_EGENERIC;
         }
@@ -1771,7 +1828,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
 
     for( ;; )
     {
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             msg_Warn( p_demux, "cannot get packet header" );
             return VLC_EGENERIC;
@@ -1779,7 +1836,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
         if( avi_pk.i_stream >= p_sys->i_track ||
             ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
         {
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -1813,7 +1870,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
                 return VLC_SUCCESS;
             }
 
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -2111,17 +2168,17 @@ static void AVI_ParseStreamHeader( vlc_fourcc_t i_id,
 /****************************************************************************
  *
  ****************************************************************************/
-static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
+static int AVI_PacketGetHeader( stream_t *s, avi_packet_t *p_pk )
 {
     const uint8_t *p_peek;
 
-    if( stream_Peek( p_demux->s, &p_peek, 16 ) < 16 )
+    if( stream_Peek( s, &p_peek, 16 ) < 16 )
     {
         return VLC_EGENERIC;
     }
     p_pk->i_fourcc  = VLC_FOURCC( p_peek[0], p_peek[1], p_peek[2], p_peek[3] );
     p_pk->i_size    = GetDWLE( p_peek + 4 );
-    p_pk->i_pos     = stream_Tell( p_demux->s );
+    p_pk->i_pos     = stream_Tell( s );
     if( p_pk->i_fourcc == AVIFOURCC_LIST || p_pk->i_fourcc == AVIFOURCC_RIFF )
     {
         p_pk->i_type = VLC_FOURCC( p_peek[8],  p_peek[9],
@@ -2138,12 +2195,12 @@ static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketNext( demux_t *p_demux )
+static int AVI_PacketNext( stream_t *s )
 {
     avi_packet_t    avi_ck;
     int             i_skip = 0;
 
-    if( AVI_PacketGetHeader( p_demux, &avi_ck ) )
+    if( AVI_PacketGetHeader( s, &avi_ck ) )
     {
         return VLC_EGENERIC;
     }
@@ -2163,7 +2220,7 @@ static int AVI_PacketNext( demux_t *p_demux )
         i_skip = __EVEN( avi_ck.i_size ) + 8;
     }
 
-    if( stream_Read( p_demux->s, NULL, i_skip ) != i_skip )
+    if( stream_Read( s, NULL, i_skip ) != i_skip )
     {
         return VLC_EGENERIC;
     }
@@ -2193,20 +2250,23 @@ static int AVI_PacketRead( demux_t   *p_demux,
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketSearch( demux_t *p_demux )
+/* Looks for the next chunk header. pf_continue, if not NULL, is called
+ * regularly and can stop the search. */
+static int AVI_PacketSearch( stream_t *s, unsigned int i_track,
+                             bool (*pf_continue)( void *, off_t ),
+                             void *p_data )
 {
-    demux_sys_t     *p_sys = p_demux->p_sys;
     avi_packet_t    avi_pk;
     int             i_count = 0;
 
     for( ;; )
     {
-        if( stream_Read( p_demux->s, NULL, 1 ) != 1 )
+        if( stream_Read( s, NULL, 1 ) != 1 )
         {
             return VLC_EGENERIC;
         }
-        AVI_PacketGetHeader( p_demux, &avi_pk );
-        if( avi_pk.i_stream < p_sys->i_track &&
+        AVI_PacketGetHeader( s, &avi_pk );
+        if( avi_pk.i_stream < i_track &&
             ( avi_pk.i_cat == AUDIO_ES || avi_pk.i_cat == VIDEO_ES ) )
         {
             return VLC_SUCCESS;
@@ -2226,9 +2286,11 @@ static int AVI_PacketSearch( demux_t *p_demux )
          * this code is called only on broken files). */
         if( !(++i_count % 1024) )
         {
+            if( pf_continue != NULL && !pf_continue( p_data, stream_Tell( s ) ) )
+                return VLC_EGENERIC;
             msleep( 10000 );
             if( !(i_count % (1024 * 10)) )
-                msg_Warn( p_demux, "trying to resync..." );
+                msg_Warn( s, "trying to resync..." );
         }
     }
 }
@@ -2467,9 +2529,9 @@ static void AVI_IndexLoad( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
 
     /* Load indexes */
-    assert( p_sys->i_track <= 100 );
-    avi_index_t p_idx_indx[p_sys->i_track];
-    avi_index_t p_idx_idx1[p_sys->i_track];
+    assert( p_sys->i_track <= AVI_TRACK_MAX );
+    avi_index_t p_idx_indx[AVI_TRACK_MAX];
+    avi_index_t p_idx_idx1[AVI_TRACK_MAX];
     for( unsigned i = 0; i < p_sys->i_track; i++ )
     {
         avi_index_Init( &p_idx_indx[i] );
@@ -2521,98 +2583,123 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
-static void AVI_IndexCreate( demux_t *p_demux )
+/*****************************************************************************
+ * Index creation from LIST-movi
+ *****************************************************************************
+ * The chunks are walked one by one, so it can take a long time on large
+ * files. The walk only depends on a copy of the file layout and can thus run
+ * on its own stream in the background while playing.
+ *****************************************************************************/
+typedef struct
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
+    off_t        i_movi_begin;
+    off_t        i_movi_end;
+    off_t        i_riff_next;  /* second RIFF of OpenDML files, or 0 */
+    bool         b_odml;
 
-    avi_chunk_list_t *p_riff;
-    avi_chunk_list_t *p_movi;
-
-    unsigned int i_stream;
-    off_t i_movi_end;
+    unsigned int i_track;
+    struct
+    {
+        unsigned int i_cat;
+        vlc_fourcc_t i_codec;
+    } track[AVI_TRACK_MAX];
 
-    mtime_t i_dialog_update;
-    dialog_progress_bar_t *p_dialog = NULL;
+    /* file the index is valid for */
+    uint64_t     i_file_size;
+    int64_t      i_file_mtime;
+} avi_index_scan_t;
 
-    p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
-    p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
+static int AVI_IndexScanInit( demux_t *p_demux, avi_index_scan_t *p_scan )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
 
+    avi_chunk_list_t *p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
+    avi_chunk_list_t *p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
     if( !p_movi )
     {
         msg_Err( p_demux, "cannot find p_movi" );
-        return;
+        return VLC_EGENERIC;
     }
+    avi_chunk_list_t *p_sysx = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 1 );
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
-        avi_index_Init( &p_sys->track[i_stream]->idx );
+    p_scan->i_movi_begin = p_movi->i_chunk_pos;
+    p_scan->i_movi_end   = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
+                                  stream_Size( p_demux->s ) );
+    p_scan->i_riff_next  = p_sysx ? p_sysx->i_chunk_pos : 0;
+    p_scan->b_odml       = p_sys->b_odml;
 
-    i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
-                        stream_Size( p_demux->s ) );
-
-    stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
-    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+    assert( p_sys->i_track <= ARRAY_SIZE(p_scan->track) );
+    p_scan->i_track = p_sys->i_track;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        p_scan->track[i].i_cat   = p_sys->track[i]->i_cat;
+        p_scan->track[i].i_codec = p_sys->track[i]->i_codec;
+    }
 
+    struct stat st;
+    if( p_demux->psz_file && !strcmp( p_demux->psz_access, "file" ) &&
+        !vlc_stat( p_demux->psz_file, &st ) )
+    {
+        p_scan->i_file_size  = st.st_size;
+        p_scan->i_file_mtime = st.st_mtime;
+    }
+    else
+    {
+        p_scan->i_file_size  = 0;
+        p_scan->i_file_mtime = 0;
+    }
+    return VLC_SUCCESS;
+}
 
-    /* Only show dialog if AVI is > 10MB */
-    i_dialog_update = mdate();
-    if( stream_Size( p_demux->s ) > 10000000 )
-        p_dialog = dialog_ProgressCreate( p_demux, _("Fixing AVI Index..."),
-                                       NULL, _("Cancel") );
+/* Walks the chunks of LIST-movi, calling pf_add for each chunk of a track.
+ * pf_continue is called before each chunk and can stop the walk.
+ * Returns true if the whole LIST-movi has been walked. */
+static bool AVI_IndexScan( stream_t *s, const avi_index_scan_t *p_scan,
+                           void (*pf_add)( void *, unsigned int, avi_entry_t * ),
+                           bool (*pf_continue)( void *, off_t ),
+                           void *p_data )
+{
+    if( stream_Seek( s, p_scan->i_movi_begin + 12 ) )
+        return false;
 
     for( ;; )
     {
         avi_packet_t pk;
 
-        /* Don't update/check dialog too often */
-        if( p_dialog && mdate() - i_dialog_update > 100000 )
-        {
-            if( dialog_ProgressCancelled( p_dialog ) )
-                break;
-
-            double f_current = stream_Tell( p_demux->s );
-            double f_size    = stream_Size( p_demux->s );
-            double f_pos     = f_current / f_size;
-            dialog_ProgressSet( p_dialog, NULL, f_pos );
-
-            i_dialog_update = mdate();
-        }
+        if( !pf_continue( p_data, stream_Tell( s ) ) )
+            return false;
 
-        if( AVI_PacketGetHeader( p_demux, &pk ) )
+        if( AVI_PacketGetHeader( s, &pk ) )
             break;
 
-        if( pk.i_stream < p_sys->i_track &&
-            pk.i_cat == p_sys->track[pk.i_stream]->i_cat )
+        if( pk.i_stream < p_scan->i_track &&
+            pk.i_cat == p_scan->track[pk.i_stream].i_cat )
         {
-            avi_track_t *tk = p_sys->track[pk.i_stream];
-
             avi_entry_t index;
             index.i_id      = pk.i_fourcc;
-            index.i_flags   = AVI_GetKeyFlag(tk->i_codec, pk.i_peek);
+            index.i_flags   = AVI_GetKeyFlag( p_scan->track[pk.i_stream].i_codec,
+                                              pk.i_peek );
             index.i_pos     = pk.i_pos;
             index.i_length  = pk.i_size;
             index.i_lengthtotal = pk.i_size;
-            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+            pf_add( p_data, pk.i_stream, &index );
         }
         else
         {
             switch( pk.i_fourcc )
             {
             case AVIFOURCC_idx1:
-                if( p_sys->b_odml )
+                if( p_scan->b_odml && p_scan->i_riff_next > 0 )
                 {
-                    avi_chunk_list_t *p_sysx;
-                    p_sysx = AVI_ChunkFind( &p_sys->ck_root,
-                                            AVIFOURCC_RIFF, 1 );
-
-                    msg_Dbg( p_demux, "looking for new RIFF chunk" );
-                    if( stream_Seek( p_demux->s, p_sysx->i_chunk_pos + 24 ) )
-                        goto print_stat;
+                    msg_Dbg( s, "looking for new RIFF chunk" );
+                    if( stream_Seek( s, p_scan->i_riff_next + 24 ) )
+                        return true;
                     break;
                 }
-                goto print_stat;
+                return true;
 
             case AVIFOURCC_RIFF:
-                    msg_Dbg( p_demux, "new RIFF chunk found" );
+                    msg_Dbg( s, "new RIFF chunk found" );
                     break;
 
             case AVIFOURCC_rec:
@@ -2620,31 +2707,470 @@ static void AVI_IndexCreate( demux_t *p_demux )
                 break;
 
             default:
-                msg_Warn( p_demux, "need resync, probably broken avi" );
-                if( AVI_PacketSearch( p_demux ) )
+                msg_Warn( s, "need resync, probably broken avi" );
+                if( AVI_PacketSearch( s, p_scan->i_track,
+                                      pf_continue, p_data ) )
                 {
-                    msg_Warn( p_demux, "lost sync, abord index creation" );
-                    goto print_stat;
+                    if( !pf_continue( p_data, stream_Tell( s ) ) )
+                        return false;
+                    msg_Warn( s, "lost sync, abord index creation" );
+                    return true;
                 }
             }
         }
 
-        if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
-            AVI_PacketNext( p_demux ) )
+        if( ( !p_scan->b_odml && pk.i_pos + pk.i_size >= p_scan->i_movi_end ) ||
+            AVI_PacketNext( s ) )
         {
             break;
         }
     }
+    return true;
+}
 
-print_stat:
-    if( p_dialog != NULL )
-        dialog_ProgressDestroy( p_dialog );
+static void AVI_IndexFileSave( vlc_object_t *, const char *psz_index_file,
+                               const avi_index_scan_t *, const avi_index_t * );
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+typedef struct
+{
+    demux_t               *p_demux;
+    dialog_progress_bar_t *p_dialog;
+    mtime_t               i_dialog_update;
+} avi_index_create_t;
+
+static void AVI_IndexCreateAdd( void *p_data, unsigned int i_stream,
+                                avi_entry_t *p_entry )
+{
+    avi_index_create_t *p_create = p_data;
+    demux_sys_t *p_sys = p_create->p_demux->p_sys;
+
+    avi_index_Append( &p_sys->track[i_stream]->idx,
+                      &p_sys->i_movi_lastchunk_pos, p_entry );
+}
+
+static bool AVI_IndexCreateProgress( void *p_data, off_t i_pos )
+{
+    avi_index_create_t *p_create = p_data;
+
+    /* Don't update/check dialog too often */
+    if( p_create->p_dialog && mdate() - p_create->i_dialog_update > 100000 )
+    {
+        if( dialog_ProgressCancelled( p_create->p_dialog ) )
+            return false;
+
+        double f_current = i_pos;
+        double f_size    = stream_Size( p_create->p_demux->s );
+        double f_pos     = f_current / f_size;
+        dialog_ProgressSet( p_create->p_dialog, NULL, f_pos );
+
+        p_create->i_dialog_update = mdate();
+    }
+    return true;
+}
+
+static void AVI_IndexCreate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    avi_index_scan_t scan;
+    avi_index_create_t create;
+
+    if( AVI_IndexScanInit( p_demux, &scan ) )
+        return;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        avi_index_Clean( &p_sys->track[i_stream]->idx );
+        avi_index_Init( &p_sys->track[i_stream]->idx );
+    }
+
+    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+
+    create.p_demux = p_demux;
+    create.p_dialog = NULL;
+    create.i_dialog_update = mdate();
+    /* Only show dialog if AVI is > 10MB */
+    if( stream_Size( p_demux->s ) > 10000000 )
+        create.p_dialog = dialog_ProgressCreate( p_demux, _("Fixing AVI Index..."),
+                                                 NULL, _("Cancel") );
+
+    bool b_complete = AVI_IndexScan( p_demux->s, &scan, AVI_IndexCreateAdd,
+                                     AVI_IndexCreateProgress, &create );
+
+    if( create.p_dialog != NULL )
+        dialog_ProgressDestroy( create.p_dialog );
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( b_complete && scan.i_file_size > 0 &&
+        var_InheritBool( p_demux, "avi-index-file" ) )
+    {
+        char *psz_index_file;
+        if( asprintf( &psz_index_file, "%s.aviindex", p_demux->psz_file ) >= 0 )
+        {
+            avi_index_t index[AVI_TRACK_MAX];
+            for( unsigned i = 0; i < scan.i_track; i++ )
+                index[i] = p_sys->track[i]->idx;
+            AVI_IndexFileSave( VLC_OBJECT(p_demux), psz_index_file, &scan, index );
+            free( psz_index_file );
+        }
+    }
+}
+
+/*****************************************************************************
+ * Index file
+ *****************************************************************************
+ * The recreated index is saved next to the file as:
+ *  - "VLCAVII1", the file size, its modification time and the track count,
+ *  - then for each track, the entry count and the entries,
+ * all in big endian. It is only used while the file size and modification
+ * time are unchanged.
+ *****************************************************************************/
+static const uint8_t index_magic[8] = { 'V', 'L', 'C', 'A', 'V', 'I', 'I', '1' };
+#define INDEX_HEADER_SIZE 28
+#define INDEX_ENTRY_SIZE  20
+
+static int AVI_IndexFileLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_index_scan_t scan;
+
+    if( !p_sys->b_fastseekable || !var_InheritBool( p_demux, "avi-index-file" ) ||
+        AVI_IndexScanInit( p_demux, &scan ) || scan.i_file_size == 0 )
+        return VLC_EGENERIC;
+
+    char *psz_index_file;
+    if( asprintf( &psz_index_file, "%s.aviindex", p_demux->psz_file ) < 0 )
+        return VLC_ENOMEM;
+
+    FILE *p_file = vlc_fopen( psz_index_file, "rb" );
+    if( p_file == NULL )
+    {
+        free( psz_index_file );
+        return VLC_EGENERIC;
+    }
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    bool b_ok = fread( header, sizeof( header ), 1, p_file ) == 1 &&
+                !memcmp( header, index_magic, sizeof( index_magic ) );
+    if( b_ok && ( GetQWBE( &header[8] ) != scan.i_file_size ||
+                  (int64_t)GetQWBE( &header[16] ) != scan.i_file_mtime ) )
+    {
+        msg_Dbg( p_demux, "ignoring outdated index %s", psz_index_file );
+        fclose( p_file );
+        free( psz_index_file );
+        return VLC_EGENERIC;
+    }
+    b_ok = b_ok && GetDWBE( &header[24] ) == p_sys->i_track;
+
+    avi_index_t index[AVI_TRACK_MAX];
+    off_t i_last_pos = 0;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Init( &index[i] );
+
+    for( unsigned i = 0; b_ok && i < p_sys->i_track; i++ )
+    {
+        uint8_t count[4];
+        if( fread( count, sizeof( count ), 1, p_file ) != 1 )
+        {
+            b_ok = false;
+            break;
+        }
+
+        uint32_t i_count = GetDWBE( count );
+        for( uint32_t j = 0; j < i_count; j++ )
+        {
+            uint8_t entry[INDEX_ENTRY_SIZE];
+            if( fread( entry, sizeof( entry ), 1, p_file ) != 1 )
+            {
+                b_ok = false;
+                break;
+            }
+
+            avi_entry_t e;
+            unsigned int i_stream;
+            e.i_id     = GetDWBE( &entry[0] );
+            e.i_flags  = GetDWBE( &entry[4] );
+            e.i_pos    = GetQWBE( &entry[8] );
+            e.i_length = GetDWBE( &entry[16] );
+            AVI_ParseStreamHeader( e.i_id, &i_stream, NULL );
+            if( i_stream != i || e.i_pos < scan.i_movi_begin ||
+                (uint64_t)e.i_pos >= scan.i_file_size ||
+                ( index[i].i_size > 0 &&
+                  e.i_pos <= index[i].p_entry[index[i].i_size - 1].i_pos ) )
+            {
+                b_ok = false;
+                break;
+            }
+            avi_index_Append( &index[i], &i_last_pos, &e );
+            if( index[i].p_entry == NULL )
+            {
+                b_ok = false;
+                break;
+            }
+        }
+    }
+    fclose( p_file );
+
+    if( !b_ok )
+    {
+        msg_Warn( p_demux, "ignoring invalid index %s", psz_index_file );
+        for( unsigned i = 0; i < p_sys->i_track; i++ )
+            avi_index_Clean( &index[i] );
+        free( psz_index_file );
+        return VLC_EGENERIC;
+    }
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        p_sys->track[i]->idx = index[i];
+        msg_Dbg( p_demux, "stream[%u] loaded %u index entries", i, index[i].i_size );
+    }
+    p_sys->i_movi_lastchunk_pos = i_last_pos;
+    p_sys->b_indexloaded = true;
+
+    msg_Dbg( p_demux, "loaded index from %s", psz_index_file );
+    free( psz_index_file );
+    return VLC_SUCCESS;
+}
+
+static void AVI_IndexFileSave( vlc_object_t *p_obj, const char *psz_index_file,
+                               const avi_index_scan_t *p_scan,
+                               const avi_index_t *p_index )
+{
+    char *psz_tmp_file;
+    if( asprintf( &psz_tmp_file, "%s.part", psz_index_file ) < 0 )
+        return;
+
+    FILE *p_file = vlc_fopen( psz_tmp_file, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Dbg( p_obj, "cannot save index to %s", psz_index_file );
+        free( psz_tmp_file );
+        return;
+    }
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    memcpy( header, index_magic, sizeof( index_magic ) );
+    SetQWBE( &header[8], p_scan->i_file_size );
+    SetQWBE( &header[16], p_scan->i_file_mtime );
+    SetDWBE( &header[24], p_scan->i_track );
+    bool b_ok = fwrite( header, sizeof( header ), 1, p_file ) == 1;
+
+    for( unsigned i = 0; b_ok && i < p_scan->i_track; i++ )
+    {
+        uint8_t count[4];
+        SetDWBE( count, p_index[i].i_size );
+        b_ok = fwrite( count, sizeof( count ), 1, p_file ) == 1;
+
+        for( unsigned j = 0; b_ok && j < p_index[i].i_size; j++ )
+        {
+            const avi_entry_t *e = &p_index[i].p_entry[j];
+            uint8_t entry[INDEX_ENTRY_SIZE];
+            SetDWBE( &entry[0], e->i_id );
+            SetDWBE( &entry[4], e->i_flags );
+            SetQWBE( &entry[8], e->i_pos );
+            SetDWBE( &entry[16], e->i_length );
+            b_ok = fwrite( entry, sizeof( entry ), 1, p_file ) == 1;
+        }
+    }
+
+    if( fclose( p_file ) != 0 )
+        b_ok = false;
+    if( !b_ok || vlc_rename( psz_tmp_file, psz_index_file ) )
+    {
+        msg_Dbg( p_obj, "cannot save index to %s", psz_index_file );
+        vlc_unlink( psz_tmp_file );
+    }
+    else
+        msg_Dbg( p_obj, "saved index to %s", psz_index_file );
+    free( psz_tmp_file );
+}
+
+/*****************************************************************************
+ * Background index creation
+ *****************************************************************************
+ * The indexer walks LIST-movi on its own stream while playing. The entries
+ * it finds are taken into the track indexes when seeking or when the length
+ * is queried, after the entries already known.
+ *****************************************************************************/
+struct avi_indexer_t
+{
+    demux_t          *p_demux;
+    vlc_thread_t     thread;
+    char             *psz_url;
+    char             *psz_index_file;  /* NULL if not saved */
+    avi_index_scan_t scan;
+
+    vlc_mutex_t      lock;
+    bool             b_abort;
+    bool             b_done;
+    avi_index_t      index[AVI_TRACK_MAX];
+    off_t            i_last_pos;
+};
+
+static void AVI_IndexerAdd( void *p_data, unsigned int i_stream,
+                            avi_entry_t *p_entry )
+{
+    avi_indexer_t *p_indexer = p_data;
+
+    vlc_mutex_lock( &p_indexer->lock );
+    avi_index_Append( &p_indexer->index[i_stream], &p_indexer->i_last_pos,
+                      p_entry );
+    vlc_mutex_unlock( &p_indexer->lock );
+}
+
+static bool AVI_IndexerContinue( void *p_data, off_t i_pos )
+{
+    avi_indexer_t *p_indexer = p_data;
+    VLC_UNUSED( i_pos );
+
+    vlc_mutex_lock( &p_indexer->lock );
+    bool b_continue = !p_indexer->b_abort;
+    vlc_mutex_unlock( &p_indexer->lock );
+    return b_continue;
+}
+
+static void *AVI_IndexerThread( void *p_data )
+{
+    avi_indexer_t *p_indexer = p_data;
+    demux_t *p_demux = p_indexer->p_demux;
+    mtime_t i_start = mdate();
+    bool b_complete = false;
+
+    stream_t *s = stream_UrlNew( p_demux, p_indexer->psz_url );
+    if( s != NULL )
+    {
+        b_complete = AVI_IndexScan( s, &p_indexer->scan, AVI_IndexerAdd,
+                                    AVI_IndexerContinue, p_indexer );
+        stream_Delete( s );
+    }
+    msg_Dbg( p_demux, "index created in %"PRId64" ms%s",
+             ( mdate() - i_start ) / 1000, b_complete ? "" : " (aborted)" );
+
+    /* Only this thread modifies the entries */
+    if( b_complete && p_indexer->psz_index_file )
+        AVI_IndexFileSave( VLC_OBJECT(p_demux), p_indexer->psz_index_file,
+                           &p_indexer->scan, p_indexer->index );
+
+    vlc_mutex_lock( &p_indexer->lock );
+    p_indexer->b_done = true;
+    vlc_mutex_unlock( &p_indexer->lock );
+    return NULL;
+}
+
+static void AVI_IndexerStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    avi_indexer_t *p_indexer = malloc( sizeof( *p_indexer ) );
+    if( unlikely( p_indexer == NULL ) )
+        return;
+
+    if( AVI_IndexScanInit( p_demux, &p_indexer->scan ) ||
+        asprintf( &p_indexer->psz_url, "%s://%s", p_demux->psz_access,
+                  p_demux->psz_location ) < 0 )
+    {
+        free( p_indexer );
+        return;
+    }
+
+    p_indexer->psz_index_file = NULL;
+    if( p_indexer->scan.i_file_size > 0 &&
+        var_InheritBool( p_demux, "avi-index-file" ) &&
+        asprintf( &p_indexer->psz_index_file, "%s.aviindex",
+                  p_demux->psz_file ) < 0 )
+        p_indexer->psz_index_file = NULL;
+
+    p_indexer->p_demux = p_demux;
+    vlc_mutex_init( &p_indexer->lock );
+    p_indexer->b_abort = false;
+    p_indexer->b_done = false;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Init( &p_indexer->index[i] );
+    p_indexer->i_last_pos = 0;
+
+    if( vlc_clone( &p_indexer->thread, AVI_IndexerThread, p_indexer,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_mutex_destroy( &p_indexer->lock );
+        free( p_indexer->psz_index_file );
+        free( p_indexer->psz_url );
+        free( p_indexer );
+        return;
+    }
+    msg_Dbg( p_demux, "creating index from LIST-movi in the background" );
+    p_sys->p_indexer = p_indexer;
+}
+
+static void AVI_IndexerStop( avi_indexer_t *p_indexer )
+{
+    vlc_mutex_lock( &p_indexer->lock );
+    p_indexer->b_abort = true;
+    vlc_mutex_unlock( &p_indexer->lock );
+    vlc_join( p_indexer->thread, NULL );
+
+    for( unsigned i = 0; i < p_indexer->scan.i_track; i++ )
+        avi_index_Clean( &p_indexer->index[i] );
+    vlc_mutex_destroy( &p_indexer->lock );
+    free( p_indexer->psz_index_file );
+    free( p_indexer->psz_url );
+    free( p_indexer );
+}
+
+static void AVI_IndexerMerge( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_indexer_t *p_indexer = p_sys->p_indexer;
+
+    if( p_indexer == NULL )
+        return;
+
+    vlc_mutex_lock( &p_indexer->lock );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_t *p_dst = &p_sys->track[i]->idx;
+        const avi_index_t *p_src = &p_indexer->index[i];
+
+        /* Skip the entries already known */
+        unsigned i_low = 0, i_high = p_src->i_size;
+        if( p_dst->i_size > 0 )
+        {
+            off_t i_last = p_dst->p_entry[p_dst->i_size - 1].i_pos;
+            while( i_low < i_high )
+            {
+                unsigned i_mid = ( i_low + i_high ) / 2;
+                if( p_src->p_entry[i_mid].i_pos <= i_last )
+                    i_low = i_mid + 1;
+                else
+                    i_high = i_mid;
+            }
+        }
+
+        for( ; i_low < p_src->i_size; i_low++ )
+        {
+            avi_entry_t index = p_src->p_entry[i_low];
+            avi_index_Append( p_dst, &p_sys->i_movi_lastchunk_pos, &index );
+        }
+    }
+    bool b_done = p_indexer->b_done;
+    vlc_mutex_unlock( &p_indexer->lock );
+
+    if( b_done )
+    {
+        AVI_IndexerStop( p_indexer );
+        p_sys->p_indexer = NULL;
+        p_sys->i_length = AVI_MovieGetLength( p_demux );
+
+        for( unsigned i = 0; i < p_sys->i_track; i++ )
+            msg_Dbg( p_demux, "stream[%u] created %u index entries",
+                     i, p_sys->track[i]->idx.i_size );
+    }
 }
 
 /* */
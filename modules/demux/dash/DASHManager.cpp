@@ -41,6 +41,7 @@
 #include "adaptationlogic/AdaptationLogicFactory.h"
 #include "SegmentTracker.hpp"
 #include <vlc_stream.h>
+#include <vlc_demux.h>
 
 using namespace dash;
 using namespace dash::http;
@@ -49,7 +50,6 @@ using namespace dash::mpd;
 
 DASHManager::DASHManager    ( MPD *mpd,
                               AbstractAdaptationLogic::LogicType type, stream_t *stream) :
-             conManager     ( NULL ),
              logicType      ( type ),
              mpd            ( mpd ),
              stream         ( stream ),
@@ -57,13 +57,16 @@ DASHManager::DASHManager    ( MPD *mpd,
 {
     for(int i=0; i<Streams::count; i++)
         streams[i] = NULL;
+    vlc_mutex_init(&lock);
+    vlc_cond_init(&wait);
 }
 
 DASHManager::~DASHManager   ()
 {
-    delete conManager;
     for(int i=0; i<Streams::count; i++)
         delete streams[i];
+    vlc_cond_destroy(&wait);
+    vlc_mutex_destroy(&lock);
 }
 
 bool DASHManager::start(demux_t *demux)
@@ -72,6 +75,8 @@ bool DASHManager::start(demux_t *demux)
     if(!period)
         return false;
 
+    mtime_t buffering = CLOCK_FREQ / 1000 * var_InheritInteger(demux, "dash-buffer");
+
     for(int i=0; i<Streams::count; i++)
     {
         Streams::Type type = static_cast<Streams::Type>(i);
@@ -94,7 +99,7 @@ bool DASHManager::start(demux_t *demux)
             {
                 if(!tracker)
                     throw VLC_ENOMEM;
-                streams[type]->create(demux, logic, tracker);
+                streams[type]->create(demux, logic, tracker, buffering, &lock, &wait);
             } catch (int) {
                 delete streams[type];
                 delete logic;
@@ -104,10 +109,6 @@ bool DASHManager::start(demux_t *demux)
         }
     }
 
-    conManager = new (std::nothrow) HTTPConnectionManager(stream);
-    if(!conManager)
-        return false;
-
     mpd->playbackStart.Set(time(NULL));
     nextMPDupdate = mpd->playbackStart.Get();
 
@@ -116,16 +117,54 @@ bool DASHManager::start(demux_t *demux)
 
 size_t DASHManager::read()
 {
+    /* Only hand over what the downloaders already have, waiting a bit
+     * for it otherwise, so the demux thread never blocks on the network */
+    mtime_t deadline = mdate() + CLOCK_FREQ / 10;
+    vlc_mutex_lock(&lock);
+    for(;;)
+    {
+        bool ready = true;
+        for(int type=0; type<Streams::count; type++)
+        {
+            if(!streams[type])
+                continue;
+            streams[type]->updatePlayback();
+            if(streams[type]->hasData())
+            {
+                ready = true;
+                break;
+            }
+            if(!streams[type]->isEOF())
+                ready = false;
+        }
+        if(ready || vlc_cond_timedwait(&wait, &lock, deadline))
+            break;
+    }
+    vlc_mutex_unlock(&lock);
+
     size_t i_ret = 0;
     for(int type=0; type<Streams::count; type++)
     {
         if(!streams[type])
             continue;
-        i_ret += streams[type]->read(conManager);
+        i_ret += streams[type]->read();
     }
     return i_ret;
 }
 
+bool DASHManager::isEOF()
+{
+    bool b_eof = true;
+    vlc_mutex_lock(&lock);
+    for(int type=0; type<Streams::count; type++)
+    {
+        if(streams[type] && !streams[type]->isEOF())
+            b_eof = false;
+    }
+    vlc_mutex_unlock(&lock);
+    return b_eof;
+}
+
 mtime_t DASHManager::getPCR() const
 {
     mtime_t pcr = VLC_TS_INVALID;
@@ -173,6 +212,7 @@ mtime_t DASHManager::getDuration() const
 bool DASHManager::setPosition(mtime_t time)
 {
     bool ret = true;
+    vlc_mutex_lock(&lock);
     for(int real = 0; real < 2; real++)
     {
         /* Always probe if we can seek first */
@@ -185,6 +225,7 @@ bool DASHManager::setPosition(mtime_t time)
         if(!ret)
             break;
     }
+    vlc_mutex_unlock(&lock);
     return ret;
 }
 
@@ -230,6 +271,7 @@ bool DASHManager::updateMPD()
             return false;
         }
 
+        vlc_mutex_lock(&lock);
         mtime_t minsegmentTime = 0;
         for(int type=0; type<Streams::count; type++)
         {
@@ -246,6 +288,7 @@ bool DASHManager::updateMPD()
             mpd->mergeWith(newmpd, minsegmentTime);
             delete newmpd;
         }
+        vlc_mutex_unlock(&lock);
         stream_Delete(mpdstream);
     }
 
@@ -40,6 +40,7 @@ namespace dash
 
             bool    start         (demux_t *);
             size_t  read();
+            bool    isEOF();
             mtime_t getDuration() const;
             mtime_t getPCR() const;
             int     getGroup() const;
@@ -49,12 +50,13 @@ namespace dash
             bool    updateMPD();
 
         private:
-            http::HTTPConnectionManager         *conManager;
             logic::AbstractAdaptationLogic::LogicType  logicType;
             mpd::MPD                            *mpd;
             stream_t                            *stream;
             Streams::Stream                     *streams[Streams::count];
             mtime_t                              nextMPDupdate;
+            vlc_mutex_t                          lock; /* streams state, MPD */
+            vlc_cond_t                           wait; /* signaled on data */
     };
 
 }
@@ -0,0 +1,250 @@
+/*
+ * Downloader.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "Downloader.hpp"
+#include "SegmentTracker.hpp"
+#include "adaptationlogic/AbstractAdaptationLogic.h"
+#include "http/HTTPConnectionManager.h"
+#include "http/Chunk.h"
+
+#include <new>
+
+using namespace dash;
+using namespace dash::http;
+using namespace dash::logic;
+
+Downloader::Downloader(stream_t *stream_, SegmentTracker *tracker_,
+                       AbstractAdaptationLogic *logic_, Streams::Type type_,
+                       mtime_t target_, vlc_mutex_t *lock_, vlc_cond_t *datawait_)
+{
+    stream = stream_;
+    tracker = tracker_;
+    logic = logic_;
+    type = type_;
+    target = target_;
+    connManager = NULL;
+    running = false;
+    lock = lock_;
+    datawait = datawait_;
+    vlc_cond_init(&spacewait);
+    killed = false;
+    eof = false;
+    generation = 0;
+    queue = NULL;
+    queue_last = &queue;
+    downloaded = 0;
+    played = 0;
+    playbackStart = VLC_TS_INVALID;
+    flushTime = VLC_TS_INVALID;
+}
+
+Downloader::~Downloader()
+{
+    if(running)
+    {
+        vlc_mutex_lock(lock);
+        killed = true;
+        vlc_cond_signal(&spacewait);
+        vlc_mutex_unlock(lock);
+        vlc_join(thread, NULL);
+    }
+    block_ChainRelease(queue);
+    vlc_cond_destroy(&spacewait);
+    delete connManager;
+}
+
+bool Downloader::start()
+{
+    connManager = new (std::nothrow) HTTPConnectionManager(stream);
+    if(!connManager)
+        return false;
+    running = !vlc_clone(&thread, entry, this, VLC_THREAD_PRIORITY_INPUT);
+    return running;
+}
+
+block_t * Downloader::dequeue()
+{
+    block_t *p_block = queue;
+    queue = NULL;
+    queue_last = &queue;
+    return p_block;
+}
+
+bool Downloader::hasData() const
+{
+    return queue != NULL;
+}
+
+bool Downloader::isEOF() const
+{
+    return eof && queue == NULL;
+}
+
+void Downloader::setPlaybackTime(mtime_t time)
+{
+    /* Until the output has some data after a flush, its time is the one
+     * from before */
+    if(time <= VLC_TS_0 || time == flushTime)
+        return;
+
+    if(playbackStart == VLC_TS_INVALID || time < playbackStart)
+    {
+        /* first time, or a discontinuity */
+        playbackStart = time;
+        downloaded -= played;
+    }
+    if(played != time - playbackStart)
+    {
+        played = time - playbackStart;
+        vlc_cond_signal(&spacewait);
+    }
+}
+
+void Downloader::flush()
+{
+    block_ChainRelease(queue);
+    queue = NULL;
+    queue_last = &queue;
+    generation++;
+    eof = false;
+    flushTime = playbackStart;
+    if(flushTime != VLC_TS_INVALID)
+        flushTime += played;
+    playbackStart = VLC_TS_INVALID;
+    downloaded = played = 0;
+    vlc_cond_signal(&spacewait);
+}
+
+void * Downloader::entry(void *data)
+{
+    Downloader *me = static_cast<Downloader *>(data);
+    me->run();
+    return NULL;
+}
+
+void Downloader::run()
+{
+    vlc_mutex_lock(lock);
+    for(;;)
+    {
+        while(!killed && (eof || downloaded - played >= target))
+            vlc_cond_wait(&spacewait, lock);
+        if(killed)
+            break;
+
+        logic->updateBufferLevel(downloaded - played);
+        Chunk *chunk = tracker->getNextChunk(type);
+        if(!chunk)
+        {
+            eof = true;
+            vlc_cond_signal(datawait);
+            continue;
+        }
+
+        unsigned gen = generation;
+        vlc_mutex_unlock(lock);
+        download(chunk, gen);
+        vlc_mutex_lock(lock);
+    }
+    vlc_mutex_unlock(lock);
+}
+
+void Downloader::download(Chunk *chunk, unsigned gen)
+{
+    if(!chunk->getConnection() && !connManager->connectChunk(chunk))
+    {
+        if(chunk->getConnection())
+            chunk->getConnection()->releaseChunk();
+        delete chunk;
+        return;
+    }
+
+    uint64_t size = 0;
+    for(;;)
+    {
+        size_t readsize;
+
+        /* Because we don't know Chunk size at start, we need to get size
+           from content length */
+        if(chunk->getBytesRead() == 0)
+        {
+            if(chunk->getConnection()->query(chunk->getPath()) == false)
+                readsize = 32768; /* we don't handle retry here :/ */
+            else
+                readsize = chunk->getBytesToRead();
+        }
+        else
+        {
+            readsize = chunk->getBytesToRead();
+        }
+
+        if (readsize > 128000)
+            readsize = 32768;
+
+        block_t *block = block_Alloc(readsize);
+        if(!block)
+            break;
+
+        mtime_t time = mdate();
+        ssize_t ret = chunk->getConnection()->read(block->p_buffer, readsize);
+        time = mdate() - time;
+
+        if(ret <= 0)
+        {
+            block_Release(block);
+            break;
+        }
+
+        block->i_buffer = (size_t)ret;
+        size += block->i_buffer;
+
+        bool last = chunk->getBytesToRead() == 0;
+
+        vlc_mutex_lock(lock);
+        logic->updateDownloadRate(block->i_buffer, time);
+        if(killed || gen != generation)
+        {
+            /* seeked, or closing */
+            vlc_mutex_unlock(lock);
+            block_Release(block);
+            break;
+        }
+        if(last)
+            chunk->onDownload(block->p_buffer, block->i_buffer);
+        block_ChainLastAppend(&queue_last, block);
+        vlc_cond_signal(datawait);
+        vlc_mutex_unlock(lock);
+
+        if(last)
+            break;
+    }
+
+    /* Without the duration from the MPD, estimate it from the bandwidth */
+    mtime_t duration = chunk->getDuration();
+    if(duration == 0 && chunk->getBitrate() > 1)
+        duration = CLOCK_FREQ * 8 * size / chunk->getBitrate();
+
+    vlc_mutex_lock(lock);
+    if(gen == generation)
+        downloaded += duration;
+    vlc_mutex_unlock(lock);
+
+    chunk->getConnection()->releaseChunk();
+    delete chunk;
+}
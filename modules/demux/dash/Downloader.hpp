@@ -0,0 +1,96 @@
+/*
+ * Downloader.hpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef DOWNLOADER_HPP
+#define DOWNLOADER_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "StreamsType.hpp"
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+namespace dash
+{
+    class SegmentTracker;
+
+    namespace logic
+    {
+        class AbstractAdaptationLogic;
+    }
+
+    namespace http
+    {
+        class Chunk;
+        class HTTPConnectionManager;
+
+        /* Downloads the segments of one adaptation set from its own thread
+         * and connections, keeping about the target duration of media ahead
+         * of the playback. The lock is shared with the other downloaders and
+         * the manager, which is signaled when data comes. */
+        class Downloader
+        {
+            public:
+                Downloader(stream_t *, SegmentTracker *,
+                           logic::AbstractAdaptationLogic *, Streams::Type,
+                           mtime_t target, vlc_mutex_t *, vlc_cond_t *);
+                ~Downloader();
+
+                bool start();
+
+                /* The following are called with the lock held */
+                block_t * dequeue();
+                bool hasData() const;
+                bool isEOF() const;
+                void setPlaybackTime(mtime_t);
+                void flush();
+
+            private:
+                static void * entry(void *);
+                void run();
+                void download(Chunk *, unsigned);
+
+                stream_t                       *stream;
+                SegmentTracker                 *tracker;
+                logic::AbstractAdaptationLogic *logic;
+                Streams::Type                   type;
+                HTTPConnectionManager          *connManager;
+                mtime_t                         target;
+
+                vlc_thread_t                    thread;
+                bool                            running;
+                vlc_mutex_t                    *lock;
+                vlc_cond_t                     *datawait;
+                vlc_cond_t                      spacewait;
+                bool                            killed;
+                bool                            eof;
+                unsigned                        generation; /* bumped on flush */
+                block_t                        *queue;
+                block_t                       **queue_last;
+                mtime_t                         downloaded; /* media downloaded */
+                mtime_t                         played;     /* and played, since start or flush */
+                mtime_t                         playbackStart;
+                mtime_t                         flushTime;
+        };
+    }
+}
+
+#endif // DOWNLOADER_HPP
@@ -19,6 +19,7 @@
  *****************************************************************************/
 #include "SegmentTracker.hpp"
 #include "mpd/MPD.h"
+#include "http/Chunk.h"
 
 using namespace dash;
 using namespace dash::logic;
@@ -91,7 +92,13 @@ Chunk * SegmentTracker::getNextChunk(Streams::Type type)
 
     Chunk *chunk = segment->toChunk(count, rep);
     if(chunk)
+    {
+        mtime_t start = rep->getPlaybackTimeBySegmentNumber(count);
+        mtime_t end = rep->getPlaybackTimeBySegmentNumber(count + 1);
+        if(end > start)
+            chunk->setDuration(end - start);
         count++;
+    }
 
     return chunk;
 }
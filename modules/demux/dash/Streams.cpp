@@ -22,6 +22,7 @@
 #include "adaptationlogic/AbstractAdaptationLogic.h"
 #include "adaptationlogic/AdaptationLogicFactory.h"
 #include "SegmentTracker.hpp"
+#include "Downloader.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
 
@@ -45,14 +46,14 @@ void Stream::init(const Type type_, const Format format_)
     format = format_;
     output = NULL;
     adaptationLogic = NULL;
-    currentChunk = NULL;
-    eof = false;
     segmentTracker = NULL;
+    downloader = NULL;
+    lock = NULL;
 }
 
 Stream::~Stream()
 {
-    delete currentChunk;
+    delete downloader;
     delete adaptationLogic;
     delete output;
     delete segmentTracker;
@@ -87,7 +88,8 @@ Format Stream::mimeToFormat(const std::string &mime)
     return format;
 }
 
-void Stream::create(demux_t *demux, AbstractAdaptationLogic *logic, SegmentTracker *tracker)
+void Stream::create(demux_t *demux, AbstractAdaptationLogic *logic, SegmentTracker *tracker,
+                    mtime_t buffering, vlc_mutex_t *lock_, vlc_cond_t *wait)
 {
     switch(format)
     {
@@ -101,13 +103,39 @@ void Stream::create(demux_t *demux, AbstractAdaptationLogic *logic, SegmentTrack
             throw VLC_EBADVAR;
             break;
     }
+
+    Downloader *dl = new (std::nothrow) Downloader(demux->s, tracker, logic, type,
+                                                   buffering, lock_, wait);
+    if(!dl)
+        throw VLC_ENOMEM;
+    if(!dl->start())
+    {
+        delete dl;
+        throw VLC_EGENERIC;
+    }
+
     adaptationLogic = logic;
     segmentTracker = tracker;
+    downloader = dl;
+    lock = lock_;
 }
 
+/* Called with the lock held */
 bool Stream::isEOF() const
 {
-    return false;
+    return downloader->isEOF();
+}
+
+/* Called with the lock held */
+bool Stream::hasData() const
+{
+    return downloader->hasData();
+}
+
+/* Called with the lock held */
+void Stream::updatePlayback()
+{
+    downloader->setPlaybackTime(output->getPCR());
 }
 
 mtime_t Stream::getPCR() const
@@ -130,96 +158,39 @@ bool Stream::operator ==(const Stream &stream) const
     return stream.type == type;
 }
 
-Chunk * Stream::getChunk()
-{
-    if (currentChunk == NULL)
-    {
-        currentChunk = segmentTracker->getNextChunk(type);
-        if (currentChunk == NULL)
-            eof = true;
-    }
-    return currentChunk;
-}
-
 bool Stream::seekAble() const
 {
     return (output && output->seekAble());
 }
 
-size_t Stream::read(HTTPConnectionManager *connManager)
+size_t Stream::read()
 {
-    Chunk *chunk = getChunk();
-    if(!chunk)
-        return 0;
-
-    if(!chunk->getConnection())
-    {
-       if(!connManager->connectChunk(chunk))
-        return 0;
-    }
+    vlc_mutex_lock(lock);
+    block_t *block = downloader->dequeue();
+    vlc_mutex_unlock(lock);
 
     size_t readsize = 0;
-
-    /* Because we don't know Chunk size at start, we need to get size
-       from content length */
-    if(chunk->getBytesRead() == 0)
-    {
-        if(chunk->getConnection()->query(chunk->getPath()) == false)
-            readsize = 32768; /* we don't handle retry here :/ */
-        else
-            readsize = chunk->getBytesToRead();
-    }
-    else
-    {
-        readsize = chunk->getBytesToRead();
-    }
-
-    if (readsize > 128000)
-        readsize = 32768;
-
-    block_t *block = block_Alloc(readsize);
-    if(!block)
-        return 0;
-
-    mtime_t time = mdate();
-    ssize_t ret = chunk->getConnection()->read(block->p_buffer, readsize);
-    time = mdate() - time;
-
-    if(ret <= 0)
-    {
-        block_Release(block);
-        chunk->getConnection()->releaseChunk();
-        currentChunk = NULL;
-        delete chunk;
-        return 0;
-    }
-    else
+    while(block)
     {
-        block->i_buffer = (size_t)ret;
-
-        adaptationLogic->updateDownloadRate(block->i_buffer, time);
-
-        if (chunk->getBytesToRead() == 0)
-        {
-            chunk->onDownload(block->p_buffer, block->i_buffer);
-            chunk->getConnection()->releaseChunk();
-            currentChunk = NULL;
-            delete chunk;
-        }
+        block_t *next = block->p_next;
+        block->p_next = NULL;
+        readsize += block->i_buffer;
+        output->pushBlock(block);
+        block = next;
     }
 
-    readsize = block->i_buffer;
-
-    output->pushBlock(block);
-
     return readsize;
 }
 
+/* Called with the lock held */
 bool Stream::setPosition(mtime_t time, bool tryonly)
 {
     bool ret = segmentTracker->setPosition(time, tryonly);
     if(!tryonly && ret)
+    {
+        downloader->flush();
         output->setPosition(time);
+    }
     return ret;
 }
 
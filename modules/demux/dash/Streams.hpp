@@ -35,6 +35,11 @@ namespace dash
 {
     class SegmentTracker;
 
+    namespace http
+    {
+        class Downloader;
+    }
+
     namespace Streams
     {
         class AbstractStreamOutput;
@@ -48,26 +53,28 @@ namespace dash
                 bool operator==(const Stream &) const;
                 static Type mimeToType(const std::string &mime);
                 static Format mimeToFormat(const std::string &mime);
-                void create(demux_t *, logic::AbstractAdaptationLogic *, SegmentTracker *);
+                void create(demux_t *, logic::AbstractAdaptationLogic *, SegmentTracker *,
+                            mtime_t, vlc_mutex_t *, vlc_cond_t *);
                 bool isEOF() const;
+                bool hasData() const;
+                void updatePlayback();
                 mtime_t getPCR() const;
                 int getGroup() const;
                 int esCount() const;
                 bool seekAble() const;
-                size_t read(http::HTTPConnectionManager *);
+                size_t read();
                 bool setPosition(mtime_t, bool);
                 mtime_t getPosition() const;
 
             private:
-                http::Chunk *getChunk();
                 void init(const Type, const Format);
                 Type type;
                 Format format;
                 AbstractStreamOutput *output;
                 logic::AbstractAdaptationLogic *adaptationLogic;
                 SegmentTracker *segmentTracker;
-                http::Chunk *currentChunk;
-                bool eof;
+                http::Downloader *downloader;
+                vlc_mutex_t *lock;
         };
 
         class AbstractStreamOutput
@@ -42,3 +42,7 @@ AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
 void AbstractAdaptationLogic::updateDownloadRate    (size_t, mtime_t)
 {
 }
+
+void AbstractAdaptationLogic::updateBufferLevel     (mtime_t)
+{
+}
@@ -49,6 +49,7 @@ namespace dash
 
                 virtual mpd::Representation* getCurrentRepresentation(Streams::Type, mpd::Period *) const = 0;
                 virtual void                updateDownloadRate     (size_t, mtime_t);
+                virtual void                updateBufferLevel      (mtime_t);
 
                 enum LogicType
                 {
@@ -56,7 +57,8 @@ namespace dash
                     AlwaysBest,
                     AlwaysLowest,
                     RateBased,
-                    FixedRate
+                    FixedRate,
+                    BufferBased
                 };
 
             protected:
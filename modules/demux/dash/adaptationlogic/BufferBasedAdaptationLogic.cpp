@@ -0,0 +1,83 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2014 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.hpp"
+#include "mpd/MPD.h"
+#include "mpd/Period.h"
+
+#include <vlc_common.h>
+#include <vlc_variables.h>
+
+#include <algorithm>
+
+using namespace dash::logic;
+using namespace dash::mpd;
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic(MPD *mpd) :
+    AbstractAdaptationLogic(mpd),
+    rule(CLOCK_FREQ / 1000 * var_InheritInteger(mpd->getVLCObject(), "dash-buffer")),
+    buffer(0)
+{
+}
+
+static bool compareBandwidth(const Representation *a, const Representation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+Representation *BufferBasedAdaptationLogic::getCurrentRepresentation(Streams::Type type, mpd::Period *period) const
+{
+    if(period == NULL)
+        return NULL;
+
+    std::vector<Representation *> reps;
+    std::vector<AdaptationSet *> adaptSets = period->getAdaptationSets(type);
+    std::vector<AdaptationSet *>::const_iterator adaptIt;
+    for(adaptIt=adaptSets.begin(); adaptIt!=adaptSets.end(); adaptIt++)
+    {
+        std::vector<Representation *> setreps = (*adaptIt)->getRepresentations();
+        reps.insert(reps.end(), setreps.begin(), setreps.end());
+    }
+    if(reps.empty())
+        return NULL;
+
+    std::stable_sort(reps.begin(), reps.end(), compareBandwidth);
+
+    std::vector<uint64_t> bitrates;
+    std::vector<Representation *>::const_iterator repIt;
+    for(repIt=reps.begin(); repIt!=reps.end(); repIt++)
+        bitrates.push_back((*repIt)->getBandwidth());
+    rule.setBitrates(bitrates);
+
+    return reps[rule.select(buffer, estimator.get())];
+}
+
+void BufferBasedAdaptationLogic::updateDownloadRate(size_t size, mtime_t time)
+{
+    estimator.push(size, time);
+}
+
+void BufferBasedAdaptationLogic::updateBufferLevel(mtime_t level)
+{
+    buffer = level;
+}
@@ -0,0 +1,150 @@
+/*
+ * BufferBasedRule.cpp
+ *****************************************************************************
+ * Copyright (C) 2014 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "BufferBasedRule.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dash::logic;
+
+#define FAST_HALFLIFE   (3 * CLOCK_FREQ)
+#define SLOW_HALFLIFE   (8 * CLOCK_FREQ)
+#define SAFETY_FACTOR   0.9
+
+ThroughputEstimator::ThroughputEstimator() :
+    fast(0.0), fastWeight(0.0),
+    slow(0.0), slowWeight(0.0)
+{
+}
+
+void ThroughputEstimator::push(size_t size, mtime_t time)
+{
+    if(unlikely(time <= 0))
+        return;
+
+    /* each sample weighs its download time */
+    double bps = (double) size * 8 * CLOCK_FREQ / time;
+    double alpha = pow(0.5, (double) time / FAST_HALFLIFE);
+    fast = alpha * fast + (1.0 - alpha) * bps;
+    fastWeight = alpha * fastWeight + (1.0 - alpha);
+
+    alpha = pow(0.5, (double) time / SLOW_HALFLIFE);
+    slow = alpha * slow + (1.0 - alpha) * bps;
+    slowWeight = alpha * slowWeight + (1.0 - alpha);
+}
+
+uint64_t ThroughputEstimator::get() const
+{
+    if(fastWeight <= 0.0 || slowWeight <= 0.0)
+        return 0;
+    /* the weights correct the bias towards the initial zero */
+    double bps = std::min(fast / fastWeight, slow / slowWeight);
+    return (uint64_t) bps;
+}
+
+BufferBasedRule::BufferBasedRule(mtime_t target_) :
+    target(target_), Vp(0.0), gp(0.0), current(0)
+{
+    if(target < CLOCK_FREQ)
+        target = CLOCK_FREQ;
+    /* below that, the buffer level says little and we use the throughput */
+    minimum = target / 3;
+}
+
+void BufferBasedRule::setBitrates(const std::vector<uint64_t> &rates)
+{
+    if(rates == bitrates)
+        return;
+
+    uint64_t previous = bitrates.empty() ? 0 : bitrates[current];
+    bitrates = rates;
+    utilities.clear();
+    current = 0;
+    if(bitrates.empty())
+        return;
+
+    for(unsigned i=0; i<bitrates.size(); i++)
+    {
+        utilities.push_back(log((double) bitrates[i] / bitrates[0]) + 1.0);
+        if(bitrates[i] <= previous)
+            current = i;
+    }
+
+    /* Lowest bitrate picked at the minimum buffer level, highest one
+     * at the target */
+    double umax = utilities.back();
+    double ratio = (double) target / minimum;
+    gp = (umax - 1.0) / (ratio - 1.0);
+    Vp = (double) (target - minimum) / CLOCK_FREQ / (umax + gp);
+}
+
+unsigned BufferBasedRule::selectThroughput(uint64_t throughput) const
+{
+    unsigned i = current;
+    /* up only with some margin, down only once under the current bitrate */
+    while(i + 1 < bitrates.size() && bitrates[i + 1] <= throughput * SAFETY_FACTOR)
+        i++;
+    while(i > 0 && bitrates[i] > throughput)
+        i--;
+    return i;
+}
+
+unsigned BufferBasedRule::selectBuffer(mtime_t buffer) const
+{
+    double level = (double) buffer / CLOCK_FREQ;
+    unsigned best = 0;
+    double bestscore = 0.0;
+    for(unsigned i=0; i<bitrates.size(); i++)
+    {
+        double score = (Vp * (utilities[i] + gp) - level) / bitrates[i];
+        if(i == 0 || score >= bestscore)
+        {
+            best = i;
+            bestscore = score;
+        }
+    }
+    return best;
+}
+
+unsigned BufferBasedRule::select(mtime_t buffer, uint64_t throughput)
+{
+    if(bitrates.empty())
+        return 0;
+
+    /* nothing measured yet: stay low */
+    if(throughput == 0)
+        return current;
+
+    unsigned thr = selectThroughput(throughput);
+    if(buffer < minimum)
+    {
+        current = thr;
+        return current;
+    }
+
+    unsigned bola = selectBuffer(buffer);
+    if(bola > current)
+    {
+        /* the buffer allows more, but not faster than the network */
+        bola = std::min(bola, std::max(current, thr));
+    }
+    current = bola;
+    return current;
+}
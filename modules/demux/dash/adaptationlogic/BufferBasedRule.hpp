@@ -0,0 +1,77 @@
+/*
+ * BufferBasedRule.hpp
+ *****************************************************************************
+ * Copyright (C) 2014 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BUFFERBASEDRULE_HPP
+#define BUFFERBASEDRULE_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vector>
+
+namespace dash
+{
+    namespace logic
+    {
+        /* Download rate smoothed by two exponentially weighted moving
+         * averages over the download time, a fast and a slow one, keeping
+         * the lowest so that drops are followed quickly and peaks slowly */
+        class ThroughputEstimator
+        {
+            public:
+                ThroughputEstimator();
+                void    push(size_t, mtime_t);
+                uint64_t get() const; /* bps, 0 when unknown */
+
+            private:
+                double  fast, fastWeight;
+                double  slow, slowWeight;
+        };
+
+        /* Picks a bitrate from the buffer level with BOLA (Spiteri et al.,
+         * "BOLA: Near-Optimal Bitrate Adaptation for Online Videos"), and
+         * from the throughput while the buffer is too low for it to be
+         * reliable. It never switches up past what the throughput allows,
+         * and switches down only when the throughput is below the current
+         * bitrate, to avoid oscillating. */
+        class BufferBasedRule
+        {
+            public:
+                BufferBasedRule(mtime_t target);
+                void     setBitrates(const std::vector<uint64_t> &); /* ascending */
+                unsigned select(mtime_t buffer, uint64_t throughput);
+
+            private:
+                unsigned selectThroughput(uint64_t throughput) const;
+                unsigned selectBuffer(mtime_t buffer) const;
+
+                std::vector<uint64_t> bitrates;
+                std::vector<double>   utilities;
+                mtime_t               target;
+                mtime_t               minimum;
+                double                Vp;
+                double                gp;
+                unsigned              current;
+        };
+    }
+}
+
+#endif // BUFFERBASEDRULE_HPP
@@ -61,12 +61,17 @@ static void Close   (vlc_object_t *);
 
 #define DASH_LOGIC_TEXT N_("Adaptation Logic")
 
-static const int pi_logics[] = {dash::logic::AbstractAdaptationLogic::RateBased,
+#define DASH_BUFFER_TEXT N_("Buffer duration (ms)")
+#define DASH_BUFFER_LONGTEXT N_("Duration of media to download ahead of the playback, for each stream")
+
+static const int pi_logics[] = {dash::logic::AbstractAdaptationLogic::BufferBased,
+                                dash::logic::AbstractAdaptationLogic::RateBased,
                                 dash::logic::AbstractAdaptationLogic::FixedRate,
                                 dash::logic::AbstractAdaptationLogic::AlwaysLowest,
                                 dash::logic::AbstractAdaptationLogic::AlwaysBest};
 
-static const char *const ppsz_logics[] = { N_("Bandwidth Adaptive"),
+static const char *const ppsz_logics[] = { N_("Buffer and Bandwidth Adaptive"),
+                                           N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
                                            N_("Highest Bandwith/Quality")};
@@ -83,6 +88,7 @@ vlc_module_begin ()
         add_integer( "dash-prefwidth",  480, DASH_WIDTH_TEXT,  DASH_WIDTH_LONGTEXT,  true )
         add_integer( "dash-prefheight", 360, DASH_HEIGHT_TEXT, DASH_HEIGHT_LONGTEXT, true )
         add_integer( "dash-prefbw",     250, DASH_BW_TEXT,     DASH_BW_LONGTEXT,     false )
+        add_integer( "dash-buffer",   10000, DASH_BUFFER_TEXT, DASH_BUFFER_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -188,6 +194,13 @@ static int Demux(demux_t *p_demux)
 
         return VLC_DEMUXER_SUCCESS;
     }
+    else if( !p_sys->p_dashManager->isEOF() )
+    {
+        /* still downloading */
+        if( !p_sys->p_dashManager->updateMPD() )
+            return VLC_DEMUXER_EOF;
+        return VLC_DEMUXER_SUCCESS;
+    }
     else
         return VLC_DEMUXER_EOF;
 }
@@ -37,6 +37,7 @@ Chunk::Chunk        (const std::string& url) :
        length       (0),
        bytesRead    (0),
        bytesToRead  (0),
+       duration     (0),
        connection   (NULL)
 {
     this->url = url;
@@ -100,6 +101,14 @@ int                 Chunk::getBitrate           ()
 {
     return this->bitrate;
 }
+void                Chunk::setDuration          (mtime_t duration)
+{
+    this->duration = duration;
+}
+mtime_t             Chunk::getDuration          () const
+{
+    return this->duration;
+}
 const std::string&  Chunk::getHostname          () const
 {
     return hostname;
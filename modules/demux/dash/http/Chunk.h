@@ -70,6 +70,8 @@ namespace dash
                 bool                usesByteRange   () const;
                 void                setBitrate      (uint64_t bitrate);
                 int                 getBitrate      ();
+                void                setDuration     (mtime_t duration);
+                mtime_t             getDuration     () const;
 
                 virtual void        onDownload      (void *, size_t) {}
 
@@ -85,6 +87,7 @@ namespace dash
                 uint64_t                    length;
                 uint64_t                    bytesRead;
                 uint64_t                    bytesToRead;
+                mtime_t                     duration;
                 HTTPConnection             *connection;
         };
     }
@@ -0,0 +1,517 @@
+/*****************************************************************************
+ * cluster_indexer.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "cluster_indexer.hpp"
+
+#include <vlc_fs.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* EBML IDs, with their length marker */
+#define MKV_ID_CLUSTER          0x1F43B675
+#define MKV_ID_CUES             0x1C53BB6B
+#define MKV_ID_SEEKHEAD         0x114D9B74
+#define MKV_ID_INFO             0x1549A966
+#define MKV_ID_TRACKS           0x1654AE6B
+#define MKV_ID_CHAPTERS         0x1043A770
+#define MKV_ID_ATTACHMENTS      0x1941A469
+#define MKV_ID_TAGS             0x1254C367
+#define MKV_ID_CLUSTERTIMECODE  0xE7
+#define MKV_ID_SIMPLEBLOCK      0xA3
+#define MKV_ID_BLOCKGROUP       0xA0
+#define MKV_ID_BLOCK            0xA1
+#define MKV_ID_REFERENCEBLOCK   0xFB
+#define MKV_ID_VOID             0xEC
+#define MKV_ID_CRC32            0xBF
+
+#define MKV_SIZE_UNKNOWN        UINT64_MAX
+
+/* index file layout, all values big endian:
+ *  - magic (8 bytes)
+ *  - segment data position (8), file size (8), file modification time (8),
+ *    complete flag (1), number of clusters (4)
+ *  - per cluster: position (8), time (8), key flag (1) */
+static const char index_magic[8] = { 'V', 'L', 'C', 'M', 'K', 'V', 'I', '2' };
+#define INDEX_HEADER_SIZE 37
+#define INDEX_ENTRY_SIZE  17
+
+/* Parses an EBML variable size integer, returns its length or 0 */
+static int ParseVint( const uint8_t *p, int i_peek, uint64_t *pi_value,
+                      bool b_marker )
+{
+    if( i_peek < 1 || p[0] == 0 )
+        return 0;
+
+    int i_len = 1;
+    uint8_t i_mask = 0x80;
+    while( !(p[0] & i_mask) )
+    {
+        i_mask >>= 1;
+        i_len++;
+    }
+    if( i_len > i_peek )
+        return 0;
+
+    uint64_t i_value = b_marker ? p[0] : p[0] & (i_mask - 1);
+    bool b_all_ones = (p[0] & (i_mask - 1)) == i_mask - 1;
+    for( int i = 1; i < i_len; i++ )
+    {
+        i_value = (i_value << 8) | p[i];
+        b_all_ones &= p[i] == 0xFF;
+    }
+    *pi_value = ( !b_marker && b_all_ones ) ? MKV_SIZE_UNKNOWN : i_value;
+    return i_len;
+}
+
+/* Reads an element header at the current position and moves to its data */
+static bool ReadHeader( stream_t *s, uint32_t *pi_id, uint64_t *pi_size,
+                        uint64_t *pi_data )
+{
+    const uint8_t *p_peek;
+    uint64_t i_id;
+    int i_peek = stream_Peek( s, &p_peek, 12 );
+    int i_id_len = ParseVint( p_peek, i_peek, &i_id, true );
+    if( i_id_len == 0 || i_id_len > 4 )
+        return false;
+
+    int i_size_len = ParseVint( &p_peek[i_id_len], i_peek - i_id_len,
+                                pi_size, false );
+    if( i_size_len == 0 )
+        return false;
+
+    *pi_id = i_id;
+    *pi_data = stream_Tell( s ) + i_id_len + i_size_len;
+    return stream_Seek( s, *pi_data ) == VLC_SUCCESS;
+}
+
+static bool IsTopLevel( uint32_t i_id )
+{
+    switch( i_id )
+    {
+        case MKV_ID_CLUSTER:
+        case MKV_ID_CUES:
+        case MKV_ID_SEEKHEAD:
+        case MKV_ID_INFO:
+        case MKV_ID_TRACKS:
+        case MKV_ID_CHAPTERS:
+        case MKV_ID_ATTACHMENTS:
+        case MKV_ID_TAGS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+cluster_indexer_c::cluster_indexer_c( demux_t *p_demux_, stream_t *s_,
+                                      const std::string & file_,
+                                      int64_t i_segment_start_,
+                                      int64_t i_segment_end_,
+                                      uint64_t i_timescale_,
+                                      const std::vector<unsigned> & video_tracks_ )
+    :p_demux(p_demux_)
+    ,s(s_)
+    ,file(file_)
+    ,i_segment_start(i_segment_start_)
+    ,i_segment_end(i_segment_end_)
+    ,i_timescale(i_timescale_)
+    ,video_tracks(video_tracks_)
+    ,b_started(false)
+    ,b_done(false)
+    ,b_dirty(false)
+    ,b_complete(false)
+    ,b_verify(false)
+    ,i_file_size(0)
+    ,i_file_mtime(0)
+    ,i_next(0)
+    ,i_duration(0)
+{
+    if( !file.empty() )
+        index_file = file + ".mkvindex";
+}
+
+cluster_indexer_c::~cluster_indexer_c()
+{
+    if( b_dirty && !index_file.empty() )
+        Save();
+}
+
+bool cluster_indexer_c::Start()
+{
+    bool b_fastseek;
+
+    /* every pass seeks the stream of the demuxer away and back */
+    if( stream_Control( s, STREAM_CAN_FASTSEEK, &b_fastseek ) || !b_fastseek )
+    {
+        msg_Dbg( p_demux, "not indexing clusters of a slow stream" );
+        return false;
+    }
+
+    struct stat st;
+
+    if( !file.empty() && vlc_stat( file.c_str(), &st ) == 0 )
+    {
+        i_file_mtime = st.st_mtime;
+        if( Load() )
+            msg_Dbg( p_demux, "loaded %zu clusters from %s", clusters.size(),
+                     index_file.c_str() );
+    }
+    return true;
+}
+
+bool cluster_indexer_c::Get( std::vector<mkv_index_t> & out ) const
+{
+    /* the loaded clusters may be stale until checked */
+    if( b_verify )
+        out.clear();
+    else
+        out = clusters;
+    return b_done;
+}
+
+bool cluster_indexer_c::IsVideoTrack( uint64_t i_number ) const
+{
+    return std::find( video_tracks.begin(), video_tracks.end(),
+                      i_number ) != video_tracks.end();
+}
+
+/* Picks where the first pass starts, from the loaded index if any */
+void cluster_indexer_c::Resume()
+{
+    uint64_t i_size = stream_Size( s );
+
+    b_started = true;
+    i_next = i_segment_start;
+    if( b_complete && i_size == i_file_size )
+    {
+        b_done = true;
+        return;
+    }
+
+    if( i_size < i_file_size )
+        clusters.clear(); /* not the file that was indexed */
+    i_file_size = i_size;
+
+    /* resume from the last known cluster, it may have grown */
+    if( !clusters.empty() )
+    {
+        mkv_index_t last = clusters.back();
+        clusters.pop_back();
+
+        /* modified since indexed: only resume an appended file */
+        if( b_verify && !SameCluster( last ) )
+        {
+            msg_Dbg( p_demux, "file changed, indexing clusters again" );
+            clusters.clear();
+        }
+        else
+            i_next = last.i_position;
+    }
+    b_verify = false;
+}
+
+bool cluster_indexer_c::Index( mtime_t i_deadline, mtime_t i_time )
+{
+    if( b_done )
+        return true;
+
+    const uint64_t i_saved = stream_Tell( s );
+    const mtime_t i_start = mdate();
+
+    if( !b_started )
+        Resume();
+
+    bool b_end = true;
+    while( !b_done && i_next < (uint64_t)i_segment_end )
+    {
+        if( mdate() >= i_deadline ||
+            ( i_time >= 0 && !clusters.empty() && clusters.back().i_time > i_time ) )
+        {
+            b_end = false;
+            break;
+        }
+
+        uint32_t i_id;
+        uint64_t i_element_size, i_data;
+
+        if( stream_Seek( s, i_next ) ||
+            !ReadHeader( s, &i_id, &i_element_size, &i_data ) )
+            break;
+
+        if( i_id == MKV_ID_CLUSTER )
+        {
+            mkv_index_t idx;
+
+            idx.i_track        = -1;
+            idx.i_block_number = -1;
+            idx.i_position     = i_next;
+            idx.i_time         = -1;
+            idx.b_key          = video_tracks.empty();
+
+            bool b_ok = ScanCluster( &idx, i_data, i_element_size, &i_next );
+            if( idx.i_time >= 0 )
+            {
+                clusters.push_back( idx );
+                b_dirty = true;
+            }
+            if( !b_ok )
+                break;
+        }
+        else if( ( IsTopLevel( i_id ) || i_id == MKV_ID_VOID ||
+                   i_id == MKV_ID_CRC32 ) && i_element_size != MKV_SIZE_UNKNOWN )
+            i_next = i_data + i_element_size;
+        else
+            break; /* damaged or not a segment child */
+    }
+
+    /* the parser of the demuxer only keeps the stream position */
+    if( stream_Seek( s, i_saved ) )
+        msg_Err( p_demux, "cannot restore the stream position %" PRIu64,
+                 i_saved );
+
+    i_duration += mdate() - i_start;
+    if( b_end && !b_done )
+    {
+        b_done = true;
+        msg_Dbg( p_demux, "indexed %zu clusters in %" PRId64 " ms",
+                 clusters.size(), i_duration / 1000 );
+    }
+    return b_done;
+}
+
+/* Checks that a cluster indexed before is still found at its position */
+bool cluster_indexer_c::SameCluster( const mkv_index_t & last )
+{
+    uint32_t i_id;
+    uint64_t i_element_size, i_data, i_next;
+    mkv_index_t idx;
+
+    if( stream_Seek( s, last.i_position ) != VLC_SUCCESS ||
+        !ReadHeader( s, &i_id, &i_element_size, &i_data ) ||
+        i_id != MKV_ID_CLUSTER )
+        return false;
+
+    idx.i_time = -1;
+    idx.b_key  = false;
+    ScanCluster( &idx, i_data, i_element_size, &i_next );
+    return idx.i_time == last.i_time && idx.b_key == last.b_key;
+}
+
+/* Walks the children of a cluster for its timecode and a video key frame.
+ * Returns false if the end of the cluster could not be found. */
+bool cluster_indexer_c::ScanCluster( mkv_index_t *p_idx, uint64_t i_data,
+                                     uint64_t i_size, uint64_t *pi_next )
+{
+    const bool b_unknown_size = i_size == MKV_SIZE_UNKNOWN;
+    const uint64_t i_end = b_unknown_size ? UINT64_MAX : i_data + i_size;
+    uint64_t i_pos = i_data;
+
+    while( i_pos < i_end )
+    {
+        uint32_t i_id;
+        uint64_t i_child_size, i_child_data;
+        const uint8_t *p_peek;
+
+        if( stream_Seek( s, i_pos ) ||
+            !ReadHeader( s, &i_id, &i_child_size, &i_child_data ) )
+        {
+            /* truncated file: the cluster ends here */
+            *pi_next = i_pos;
+            return false;
+        }
+        if( b_unknown_size && IsTopLevel( i_id ) )
+        {
+            *pi_next = i_pos;
+            return true;
+        }
+        if( i_child_size == MKV_SIZE_UNKNOWN )
+            break;
+
+        switch( i_id )
+        {
+            case MKV_ID_CLUSTERTIMECODE:
+            {
+                if( i_child_size > 8 ||
+                    stream_Peek( s, &p_peek, i_child_size ) < (int)i_child_size )
+                    break;
+                uint64_t i_timecode = 0;
+                for( uint64_t i = 0; i < i_child_size; i++ )
+                    i_timecode = (i_timecode << 8) | p_peek[i];
+                p_idx->i_time = i_timecode * i_timescale / 1000;
+                break;
+            }
+            case MKV_ID_SIMPLEBLOCK:
+            {
+                uint64_t i_track;
+                int i_peek = stream_Peek( s, &p_peek, 11 );
+                int i_len = ParseVint( p_peek, i_peek, &i_track, false );
+                if( i_len > 0 && i_peek >= i_len + 3 &&
+                    ( p_peek[i_len + 2] & 0x80 ) && IsVideoTrack( i_track ) )
+                    p_idx->b_key = true;
+                break;
+            }
+            case MKV_ID_BLOCKGROUP:
+            {
+                uint64_t i_track = 0;
+                bool b_reference = false;
+                uint64_t i_group = i_child_data;
+
+                while( i_group < i_child_data + i_child_size )
+                {
+                    uint32_t i_group_id;
+                    uint64_t i_group_size, i_group_data;
+
+                    if( stream_Seek( s, i_group ) ||
+                        !ReadHeader( s, &i_group_id, &i_group_size, &i_group_data ) ||
+                        i_group_size == MKV_SIZE_UNKNOWN )
+                        break;
+
+                    if( i_group_id == MKV_ID_BLOCK )
+                    {
+                        int i_peek = stream_Peek( s, &p_peek, 8 );
+                        if( ParseVint( p_peek, i_peek, &i_track, false ) == 0 )
+                            i_track = 0;
+                    }
+                    else if( i_group_id == MKV_ID_REFERENCEBLOCK )
+                        b_reference = true;
+                    i_group = i_group_data + i_group_size;
+                }
+                if( !b_reference && IsVideoTrack( i_track ) )
+                    p_idx->b_key = true;
+                break;
+            }
+            default:
+                break;
+        }
+
+        i_pos = i_child_data + i_child_size;
+
+        /* no need to look further, skip the payloads at once */
+        if( !b_unknown_size && p_idx->i_time >= 0 && p_idx->b_key )
+            break;
+    }
+
+    if( b_unknown_size )
+    {
+        *pi_next = i_pos;
+        return false;
+    }
+    *pi_next = i_end;
+    return true;
+}
+
+bool cluster_indexer_c::Load()
+{
+    FILE *p_file = vlc_fopen( index_file.c_str(), "rb" );
+    if( p_file == NULL )
+        return false;
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    bool b_ok = fread( header, sizeof( header ), 1, p_file ) == 1 &&
+                !memcmp( header, index_magic, sizeof( index_magic ) ) &&
+                (int64_t)GetQWBE( &header[8] ) == i_segment_start;
+    if( b_ok )
+    {
+        uint64_t i_saved_size = GetQWBE( &header[16] );
+        int64_t i_saved_mtime = GetQWBE( &header[24] );
+        bool b_saved_complete = header[32];
+        uint32_t i_count = GetDWBE( &header[33] );
+        std::vector<mkv_index_t> loaded;
+        uint8_t entry[INDEX_ENTRY_SIZE];
+
+        for( uint32_t i = 0; i < i_count; i++ )
+        {
+            if( fread( entry, sizeof( entry ), 1, p_file ) != 1 )
+            {
+                b_ok = false;
+                break;
+            }
+
+            mkv_index_t idx;
+            idx.i_track        = -1;
+            idx.i_block_number = -1;
+            idx.i_position     = GetQWBE( &entry[0] );
+            idx.i_time         = GetQWBE( &entry[8] );
+            idx.b_key          = entry[16];
+            if( idx.i_position < i_segment_start ||
+                ( !loaded.empty() && idx.i_position <= loaded.back().i_position ) )
+            {
+                b_ok = false;
+                break;
+            }
+            loaded.push_back( idx );
+        }
+
+        if( b_ok )
+        {
+            clusters.swap( loaded );
+            i_file_size = i_saved_size;
+            /* the size alone does not tell a rewritten file apart */
+            b_verify = i_saved_mtime != i_file_mtime;
+            b_complete = b_saved_complete && !b_verify;
+        }
+    }
+    fclose( p_file );
+
+    if( !b_ok )
+        msg_Warn( p_demux, "ignoring invalid index %s", index_file.c_str() );
+    return b_ok;
+}
+
+void cluster_indexer_c::Save() const
+{
+    std::string tmp_file = index_file + ".part";
+    FILE *p_file = vlc_fopen( tmp_file.c_str(), "wb" );
+    if( p_file == NULL )
+    {
+        msg_Dbg( p_demux, "cannot save index to %s", index_file.c_str() );
+        return;
+    }
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    memcpy( header, index_magic, sizeof( index_magic ) );
+    SetQWBE( &header[8], i_segment_start );
+    SetQWBE( &header[16], i_file_size );
+    SetQWBE( &header[24], i_file_mtime );
+    header[32] = b_done;
+    SetDWBE( &header[33], clusters.size() );
+    bool b_ok = fwrite( header, sizeof( header ), 1, p_file ) == 1;
+
+    for( size_t i = 0; b_ok && i < clusters.size(); i++ )
+    {
+        uint8_t entry[INDEX_ENTRY_SIZE];
+        SetQWBE( &entry[0], clusters[i].i_position );
+        SetQWBE( &entry[8], clusters[i].i_time );
+        entry[16] = clusters[i].b_key;
+        b_ok = fwrite( entry, sizeof( entry ), 1, p_file ) == 1;
+    }
+
+    if( fclose( p_file ) != 0 )
+        b_ok = false;
+    if( !b_ok || vlc_rename( tmp_file.c_str(), index_file.c_str() ) )
+    {
+        msg_Dbg( p_demux, "cannot save index to %s", index_file.c_str() );
+        vlc_unlink( tmp_file.c_str() );
+        return;
+    }
+    msg_Dbg( p_demux, "saved %zu clusters to %s", clusters.size(),
+             index_file.c_str() );
+}
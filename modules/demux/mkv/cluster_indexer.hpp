@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * cluster_indexer.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _CLUSTER_INDEXER_HPP_
+#define _CLUSTER_INDEXER_HPP_
+
+#include "mkv.hpp"
+
+/*****************************************************************************
+ * Indexing of segments without cues
+ *****************************************************************************
+ * The indexer walks the cluster headers only, skipping the block payloads,
+ * so that seeking does not have to scan the file linearly. Each cluster gets
+ * one entry, flagged as key if it holds a key frame of a video track.
+ *
+ * It reads through the stream of the demuxer, so that the stream filters
+ * stacked on it are used, in short passes run by the demuxer thread. Each
+ * pass restores the stream position, which is all the EBML parser keeps.
+ *
+ * The index can be saved next to the file and is then reloaded and
+ * completed (if the file grew) on later opens. It is keyed by the size and
+ * modification time of the file, and a modified file is only resumed if the
+ * last indexed cluster is still found at its position.
+ *****************************************************************************/
+class cluster_indexer_c
+{
+public:
+    cluster_indexer_c( demux_t *, stream_t *, const std::string & file,
+                       int64_t i_segment_start, int64_t i_segment_end,
+                       uint64_t i_timescale,
+                       const std::vector<unsigned> & video_tracks );
+    ~cluster_indexer_c();
+
+    bool Start();
+
+    /* Indexes until the deadline, or until a cluster past the given time
+     * (if not negative) is found. Returns true once the whole segment has
+     * been indexed. */
+    bool Index( mtime_t i_deadline, mtime_t i_time );
+
+    /* Copies the clusters found so far, sorted by position.
+     * Returns true once the whole segment has been indexed. */
+    bool Get( std::vector<mkv_index_t> & clusters ) const;
+
+private:
+    void Resume();
+    bool ScanCluster( mkv_index_t *, uint64_t i_data, uint64_t i_size,
+                      uint64_t *pi_next );
+    bool SameCluster( const mkv_index_t & );
+    bool IsVideoTrack( uint64_t i_number ) const;
+
+    bool Load();
+    void Save() const;
+
+    demux_t               *p_demux;
+    stream_t              *s;
+    std::string           file;        /* local file, if the index is saved */
+    std::string           index_file;
+    int64_t               i_segment_start;
+    int64_t               i_segment_end;
+    uint64_t              i_timescale;
+    std::vector<unsigned> video_tracks;
+
+    bool                  b_started;
+    bool                  b_done;
+    bool                  b_dirty;
+    bool                  b_complete;  /* as loaded from the index file */
+    bool                  b_verify;    /* file modified since indexed */
+    uint64_t              i_file_size;
+    int64_t               i_file_mtime;
+    uint64_t              i_next;      /* where the next pass starts */
+    mtime_t               i_duration;  /* spent indexing so far */
+    std::vector<mkv_index_t> clusters;
+};
+
+#endif
@@ -27,6 +27,8 @@
 #include "demux.hpp"
 #include "util.hpp"
 #include "Ebml_parser.hpp"
+#include "cluster_indexer.hpp"
+#include "stream_io_callback.hpp"
 
 matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estream )
     :segment(NULL)
@@ -52,6 +54,9 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,b_cues(false)
     ,i_index(0)
     ,i_index_max(1024)
+    ,p_indexer(NULL)
+    ,i_indexer_count(0)
+    ,i_indexer_date(0)
     ,psz_muxing_application(NULL)
     ,psz_writing_application(NULL)
     ,psz_segment_filename(NULL)
@@ -68,6 +73,8 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
 
 matroska_segment_c::~matroska_segment_c()
 {
+    delete p_indexer;
+
     for( size_t i_track = 0; i_track < tracks.size(); i_track++ )
     {
         delete tracks[i_track]->p_compression_data;
@@ -604,6 +611,105 @@ void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
 #undef idx
 }
 
+/* Passes of the indexer, run between the blocks by the demuxer thread */
+#define INDEXER_PASS        (CLOCK_FREQ / 100)
+#define INDEXER_PERIOD      (CLOCK_FREQ / 10)
+/* at most, when seeking past the indexed clusters */
+#define INDEXER_SEEK_PASS   (CLOCK_FREQ / 2)
+
+void matroska_segment_c::IndexerStart()
+{
+    demux_t *p_demux = &sys.demuxer;
+    stream_t *s = static_cast<vlc_stream_io_callback &>( es.I_O() ).GetStream();
+    std::vector<unsigned> video_tracks;
+    std::string file;
+
+    if( b_cues || p_indexer )
+        return;
+
+    for( size_t i = 0; i < tracks.size(); i++ )
+        if( tracks[i]->fmt.i_cat == VIDEO_ES )
+            video_tracks.push_back( tracks[i]->i_number );
+
+    if( s == p_demux->s && p_demux->psz_file &&
+        !strcmp( p_demux->psz_access, "file" ) &&
+        var_InheritBool( p_demux, "mkv-index-file" ) )
+        file = p_demux->psz_file;
+
+    int64_t i_data_start = segment->GetGlobalPosition( 0 );
+    int64_t i_data_end = segment->IsFiniteSize() ?
+                         segment->GetGlobalPosition( segment->GetSize() ) : INT64_MAX;
+
+    p_indexer = new cluster_indexer_c( p_demux, s, file,
+                                       i_data_start, i_data_end, i_timescale,
+                                       video_tracks );
+    if( !p_indexer->Start() )
+    {
+        delete p_indexer;
+        p_indexer = NULL;
+    }
+}
+
+/* Runs a short indexing pass now and then during playback */
+void matroska_segment_c::IndexerStep()
+{
+    if( p_indexer == NULL || b_cues )
+        return;
+
+    mtime_t i_now = mdate();
+    if( i_now < i_indexer_date )
+        return;
+
+    if( p_indexer->Index( i_now + INDEXER_PASS, -1 ) )
+        i_indexer_date = INT64_MAX;
+    else
+        i_indexer_date = i_now + INDEXER_PERIOD;
+}
+
+/* Takes the clusters found by the indexer into the index, after indexing
+ * up to the given date if not negative. The clusters found by playback past
+ * the indexed part are kept. */
+void matroska_segment_c::IndexMerge( mtime_t i_date )
+{
+    std::vector<mkv_index_t> clusters;
+
+    if( p_indexer == NULL || b_cues )
+        return;
+
+    if( i_date >= 0 )
+        p_indexer->Index( mdate() + INDEXER_SEEK_PASS, i_date );
+
+    bool b_done = p_indexer->Get( clusters );
+    if( clusters.size() > i_indexer_count )
+    {
+        int64_t i_last = clusters.back().i_position;
+        int i_keep = 0;
+        while( i_keep < i_index && p_indexes[i_keep].i_position <= i_last )
+            i_keep++;
+
+        int i_count = clusters.size() + i_index - i_keep;
+        if( i_count >= i_index_max )
+        {
+            i_index_max = i_count + 1024;
+            p_indexes = (mkv_index_t*)xrealloc( p_indexes,
+                                                sizeof( mkv_index_t ) * i_index_max );
+        }
+        memmove( &p_indexes[clusters.size()], &p_indexes[i_keep],
+                 sizeof( mkv_index_t ) * ( i_index - i_keep ) );
+        memcpy( p_indexes, &clusters[0], sizeof( mkv_index_t ) * clusters.size() );
+        i_index = i_count;
+        i_indexer_count = clusters.size();
+    }
+
+    if( b_done && !clusters.empty() )
+    {
+        /* the index is now as complete as cues would be */
+        msg_Dbg( &sys.demuxer, "using %zu indexed clusters as cues",
+                 clusters.size() );
+        b_cues = true;
+    }
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -861,6 +967,8 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
     for( size_t i = 0; i < tracks.size(); i++)
         tracks[i]->i_last_dts = VLC_TS_INVALID;
 
+    IndexMerge( i_date - i_time_offset );
+
     if( i_global_position >= 0 )
     {
         /* Special case for seeking in files with no cues */
@@ -923,6 +1031,10 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
         if( i_idx > 0 )
             i_idx--;
 
+        /* clusters found by the indexer may not start with a key frame */
+        while( i_idx > 0 && !p_indexes[i_idx].b_key )
+            i_idx--;
+
         i_seek_position = p_indexes[i_idx].i_position;
         i_seek_time = p_indexes[i_idx].i_time;
     }
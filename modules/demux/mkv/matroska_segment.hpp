@@ -28,6 +28,7 @@
 #include "mkv.hpp"
 
 class EbmlParser;
+class cluster_indexer_c;
 
 class chapter_edition_c;
 class chapter_translation_c;
@@ -110,6 +111,9 @@ public:
     int                     i_index;
     int                     i_index_max;
     mkv_index_t             *p_indexes;
+    cluster_indexer_c       *p_indexer;   /* NULL if cues were found */
+    size_t                  i_indexer_count;
+    mtime_t                 i_indexer_date; /* of the next indexing pass */
 
     /* info */
     char                    *psz_muxing_application;
@@ -145,6 +149,10 @@ public:
     bool Select( mtime_t i_start_time );
     void UnSelect();
 
+    void IndexerStart();
+    void IndexerStep();
+    void IndexMerge( mtime_t i_date );
+
     static bool CompareSegmentUIDs( const matroska_segment_c * item_a, const matroska_segment_c * item_b );
 
 private:
@@ -70,6 +70,16 @@ vlc_module_begin ()
             N_("Dummy Elements"),
             N_("Read and discard unknown EBML elements (not good for broken files)."), true );
 
+    add_bool( "mkv-index-clusters", true,
+            N_("Index clusters of files without cues"),
+            N_("Look for the clusters of files without cues during playback "
+               "and when seeking, for fast and precise seeking."), true );
+
+    add_bool( "mkv-index-file", false,
+            N_("Save cluster index"),
+            N_("Save the clusters found in files without cues next to the file "
+               "(.mkvindex) and reuse them when the file is opened again."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -247,6 +257,9 @@ static int Open( vlc_object_t * p_this )
 
     p_sys->FreeUnused();
 
+    if( !p_segment->b_cues && var_InheritBool( p_demux, "mkv-index-clusters" ) )
+        p_segment->IndexerStart();
+
     p_sys->InitUi();
 
     return VLC_SUCCESS;
@@ -452,6 +465,8 @@ static void Seek( demux_t *p_demux, mtime_t i_date, double f_percent, virtual_ch
         return;
     }
 
+    p_segment->IndexMerge( i_date );
+
     /* seek without index or without date */
     if( f_percent >= 0 && (var_InheritBool( p_demux, "mkv-seek-percent" ) || !p_segment->b_cues || i_date < 0 ))
     {
@@ -707,6 +722,8 @@ static int Demux( demux_t *p_demux)
     }
     int i_return = 0;
 
+    p_segment->IndexerStep();
+
     do
     {
         if( p_sys->i_pts >= p_sys->i_start_pts  )
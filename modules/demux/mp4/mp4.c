@@ -36,6 +36,7 @@
 #include <vlc_charset.h>                           /* EnsureUTF8 */
 #include <vlc_input.h>
 #include <vlc_aout.h>
+#include <vlc_atomic.h>
 #include <assert.h>
 #include <limits.h>
 
@@ -45,6 +46,13 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define READAHEAD_TEXT N_("Read-ahead size (KiB)")
+#define READAHEAD_LONGTEXT N_( \
+    "Amount of sample data the demuxer may read ahead with a single read " \
+    "when the samples of the selected tracks are stored next to each " \
+    "other. This avoids one seek per sample on badly interleaved files " \
+    "and remote sources. 0 reads one sample at a time." )
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -52,6 +60,8 @@ vlc_module_begin ()
     set_shortname( N_("MP4") )
     set_capability( "demux", 240 )
     set_callbacks( Open, Close )
+
+    add_integer( "mp4-readahead", 4096, READAHEAD_TEXT, READAHEAD_LONGTEXT, true )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -64,6 +74,27 @@ static int   DemuxAsLeaf( demux_t * );
 static int   Seek    ( demux_t *, mtime_t );
 static int   Control ( demux_t *, int, va_list );
 
+/* Bytes held by the read-ahead windows, outliving the demuxer as long as
+ * blocks sliced from them are alive */
+typedef struct
+{
+    atomic_uint   refs;      /* demuxer and live windows */
+    atomic_size_t i_held;    /* windows cached or pinned by slices */
+} mp4_readahead_pool_t;
+
+/* Sample data read with a single I/O and shared by the blocks sliced from it */
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *p_data;
+    uint64_t    i_pos;       /* file offset of the first byte */
+    mp4_readahead_pool_t *p_pool;
+} mp4_readahead_t;
+
+#define MP4_READAHEAD_WINDOWS 4
+/* holes smaller than this between samples are read through, not skipped */
+#define MP4_READAHEAD_GAP     (32 * 1024)
+
 struct demux_sys_t
 {
     MP4_Box_t    *p_root;      /* container for the whole file */
@@ -110,6 +141,20 @@ struct demux_sys_t
     uint64_t i_preroll;         /* foobar */
     int64_t  i_preroll_start;
     mp4_track_t *p_current_track; /* avoids matching stream_number */
+
+    /* Read-ahead of the non fragmented demuxer */
+    struct
+    {
+        mp4_readahead_t *window[MP4_READAHEAD_WINDOWS]; /* most recent first */
+        uint64_t         i_budget;    /* 0 if disabled */
+        mp4_readahead_pool_t *p_pool;
+
+        /* statistics */
+        uint64_t         i_reads;
+        uint64_t         i_seeks;
+        uint64_t         i_bytes;
+        mtime_t          i_time;
+    } readahead;
 };
 
 /*****************************************************************************
@@ -231,6 +276,18 @@ static MP4_Box_t * MP4_GetTrakByTrackID( MP4_Box_t *p_moov, const uint32_t i_id
 }
 
 /* Return time in microsecond of a track */
+/* Number of samples of the i-th dts run, as seen from the chunk */
+static inline uint32_t MP4_ChunkDTSRun( const mp4_chunk_t *ck, unsigned i )
+{
+    return ck->p_sample_count_dts[i] - ( i == 0 ? ck->i_dts_skip : 0 );
+}
+
+/* Number of samples of the i-th pts run, as seen from the chunk */
+static inline uint32_t MP4_ChunkPTSRun( const mp4_chunk_t *ck, unsigned i )
+{
+    return ck->p_sample_count_pts[i] - ( i == 0 ? ck->i_pts_skip : 0 );
+}
+
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -241,25 +298,48 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
         p_chunk = &p_track->chunk[p_track->i_chunk];
 
     unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
+    uint32_t i_in_run = 0;
+    uint32_t i_sample = p_track->i_sample - p_chunk->i_sample_first;
+    uint32_t i_done = 0;
     int64_t i_dts = p_chunk->i_first_dts;
 
-    while( i_sample > 0 )
+    /* Resume from the previous sample of the same chunk if possible */
+    if( !p_sys->b_fragmented && p_track->cursor.i_chunk == p_track->i_chunk &&
+        p_track->cursor.i_sample <= i_sample )
+    {
+        i_index = p_track->cursor.i_dts_index;
+        i_in_run = p_track->cursor.i_dts_in_run;
+        i_done = p_track->cursor.i_sample;
+        i_dts = p_track->cursor.i_dts;
+    }
+
+    for( uint32_t i_todo = i_sample - i_done; i_todo > 0; )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        uint32_t i_run = MP4_ChunkDTSRun( p_chunk, i_index ) - i_in_run;
+        if( i_todo >= i_run )
         {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_dts += (int64_t)i_run * p_chunk->p_sample_delta_dts[i_index];
+            i_todo -= i_run;
             i_index++;
+            i_in_run = 0;
         }
         else
         {
-            i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            i_dts += (int64_t)i_todo * p_chunk->p_sample_delta_dts[i_index];
+            i_in_run += i_todo;
             break;
         }
     }
 
+    if( !p_sys->b_fragmented )
+    {
+        p_track->cursor.i_chunk = p_track->i_chunk;
+        p_track->cursor.i_sample = i_sample;
+        p_track->cursor.i_dts_index = i_index;
+        p_track->cursor.i_dts_in_run = i_in_run;
+        p_track->cursor.i_dts = i_dts;
+    }
+
     /* now handle elst */
     if( p_track->p_elst )
     {
@@ -302,14 +382,14 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
 
     for( i_index = 0;; i_index++ )
     {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
+        if( i_sample < MP4_ChunkPTSRun( ck, i_index ) )
         {
             *pi_delta = ck->p_sample_offset_pts[i_index] * CLOCK_FREQ /
                         (int64_t)p_track->i_timescale;
             return true;
         }
 
-        i_sample -= ck->p_sample_count_pts[i_index];
+        i_sample -= MP4_ChunkPTSRun( ck, i_index );
     }
     return false;
 }
@@ -478,12 +558,8 @@ static block_t * MP4_EIA608_Convert( block_t * p_block )
     return p_newblock;
 }
 
-static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, int i_size )
+static block_t * MP4_Block_Encap( const mp4_track_t *p_track, block_t *p_block )
 {
-    block_t *p_block = stream_Block( p_demux->s, i_size );
-    if ( !p_block )
-        return NULL;
-
     /* might have some encap */
     if( p_track->fmt.i_cat == SPU_ES )
     {
@@ -505,6 +581,277 @@ static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, i
     return p_block;
 }
 
+static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, int i_size )
+{
+    block_t *p_block = stream_Block( p_demux->s, i_size );
+    if ( !p_block )
+        return NULL;
+
+    return MP4_Block_Encap( p_track, p_block );
+}
+
+/*****************************************************************************
+ * Read-ahead: samples of the selected tracks stored next to each other are
+ * read with a single stream_Block() then handed out as slices of that buffer.
+ *****************************************************************************/
+typedef struct
+{
+    block_t          self;
+    mp4_readahead_t *p_window;
+} mp4_readahead_slice_t;
+
+static void MP4_ReadAheadPoolRelease( mp4_readahead_pool_t *p_pool )
+{
+    if( atomic_fetch_sub( &p_pool->refs, 1 ) == 1 )
+        free( p_pool );
+}
+
+static void MP4_ReadAheadRelease( mp4_readahead_t *p_window )
+{
+    if( atomic_fetch_sub( &p_window->refs, 1 ) == 1 )
+    {
+        atomic_fetch_sub( &p_window->p_pool->i_held,
+                          p_window->p_data->i_buffer );
+        MP4_ReadAheadPoolRelease( p_window->p_pool );
+        block_Release( p_window->p_data );
+        free( p_window );
+    }
+}
+
+static void MP4_ReadAheadSliceRelease( block_t *p_block )
+{
+    mp4_readahead_slice_t *p_slice = (mp4_readahead_slice_t *)p_block;
+
+    MP4_ReadAheadRelease( p_slice->p_window );
+    free( p_slice );
+}
+
+static block_t * MP4_ReadAheadSlice( mp4_readahead_t *p_window,
+                                     uint64_t i_pos, uint32_t i_size )
+{
+    mp4_readahead_slice_t *p_slice = malloc( sizeof( *p_slice ) );
+    if( !p_slice )
+        return NULL;
+
+    block_Init( &p_slice->self,
+                &p_window->p_data->p_buffer[i_pos - p_window->i_pos], i_size );
+    p_slice->self.pf_release = MP4_ReadAheadSliceRelease;
+    p_slice->p_window = p_window;
+    atomic_fetch_add( &p_window->refs, 1 );
+    return &p_slice->self;
+}
+
+static void MP4_ReadAheadFlush( demux_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < MP4_READAHEAD_WINDOWS; i++ )
+    {
+        if( p_sys->readahead.window[i] )
+            MP4_ReadAheadRelease( p_sys->readahead.window[i] );
+        p_sys->readahead.window[i] = NULL;
+    }
+}
+
+/* Returns the data at [i_pos, i_pos + i_size) if it was already read */
+static block_t * MP4_ReadAheadGet( demux_sys_t *p_sys,
+                                   uint64_t i_pos, uint32_t i_size )
+{
+    mp4_readahead_t **window = p_sys->readahead.window;
+
+    for( unsigned i = 0; i < MP4_READAHEAD_WINDOWS && window[i]; i++ )
+    {
+        mp4_readahead_t *p_window = window[i];
+
+        if( i_pos < p_window->i_pos ||
+            i_pos + i_size > p_window->i_pos + p_window->p_data->i_buffer )
+            continue;
+
+        memmove( &window[1], &window[0], i * sizeof( *window ) );
+        window[0] = p_window;
+        return MP4_ReadAheadSlice( p_window, i_pos, i_size );
+    }
+    return NULL;
+}
+
+static uint64_t MP4_TrackGetChunkSize( const mp4_track_t *p_track,
+                                       const mp4_chunk_t *p_chunk )
+{
+    uint64_t i_size = 0;
+
+    /* same rules as MP4_TrackGetPos() */
+    if( p_track->i_sample_size )
+    {
+        const MP4_Box_data_sample_soun_t *p_soun =
+            p_track->p_sample->data.p_sample_soun;
+
+        if( p_track->fmt.i_cat != AUDIO_ES || p_soun->i_qt_version == 0 ||
+            p_track->fmt.audio.i_blockalign <= 1 ||
+            p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame == 0 )
+            return (uint64_t)p_chunk->i_sample_count * p_track->i_sample_size;
+
+        return (uint64_t)( p_chunk->i_sample_count / p_soun->i_sample_per_packet ) *
+               p_soun->i_bytes_per_frame;
+    }
+
+    for( uint32_t i = 0; i < p_chunk->i_sample_count; i++ )
+        i_size += p_track->p_sample_size[p_chunk->i_sample_first + i];
+    return i_size;
+}
+
+/* Returns the end of the last whole sample of the chunk ending before i_max,
+ * starting from sample i_sample at i_pos */
+static uint64_t MP4_TrackGetChunkCut( const mp4_track_t *p_track,
+                                      const mp4_chunk_t *p_chunk,
+                                      uint32_t i_sample, uint64_t i_pos,
+                                      uint64_t i_max )
+{
+    /* same rules as MP4_TrackGetChunkSize() */
+    if( p_track->i_sample_size )
+    {
+        const MP4_Box_data_sample_soun_t *p_soun =
+            p_track->p_sample->data.p_sample_soun;
+        uint64_t i_unit = p_track->i_sample_size;
+
+        if( p_track->fmt.i_cat == AUDIO_ES && p_soun->i_qt_version != 0 &&
+            p_track->fmt.audio.i_blockalign > 1 &&
+            p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame != 0 )
+            i_unit = p_soun->i_bytes_per_frame;
+
+        return i_pos + ( i_max - i_pos ) / i_unit * i_unit;
+    }
+
+    for( ; i_sample < p_chunk->i_sample_first + p_chunk->i_sample_count &&
+           i_pos + p_track->p_sample_size[i_sample] <= i_max; i_sample++ )
+        i_pos += p_track->p_sample_size[i_sample];
+    return i_pos;
+}
+
+/* Extends [i_pos, i_end) with the chunks of the selected tracks following
+ * it in the file, up to i_max without splitting samples */
+static uint64_t MP4_ReadAheadPlan( demux_t *p_demux, uint64_t i_pos,
+                                   uint64_t i_end, uint64_t i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_grown;
+
+    do
+    {
+        b_grown = false;
+        for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+        {
+            mp4_track_t *tk = &p_sys->track[i_track];
+            if( !tk->b_ok || tk->b_chapter || !tk->b_selected ||
+                tk->i_sample >= tk->i_sample_count )
+                continue;
+
+            for( uint32_t i_chunk = tk->i_chunk; i_chunk < tk->i_chunk_count;
+                 i_chunk++ )
+            {
+                const mp4_chunk_t *ck = &tk->chunk[i_chunk];
+                uint64_t i_start = i_chunk == tk->i_chunk ? MP4_TrackGetPos( tk )
+                                                          : ck->i_offset;
+                if( i_start < i_pos )
+                    continue;
+                if( i_start > i_end + MP4_READAHEAD_GAP )
+                    break;
+
+                uint64_t i_stop = ck->i_offset + MP4_TrackGetChunkSize( tk, ck );
+                if( i_stop > i_max )
+                {
+                    /* the window is full */
+                    if( i_start < i_max )
+                        i_end = __MAX( i_end, MP4_TrackGetChunkCut( tk, ck,
+                                    i_chunk == tk->i_chunk ? tk->i_sample
+                                                           : ck->i_sample_first,
+                                    i_start, i_max ) );
+                    return i_end;
+                }
+                if( i_stop > i_end )
+                {
+                    i_end = i_stop;
+                    b_grown = true;
+                }
+            }
+        }
+    } while( b_grown );
+
+    return i_end;
+}
+
+/* Reads i_size bytes at the current stream position i_pos, along with the
+ * data of the selected tracks that directly follows them */
+static block_t * MP4_ReadAheadRead( demux_t *p_demux,
+                                    uint64_t i_pos, uint32_t i_size )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_readahead_t **window = p_sys->readahead.window;
+    uint64_t i_end = i_pos + i_size;
+    block_t *p_data;
+
+    if( p_sys->readahead.i_budget > 0 )
+    {
+        mp4_readahead_pool_t *p_pool = p_sys->readahead.p_pool;
+        const uint64_t i_budget = p_sys->readahead.i_budget;
+        uint64_t i_window = i_budget / MP4_READAHEAD_WINDOWS;
+
+        /* Make room for a new window, dropping the least recently used ones.
+         * The windows still pinned by slices stay counted until released. */
+        for( unsigned i = MP4_READAHEAD_WINDOWS; i > 0; i-- )
+        {
+            if( !window[i - 1] )
+                continue;
+            if( i < MP4_READAHEAD_WINDOWS &&
+                atomic_load( &p_pool->i_held ) + i_window <= i_budget )
+                break;
+            MP4_ReadAheadRelease( window[i - 1] );
+            window[i - 1] = NULL;
+        }
+
+        uint64_t i_held = atomic_load( &p_pool->i_held );
+        i_window = __MIN( i_window, i_held < i_budget ? i_budget - i_held : 0 );
+
+        /* do not read again what is already cached */
+        for( unsigned i = 0; i < MP4_READAHEAD_WINDOWS && window[i]; i++ )
+            if( window[i]->i_pos > i_pos &&
+                window[i]->i_pos - i_pos < i_window )
+                i_window = window[i]->i_pos - i_pos;
+
+        if( i_window > i_size )
+            i_end = MP4_ReadAheadPlan( p_demux, i_pos, i_end, i_pos + i_window );
+    }
+
+    mtime_t i_start = mdate();
+    p_data = stream_Block( p_demux->s, i_end - i_pos );
+    p_sys->readahead.i_time += mdate() - i_start;
+    p_sys->readahead.i_reads++;
+    if( !p_data )
+        return NULL;
+    p_sys->readahead.i_bytes += p_data->i_buffer;
+
+    if( i_end == i_pos + i_size || p_data->i_buffer < i_size )
+        return p_data;
+
+    mp4_readahead_t *p_window = malloc( sizeof( *p_window ) );
+    if( !p_window )
+    {
+        block_Release( p_data );
+        return NULL;
+    }
+    atomic_init( &p_window->refs, 1 );
+    p_window->p_data = p_data;
+    p_window->i_pos = i_pos;
+    p_window->p_pool = p_sys->readahead.p_pool;
+    atomic_fetch_add( &p_window->p_pool->refs, 1 );
+    atomic_fetch_add( &p_window->p_pool->i_held, p_data->i_buffer );
+
+    /* the last slot was freed above */
+    assert( window[MP4_READAHEAD_WINDOWS - 1] == NULL );
+    memmove( &window[1], &window[0],
+             ( MP4_READAHEAD_WINDOWS - 1 ) * sizeof( *window ) );
+    window[0] = p_window;
+
+    return MP4_ReadAheadSlice( p_window, i_pos, i_size );
+}
+
 static void MP4_Block_Send( demux_t *p_demux, mp4_track_t *p_track, block_t *p_block )
 {
     if ( p_track->b_chans_reorder && aout_BitsPerSample( p_track->fmt.i_codec ) )
@@ -950,6 +1297,16 @@ static int Open( vlc_object_t * p_this )
     p_sys->asfpacketsys.pf_updatetime = NULL;
     p_sys->asfpacketsys.pf_setaspectratio = NULL;
 
+    int64_t i_readahead = var_InheritInteger( p_demux, "mp4-readahead" );
+    if( i_readahead > 0 )
+        p_sys->readahead.p_pool = malloc( sizeof( mp4_readahead_pool_t ) );
+    if( p_sys->readahead.p_pool )
+    {
+        atomic_init( &p_sys->readahead.p_pool->refs, 1 );
+        atomic_init( &p_sys->readahead.p_pool->i_held, 0 );
+        p_sys->readahead.i_budget = (uint64_t)i_readahead * 1024;
+    }
+
     return VLC_SUCCESS;
 
 error:
@@ -1066,16 +1423,6 @@ static int Demux( demux_t *p_demux )
         msg_Dbg( p_demux, "Could not select track by data position" );
         goto end;
     }
-    else if ( p_sys->b_seekmode )
-    {
-        if( stream_Seek( p_demux->s, i_candidate_pos ) )
-        {
-            msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                      tk->i_track_ID );
-            MP4_TrackUnselect( p_demux, tk );
-            goto end;
-        }
-    }
 
 #if 0
     msg_Dbg( p_demux, "tk(%i)=%"PRId64" mv=%"PRId64" pos=%"PRIu64, tk->i_track_ID,
@@ -1092,31 +1439,41 @@ static int Demux( demux_t *p_demux )
         uint64_t i_current_pos;
 
         /* go,go go ! */
-        if ( !MP4_stream_Tell( p_demux->s, &i_current_pos ) )
-            goto end;
-
-        if( i_current_pos != i_candidate_pos )
+        p_block = MP4_ReadAheadGet( p_sys, i_candidate_pos, i_samplessize );
+        if( !p_block )
         {
-            if( stream_Seek( p_demux->s, i_candidate_pos ) )
+            if ( !MP4_stream_Tell( p_demux->s, &i_current_pos ) )
+                goto end;
+
+            if( i_current_pos != i_candidate_pos )
+            {
+                mtime_t i_start = mdate();
+                int i_ret = stream_Seek( p_demux->s, i_candidate_pos );
+                p_sys->readahead.i_time += mdate() - i_start;
+                p_sys->readahead.i_seeks++;
+                if( i_ret )
+                {
+                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
+                              ": Failed to seek to %"PRIu64,
+                              tk->i_track_ID, i_candidate_pos );
+                    MP4_TrackUnselect( p_demux, tk );
+                    goto end;
+                }
+                i_current_pos = i_candidate_pos;
+            }
+
+            /* now read pes */
+            if( !(p_block = MP4_ReadAheadRead( p_demux, i_current_pos,
+                                               i_samplessize )) )
             {
                 msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
-                          ": Failed to seek to %"PRIu64,
-                          tk->i_track_ID, i_candidate_pos );
+                          ": Failed to read %d bytes sample at %"PRIu64,
+                          tk->i_track_ID, i_samplessize, i_current_pos );
                 MP4_TrackUnselect( p_demux, tk );
                 goto end;
             }
-            i_current_pos = i_candidate_pos;
-        }
-
-        /* now read pes */
-        if( !(p_block = MP4_Block_Read( p_demux, tk, i_samplessize )) )
-        {
-            msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
-                      ": Failed to read %d bytes sample at %"PRIu64,
-                      tk->i_track_ID, i_samplessize, i_current_pos );
-            MP4_TrackUnselect( p_demux, tk );
-            goto end;
         }
+        p_block = MP4_Block_Encap( tk, p_block );
 
         /* dts */
         p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
@@ -1191,6 +1548,50 @@ static void MP4_UpdateSeekpoint( demux_t *p_demux )
 /*****************************************************************************
  * Seek: Go to i_date
 ******************************************************************************/
+/* Tells a slow seeking stream which data the selected tracks will read
+ * next, by increasing offset, so that it can fetch them ahead and in as
+ * few requests as possible */
+static void MP4_HintTracks( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_next = 0;
+
+    /* The previous hints were for the data before the seek */
+    if( p_sys->b_fastseekable ||
+        stream_Control( p_demux->s, STREAM_CLEAR_HINTS ) )
+        return;
+
+    for( ;; )
+    {
+        mp4_track_t *tk = NULL;
+        uint64_t i_pos = UINT64_MAX;
+
+        for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+        {
+            mp4_track_t *tk_tmp = &p_sys->track[i_track];
+            if( !tk_tmp->b_ok || tk_tmp->b_chapter || !tk_tmp->b_selected ||
+                tk_tmp->i_sample >= tk_tmp->i_sample_count )
+                continue;
+
+            uint64_t i_tk_pos = MP4_TrackGetPos( tk_tmp );
+            if( i_tk_pos >= i_next && i_tk_pos < i_pos )
+            {
+                tk = tk_tmp;
+                i_pos = i_tk_pos;
+            }
+        }
+        if( !tk )
+            break;
+
+        const mp4_chunk_t *ck = &tk->chunk[tk->i_chunk];
+        uint64_t i_end = ck->i_offset + MP4_TrackGetChunkSize( tk, ck );
+        if( i_end > i_pos &&
+            stream_Control( p_demux->s, STREAM_HINT_RANGE, i_pos, i_end - i_pos ) )
+            break; /* not supported */
+        i_next = i_pos + 1;
+    }
+}
+
 static int Seek( demux_t *p_demux, mtime_t i_date )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1207,6 +1608,7 @@ static int Seek( demux_t *p_demux, mtime_t i_date )
         MP4_TrackSeek( p_demux, tk, i_date );
     }
     MP4_UpdateSeekpoint( p_demux );
+    MP4_HintTracks( p_demux );
 
     MP4ASF_ResetFrames( p_sys );
     es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, i_date );
@@ -1706,6 +2108,16 @@ static void Close ( vlc_object_t * p_this )
     demux_sys_t *p_sys = p_demux->p_sys;
     unsigned int i_track;
 
+    if( p_sys->readahead.i_reads > 0 )
+        msg_Dbg( p_demux, "read %"PRIu64" bytes with %"PRIu64" reads and "
+                 "%"PRIu64" seeks (%"PRIu64" bytes/s)", p_sys->readahead.i_bytes,
+                 p_sys->readahead.i_reads, p_sys->readahead.i_seeks,
+                 p_sys->readahead.i_time > 0 ? p_sys->readahead.i_bytes *
+                 CLOCK_FREQ / p_sys->readahead.i_time : 0 );
+    MP4_ReadAheadFlush( p_sys );
+    if( p_sys->readahead.p_pool )
+        MP4_ReadAheadPoolRelease( p_sys->readahead.p_pool );
+
     msg_Dbg( p_demux, "freeing all memory" );
 
     MP4_BoxFree( p_demux->s, p_sys->p_root );
@@ -1875,6 +2287,8 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->p_sample_delta_dts = NULL;
         ck->p_sample_count_pts = NULL;
         ck->p_sample_offset_pts = NULL;
+        ck->i_dts_skip = 0;
+        ck->i_pts_skip = 0;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -1925,51 +2339,66 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
+/* Points each chunk into a run length time table (stts or ctts), without
+ * expanding it. Returns the number of time units covered by the chunks. */
+static int TrackIndexTimeTable( demux_t *p_demux, mp4_track_t *p_track,
+                                const uint32_t *pi_count, const int32_t *pi_value,
+                                uint32_t i_entry_count, bool b_dts,
+                                uint64_t *pi_duration )
 {
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
+    uint32_t i_index = 0;
+    uint32_t i_skip = 0;
+    uint64_t i_next_dts = 0;
+
+    for( uint32_t i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
     {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
+        mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+        uint32_t i_left = ck->i_sample_count;
 
-        if ( i_array_offset >= i_table_count )
+        if( b_dts )
         {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_EGENERIC;
+            ck->p_sample_count_dts = (uint32_t *)&pi_count[i_index];
+            ck->p_sample_delta_dts = (uint32_t *)&pi_value[i_index];
+            ck->i_dts_skip = i_skip;
+            ck->i_first_dts = i_next_dts;
+            ck->i_last_dts  = i_next_dts;
+        }
+        else
+        {
+            ck->p_sample_count_pts = (uint32_t *)&pi_count[i_index];
+            ck->p_sample_offset_pts = (int32_t *)&pi_value[i_index];
+            ck->i_pts_skip = i_skip;
         }
 
-        if ( i_index_samples_left )
+        while( i_left > 0 )
         {
-            if ( i_index_samples_left > i_sample_count )
+            if( i_index >= i_entry_count )
             {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
+                msg_Err( p_demux, "invalid index counting total samples %u %u",
+                         i_index, i_entry_count );
+                return VLC_EGENERIC;
             }
-            else
+
+            uint32_t i_run = pi_count[i_index] - i_skip;
+            uint32_t i_used = __MIN( i_run, i_left );
+
+            if( b_dts )
             {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
+                ck->i_last_dts = i_next_dts;
+                i_next_dts += (uint64_t)i_used * (uint32_t)pi_value[i_index];
             }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
+            i_left -= i_used;
+            if( i_used == i_run )
+            {
+                i_index++;
+                i_skip = 0;
+            }
+            else
+                i_skip += i_used;
         }
     }
 
+    *pi_duration = i_next_dts;
     return VLC_SUCCESS;
 }
 
@@ -1980,7 +2409,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     MP4_Box_t *p_box;
     MP4_Box_data_stsz_t *stsz;
-    /* TODO use also stss and stsh table for seeking */
+    /* TODO use also stsh table for seeking */
     /* FIXME use edit table */
 
     /* Find stsz
@@ -1995,7 +2424,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     stsz = p_box->data.p_stsz;
 
-    /* Use stsz table to create a sample number -> sample size table */
+    /* Use stsz table as the sample number -> sample size table */
     p_demux_track->i_sample_count = stsz->i_sample_count;
     if( stsz->i_sample_size )
     {
@@ -2005,18 +2434,13 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size; the table is not copied,
+         * the stsz box stays loaded */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
+        p_demux_track->p_sample_size = stsz->i_entry_size;
+        if( p_demux_track->p_sample_size == NULL &&
+            p_demux_track->i_sample_count > 0 )
             return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
     }
 
     if ( p_demux_track->i_chunk_count )
@@ -2047,16 +2471,10 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             p_sys->moovfragment.i_chunk_range_max_offset = i_total_size;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
-
-    mtime_t i_next_dts = 0;
+    /* Use stts table as the sample number -> dts table.
+     * The run length table is not expanded: each chunk points to the run of
+     * its first sample, and the times are decoded on demand. */
+    uint64_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
@@ -2072,98 +2490,15 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_entry, i_sample_count;
-
-            /* save first dts */
-            ck->i_first_dts = i_next_dts;
-            ck->i_last_dts  = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_entry = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &i_entry, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret != VLC_SUCCESS )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, i_entry );
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < i_entry; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        if ( i_current_index_samples_left ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        if ( stts->pi_sample_count[i_index] ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
-        }
+        int i_ret = TrackIndexTimeTable( p_demux, p_demux_track,
+                                         stts->pi_sample_count,
+                                         stts->pi_sample_delta,
+                                         stts->i_entry_count, true,
+                                         &i_next_dts );
+        if( i_ret != VLC_SUCCESS )
+            return i_ret;
     }
 
-
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
      */
@@ -2171,88 +2506,22 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     if( p_box && p_box->data.p_ctts )
     {
         MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        uint64_t i_unused;
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_entry, i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            i_entry = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &i_entry, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret != VLC_SUCCESS )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, i_entry );
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < i_entry; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
-            }
-        }
+        int i_ret = TrackIndexTimeTable( p_demux, p_demux_track,
+                                         ctts->pi_sample_count,
+                                         ctts->pi_sample_offset,
+                                         ctts->i_entry_count, false,
+                                         &i_unused );
+        if( i_ret != VLC_SUCCESS )
+            return i_ret;
     }
 
+    p_demux_track->cursor.i_chunk = UINT32_MAX;
+    p_demux_track->cursor.i_pos_chunk = UINT32_MAX;
+
     msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
              i_next_dts / p_demux_track->i_timescale );
@@ -2459,49 +2728,42 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
-    {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+    /* chunks are sorted by dts: look for the last one starting at or before
+     * i_start */
+    uint32_t i_low = 0, i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
+    {
+        uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+        if( p_track->chunk[i_mid].i_first_dts <= (uint64_t)i_start )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
     }
+    i_chunk = i_low;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    for( i_index = 0; i_sample < ck->i_sample_first + ck->i_sample_count; )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        uint32_t i_run = MP4_ChunkDTSRun( ck, i_index );
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+        if( i_dts + (uint64_t)i_run * ck->p_sample_delta_dts[i_index] <
+            (uint64_t)i_start )
+        {
+            i_dts    += (uint64_t)i_run * ck->p_sample_delta_dts[i_index];
+            i_sample += i_run;
             i_index++;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+            if( ck->p_sample_delta_dts[i_index] <= 0 )
             {
                 break;
             }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            i_sample += ( i_start - i_dts ) / ck->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -2516,37 +2778,44 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
 
 
     /* *** Try to find nearest sync points *** */
-    if( ( p_box_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) )
+    if( ( p_box_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) &&
+        p_box_stss->data.p_stss->i_entry_count > 0 )
     {
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
+
+        /* sync samples are sorted: look for the last one at or before
+         * i_sample, or use the first one */
+        i_low = 0;
+        i_high = p_stss->i_entry_count;
+        while( i_high - i_low > 1 )
         {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
-            {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
+            uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+            if( p_stss->i_sample_number[i_mid] <= i_sample )
+                i_low = i_mid;
+            else
+                i_high = i_mid;
+        }
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
-                else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
-            }
+        unsigned i_sync_sample = p_stss->i_sample_number[i_low];
+        msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
+                 i_sample, i_sync_sample );
+
+        if( i_sync_sample <= i_sample )
+        {
+            while( i_chunk > 0 &&
+                   i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
+                i_chunk--;
+        }
+        else
+        {
+            while( i_chunk < p_track->i_chunk_count - 1 &&
+                   i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
+                                    p_track->chunk[i_chunk].i_sample_count )
+                i_chunk++;
         }
+        i_sample = i_sync_sample;
     }
     else
     {
@@ -2894,35 +3163,21 @@ static void FreeAndResetChunk( mp4_chunk_t *ck )
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-    {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
-    }
+    /* the chunks timing tables belong to the stts/ctts boxes */
     FREENULL( p_track->chunk );
     if( p_track->cchunk ) {
         FreeAndResetChunk( p_track->cchunk );
         FREENULL( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
-    {
-        FREENULL( p_track->p_sample_size );
-    }
+    /* the sample size table belongs to the stsz box */
+    p_track->p_sample_size = NULL;
 
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
@@ -3138,11 +3393,24 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
     }
     else
     {
-        for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
-             i_sample < p_track->i_sample; i_sample++ )
+        i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
+
+        /* Resume from the previous position in the same chunk if possible */
+        if( p_track->cursor.i_pos_chunk == p_track->i_chunk &&
+            p_track->cursor.i_pos_sample <= p_track->i_sample )
+        {
+            i_sample = p_track->cursor.i_pos_sample;
+            i_pos = p_track->cursor.i_pos;
+        }
+
+        for( ; i_sample < p_track->i_sample; i_sample++ )
         {
             i_pos += p_track->p_sample_size[i_sample];
         }
+
+        p_track->cursor.i_pos_chunk = p_track->i_chunk;
+        p_track->cursor.i_pos_sample = p_track->i_sample;
+        p_track->cursor.i_pos = i_pos;
     }
 
     return i_pos;
@@ -4586,11 +4854,11 @@ static inline mtime_t LeafGetMOOVTimeInChunk( const mp4_chunk_t *p_chunk, uint32
 
     while( i_sample > 0 )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        if( i_sample > MP4_ChunkDTSRun( p_chunk, i_index ) )
         {
-            i_time += p_chunk->p_sample_count_dts[i_index] *
+            i_time += MP4_ChunkDTSRun( p_chunk, i_index ) *
                 p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_sample -= MP4_ChunkDTSRun( p_chunk, i_index );
             i_index++;
         }
         else
@@ -54,6 +54,12 @@ typedef struct
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
+    /* When not fragmented, the tables above point into the stts/ctts run
+     * length tables and are shared by all chunks: the first run of a chunk
+     * may have been partly consumed by the previous chunks. */
+    uint32_t     i_dts_skip;    /* samples of the first dts run to skip */
+    uint32_t     i_pts_skip;    /* samples of the first pts run to skip */
+
     uint8_t      **p_sample_data;     /* set when b_fragmented is true */
     uint32_t     *p_sample_size;
     /* TODO if needed add pts
@@ -108,8 +114,21 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    uint32_t         *p_sample_size; /* shared with the stsz box */
+
+    /* cursor cache, so that sequential reads do not walk the tables from
+     * the start of the chunk for each sample */
+    struct
+    {
+        uint32_t i_chunk;       /* chunk of the cached sample, or UINT32_MAX */
+        uint32_t i_sample;      /* cached sample, relative to the chunk */
+        uint32_t i_dts_index;   /* dts run of the cached sample */
+        uint32_t i_dts_in_run;  /* samples of that run before it */
+        uint64_t i_dts;         /* dts of the cached sample */
+        uint32_t i_pos_chunk;   /* chunk of the cached position */
+        uint32_t i_pos_sample;  /* sample of the cached position */
+        uint64_t i_pos;         /* file position of that sample */
+    } cursor;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
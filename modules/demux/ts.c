@@ -370,6 +370,10 @@ struct demux_sys_t
     bool        b_es_id_pid;
     csa_t       *csa;
     int         i_csa_pkt_size;
+    /* packets read ahead to be descrambled by batches */
+    block_t     *csa_queue[CSA_BATCH_SIZE];
+    int         i_csa_queue;
+    int         i_csa_queue_next;
     bool        b_split_es;
 
     bool        b_trust_pcr;
@@ -437,6 +441,8 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static block_t* ReadDescrambledTSPacket( demux_t *p_demux );
+static void FlushDescrambledTSPackets( demux_t *p_demux );
 static int Seek( demux_t *p_demux, double f_percent );
 static void GetFirstPCR( demux_t *p_demux );
 static void GetLastPCR( demux_t *p_demux );
@@ -1265,6 +1271,8 @@ static void Close( vlc_object_t *p_this )
             SetPIDFilter( p_demux, pid->i_pid, false );
     }
 
+    FlushDescrambledTSPackets( p_demux );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -1331,7 +1339,7 @@ static int Demux( demux_t *p_demux )
     {
         bool         b_frame = false;
         block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        if( !(p_pkt = ReadDescrambledTSPacket( p_demux )) )
         {
             return 0;
         }
@@ -1486,6 +1494,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 return VLC_EGENERIC;
             }
         }
+        FlushDescrambledTSPackets( p_demux );
         return VLC_SUCCESS;
 
     case DEMUX_GET_TIME:
@@ -2064,6 +2073,7 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
     mtime_t i_dts = -1;
     mtime_t i_pts = -1;
     mtime_t i_length = 0;
+    const uint32_t i_flags = p_pes->i_flags & BLOCK_FLAG_TYPE_I;
 
     /* FIXME find real max size */
     /* const int i_max = */ block_ChainExtract( p_pes, header, 34 );
@@ -2216,6 +2226,7 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
         p_pes->i_length = i_length * 100 / 9;
 
         p_block = block_ChainGather( p_pes );
+        p_block->i_flags |= i_flags;
         if( pid->es->fmt.i_codec == VLC_CODEC_SUBT )
         {
             if( i_pes_size > 0 && p_block->i_buffer > i_pes_size )
@@ -2436,6 +2447,55 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/* Without descrambling, same as ReadTSPacket.
+ * Otherwise, up to CSA_BATCH_SIZE packets are read ahead and their scrambled
+ * ones are descrambled at once. */
+static block_t* ReadDescrambledTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->csa == NULL )
+        return ReadTSPacket( p_demux );
+
+    if( p_sys->i_csa_queue_next >= p_sys->i_csa_queue )
+    {
+        uint8_t *pp_pkt[CSA_BATCH_SIZE];
+        int i_pkt = 0;
+
+        p_sys->i_csa_queue = 0;
+        p_sys->i_csa_queue_next = 0;
+        while( p_sys->i_csa_queue < CSA_BATCH_SIZE )
+        {
+            block_t *p_pkt = ReadTSPacket( p_demux );
+            if( p_pkt == NULL )
+                break;
+            p_sys->csa_queue[p_sys->i_csa_queue++] = p_pkt;
+            if( p_pkt->p_buffer[3]&0x80 )
+                pp_pkt[i_pkt++] = p_pkt->p_buffer;
+        }
+        if( p_sys->i_csa_queue == 0 )
+            return NULL;
+
+        if( i_pkt > 0 )
+        {
+            vlc_mutex_lock( &p_sys->csa_lock );
+            csa_DecryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+            vlc_mutex_unlock( &p_sys->csa_lock );
+        }
+    }
+    return p_sys->csa_queue[p_sys->i_csa_queue_next++];
+}
+
+static void FlushDescrambledTSPackets( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( p_sys->i_csa_queue_next < p_sys->i_csa_queue )
+        block_Release( p_sys->csa_queue[p_sys->i_csa_queue_next++] );
+    p_sys->i_csa_queue = 0;
+    p_sys->i_csa_queue_next = 0;
+}
+
 static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -2836,13 +2896,6 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             pid->es->p_data->i_flags |= BLOCK_FLAG_CORRUPTED;
     }
 
-    if( p_demux->p_sys->csa )
-    {
-        vlc_mutex_lock( &p_demux->p_sys->csa_lock );
-        csa_Decrypt( p_demux->p_sys->csa, p_bk->p_buffer, p_demux->p_sys->i_csa_pkt_size );
-        vlc_mutex_unlock( &p_demux->p_sys->csa_lock );
-    }
-
     if( !b_adaptation )
     {
         /* We don't have any adaptation_field, so payload starts
@@ -2863,10 +2916,10 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
                             pid->i_pid );
                 /* pid->es->p_data->i_flags |= BLOCK_FLAG_DISCONTINUITY; */
             }
-#if 0
-            if( p[5]&0x40 )
-                msg_Dbg( p_demux, "random access indicator (pid=%d) ", pid->i_pid );
-#endif
+            /* random access indicator: the PES starting here can be
+             * decoded on its own */
+            if( b_unit_start && (p[5]&0x40) )
+                p_bk->i_flags |= BLOCK_FLAG_TYPE_I;
         }
     }
 
@@ -209,6 +209,69 @@ static int vlclua_input_item_stats( lua_State *L )
     return 1;
 }
 
+static int vlclua_input_clock_stats( lua_State *L )
+{
+    input_thread_t *p_input = vlclua_get_input_internal( L );
+    input_clock_stats_t *p_stats;
+
+    if( !p_input )
+    {
+        lua_pushnil( L );
+        return 1;
+    }
+    int i_ret = input_Control( p_input, INPUT_GET_CLOCK_STATS, &p_stats );
+    vlc_object_release( p_input );
+    if( i_ret )
+    {
+        lua_pushnil( L );
+        return 1;
+    }
+
+    lua_newtable( L );
+    lua_pushinteger( L, p_stats->i_references );
+    lua_setfield( L, -2, "references" );
+    lua_newtable( L );
+    for( int i = 0; i < INPUT_CLOCK_JITTER_BINS; i++ )
+    {
+        lua_pushinteger( L, p_stats->pi_jitter[i] );
+        lua_rawseti( L, -2, i + 1 );
+    }
+    lua_setfield( L, -2, "jitter" );
+    lua_pushinteger( L, p_stats->i_jitter_max );
+    lua_setfield( L, -2, "jitter_max" );
+    lua_pushnumber( L, p_stats->f_drift );
+    lua_setfield( L, -2, "drift" );
+    lua_pushinteger( L, p_stats->i_pts_delay );
+    lua_setfield( L, -2, "pts_delay" );
+    lua_pushinteger( L, p_stats->i_resamplings );
+    lua_setfield( L, -2, "resamplings" );
+
+    lua_newtable( L );
+    for( int i = 0; i < p_stats->i_es; i++ )
+    {
+        const input_clock_es_stats_t *p_es = &p_stats->p_es[i];
+
+        lua_newtable( L );
+        lua_pushinteger( L, p_es->i_id );
+        lua_setfield( L, -2, "id" );
+        lua_pushinteger( L, p_es->i_late );
+        lua_setfield( L, -2, "late" );
+        lua_pushinteger( L, p_es->i_early );
+        lua_setfield( L, -2, "early" );
+        lua_pushinteger( L, p_es->i_resamplings );
+        lua_setfield( L, -2, "resamplings" );
+        lua_pushinteger( L, p_es->i_decoder_delay );
+        lua_setfield( L, -2, "decoder_delay" );
+        lua_pushinteger( L, p_es->i_output_delay );
+        lua_setfield( L, -2, "output_delay" );
+        lua_rawseti( L, -2, i + 1 );
+    }
+    lua_setfield( L, -2, "es" );
+
+    free( p_stats );
+    return 1;
+}
+
 static int vlclua_input_add_subtitle( lua_State *L )
 {
     input_thread_t *p_input = vlclua_get_input_internal( L );
@@ -369,6 +432,7 @@ static const luaL_Reg vlclua_input_reg[] = {
     { "is_playing", vlclua_input_is_playing },
     { "item", vlclua_input_item_get_current },
     { "add_subtitle", vlclua_input_add_subtitle },
+    { "clock_stats", vlclua_input_clock_stats },
     { NULL, NULL }
 };
 
@@ -735,6 +735,12 @@ static block_t *ConvertSUBT(block_t *p_block)
 
 static block_t *ConvertFromAnnexB(block_t *p_block)
 {
+    /* The start codes are rewritten in place, the payload may be shared
+     * with other outputs (see stream_out/duplicate) */
+    p_block = block_Writable(p_block);
+    if (unlikely(p_block == NULL))
+        return NULL;
+
     uint8_t *last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
     uint8_t *dat  = &p_block->p_buffer[4];
     uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
@@ -2836,6 +2842,8 @@ static int MuxFrag(sout_mux_t *p_mux)
     default:
         break;
     }
+    if (unlikely(p_currentblock == NULL))
+        return VLC_ENOMEM;
 
     /* If we have a previous entry for outgoing queue */
     if (p_stream->p_held_entry)
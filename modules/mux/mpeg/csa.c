@@ -47,6 +47,15 @@ struct csa_t
     int     p, q, r;
 
     bool    use_odd;
+
+    /* algebraic normal form of the stream cypher s-boxes, used by the bit
+     * sliced cypher: for each output bit, the count then the monomials */
+    uint8_t sbox_anf[7][2][33];
+
+    /* block cypher s-box and permutation, placed in a 64 bits register
+     * holding the 8 bytes of a block, used by the batch versions */
+    uint64_t block_dec[256];
+    uint64_t block_enc[256];
 };
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
@@ -56,12 +65,39 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
 
+/* bit sliced stream cypher state: each nibble is stored as 4 words, bit i
+ * of a word belonging to the i-th packet */
+typedef uint64_t csa_bs_t;
+
+typedef struct
+{
+    csa_bs_t A[11][4];
+    csa_bs_t B[11][4];
+    csa_bs_t X[4], Y[4], Z[4];
+    csa_bs_t D[4], E[4], F[4];
+    csa_bs_t p, q, r;
+} csa_bs_state_t;
+
+static void csa_ComputeTables( csa_t *c );
+static void csa_ComputeSBoxAnf( csa_t *c );
+static void csa_BlockDecypherN( const csa_t *c, const uint8_t kk[57],
+                                uint64_t *block, int n );
+static void csa_BlockCypherN( const csa_t *c, const uint8_t kk[57],
+                              uint64_t *block, int n );
+static void csa_BsStreamInit( const csa_t *c, csa_bs_state_t *s, csa_bs_t odd,
+                              uint8_t *const sb[], int i_lanes );
+static void csa_BsStreamCypher( const csa_t *c, csa_bs_state_t *s,
+                                uint8_t cb[][8], int i_lanes );
+
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
 csa_t *csa_New( void )
 {
-    return calloc( 1, sizeof( csa_t ) );
+    csa_t *c = calloc( 1, sizeof( csa_t ) );
+    if( c )
+        csa_ComputeTables( c );
+    return c;
 }
 
 /*****************************************************************************
@@ -307,6 +343,249 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************
+ * The stream cypher of all the packets is run at once, bit sliced (one bit
+ * of each packet per machine word bit), which is where most of the time is
+ * spent. The block cypher is then run packet by packet.
+ *****************************************************************************/
+static void csa_DecryptLanes( csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                              int i_pkt_size )
+{
+    uint8_t *lane[CSA_BATCH_SIZE];
+    int      lane_hdr[CSA_BATCH_SIZE];
+    int      i_lanes = 0, i_stream = 0;
+    csa_bs_t odd = 0;
+
+    for( int i = 0; i < i_pkt; i++ )
+    {
+        uint8_t *pkt = pp_pkt[i];
+
+        /* transport scrambling control */
+        if( (pkt[3]&0x80) == 0 )
+            continue;
+
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1;
+        if( 188 - i_hdr < 8 || i_pkt_size - i_hdr < 8 )
+        {
+            /* nothing or only a residue: rare enough */
+            csa_Decrypt( c, pkt, i_pkt_size );
+            continue;
+        }
+
+        if( pkt[3]&0x40 )
+            odd |= (csa_bs_t)1 << i_lanes;
+        pkt[3] &= 0x3f;
+
+        /* stream blocks, the first one being used for the second block */
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        i_stream = __MAX( i_stream, n - 1 + (i_residue > 0) );
+
+        lane[i_lanes] = pkt;
+        lane_hdr[i_lanes++] = i_hdr;
+    }
+    if( i_lanes == 0 )
+        return;
+
+    /* stream cypher */
+    csa_bs_state_t s;
+    uint8_t *sb[CSA_BATCH_SIZE];
+    for( int i = 0; i < i_lanes; i++ )
+        sb[i] = &lane[i][lane_hdr[i]];
+    csa_BsStreamInit( c, &s, odd, sb, i_lanes );
+
+    for( int k = 1; k <= i_stream; k++ )
+    {
+        uint8_t stream[CSA_BATCH_SIZE][8];
+
+        csa_BsStreamCypher( c, &s, stream, i_lanes );
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            uint8_t *pkt = lane[i];
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            const int i_residue = (i_pkt_size - lane_hdr[i]) % 8;
+
+            if( k < n )
+            {
+                /* xor ib with stream */
+                for( int j = 0; j < 8; j++ )
+                    pkt[lane_hdr[i]+8*k+j] ^= stream[i][j];
+            }
+            else if( k == n )
+            {
+                for( int j = 0; j < i_residue; j++ )
+                    pkt[i_pkt_size - i_residue + j] ^= stream[i][j];
+            }
+        }
+    }
+
+    /* block cypher, all the blocks using the same key at once */
+    for( int i_key = 0; i_key < 2; i_key++ )
+    {
+        uint64_t block[CSA_BATCH_SIZE * 23];
+        int i_block = 0;
+
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            if( (int)((odd >> i)&1) != i_key )
+                continue;
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            for( int k = 0; k < n; k++ )
+                block[i_block++] = GetQWLE( &lane[i][lane_hdr[i]+8*k] );
+        }
+        if( i_block == 0 )
+            continue;
+
+        csa_BlockDecypherN( c, i_key ? c->o_kk : c->e_kk, block, i_block );
+
+        i_block = 0;
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            if( (int)((odd >> i)&1) != i_key )
+                continue;
+            uint8_t *pkt = &lane[i][lane_hdr[i]];
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            for( int k = 0; k < n; k++ )
+            {
+                /* xor with the next ib (none for the last block) */
+                uint64_t bd = block[i_block++];
+                if( k + 1 < n )
+                    bd ^= GetQWLE( &pkt[8*(k+1)] );
+                SetQWLE( &pkt[8*k], bd );
+            }
+        }
+    }
+}
+
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    while( i_pkt > 0 )
+    {
+        const int i_lanes = __MIN( i_pkt, CSA_BATCH_SIZE );
+
+        csa_DecryptLanes( c, pp_pkt, i_lanes, i_pkt_size );
+        pp_pkt += i_lanes;
+        i_pkt -= i_lanes;
+    }
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+static void csa_EncryptLanes( csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                              int i_pkt_size )
+{
+    uint8_t *lane[CSA_BATCH_SIZE];
+    int      lane_hdr[CSA_BATCH_SIZE];
+    int      i_lanes = 0, i_stream = 0, i_blocks = 0;
+    const uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+
+    for( int i = 0; i < i_pkt; i++ )
+    {
+        uint8_t *pkt = pp_pkt[i];
+
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1;
+        if( i_pkt_size - i_hdr < 8 )
+        {
+            /* left clear */
+            csa_Encrypt( c, pkt, i_pkt_size );
+            continue;
+        }
+
+        /* set transport scrambling control */
+        pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        i_stream = __MAX( i_stream, n - 1 + (i_residue > 0) );
+        i_blocks = __MAX( i_blocks, n );
+
+        lane[i_lanes] = pkt;
+        lane_hdr[i_lanes++] = i_hdr;
+    }
+    if( i_lanes == 0 )
+        return;
+
+    /* block cypher, from the last block, the same block of all the packets
+     * at once */
+    for( int k = i_blocks - 1; k >= 0; k-- )
+    {
+        uint64_t block[CSA_BATCH_SIZE];
+        int i_block = 0;
+
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            const uint8_t *p = &lane[i][lane_hdr[i]];
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            if( k >= n )
+                continue;
+            block[i_block] = GetQWLE( &p[8*k] );
+            if( k + 1 < n )
+                block[i_block] ^= GetQWLE( &p[8*(k+1)] );
+            i_block++;
+        }
+
+        csa_BlockCypherN( c, kk, block, i_block );
+
+        i_block = 0;
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            if( k < n )
+                SetQWLE( &lane[i][lane_hdr[i]+8*k], block[i_block++] );
+        }
+    }
+
+    /* stream cypher, initialized with the first ib */
+    csa_bs_state_t s;
+    uint8_t *sb[CSA_BATCH_SIZE];
+    for( int i = 0; i < i_lanes; i++ )
+        sb[i] = &lane[i][lane_hdr[i]];
+    csa_BsStreamInit( c, &s, c->use_odd ? ~(csa_bs_t)0 : 0, sb, i_lanes );
+
+    for( int k = 1; k <= i_stream; k++ )
+    {
+        uint8_t stream[CSA_BATCH_SIZE][8];
+
+        csa_BsStreamCypher( c, &s, stream, i_lanes );
+        for( int i = 0; i < i_lanes; i++ )
+        {
+            uint8_t *pkt = lane[i];
+            const int n = (i_pkt_size - lane_hdr[i]) / 8;
+            const int i_residue = (i_pkt_size - lane_hdr[i]) % 8;
+
+            if( k < n )
+            {
+                for( int j = 0; j < 8; j++ )
+                    pkt[lane_hdr[i]+8*k+j] ^= stream[i][j];
+            }
+            else if( k == n )
+            {
+                for( int j = 0; j < i_residue; j++ )
+                    pkt[i_pkt_size - i_residue + j] ^= stream[i][j];
+            }
+        }
+    }
+}
+
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    while( i_pkt > 0 )
+    {
+        const int i_lanes = __MIN( i_pkt, CSA_BATCH_SIZE );
+
+        csa_EncryptLanes( c, pp_pkt, i_lanes, i_pkt_size );
+        pp_pkt += i_lanes;
+        i_pkt -= i_lanes;
+    }
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -610,3 +889,286 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Batch block cypher
+ *****************************************************************************
+ * Same as csa_BlockDecypher/csa_BlockCypher, for n blocks read as little
+ * endian 64 bits words (R[i+1] in byte i), one round of all the blocks at a
+ * time. A round is a byte shift of the word, the xor of R[8] (resp. R[1])
+ * into its 3 (resp. 4) target bytes and a table lookup for the s-box and
+ * permutation outputs.
+ *****************************************************************************/
+static void csa_ComputeTables( csa_t *c )
+{
+    for( int i = 0; i < 256; i++ )
+    {
+        const uint64_t s = block_sbox[i];
+        const uint64_t p = block_perm[s];
+
+        /* sbox_out in R[1], R[3], R[4], R[5] and perm_out in R[7] */
+        c->block_dec[i] = s * UINT64_C(0x0000000101010001) ^ ( p << 48 );
+        /* perm_out in R[6] and sbox_out in R[8] */
+        c->block_enc[i] = ( p << 40 ) | ( s << 56 );
+    }
+    csa_ComputeSBoxAnf( c );
+}
+
+static void csa_BlockDecypherN( const csa_t *c, const uint8_t kk[57],
+                                uint64_t *block, int n )
+{
+    for( int i = 56; i > 0; i-- )
+    {
+        const uint8_t k = kk[i];
+
+        for( int j = 0; j < n; j++ )
+        {
+            const uint64_t R = block[j];
+
+            block[j] = ( R << 8 ) ^ c->block_dec[ ( ( R >> 48 )&0xff ) ^ k ]
+                     ^ ( R >> 56 ) * UINT64_C(0x0000000101010001);
+        }
+    }
+}
+
+static void csa_BlockCypherN( const csa_t *c, const uint8_t kk[57],
+                              uint64_t *block, int n )
+{
+    for( int i = 1; i <= 56; i++ )
+    {
+        const uint8_t k = kk[i];
+
+        for( int j = 0; j < n; j++ )
+        {
+            const uint64_t R = block[j];
+
+            block[j] = ( R >> 8 ) ^ c->block_enc[ ( R >> 56 ) ^ k ]
+                     ^ ( R&0xff ) * UINT64_C(0x0100000001010100);
+        }
+    }
+}
+
+
+/*****************************************************************************
+ * Bit sliced stream cypher
+ *****************************************************************************
+ * Same as csa_StreamCypher, for up to 64 packets. The s-boxes are computed
+ * from their algebraic normal form (xor of and-ed inputs).
+ *****************************************************************************/
+static void csa_ComputeSBoxAnf( csa_t *c )
+{
+    static const int *const sbox[7] = {
+        sbox1, sbox2, sbox3, sbox4, sbox5, sbox6, sbox7
+    };
+
+    for( int i = 0; i < 7; i++ )
+    {
+        for( int o = 0; o < 2; o++ )
+        {
+            uint8_t f[32];
+            uint8_t *anf = c->sbox_anf[i][o];
+
+            for( int x = 0; x < 32; x++ )
+                f[x] = ( sbox[i][x] >> o )&1;
+            /* Moebius transform */
+            for( int k = 0; k < 5; k++ )
+                for( int x = 0; x < 32; x++ )
+                    if( x & (1 << k) )
+                        f[x] ^= f[x ^ (1 << k)];
+
+            anf[0] = 0;
+            for( int x = 0; x < 32; x++ )
+                if( f[x] )
+                    anf[++anf[0]] = x;
+        }
+    }
+}
+
+static inline void csa_BsSBox( const uint8_t anf[2][33],
+                               csa_bs_t x4, csa_bs_t x3, csa_bs_t x2,
+                               csa_bs_t x1, csa_bs_t x0, csa_bs_t out[2] )
+{
+    const csa_bs_t x[5] = { x0, x1, x2, x3, x4 };
+    csa_bs_t m[32];
+
+    /* all the monomials */
+    m[0] = ~(csa_bs_t)0;
+    for( int k = 0; k < 5; k++ )
+        for( int i = 0; i < (1 << k); i++ )
+            m[i | (1 << k)] = m[i] & x[k];
+
+    for( int o = 0; o < 2; o++ )
+    {
+        csa_bs_t v = 0;
+        for( int i = 1; i <= anf[o][0]; i++ )
+            v ^= m[anf[o][i]];
+        out[o] = v;
+    }
+}
+
+/* One iteration (2 bits of output), in_a/in_b are the bits fed during
+ * initialisation, NULL otherwise */
+static void csa_BsRound( const csa_t *c, csa_bs_state_t *s,
+                         const csa_bs_t *in_a, const csa_bs_t *in_b,
+                         csa_bs_t *p_hi, csa_bs_t *p_lo )
+{
+    csa_bs_t (*A)[4] = s->A;
+    csa_bs_t (*B)[4] = s->B;
+    csa_bs_t so[7][2];
+    csa_bs_t extra_B[4], next_A1[4], next_B1[4], next_D[4], next_F[4];
+
+    csa_BsSBox( c->sbox_anf[0], A[4][0], A[1][2], A[6][1], A[7][3], A[9][0], so[0] );
+    csa_BsSBox( c->sbox_anf[1], A[2][1], A[3][2], A[6][3], A[7][0], A[9][1], so[1] );
+    csa_BsSBox( c->sbox_anf[2], A[1][3], A[2][0], A[5][1], A[5][3], A[6][2], so[2] );
+    csa_BsSBox( c->sbox_anf[3], A[3][3], A[1][1], A[2][3], A[4][2], A[8][0], so[3] );
+    csa_BsSBox( c->sbox_anf[4], A[5][2], A[4][3], A[6][0], A[8][1], A[9][2], so[4] );
+    csa_BsSBox( c->sbox_anf[5], A[3][1], A[4][1], A[5][0], A[7][2], A[9][3], so[5] );
+    csa_BsSBox( c->sbox_anf[6], A[2][2], A[3][0], A[7][1], A[8][2], A[8][3], so[6] );
+
+    extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+    extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+    extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+    extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+    csa_bs_t carry = s->r;
+    for( int b = 0; b < 4; b++ )
+    {
+        next_A1[b] = A[10][b] ^ s->X[b];
+        next_B1[b] = B[7][b] ^ B[10][b] ^ s->Y[b];
+        if( in_a )
+        {
+            next_A1[b] ^= s->D[b] ^ in_a[b];
+            next_B1[b] ^= in_b[b];
+        }
+
+        next_D[b] = s->E[b] ^ s->Z[b] ^ extra_B[b];
+
+        /* F = Z + E + r if q, E otherwise */
+        const csa_bs_t t = s->Z[b] ^ s->E[b];
+        const csa_bs_t sum = t ^ carry;
+        carry = ( s->Z[b] & s->E[b] ) | ( carry & t );
+        next_F[b] = s->E[b] ^ ( ( s->E[b] ^ sum ) & s->q );
+    }
+    s->r ^= ( s->r ^ carry ) & s->q;
+
+    /* if p=1, rotate left */
+    const csa_bs_t rot[4] = { next_B1[3], next_B1[0], next_B1[1], next_B1[2] };
+    for( int b = 0; b < 4; b++ )
+        next_B1[b] ^= ( next_B1[b] ^ rot[b] ) & s->p;
+
+    memmove( &A[2], &A[1], 9 * sizeof( A[1] ) );
+    memmove( &B[2], &B[1], 9 * sizeof( B[1] ) );
+    memcpy( A[1], next_A1, sizeof( next_A1 ) );
+    memcpy( B[1], next_B1, sizeof( next_B1 ) );
+
+    memcpy( s->E, s->F, sizeof( s->E ) );
+    memcpy( s->F, next_F, sizeof( s->F ) );
+    memcpy( s->D, next_D, sizeof( s->D ) );
+
+    s->X[3] = so[3][0]; s->X[2] = so[2][0]; s->X[1] = so[1][1]; s->X[0] = so[0][1];
+    s->Y[3] = so[5][0]; s->Y[2] = so[4][0]; s->Y[1] = so[3][1]; s->Y[0] = so[2][1];
+    s->Z[3] = so[1][0]; s->Z[2] = so[0][0]; s->Z[1] = so[5][1]; s->Z[0] = so[4][1];
+    s->p = so[6][1];
+    s->q = so[6][0];
+
+    /* 2 output bits are a function of the 4 bits of D */
+    *p_hi = s->D[3] ^ s->D[2];
+    *p_lo = s->D[1] ^ s->D[0];
+}
+
+/* Transposes 8x8 bits (Hacker's Delight) */
+static inline uint64_t csa_Transpose8( uint64_t x )
+{
+    uint64_t t;
+    t = ( x ^ ( x >> 7 ) ) & UINT64_C(0x00AA00AA00AA00AA);
+    x = x ^ t ^ ( t << 7 );
+    t = ( x ^ ( x >> 14 ) ) & UINT64_C(0x0000CCCC0000CCCC);
+    x = x ^ t ^ ( t << 14 );
+    t = ( x ^ ( x >> 28 ) ) & UINT64_C(0x00000000F0F0F0F0);
+    x = x ^ t ^ ( t << 28 );
+    return x;
+}
+
+/* bit b of byte i of packet l goes to bit l of bits[i][b] */
+static void csa_BsSlice( uint8_t *const bytes[], int i_lanes,
+                         csa_bs_t bits[8][8] )
+{
+    memset( bits, 0, sizeof( csa_bs_t[8][8] ) );
+    for( int l = 0; l < i_lanes; l += 8 )
+    {
+        for( int i = 0; i < 8; i++ )
+        {
+            uint64_t x = 0;
+            for( int k = 0; k < 8 && l + k < i_lanes; k++ )
+                x |= (uint64_t)bytes[l + k][i] << ( 8 * k );
+            x = csa_Transpose8( x );
+            for( int b = 0; b < 8; b++ )
+                bits[i][b] |= ( ( x >> ( 8 * b ) )&0xff ) << l;
+        }
+    }
+}
+
+static void csa_BsStreamInit( const csa_t *c, csa_bs_state_t *s, csa_bs_t odd,
+                              uint8_t *const sb[], int i_lanes )
+{
+    memset( s, 0, sizeof( *s ) );
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8] */
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int b = 0; b < 8; b++ )
+        {
+            const int n = 1 + 2 * i + ( b < 4 );
+            const csa_bs_t a = ( ( c->o_ck[i] >> b )&1 ? odd : 0 ) |
+                               ( ( c->e_ck[i] >> b )&1 ? ~odd : 0 );
+            const csa_bs_t bb = ( ( c->o_ck[4+i] >> b )&1 ? odd : 0 ) |
+                                ( ( c->e_ck[4+i] >> b )&1 ? ~odd : 0 );
+            s->A[n][b % 4] = a;
+            s->B[n][b % 4] = bb;
+        }
+    }
+
+    csa_bs_t in[8][8];
+    csa_BsSlice( sb, i_lanes, in );
+
+    for( int i = 0; i < 8; i++ )
+    {
+        const csa_bs_t *in1 = &in[i][4]; /* high nibble */
+        const csa_bs_t *in2 = &in[i][0];
+        csa_bs_t hi, lo;
+
+        for( int j = 0; j < 4; j++ )
+        {
+            if( j % 2 )
+                csa_BsRound( c, s, in2, in1, &hi, &lo );
+            else
+                csa_BsRound( c, s, in1, in2, &hi, &lo );
+        }
+    }
+}
+
+static void csa_BsStreamCypher( const csa_t *c, csa_bs_state_t *s,
+                                uint8_t cb[][8], int i_lanes )
+{
+    csa_bs_t out[8][8];
+
+    /* 8 bytes per operation, 2 bits per iteration */
+    for( int i = 0; i < 8; i++ )
+        for( int j = 0; j < 4; j++ )
+            csa_BsRound( c, s, NULL, NULL,
+                         &out[i][7 - 2 * j], &out[i][6 - 2 * j] );
+
+    for( int l = 0; l < i_lanes; l += 8 )
+    {
+        for( int i = 0; i < 8; i++ )
+        {
+            uint64_t x = 0;
+            for( int b = 0; b < 8; b++ )
+                x |= ( ( out[i][b] >> l )&0xff ) << ( 8 * b );
+            x = csa_Transpose8( x );
+            for( int k = 0; k < 8 && l + k < i_lanes; k++ )
+                cb[l + k][i] = x >> ( 8 * k );
+        }
+    }
+}
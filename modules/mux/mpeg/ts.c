@@ -39,6 +39,7 @@
 #include <vlc_sout.h>
 #include <vlc_block.h>
 #include <vlc_rand.h>
+#include <vlc_atomic.h>
 
 #include <vlc_iso_lang.h>
 
@@ -177,6 +178,10 @@ static void    Close  ( vlc_object_t * );
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define PACKETS_TEXT N_("TS packets per output buffer")
+#define PACKETS_LONGTEXT N_("Number of consecutive TS packets sent to the " \
+  "access output as a single buffer. The default (0) fills the MTU." )
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -223,6 +228,9 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_integer(SOUT_CFG_PREFIX "packets", 0, PACKETS_TEXT, PACKETS_LONGTEXT, true)
+        change_integer_range( 0, 64 )
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -234,7 +242,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "packets",
     NULL
 };
 
@@ -308,6 +316,29 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
     BufferChainInit( c );
 }
 
+/*****************************************************************************
+ * TS packets are carved out of slabs of contiguous packets. This saves an
+ * allocation per packet, and consecutive packets of a slab are handed to the
+ * access output as a single buffer.
+ *****************************************************************************/
+#define TS_SLAB_PACKETS 64
+
+typedef struct ts_slab_t ts_slab_t;
+
+typedef struct
+{
+    block_t    self;
+    ts_slab_t *p_slab;
+} ts_packet_t;
+
+struct ts_slab_t
+{
+    atomic_uint refs;
+    unsigned    i_used;
+    ts_packet_t packets[TS_SLAB_PACKETS];
+    uint8_t     data[TS_SLAB_PACKETS][188];
+};
+
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
@@ -373,6 +404,9 @@ struct sout_mux_sys_t
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    ts_slab_t       *p_slab;   /* where the next packets are allocated */
+    size_t          i_buffer_size; /* of the buffers sent to the access */
 };
 
 
@@ -469,6 +503,7 @@ static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
+static void TSSlabRelease( ts_slab_t *p_slab );
 static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
@@ -725,6 +760,11 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    int i_packets = var_GetInteger( p_mux, SOUT_CFG_PREFIX "packets" );
+    if( i_packets <= 0 )
+        i_packets = __MAX( var_InheritInteger( p_mux, "mtu" ) / 188, 1 );
+    p_sys->i_buffer_size = __MIN( i_packets, TS_SLAB_PACKETS ) * 188;
+
     p_mux->p_sys        = p_sys;
 
     p_sys->csa = csaSetup(p_this);
@@ -765,6 +805,9 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    if( p_sys->p_slab )
+        TSSlabRelease( p_sys->p_slab );
+
     free( p_sys );
 }
 
@@ -1764,6 +1807,92 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+static void TSSlabRelease( ts_slab_t *p_slab )
+{
+    if( atomic_fetch_sub( &p_slab->refs, 1 ) == 1 )
+        free( p_slab );
+}
+
+static void TSPacketRelease( block_t *p_block )
+{
+    TSSlabRelease( ((ts_packet_t *)p_block)->p_slab );
+}
+
+static block_t *TSPacketNew( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    ts_slab_t *p_slab = p_sys->p_slab;
+
+    if( p_slab == NULL || p_slab->i_used >= TS_SLAB_PACKETS )
+    {
+        if( p_slab != NULL )
+            TSSlabRelease( p_slab );
+
+        p_sys->p_slab = p_slab = malloc( sizeof( *p_slab ) );
+        if( unlikely(p_slab == NULL) )
+            return NULL;
+        atomic_init( &p_slab->refs, 1 ); /* held by the muxer */
+        p_slab->i_used = 0;
+    }
+
+    ts_packet_t *p_pkt = &p_slab->packets[p_slab->i_used];
+
+    block_Init( &p_pkt->self, p_slab->data[p_slab->i_used], 188 );
+    p_pkt->self.pf_release = TSPacketRelease;
+    p_pkt->p_slab = p_slab;
+    p_slab->i_used++;
+    atomic_fetch_add( &p_slab->refs, 1 );
+    return &p_pkt->self;
+}
+
+/* Appends p_ts to p_buffer if it is the next packet of the same slab, and if
+ * neither a PCR nor a random access point has to start a new buffer */
+static bool TSMerge( sout_mux_t *p_mux, block_t *p_buffer, block_t *p_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_buffer->pf_release != TSPacketRelease ||
+        p_ts->pf_release != TSPacketRelease ||
+        ((ts_packet_t *)p_buffer)->p_slab != ((ts_packet_t *)p_ts)->p_slab ||
+        p_buffer->p_buffer + p_buffer->i_buffer != p_ts->p_buffer ||
+        p_buffer->i_buffer + p_ts->i_buffer > p_sys->i_buffer_size ||
+        ( p_ts->i_flags & ( BLOCK_FLAG_CLOCK | BLOCK_FLAG_TYPE_I |
+                            BLOCK_FLAG_HEADER ) ) )
+        return false;
+
+    p_buffer->i_buffer += p_ts->i_buffer;
+    p_buffer->i_size    = p_buffer->i_buffer;
+    p_buffer->i_length += p_ts->i_length;
+    block_Release( p_ts );
+    return true;
+}
+
+/* Scrambles the packets of the chain flagged as such, CSA_BATCH_SIZE at a
+ * time */
+static void TSEncrypt( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint8_t *pp_pkt[CSA_BATCH_SIZE];
+    int i_pkt = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts != NULL; p_ts = p_ts->p_next )
+    {
+        if( !( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED ) )
+            continue;
+
+        pp_pkt[i_pkt++] = p_ts->p_buffer;
+        if( i_pkt == CSA_BATCH_SIZE )
+        {
+            csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+            i_pkt = 0;
+        }
+    }
+    if( i_pkt > 0 )
+        csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1789,7 +1918,11 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->csa != NULL )
+        TSEncrypt( p_mux, p_chain_ts );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
+    block_t *p_buffer = NULL;
     for (int i = 0; i < i_packet_count; i++ )
     {
         block_t *p_ts = BufferChainGet( p_chain_ts );
@@ -1803,24 +1936,23 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        if( p_buffer != NULL && TSMerge( p_mux, p_buffer, p_ts ) )
+            continue;
+
+        if( p_buffer != NULL )
+            sout_AccessOutWrite( p_mux->p_access, p_buffer );
+        p_buffer = p_ts;
     }
+    if( p_buffer != NULL )
+        sout_AccessOutWrite( p_mux->p_access, p_buffer );
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1840,7 +1972,7 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    block_t *p_ts = TSPacketNew( p_mux );
 
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
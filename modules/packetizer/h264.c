@@ -43,6 +43,7 @@
 #include "../codec/cc.h"
 #include "../codec/h264_nal.h"
 #include "packetizer_helper.h"
+#include "startcode_helper.h"
 #include "../demux/mpeg/mpeg_parser_helpers.h"
 
 /*****************************************************************************
@@ -203,6 +204,7 @@ static int Open( vlc_object_t *p_this )
 
     packetizer_Init( &p_sys->packetizer,
                      p_h264_startcode, sizeof(p_h264_startcode),
+                     startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
 
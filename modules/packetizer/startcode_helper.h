@@ -0,0 +1,190 @@
+/*****************************************************************************
+ * startcode_helper.h: Annex B start code search
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <string.h>
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+# define STARTCODE_NEON 1
+#endif
+
+/* All the functions below return the first 00 00 01 lying entirely
+ * within [p, end), or NULL. */
+
+static inline const uint8_t *startcode_FindAnnexB_C( const uint8_t *p,
+                                                     const uint8_t *end )
+{
+    /* Checks the third byte first: most of the time, it is neither 0 nor 1
+     * and none of the 3 positions ending there can match. */
+    for( end -= 2; p < end; )
+    {
+        if( p[2] > 1 )
+            p += 3;
+        else if( p[1] != 0 )
+            p += 2;
+        else if( p[0] != 0 || p[2] != 1 )
+            p++;
+        else
+            return p;
+    }
+    return NULL;
+}
+
+/* Skips to the next zero byte with memchr(), vectorized by the C library:
+ * every start code begins with one, and they are rare in coded data. */
+static inline const uint8_t *startcode_FindAnnexB_memchr( const uint8_t *p,
+                                                          const uint8_t *end )
+{
+    while( end - p >= 3 )
+    {
+        const uint8_t *z = memchr( p, 0, end - p - 2 );
+        if( z == NULL )
+            return NULL;
+        if( z[1] == 0 && z[2] == 1 )
+            return z;
+        p = z + 1;
+    }
+    return NULL;
+}
+
+/* The SIMD versions compare p[i], p[i + 1] and p[i + 2] to 0, 0 and 1 for a
+ * whole vector of positions at once, with unaligned loads: there are no
+ * false positives to check. */
+#ifdef CAN_COMPILE_SSE2
+VLC_SSE
+static inline const uint8_t *startcode_FindAnnexB_SSE2( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    while( end - p >= 16 + 2 )
+    {
+        unsigned match;
+
+        asm volatile (
+            "pxor       %%xmm3, %%xmm3\n"
+            "pcmpeqb    %%xmm4, %%xmm4\n"
+            "psubb      %%xmm4, %%xmm3\n" /* 0x01 */
+            "pxor       %%xmm4, %%xmm4\n"
+            "movdqu    0(%[p]), %%xmm0\n"
+            "movdqu    1(%[p]), %%xmm1\n"
+            "movdqu    2(%[p]), %%xmm2\n"
+            "pcmpeqb    %%xmm4, %%xmm0\n"
+            "pcmpeqb    %%xmm4, %%xmm1\n"
+            "pcmpeqb    %%xmm3, %%xmm2\n"
+            "pand       %%xmm1, %%xmm0\n"
+            "pand       %%xmm2, %%xmm0\n"
+            "pmovmskb   %%xmm0, %[match]\n"
+            : [match]"=r"(match)
+            : [p]"r"(p)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory" );
+        if( match )
+            return p + ctz( match );
+        p += 16;
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+static inline const uint8_t *startcode_FindAnnexB_AVX2( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    if( end - p >= 32 + 2 )
+    {
+        do
+        {
+            unsigned match;
+
+            asm volatile (
+                "vpxor      %%ymm4, %%ymm4, %%ymm4\n"
+                "vpcmpeqb   %%ymm3, %%ymm3, %%ymm3\n"
+                "vpabsb     %%ymm3, %%ymm3\n" /* 0x01 */
+                "vpcmpeqb  0(%[p]), %%ymm4, %%ymm0\n"
+                "vpcmpeqb  1(%[p]), %%ymm4, %%ymm1\n"
+                "vpcmpeqb  2(%[p]), %%ymm3, %%ymm2\n"
+                "vpand      %%ymm1, %%ymm0, %%ymm0\n"
+                "vpand      %%ymm2, %%ymm0, %%ymm0\n"
+                "vpmovmskb  %%ymm0, %[match]\n"
+                : [match]"=r"(match)
+                : [p]"r"(p)
+                : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory" );
+            if( match )
+            {
+                asm volatile ( "vzeroupper\n" );
+                return p + ctz( match );
+            }
+            p += 32;
+        }
+        while( end - p >= 32 + 2 );
+        asm volatile ( "vzeroupper\n" );
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+#ifdef STARTCODE_NEON
+static inline const uint8_t *startcode_FindAnnexB_NEON( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    const uint8x16_t zero = vdupq_n_u8( 0 );
+    const uint8x16_t one = vdupq_n_u8( 1 );
+
+    while( end - p >= 16 + 2 )
+    {
+        uint8x16_t match = vandq_u8( vandq_u8( vceqq_u8( vld1q_u8( p ), zero ),
+                                               vceqq_u8( vld1q_u8( p + 1 ), zero ) ),
+                                     vceqq_u8( vld1q_u8( p + 2 ), one ) );
+        uint64x2_t match64 = vreinterpretq_u64_u8( match );
+
+        if( vgetq_lane_u64( match64, 0 ) | vgetq_lane_u64( match64, 1 ) )
+            return startcode_FindAnnexB_C( p, p + 16 + 2 );
+        p += 16;
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+/**
+ * Finds the first 00 00 01 start code within [p, end), with the fastest
+ * version the CPU supports.
+ * This is a block_startcode_helper_t for block_FindStartcodeFromOffset().
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+        return startcode_FindAnnexB_AVX2( p, end );
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU_SSE2() )
+        return startcode_FindAnnexB_SSE2( p, end );
+#endif
+#ifdef STARTCODE_NEON
+    return startcode_FindAnnexB_NEON( p, end );
+#else
+    return startcode_FindAnnexB_memchr( p, end );
+#endif
+}
+
+#endif
@@ -0,0 +1,591 @@
+/*****************************************************************************
+ * prefetch.c: asynchronous read-ahead stream filter
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+
+static int  Open (vlc_object_t *);
+static void Close (vlc_object_t *);
+
+#define BUFFER_TEXT N_("Buffer size")
+#define BUFFER_LONGTEXT N_( \
+    "Maximum amount of data read ahead, in KiB.")
+#define READ_TEXT N_("Read size")
+#define READ_LONGTEXT N_( \
+    "Amount of data read from the source at once, in bytes.")
+#define DURATION_TEXT N_("Read-ahead duration")
+#define DURATION_LONGTEXT N_( \
+    "Amount of playback read ahead, in milliseconds. The data window is " \
+    "sized from this, the consumption rate and the stalls of the source.")
+#define SEEK_TEXT N_("Seek threshold")
+#define SEEK_LONGTEXT N_( \
+    "Forward seeks within this many bytes after the buffered data are " \
+    "performed by reading through, in bytes.")
+
+vlc_module_begin ()
+    set_category (CAT_INPUT)
+    set_subcategory (SUBCAT_INPUT_STREAM_FILTER)
+    set_capability ("stream_filter", 0)
+    set_shortname (N_("Prefetch"))
+    set_description (N_("Stream prefetch filter"))
+    set_callbacks (Open, Close)
+
+    add_integer ("prefetch-buffer-size", 16384, BUFFER_TEXT,
+                 BUFFER_LONGTEXT, true)
+        change_integer_range (64, INT32_MAX)
+    add_integer ("prefetch-read-size", 16384, READ_TEXT, READ_LONGTEXT, true)
+        change_integer_range (512, 1 << 20)
+    add_integer ("prefetch-duration", 5000, DURATION_TEXT,
+                 DURATION_LONGTEXT, true)
+        change_integer_range (0, 600000)
+    add_integer ("prefetch-seek-threshold", 1 << 16, SEEK_TEXT,
+                 SEEK_LONGTEXT, true)
+        change_integer_range (0, UINT32_MAX)
+vlc_module_end ()
+
+struct stream_sys_t
+{
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_data;  /* signaled to the consumer */
+    vlc_cond_t   wait_space; /* signaled to the thread */
+    vlc_thread_t thread;
+
+    bool         killed;
+    bool         eof;
+    bool         error;
+    bool         paused;
+    bool         seek_pending;
+    int          seek_status;
+
+    /* Ring buffer of buffer_size bytes. The data from buffer_offset in the
+     * stream starts at buffer_start; what precedes stream_offset is kept
+     * for backward seeks until its space is needed. */
+    uint8_t     *buffer;
+    size_t       buffer_size;
+    size_t       buffer_start;
+    size_t       buffer_length;
+    uint64_t     buffer_offset;
+    uint64_t     stream_offset;
+    size_t       wanted;     /* bytes the consumer is waiting for */
+
+    size_t       read_size;
+    uint64_t     seek_threshold;
+    mtime_t      duration;
+
+    /* Window sizing */
+    size_t       window;
+    uint64_t     rate;       /* consumption, bytes per second */
+    uint64_t     throughput; /* source, bytes per second */
+    mtime_t      stall;      /* longest recent source read */
+    mtime_t      rate_start;
+    uint64_t     rate_bytes;
+    uint64_t     underruns;
+
+    uint8_t     *peek;
+    size_t       peek_size;
+
+    bool         can_seek;
+    bool         can_fastseek;
+    bool         can_pause;
+    bool         can_pace;
+    int64_t      pts_delay;
+    uint64_t     size;
+    char        *content_type;
+};
+
+/* Bytes readily available to the consumer, under the lock */
+static size_t Available (const stream_sys_t *sys)
+{
+    uint64_t end = sys->buffer_offset + sys->buffer_length;
+
+    if (sys->stream_offset < sys->buffer_offset || sys->stream_offset >= end)
+        return 0;
+    return end - sys->stream_offset;
+}
+
+/**
+ * Sizes the window to cover the configured duration at the consumption
+ * rate, plus the longest recent stall of the source. When the source is
+ * barely faster than the consumer, refilling takes long: the window is
+ * doubled.
+ */
+static void UpdateWindow (stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+    uint64_t window;
+
+    if (sys->rate == 0)
+        window = 1 << 20; /* until the rate is known */
+    else
+    {
+        window = sys->rate * (sys->duration + sys->stall) / CLOCK_FREQ;
+        if (sys->throughput < 2 * sys->rate)
+            window *= 2;
+    }
+
+    if (window < 4 * sys->read_size)
+        window = 4 * sys->read_size;
+    if (window > sys->buffer_size - sys->read_size)
+        window = sys->buffer_size - sys->read_size;
+    sys->window = window;
+}
+
+/* Accounts for the consumption, under the lock */
+static void Consume (stream_t *stream, size_t len)
+{
+    stream_sys_t *sys = stream->p_sys;
+    mtime_t now = mdate ();
+
+    sys->stream_offset += len;
+    sys->rate_bytes += len;
+
+    if (sys->rate_start == VLC_TS_INVALID)
+        sys->rate_start = now;
+    else if (now - sys->rate_start >= CLOCK_FREQ)
+    {
+        uint64_t rate = sys->rate_bytes * CLOCK_FREQ / (now - sys->rate_start);
+
+        sys->rate = sys->rate ? (3 * sys->rate + rate) / 4 : rate;
+        sys->rate_start = now;
+        sys->rate_bytes = 0;
+        UpdateWindow (stream);
+    }
+    vlc_cond_signal (&sys->wait_space);
+}
+
+static void *Thread (void *data)
+{
+    stream_t *stream = data;
+    stream_sys_t *sys = stream->p_sys;
+    bool paused = false;
+
+    vlc_mutex_lock (&sys->lock);
+    for (;;)
+    {
+        if (sys->killed)
+            break;
+
+        if (sys->paused != paused)
+        {
+            paused = sys->paused;
+            vlc_mutex_unlock (&sys->lock);
+            stream_Control (stream->p_source, STREAM_SET_PAUSE_STATE, paused);
+            vlc_mutex_lock (&sys->lock);
+            continue;
+        }
+
+        uint64_t end = sys->buffer_offset + sys->buffer_length;
+
+        if (sys->seek_pending)
+        {   /* Seek outside of the buffered data: drop it all and restart
+             * from the new position. */
+            uint64_t offset = sys->stream_offset;
+
+            vlc_mutex_unlock (&sys->lock);
+            int val = stream_Seek (stream->p_source, offset);
+            vlc_mutex_lock (&sys->lock);
+
+            sys->seek_pending = false;
+            sys->seek_status = val;
+            if (val == VLC_SUCCESS)
+            {
+                sys->buffer_start = 0;
+                sys->buffer_length = 0;
+                sys->buffer_offset = offset;
+                sys->eof = false;
+                sys->error = false;
+            }
+            vlc_cond_broadcast (&sys->wait_data);
+            continue;
+        }
+
+        size_t ahead = (end > sys->stream_offset) ? end - sys->stream_offset : 0;
+        size_t target = __MAX(sys->window, sys->wanted);
+
+        if (paused || sys->eof || sys->error || ahead >= target)
+        {
+            vlc_cond_wait (&sys->wait_space, &sys->lock);
+            continue;
+        }
+
+        /* Drop consumed data if the space is needed */
+        size_t len = sys->buffer_size - sys->buffer_length;
+        if (len < sys->read_size)
+        {
+            uint64_t consumed = __MIN(sys->stream_offset, end);
+            size_t drop = __MIN(consumed - sys->buffer_offset,
+                                sys->read_size - len);
+
+            sys->buffer_start = (sys->buffer_start + drop) % sys->buffer_size;
+            sys->buffer_length -= drop;
+            sys->buffer_offset += drop;
+            len += drop;
+            if (len == 0)
+            {   /* Everything is ahead, cannot happen with the window
+                 * bounded by the buffer size */
+                vlc_cond_wait (&sys->wait_space, &sys->lock);
+                continue;
+            }
+        }
+
+        size_t index = (sys->buffer_start + sys->buffer_length)
+                     % sys->buffer_size;
+        len = __MIN(len, sys->read_size);
+        len = __MIN(len, sys->buffer_size - index);
+        vlc_mutex_unlock (&sys->lock);
+
+        mtime_t start = mdate ();
+        int val = stream_Read (stream->p_source, sys->buffer + index, len);
+        mtime_t delay = mdate () - start;
+
+        vlc_mutex_lock (&sys->lock);
+        if (val < 0)
+            sys->error = true;
+        else if (val == 0)
+            sys->eof = true;
+        else
+        {
+            sys->buffer_length += val;
+
+            uint64_t throughput = (uint64_t)val * CLOCK_FREQ / __MAX(delay, 1);
+            sys->throughput = sys->throughput
+                            ? (7 * sys->throughput + throughput) / 8
+                            : throughput;
+            sys->stall = __MAX(delay, sys->stall - sys->stall / 16);
+        }
+        vlc_cond_broadcast (&sys->wait_data);
+
+        size_t level = Available (sys);
+        size_t window = sys->window;
+        vlc_mutex_unlock (&sys->lock);
+
+        var_SetInteger (stream, "prefetch-level", level);
+        var_SetInteger (stream, "prefetch-window", window);
+        vlc_mutex_lock (&sys->lock);
+    }
+    vlc_mutex_unlock (&sys->lock);
+    return NULL;
+}
+
+/* Waits for len bytes ahead (or the end of the stream), under the lock */
+static size_t Wait (stream_t *stream, size_t len)
+{
+    stream_sys_t *sys = stream->p_sys;
+    size_t avail = Available (sys);
+
+    if (avail >= len)
+        return len;
+
+    if (avail == 0 && !sys->eof && !sys->error)
+    {
+        sys->underruns++;
+        var_SetInteger (stream, "prefetch-underruns", sys->underruns);
+    }
+
+    sys->wanted = len;
+    vlc_cond_signal (&sys->wait_space);
+    while ((avail = Available (sys)) < len
+        && !sys->eof && !sys->error && !sys->seek_pending)
+        vlc_cond_wait (&sys->wait_data, &sys->lock);
+    sys->wanted = 0;
+    return __MIN(avail, len);
+}
+
+static int Read (stream_t *stream, void *buf, unsigned len)
+{
+    stream_sys_t *sys = stream->p_sys;
+    uint8_t *p = buf;
+    unsigned total = 0;
+
+    vlc_mutex_lock (&sys->lock);
+    while (total < len)
+    {
+        size_t copy = Wait (stream, __MIN(len - total, sys->buffer_size / 2));
+        if (copy == 0)
+            break;
+
+        size_t index = (sys->buffer_start
+                     + (sys->stream_offset - sys->buffer_offset))
+                     % sys->buffer_size;
+        copy = __MIN(copy, sys->buffer_size - index);
+        if (p != NULL)
+        {
+            memcpy (p, sys->buffer + index, copy);
+            p += copy;
+        }
+        Consume (stream, copy);
+        total += copy;
+    }
+    vlc_mutex_unlock (&sys->lock);
+    return total;
+}
+
+static int Peek (stream_t *stream, const uint8_t **pp, unsigned len)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    if (len > sys->buffer_size / 2)
+        len = sys->buffer_size / 2;
+
+    vlc_mutex_lock (&sys->lock);
+    len = Wait (stream, len);
+
+    size_t index = (sys->buffer_start
+                 + (sys->stream_offset - sys->buffer_offset))
+                 % sys->buffer_size;
+
+    if (len <= sys->buffer_size - index)
+        *pp = sys->buffer + index; /* not dropped before the next read */
+    else
+    {   /* Wraps around the ring */
+        if (sys->peek_size < len)
+        {
+            uint8_t *peek = realloc (sys->peek, len);
+            if (unlikely(peek == NULL))
+            {
+                vlc_mutex_unlock (&sys->lock);
+                return 0;
+            }
+            sys->peek = peek;
+            sys->peek_size = len;
+        }
+
+        size_t first = sys->buffer_size - index;
+        memcpy (sys->peek, sys->buffer + index, first);
+        memcpy (sys->peek + first, sys->buffer, len - first);
+        *pp = sys->peek;
+    }
+    vlc_mutex_unlock (&sys->lock);
+    return len;
+}
+
+static int Seek (stream_t *stream, uint64_t offset)
+{
+    stream_sys_t *sys = stream->p_sys;
+    int val = VLC_SUCCESS;
+
+    vlc_mutex_lock (&sys->lock);
+    sys->stream_offset = offset;
+
+    /* Within the buffered data or a bit after: no need to seek the source */
+    if (offset < sys->buffer_offset
+     || offset > sys->buffer_offset + sys->buffer_length + sys->seek_threshold)
+    {
+        sys->seek_pending = true;
+        vlc_cond_signal (&sys->wait_space);
+        while (sys->seek_pending)
+            vlc_cond_wait (&sys->wait_data, &sys->lock);
+        val = sys->seek_status;
+        if (val != VLC_SUCCESS)
+            sys->error = true;
+    }
+    else
+    {
+        sys->error = false;
+        vlc_cond_signal (&sys->wait_space);
+    }
+    vlc_mutex_unlock (&sys->lock);
+    return val;
+}
+
+static int Control (stream_t *stream, int query, va_list args)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+            *va_arg (args, bool *) = sys->can_seek;
+            break;
+        case STREAM_CAN_FASTSEEK:
+            *va_arg (args, bool *) = sys->can_fastseek;
+            break;
+        case STREAM_CAN_PAUSE:
+            *va_arg (args, bool *) = sys->can_pause;
+            break;
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg (args, bool *) = sys->can_pace;
+            break;
+        case STREAM_IS_DIRECTORY:
+            *va_arg (args, bool *) = false;
+            break;
+        case STREAM_GET_POSITION:
+            vlc_mutex_lock (&sys->lock);
+            *va_arg (args, uint64_t *) = sys->stream_offset;
+            vlc_mutex_unlock (&sys->lock);
+            break;
+        case STREAM_GET_SIZE:
+            *va_arg (args, uint64_t *) = sys->size;
+            break;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg (args, int64_t *) = sys->pts_delay;
+            break;
+        case STREAM_GET_CONTENT_TYPE:
+        {
+            char **type = va_arg (args, char **);
+            if (sys->content_type == NULL)
+                return VLC_EGENERIC;
+            *type = strdup (sys->content_type);
+            if (unlikely(*type == NULL))
+                return VLC_ENOMEM;
+            break;
+        }
+        case STREAM_SET_POSITION:
+            if (!sys->can_seek)
+                return VLC_EGENERIC;
+            return Seek (stream, va_arg (args, uint64_t));
+        case STREAM_SET_PAUSE_STATE:
+        {
+            bool paused = va_arg (args, unsigned);
+
+            /* The thread forwards it, as it owns the source */
+            vlc_mutex_lock (&sys->lock);
+            sys->paused = paused;
+            if (!paused)
+                sys->rate_start = VLC_TS_INVALID;
+            vlc_cond_signal (&sys->wait_space);
+            vlc_mutex_unlock (&sys->lock);
+            break;
+        }
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open (vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+
+    if (stream->p_source->pf_read == NULL)
+        return VLC_EGENERIC;
+
+    stream_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->buffer_size = var_InheritInteger (stream, "prefetch-buffer-size") << 10;
+    sys->read_size = var_InheritInteger (stream, "prefetch-read-size");
+    if (sys->read_size > sys->buffer_size / 4)
+        sys->read_size = sys->buffer_size / 4;
+    sys->duration = var_InheritInteger (stream, "prefetch-duration") * 1000;
+    sys->seek_threshold = var_InheritInteger (stream,
+                                              "prefetch-seek-threshold");
+
+    sys->buffer = malloc (sys->buffer_size);
+    if (unlikely(sys->buffer == NULL))
+    {
+        free (sys);
+        return VLC_ENOMEM;
+    }
+
+    vlc_mutex_init (&sys->lock);
+    vlc_cond_init (&sys->wait_data);
+    vlc_cond_init (&sys->wait_space);
+    sys->killed = false;
+    sys->eof = false;
+    sys->error = false;
+    sys->paused = false;
+    sys->seek_pending = false;
+    sys->seek_status = VLC_SUCCESS;
+    sys->buffer_start = 0;
+    sys->buffer_length = 0;
+    sys->buffer_offset = stream_Tell (stream->p_source);
+    sys->stream_offset = sys->buffer_offset;
+    sys->wanted = 0;
+    sys->rate = 0;
+    sys->throughput = 0;
+    sys->stall = 0;
+    sys->rate_start = VLC_TS_INVALID;
+    sys->rate_bytes = 0;
+    sys->underruns = 0;
+    sys->peek = NULL;
+    sys->peek_size = 0;
+
+    stream_Control (stream->p_source, STREAM_CAN_SEEK, &sys->can_seek);
+    stream_Control (stream->p_source, STREAM_CAN_FASTSEEK,
+                    &sys->can_fastseek);
+    stream_Control (stream->p_source, STREAM_CAN_PAUSE, &sys->can_pause);
+    stream_Control (stream->p_source, STREAM_CAN_CONTROL_PACE,
+                    &sys->can_pace);
+    stream_Control (stream->p_source, STREAM_GET_PTS_DELAY, &sys->pts_delay);
+    sys->size = stream_Size (stream->p_source);
+    if (stream_Control (stream->p_source, STREAM_GET_CONTENT_TYPE,
+                        &sys->content_type))
+        sys->content_type = NULL;
+
+    stream->p_sys = sys;
+    UpdateWindow (stream);
+
+    var_Create (stream, "prefetch-level", VLC_VAR_INTEGER);
+    var_Create (stream, "prefetch-window", VLC_VAR_INTEGER);
+    var_Create (stream, "prefetch-underruns", VLC_VAR_INTEGER);
+
+    if (vlc_clone (&sys->thread, Thread, stream, VLC_THREAD_PRIORITY_INPUT))
+    {
+        vlc_cond_destroy (&sys->wait_space);
+        vlc_cond_destroy (&sys->wait_data);
+        vlc_mutex_destroy (&sys->lock);
+        free (sys->content_type);
+        free (sys->buffer);
+        free (sys);
+        return VLC_ENOMEM;
+    }
+
+    msg_Dbg (stream, "using %zu bytes buffer, %zu bytes read size",
+             sys->buffer_size, sys->read_size);
+    stream->pf_read = Read;
+    stream->pf_peek = Peek;
+    stream->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void Close (vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+    stream_sys_t *sys = stream->p_sys;
+
+    vlc_mutex_lock (&sys->lock);
+    sys->killed = true;
+    vlc_cond_signal (&sys->wait_space);
+    vlc_mutex_unlock (&sys->lock);
+    vlc_join (sys->thread, NULL);
+
+    msg_Dbg (stream, "%"PRIu64" underrun(s), consumption %"PRIu64" B/s, "
+             "source %"PRIu64" B/s", sys->underruns, sys->rate,
+             sys->throughput);
+
+    vlc_cond_destroy (&sys->wait_space);
+    vlc_cond_destroy (&sys->wait_data);
+    vlc_mutex_destroy (&sys->lock);
+    free (sys->content_type);
+    free (sys->peek);
+    free (sys->buffer);
+    free (sys);
+}
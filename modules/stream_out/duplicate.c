@@ -68,6 +68,10 @@ struct sout_stream_sys_t
 
     int             i_nb_select;
     char            **ppsz_select;
+
+    /* Statistics of the buffers sent to several destinations */
+    uint64_t        i_shared_blocks;
+    uint64_t        i_shared_bytes;
 };
 
 struct sout_stream_id_sys_t
@@ -96,6 +100,8 @@ static int Open( vlc_object_t *p_this )
     TAB_INIT( p_sys->i_nb_streams, p_sys->pp_streams );
     TAB_INIT( p_sys->i_nb_last_streams, p_sys->pp_last_streams );
     TAB_INIT( p_sys->i_nb_select, p_sys->ppsz_select );
+    p_sys->i_shared_blocks = 0;
+    p_sys->i_shared_bytes = 0;
 
     for( p_cfg = p_stream->p_cfg; p_cfg != NULL; p_cfg = p_cfg->p_next )
     {
@@ -167,7 +173,9 @@ static void Close( vlc_object_t * p_this )
 
     int i;
 
-    msg_Dbg( p_stream, "closing a duplication" );
+    msg_Dbg( p_stream, "closing a duplication (%"PRIu64" buffers, %"PRIu64
+             " KiB sent to several destinations without copy)",
+             p_sys->i_shared_blocks, p_sys->i_shared_bytes / 1024 );
     for( i = 0; i < p_sys->i_nb_streams; i++ )
     {
         sout_StreamChainDelete(p_sys->pp_streams[i], p_sys->pp_last_streams[i]);
@@ -281,13 +289,29 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
             if( id->pp_ids[i_stream] )
             {
-                block_t *p_dup = block_Duplicate( p_buffer );
+                /* The destinations share the payload, which is copied only
+                 * by those modifying it */
+                p_buffer = block_Shareable( p_buffer );
+                if( unlikely(p_buffer == NULL) )
+                    break;
+
+                block_t *p_dup = block_Share( p_buffer );
 
                 if( p_dup )
+                {
+                    p_sys->i_shared_blocks++;
+                    p_sys->i_shared_bytes += p_dup->i_buffer;
                     sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
+                }
             }
         }
 
+        if( unlikely(p_buffer == NULL) )
+        {
+            p_buffer = p_next;
+            continue;
+        }
+
         if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
         {
             p_dup_stream = p_sys->pp_streams[i_stream];
@@ -294,7 +294,7 @@ int transcode_audio_process( sout_stream_t *p_stream,
                 if( likely(p_audio_buf->i_pts != VLC_TS_INVALID ) )
                     i_drift = p_audio_buf->i_pts - i_pts;
             }
-            p_sys->i_master_drift = i_drift;
+            atomic_store( &p_sys->i_master_drift, i_drift );
             date_Increment( &id->next_input_pts, p_audio_buf->i_nb_samples );
         }
 
@@ -84,8 +84,10 @@ int transcode_osd_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         if( !id->id ) goto error;
     }
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream );
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     return VLC_SUCCESS;
 
@@ -117,6 +119,7 @@ int transcode_osd_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     subpicture_t *p_subpic = NULL;
 
     /* Check if we have a subpicture to send */
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu && in->i_dts > VLC_TS_INVALID )
     {
         video_format_t fmt;
@@ -130,15 +133,17 @@ int transcode_osd_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         if( !p_sys->p_spu )
             p_sys->p_spu = spu_Create( p_stream );
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     if( p_subpic )
     {
         block_t *p_block = NULL;
 
-        if( p_sys->b_master_sync && p_sys->i_master_drift )
+        mtime_t i_drift = atomic_load( &p_sys->i_master_drift );
+        if( p_sys->b_master_sync && i_drift )
         {
-            p_subpic->i_start -= p_sys->i_master_drift;
-            if( p_subpic->i_stop ) p_subpic->i_stop -= p_sys->i_master_drift;
+            p_subpic->i_start -= i_drift;
+            if( p_subpic->i_stop ) p_subpic->i_stop -= i_drift;
         }
 
         p_block = id->p_encoder->pf_encode_sub( id->p_encoder, p_subpic );
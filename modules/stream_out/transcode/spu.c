@@ -88,8 +88,10 @@ int transcode_spu_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         }
     }
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream );
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     return VLC_SUCCESS;
 }
@@ -107,11 +109,13 @@ void transcode_spu_close( sout_stream_t *p_stream, sout_stream_id_sys_t *id)
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu )
     {
         spu_Destroy( p_sys->p_spu );
         p_sys->p_spu = NULL;
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 }
 
 int transcode_spu_process( sout_stream_t *p_stream,
@@ -129,10 +133,11 @@ int transcode_spu_process( sout_stream_t *p_stream,
         return VLC_SUCCESS;
     }
 
-    if( p_sys->b_master_sync && p_sys->i_master_drift )
+    mtime_t i_drift = atomic_load( &p_sys->i_master_drift );
+    if( p_sys->b_master_sync && i_drift )
     {
-        p_subpic->i_start -= p_sys->i_master_drift;
-        if( p_subpic->i_stop ) p_subpic->i_stop -= p_sys->i_master_drift;
+        p_subpic->i_start -= i_drift;
+        if( p_subpic->i_stop ) p_subpic->i_stop -= i_drift;
     }
 
     if( p_sys->b_soverlay )
@@ -80,6 +80,19 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define VRENDITIONS_TEXT N_("Video renditions")
+#define VRENDITIONS_LONGTEXT N_( \
+    "Additional video streams encoded from the same decoded and filtered " \
+    "pictures, as a comma-separated list of WIDTHxHEIGHT@BITRATE. Either " \
+    "dimension may be omitted to keep the aspect ratio, and the bitrate " \
+    "defaults to the one of the main video stream." )
+#define KEYINT_TEXT N_("Key frame interval")
+#define KEYINT_LONGTEXT N_( \
+    "Number of pictures between two key frames of the video streams. All " \
+    "the renditions then get their key frames on the same pictures, so " \
+    "that their segments can be cut at the same time. With renditions, 0 " \
+    "selects two seconds of pictures; otherwise it leaves the encoder " \
+    "default." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -127,6 +140,10 @@
 #define THREADS_TEXT N_("Number of threads")
 #define THREADS_LONGTEXT N_( \
     "Number of threads used for the transcoding." )
+#define WORKERS_TEXT N_("Stream threads")
+#define WORKERS_LONGTEXT N_( \
+    "Decode, filter and encode each audio, video and subtitle stream on " \
+    "its own thread, with a bounded queue from the input." )
 #define HP_TEXT N_("High priority")
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
@@ -179,6 +196,11 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter2",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "vrenditions", NULL, VRENDITIONS_TEXT,
+                VRENDITIONS_LONGTEXT, false )
+    add_integer( SOUT_CFG_PREFIX "keyint", 0, KEYINT_TEXT,
+                 KEYINT_LONGTEXT, true )
+        change_integer_range( 0, 10000 )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -218,6 +240,8 @@ vlc_module_begin ()
                  THREADS_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "stream-threads", false, WORKERS_TEXT,
+              WORKERS_LONGTEXT, true )
 
 vlc_module_end ()
 
@@ -227,6 +251,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "high-priority", "maxwidth", "maxheight",
+    "vrenditions", "keyint", "stream-threads",
     NULL
 };
 
@@ -237,6 +262,57 @@ static sout_stream_id_sys_t *Add ( sout_stream_t *, es_format_t * );
 static int               Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/*****************************************************************************
+ * ParseRenditions: parses the WIDTHxHEIGHT@BITRATE list of vrenditions
+ *****************************************************************************/
+static void ParseRenditions( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                             const char *psz_list )
+{
+    unsigned i_count = 1;
+    for( const char *psz = psz_list; (psz = strchr( psz, ',' )) != NULL; psz++ )
+        i_count++;
+
+    p_sys->p_renditions = calloc( i_count, sizeof( *p_sys->p_renditions ) );
+    if( !p_sys->p_renditions )
+        return;
+
+    for( ;; )
+    {
+        transcode_rendition_t *p_cfg =
+            &p_sys->p_renditions[p_sys->i_renditions];
+        size_t i_len = strcspn( psz_list, "," );
+        char *psz_end;
+
+        p_cfg->i_width = strtoul( psz_list, &psz_end, 10 );
+        if( *psz_end == 'x' )
+            p_cfg->i_height = strtoul( psz_end + 1, &psz_end, 10 );
+        p_cfg->i_bitrate = p_sys->i_vbitrate;
+        if( *psz_end == '@' )
+        {
+            p_cfg->i_bitrate = strtol( psz_end + 1, &psz_end, 10 );
+            if( p_cfg->i_bitrate < 16000 ) p_cfg->i_bitrate *= 1000;
+        }
+
+        if( psz_end != psz_list + i_len ||
+            ( !p_cfg->i_width && !p_cfg->i_height ) )
+        {
+            msg_Warn( p_stream, "invalid video rendition `%.*s'",
+                      (int)i_len, psz_list );
+        }
+        else
+        {
+            msg_Dbg( p_stream, "video rendition %ux%u %dkb/s",
+                     p_cfg->i_width, p_cfg->i_height,
+                     p_cfg->i_bitrate / 1000 );
+            p_sys->i_renditions++;
+        }
+
+        if( psz_list[i_len] == '\0' )
+            break;
+        psz_list += i_len + 1;
+    }
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -252,7 +328,7 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
     p_sys = calloc( 1, sizeof( *p_sys ) );
-    p_sys->i_master_drift = 0;
+    atomic_init( &p_sys->i_master_drift, 0 );
 
     config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
                    p_stream->p_cfg );
@@ -373,8 +449,16 @@ static int Open( vlc_object_t *p_this )
     }
     free( psz_string );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "vrenditions" );
+    if( psz_string && *psz_string )
+        ParseRenditions( p_stream, p_sys, psz_string );
+    free( psz_string );
+    p_sys->i_keyint = var_GetInteger( p_stream, SOUT_CFG_PREFIX "keyint" );
+
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
+    p_sys->b_workers = var_GetBool( p_stream, SOUT_CFG_PREFIX "stream-threads" );
+    TAB_INIT( p_sys->i_workers, p_sys->pp_workers );
 
     if( p_sys->i_vcodec )
     {
@@ -392,6 +476,7 @@ static int Open( vlc_object_t *p_this )
     /* Subpictures transcoding parameters */
     p_sys->p_spu = NULL;
     p_sys->p_spu_blend = NULL;
+    vlc_mutex_init( &p_sys->lock_spu );
     p_sys->psz_senc = NULL;
     p_sys->p_spu_cfg = NULL;
     p_sys->i_scodec = 0;
@@ -478,6 +563,7 @@ static void Close( vlc_object_t * p_this )
     sout_stream_t       *p_stream = (sout_stream_t*)p_this;
     sout_stream_sys_t   *p_sys = p_stream->p_sys;
 
+    TAB_CLEAN( p_sys->i_workers, p_sys->pp_workers );
     free( p_sys->psz_af );
 
     config_ChainDestroy( p_sys->p_audio_cfg );
@@ -485,6 +571,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_renditions );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -497,6 +584,7 @@ static void Close( vlc_object_t * p_this )
 
     if( p_sys->p_spu ) spu_Destroy( p_sys->p_spu );
     if( p_sys->p_spu_blend ) filter_DeleteBlend( p_sys->p_spu_blend );
+    vlc_mutex_destroy( &p_sys->lock_spu );
 
     config_ChainDestroy( p_sys->p_osd_cfg );
     free( p_sys->psz_osdenc );
@@ -504,6 +592,181 @@ static void Close( vlc_object_t * p_this )
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Process: decodes, filters and encodes a block of a transcoded ES
+ *****************************************************************************/
+static int Process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                    block_t *p_buffer, block_t **pp_out )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    *pp_out = NULL;
+    if( id->b_error )
+    {
+        if( p_buffer )
+            block_Release( p_buffer );
+        return VLC_EGENERIC;
+    }
+
+    /* The decoders may modify their input in place */
+    if( p_buffer )
+    {
+        p_buffer = block_Writable( p_buffer );
+        if( unlikely(p_buffer == NULL) )
+            return VLC_ENOMEM;
+    }
+
+    switch( id->p_decoder->fmt_in.i_cat )
+    {
+    case AUDIO_ES:
+        return transcode_audio_process( p_stream, id, p_buffer, pp_out );
+
+    case VIDEO_ES:
+        return transcode_video_process( p_stream, id, p_buffer, pp_out );
+
+    case SPU_ES:
+        /* Transcode OSD menu pictures. */
+        if( p_sys->b_osd )
+            return transcode_osd_process( p_stream, id, p_buffer, pp_out );
+        return transcode_spu_process( p_stream, id, p_buffer, pp_out );
+
+    default:
+        block_Release( p_buffer );
+        return VLC_SUCCESS;
+    }
+}
+
+/*****************************************************************************
+ * SendOutput: sends the output of an ES to the next stream
+ *****************************************************************************
+ * This is only called from Send() and Del(), as the next stream is not
+ * to be used from the workers.
+ *****************************************************************************/
+static int SendOutput( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_out )
+{
+    int i_ret = VLC_SUCCESS;
+
+    /* The video encoders hand their output over by themselves */
+    if( id->p_decoder->fmt_in.i_cat == VIDEO_ES )
+        i_ret = transcode_video_send( p_stream, id );
+
+    if( p_out )
+    {
+        if( id->id )
+            return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
+        block_ChainRelease( p_out );
+    }
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Workers
+ *****************************************************************************/
+static void *WorkerThread( void *data )
+{
+    transcode_worker_t *p_worker = data;
+
+    for( ;; )
+    {
+        block_t *p_in = block_FifoGet( p_worker->p_fifo );
+        if( p_in == &p_worker->eos )
+            break;
+
+        block_t *p_out;
+        int i_ret = Process( p_worker->p_stream, p_worker->id, p_in, &p_out );
+
+        vlc_mutex_lock( &p_worker->lock );
+        block_ChainAppend( &p_worker->p_out, p_out );
+        if( i_ret != VLC_SUCCESS )
+            p_worker->i_ret = i_ret;
+        vlc_mutex_unlock( &p_worker->lock );
+    }
+    return NULL;
+}
+
+static int WorkerStart( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    transcode_worker_t *p_worker = malloc( sizeof( *p_worker ) );
+    if( !p_worker )
+        return VLC_ENOMEM;
+
+    p_worker->p_fifo = block_FifoNew();
+    if( !p_worker->p_fifo )
+    {
+        free( p_worker );
+        return VLC_ENOMEM;
+    }
+    p_worker->p_stream = p_stream;
+    p_worker->id = id;
+    block_Init( &p_worker->eos, NULL, 0 );
+    vlc_mutex_init( &p_worker->lock );
+    p_worker->p_out = NULL;
+    p_worker->i_ret = VLC_SUCCESS;
+
+    int i_priority;
+    switch( id->p_decoder->fmt_in.i_cat )
+    {
+    case AUDIO_ES:
+        i_priority = VLC_THREAD_PRIORITY_AUDIO;
+        break;
+    case VIDEO_ES:
+        i_priority = VLC_THREAD_PRIORITY_VIDEO;
+        break;
+    default:
+        i_priority = VLC_THREAD_PRIORITY_LOW;
+        break;
+    }
+
+    if( vlc_clone( &p_worker->thread, WorkerThread, p_worker, i_priority ) )
+    {
+        vlc_mutex_destroy( &p_worker->lock );
+        block_FifoRelease( p_worker->p_fifo );
+        free( p_worker );
+        return VLC_EGENERIC;
+    }
+    id->p_worker = p_worker;
+    TAB_APPEND( p_stream->p_sys->i_workers, p_stream->p_sys->pp_workers, id );
+    return VLC_SUCCESS;
+}
+
+/* Waits for the worker to process its queue, and returns the output it has
+ * not handed over yet. */
+static block_t *WorkerStop( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    transcode_worker_t *p_worker = id->p_worker;
+
+    TAB_REMOVE( p_stream->p_sys->i_workers, p_stream->p_sys->pp_workers, id );
+    block_FifoPut( p_worker->p_fifo, &p_worker->eos );
+    vlc_join( p_worker->thread, NULL );
+
+    block_t *p_out = p_worker->p_out;
+    vlc_mutex_destroy( &p_worker->lock );
+    block_FifoRelease( p_worker->p_fifo );
+    free( p_worker );
+    id->p_worker = NULL;
+    return p_out;
+}
+
+/* Sends the output produced by the worker so far. A sending error is kept
+ * for the next Send() of its own ES. */
+static void WorkerSendOutput( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    transcode_worker_t *p_worker = id->p_worker;
+
+    vlc_mutex_lock( &p_worker->lock );
+    block_t *p_out = p_worker->p_out;
+    p_worker->p_out = NULL;
+    vlc_mutex_unlock( &p_worker->lock );
+
+    if( SendOutput( p_stream, id, p_out ) != VLC_SUCCESS )
+    {
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->i_ret = VLC_EGENERIC;
+        vlc_mutex_unlock( &p_worker->lock );
+    }
+}
+
 static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -542,6 +805,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
         id->p_encoder->fmt_out.psz_language = strdup( p_fmt->psz_language );
 
     bool success;
+    bool b_worker = p_sys->b_workers;
 
     if( p_fmt->i_cat == AUDIO_ES && p_sys->i_acodec )
         success = transcode_audio_add(p_stream, p_fmt, id);
@@ -565,6 +829,13 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
     if(!success)
         goto error;
 
+    /* The OSD menu shares the SPU renderer, keep it on the input thread */
+    if( p_fmt->i_cat == SPU_ES && p_sys->b_osd )
+        b_worker = false;
+    if( b_worker && id->b_transcode &&
+        WorkerStart( p_stream, id ) != VLC_SUCCESS )
+        msg_Warn( p_stream, "cannot start the stream thread" );
+
     return id;
 
 error:
@@ -594,6 +865,9 @@ static int Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 
     if( id->b_transcode )
     {
+        if( id->p_worker )
+            SendOutput( p_stream, id, WorkerStop( p_stream, id ) );
+
         switch( id->p_decoder->fmt_in.i_cat )
         {
         case AUDIO_ES:
@@ -637,6 +911,7 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     block_t *p_out = NULL;
+    int i_ret;
 
     if( !id->b_transcode )
     {
@@ -647,48 +922,33 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         return VLC_EGENERIC;
     }
 
-    switch( id->p_decoder->fmt_in.i_cat )
+    if( id->p_worker )
     {
-    case AUDIO_ES:
-        if( transcode_audio_process( p_stream, id, p_buffer, &p_out )
-            != VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+        transcode_worker_t *p_worker = id->p_worker;
 
-    case VIDEO_ES:
-        if( transcode_video_process( p_stream, id, p_buffer, &p_out )
-            != VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+        /* Let the input run ahead of the worker by a bounded amount only */
+        block_FifoPace( p_worker->p_fifo, TRANSCODE_WORKER_DEPTH, SIZE_MAX );
+        block_FifoPut( p_worker->p_fifo, p_buffer );
+        i_ret = VLC_SUCCESS;
+    }
+    else
+    {
+        i_ret = Process( p_stream, id, p_buffer, &p_out );
+        if( SendOutput( p_stream, id, p_out ) != VLC_SUCCESS )
+            i_ret = VLC_EGENERIC;
+    }
 
-    case SPU_ES:
-        /* Transcode OSD menu pictures. */
-        if( p_sys->b_osd )
-        {
-            if( transcode_osd_process( p_stream, id, p_buffer, &p_out ) !=
-                VLC_SUCCESS )
-            {
-                return VLC_EGENERIC;
-            }
-        }
-        else if ( transcode_spu_process( p_stream, id, p_buffer, &p_out ) !=
-            VLC_SUCCESS )
-        {
-            return VLC_EGENERIC;
-        }
-        break;
+    /* Hand over the output of every worker, so that an ES whose input
+     * stalls (sparse subtitles, audio-only gaps) is not held back */
+    for( int i = 0; i < p_sys->i_workers; i++ )
+        WorkerSendOutput( p_stream, p_sys->pp_workers[i] );
 
-    default:
-        p_out = NULL;
-        block_Release( p_buffer );
-        break;
+    if( id->p_worker )
+    {
+        vlc_mutex_lock( &id->p_worker->lock );
+        i_ret = id->p_worker->i_ret;
+        id->p_worker->i_ret = VLC_SUCCESS;
+        vlc_mutex_unlock( &id->p_worker->lock );
     }
-
-    if( p_out )
-        return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
-    return VLC_SUCCESS;
+    return i_ret;
 }
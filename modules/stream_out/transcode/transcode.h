@@ -10,20 +10,25 @@
 #include <vlc_codec.h>
 
 #include <vlc_picture_fifo.h>
+#include <vlc_atomic.h>
 
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
-struct sout_stream_sys_t
+/* Maximum number of input blocks queued to an ES worker */
+#define TRANSCODE_WORKER_DEPTH 64
+/* Maximum number of pictures queued to a video encoder thread */
+#define TRANSCODE_ENCODER_DEPTH 8
+
+/* Extra video encoding, fed from the same decoded pictures */
+typedef struct
 {
-    sout_stream_id_sys_t *id_video;
-    block_t         *p_buffers;
-    vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
-    bool            b_abort;
-    picture_fifo_t *pp_pics;
-    vlc_thread_t    thread;
+    unsigned int    i_width, i_height; /* 0 to keep the aspect ratio */
+    int             i_bitrate;
+} transcode_rendition_t;
 
+struct sout_stream_sys_t
+{
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
     char            *psz_aenc;
@@ -53,6 +58,15 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    transcode_rendition_t *p_renditions;
+    unsigned int    i_renditions;
+    int             i_keyint;
+
+    /* Decode and encode each ES on its own thread */
+    bool            b_workers;
+    int             i_workers;
+    sout_stream_id_sys_t **pp_workers; /**< ES having a worker */
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -60,6 +74,7 @@ struct sout_stream_sys_t
     config_chain_t  *p_spu_cfg;
     spu_t           *p_spu;
     filter_t        *p_spu_blend;
+    vlc_mutex_t     lock_spu; /* p_spu and p_spu_blend, shared by the ES */
 
     /* OSD Menu */
     vlc_fourcc_t    i_osdcodec; /* codec osd menu (0 if not transcode) */
@@ -70,14 +85,55 @@ struct sout_stream_sys_t
     /* Sync */
     bool            b_master_sync;
     /* i_master drift is how much audio buffer is ahead of calculated pts */
-    mtime_t         i_master_drift;
+    atomic_llong    i_master_drift;
 };
 
 struct aout_filters;
 
+/* Video encoder of a video ES. The first one encodes the filtered pictures
+ * with sout_stream_id_sys_t.p_encoder, the others are renditions, encoding
+ * them after scaling. */
+typedef struct
+{
+    encoder_t       *p_encoder;
+    filter_chain_t  *p_scale_chain; /**< Renditions only */
+    const transcode_rendition_t *p_cfg; /**< Renditions only */
+
+    /* Encoder thread, if threads > 0 */
+    vlc_thread_t    thread;
+    vlc_cond_t      cond;
+    vlc_cond_t      cond_room;
+    picture_fifo_t  *pp_pics;
+    unsigned int    i_pics;
+    bool            b_abort;
+
+    /* Output, sent by the thread calling Send() */
+    vlc_mutex_t     lock_out;
+    block_t         *p_buffers;
+    es_format_t     fmt_out;    /**< Valid once b_opened */
+    bool            b_opened;
+    void            *id;
+} transcode_video_enc_t;
+
+/* Worker decoding and encoding one ES from a bounded queue */
+typedef struct
+{
+    sout_stream_t   *p_stream;
+    sout_stream_id_sys_t *id;
+
+    vlc_thread_t    thread;
+    block_fifo_t    *p_fifo;
+    block_t         eos;        /**< Queued to stop the worker */
+
+    vlc_mutex_t     lock;
+    block_t         *p_out;     /**< Output waiting for Send() */
+    int             i_ret;      /**< Error since the last Send() */
+} transcode_worker_t;
+
 struct sout_stream_id_sys_t
 {
     bool            b_transcode;
+    bool            b_error; /**< Transcoding failed, drop the input */
 
     /* id of the out stream */
     void *id;
@@ -92,6 +148,8 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
+             transcode_video_enc_t *p_venc; /**< Encoder and renditions */
+             unsigned int    i_venc;
          };
          struct
          {
@@ -108,6 +166,8 @@ struct sout_stream_id_sys_t
     date_t          next_input_pts; /**< Incoming calculated PTS */
     date_t          next_output_pts; /**< output calculated PTS */
 
+    /* Worker, NULL if the ES is processed by Send() */
+    transcode_worker_t *p_worker;
 };
 
 /* OSD */
@@ -143,3 +203,4 @@ int  transcode_video_process( sout_stream_t *, sout_stream_id_sys_t *,
                                      block_t *, block_t ** );
 bool transcode_video_add    ( sout_stream_t *, es_format_t *,
                                 sout_stream_id_sys_t *);
+int  transcode_video_send   ( sout_stream_t *, sout_stream_id_sys_t * );
@@ -66,58 +66,203 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
+static void EncoderInit( transcode_video_enc_t *p_venc, encoder_t *p_enc,
+                         const transcode_rendition_t *p_cfg )
+{
+    p_venc->p_encoder = p_enc;
+    p_venc->p_cfg = p_cfg;
+    vlc_mutex_init( &p_venc->lock_out );
+    vlc_cond_init( &p_venc->cond );
+    vlc_cond_init( &p_venc->cond_room );
+}
+
 static void* EncoderThread( void *obj )
 {
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
-    sout_stream_id_sys_t *id = p_sys->id_video;
+    transcode_video_enc_t *p_venc = obj;
+    encoder_t *p_enc = p_venc->p_encoder;
     picture_t *p_pic = NULL;
     int canc = vlc_savecancel ();
     block_t *p_block = NULL;
 
-    vlc_mutex_lock( &p_sys->lock_out );
+    vlc_mutex_lock( &p_venc->lock_out );
 
     for( ;; )
     {
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
-            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
+        while( !p_venc->b_abort &&
+               (p_pic = picture_fifo_Pop( p_venc->pp_pics )) == NULL )
+            vlc_cond_wait( &p_venc->cond, &p_venc->lock_out );
 
         if( p_pic )
         {
+            p_venc->i_pics--;
+            vlc_cond_signal( &p_venc->cond_room );
+
             /* release lock while encoding */
-            vlc_mutex_unlock( &p_sys->lock_out );
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+            vlc_mutex_unlock( &p_venc->lock_out );
+            p_block = p_enc->pf_encode_video( p_enc, p_pic );
             picture_Release( p_pic );
-            vlc_mutex_lock( &p_sys->lock_out );
+            vlc_mutex_lock( &p_venc->lock_out );
 
-            block_ChainAppend( &p_sys->p_buffers, p_block );
+            block_ChainAppend( &p_venc->p_buffers, p_block );
         }
 
-        if( p_sys->b_abort )
+        if( p_venc->b_abort )
             break;
     }
 
     /*Encode what we have in the buffer on closing*/
-    while( (p_pic = picture_fifo_Pop( p_sys->pp_pics )) != NULL )
+    while( (p_pic = picture_fifo_Pop( p_venc->pp_pics )) != NULL )
     {
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+        p_block = p_enc->pf_encode_video( p_enc, p_pic );
         picture_Release( p_pic );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
+        block_ChainAppend( &p_venc->p_buffers, p_block );
     }
+    p_venc->i_pics = 0;
 
     /*Now flush encoder*/
-    do {
-        p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    } while( p_block );
+    if( p_enc->p_module )
+    {
+        do {
+            p_block = p_enc->pf_encode_video( p_enc, NULL );
+            block_ChainAppend( &p_venc->p_buffers, p_block );
+        } while( p_block );
+    }
 
-    vlc_mutex_unlock( &p_sys->lock_out );
+    vlc_mutex_unlock( &p_venc->lock_out );
 
     vlc_restorecancel (canc);
 
     return NULL;
 }
 
+static int EncoderThreadStart( sout_stream_t *p_stream,
+                               transcode_video_enc_t *p_venc )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+
+    p_venc->pp_pics = picture_fifo_New();
+    if( p_venc->pp_pics == NULL )
+    {
+        msg_Err( p_stream, "cannot create picture fifo" );
+        return VLC_ENOMEM;
+    }
+    p_venc->i_pics = 0;
+    p_venc->b_abort = false;
+    if( vlc_clone( &p_venc->thread, EncoderThread, p_venc, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn encoder thread" );
+        picture_fifo_Delete( p_venc->pp_pics );
+        p_venc->pp_pics = NULL;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Stops the encoder thread once it has encoded and flushed everything */
+static void EncoderThreadStop( transcode_video_enc_t *p_venc )
+{
+    vlc_mutex_lock( &p_venc->lock_out );
+    p_venc->b_abort = true;
+    vlc_cond_signal( &p_venc->cond );
+    vlc_mutex_unlock( &p_venc->lock_out );
+
+    vlc_join( p_venc->thread, NULL );
+    picture_fifo_Delete( p_venc->pp_pics );
+    p_venc->pp_pics = NULL;
+}
+
+static void EncodePicture( transcode_video_enc_t *p_venc, picture_t *p_pic )
+{
+    if( p_venc->pp_pics == NULL )
+    {
+        encoder_t *p_enc = p_venc->p_encoder;
+        block_t *p_block = p_enc->pf_encode_video( p_enc, p_pic );
+        picture_Release( p_pic );
+
+        vlc_mutex_lock( &p_venc->lock_out );
+        block_ChainAppend( &p_venc->p_buffers, p_block );
+        vlc_mutex_unlock( &p_venc->lock_out );
+        return;
+    }
+
+    vlc_mutex_lock( &p_venc->lock_out );
+    while( p_venc->i_pics >= TRANSCODE_ENCODER_DEPTH )
+        vlc_cond_wait( &p_venc->cond_room, &p_venc->lock_out );
+    picture_fifo_Push( p_venc->pp_pics, p_pic );
+    p_venc->i_pics++;
+    vlc_cond_signal( &p_venc->cond );
+    vlc_mutex_unlock( &p_venc->lock_out );
+}
+
+static void EncoderFlush( transcode_video_enc_t *p_venc )
+{
+    encoder_t *p_enc = p_venc->p_encoder;
+
+    if( p_venc->pp_pics != NULL )
+        EncoderThreadStop( p_venc );
+    else if( p_enc->p_module )
+    {
+        block_t *p_out = NULL, *p_block;
+        do {
+            p_block = p_enc->pf_encode_video( p_enc, NULL );
+            block_ChainAppend( &p_out, p_block );
+        } while( p_block );
+
+        vlc_mutex_lock( &p_venc->lock_out );
+        block_ChainAppend( &p_venc->p_buffers, p_out );
+        vlc_mutex_unlock( &p_venc->lock_out );
+    }
+}
+
+/* Hands the output format over to the thread sending the output */
+static void EncoderPublish( transcode_video_enc_t *p_venc )
+{
+    vlc_mutex_lock( &p_venc->lock_out );
+    es_format_Copy( &p_venc->fmt_out, &p_venc->p_encoder->fmt_out );
+    p_venc->b_opened = true;
+    vlc_mutex_unlock( &p_venc->lock_out );
+}
+
+static void EncoderClean( sout_stream_t *p_stream,
+                          transcode_video_enc_t *p_venc )
+{
+    if( p_venc->pp_pics != NULL )
+        EncoderThreadStop( p_venc );
+
+    /* The encoder of the main rendition belongs to the ES */
+    if( p_venc->p_cfg )
+    {
+        encoder_t *p_enc = p_venc->p_encoder;
+
+        if( p_enc->p_module )
+            module_unneed( p_enc, p_enc->p_module );
+        if( p_venc->p_scale_chain )
+            filter_chain_Delete( p_venc->p_scale_chain );
+        if( p_venc->id )
+            sout_StreamIdDel( p_stream->p_next, p_venc->id );
+        es_format_Clean( &p_enc->fmt_out );
+        vlc_object_release( p_enc );
+    }
+
+    block_ChainRelease( p_venc->p_buffers );
+    es_format_Clean( &p_venc->fmt_out );
+    vlc_cond_destroy( &p_venc->cond_room );
+    vlc_cond_destroy( &p_venc->cond );
+    vlc_mutex_destroy( &p_venc->lock_out );
+}
+
+static void transcode_video_encoders_delete( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_venc; i++ )
+        EncoderClean( p_stream, &id->p_venc[i] );
+    free( id->p_venc );
+    id->p_venc = NULL;
+    id->i_venc = 0;
+}
+
 int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -215,28 +360,8 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     if( p_sys->i_threads <= 0 )
         return VLC_SUCCESS;
 
-    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                       VLC_THREAD_PRIORITY_VIDEO;
-    p_sys->id_video = id;
-    p_sys->pp_pics = picture_fifo_New();
-    if( p_sys->pp_pics == NULL )
+    if( EncoderThreadStart( p_stream, &id->p_venc[0] ) != VLC_SUCCESS )
     {
-        msg_Err( p_stream, "cannot create picture fifo" );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        free( id->p_decoder->p_owner );
-        return VLC_ENOMEM;
-    }
-    vlc_mutex_init( &p_sys->lock_out );
-    vlc_cond_init( &p_sys->cond );
-    p_sys->p_buffers = NULL;
-    p_sys->b_abort = false;
-    if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
-    {
-        msg_Err( p_stream, "cannot spawn encoder thread" );
-        vlc_mutex_destroy( &p_sys->lock_out );
-        vlc_cond_destroy( &p_sys->cond );
-        picture_fifo_Delete( p_sys->pp_pics );
         module_unneed( id->p_decoder, id->p_decoder->p_module );
         id->p_decoder->p_module = NULL;
         free( id->p_decoder->p_owner );
@@ -547,6 +672,16 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
              id->p_encoder->fmt_in.video.i_width,
              id->p_encoder->fmt_in.video.i_height );
 
+    /* The renditions are cut at the same pictures as the main stream */
+    id->p_encoder->i_iframes = p_sys->i_keyint;
+    if( !id->p_encoder->i_iframes && p_sys->i_renditions > 0 )
+        id->p_encoder->i_iframes =
+            2 * id->p_encoder->fmt_in.video.i_frame_rate
+              / __MAX( 1, id->p_encoder->fmt_in.video.i_frame_rate_base );
+    if( id->p_encoder->i_iframes > 0 )
+        msg_Dbg( p_stream, "key frame every %d pictures",
+                 id->p_encoder->i_iframes );
+
     id->p_encoder->p_module =
         module_need( id->p_encoder, "encoder", p_sys->psz_venc, true );
     if( !id->p_encoder->p_module )
@@ -563,34 +698,154 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     id->p_encoder->fmt_out.i_codec =
         vlc_fourcc_GetCodec( VIDEO_ES, id->p_encoder->fmt_out.i_codec );
 
-    id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
-    if( !id->id )
-    {
-        msg_Err( p_stream, "cannot add this stream" );
-        return VLC_EGENERIC;
-    }
+    /* The stream is added by transcode_video_send() */
+    EncoderPublish( &id->p_venc[0] );
 
     return VLC_SUCCESS;
 }
 
-void transcode_video_close( sout_stream_t *p_stream,
-                                   sout_stream_id_sys_t *id )
+/* Format of the pictures given to the encoders */
+static const es_format_t *transcode_video_filters_fmt_out( sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    if( id->p_uf_chain )
+        return filter_chain_GetFmtOut( id->p_uf_chain );
+    if( id->p_f_chain )
+        return filter_chain_GetFmtOut( id->p_f_chain );
+    return &id->p_decoder->fmt_out;
+}
+
+/* Scales the pictures of the main rendition to the size of another one */
+static int transcode_video_rendition_scale_init( sout_stream_t *p_stream,
+                                                 sout_stream_id_sys_t *id,
+                                                 transcode_video_enc_t *p_venc )
+{
+    filter_owner_t owner = {
+        .sys = p_stream->p_sys,
+        .video = {
+            .buffer_new = transcode_video_filter_buffer_new,
+        },
+    };
+    const es_format_t *p_fmt_in = transcode_video_filters_fmt_out( id );
+    const es_format_t *p_fmt_out = &p_venc->p_encoder->fmt_in;
+
+    if( p_venc->p_scale_chain )
+        filter_chain_Delete( p_venc->p_scale_chain );
+    p_venc->p_scale_chain = filter_chain_NewVideo( p_stream, false, &owner );
+    if( !p_venc->p_scale_chain )
+        return VLC_ENOMEM;
+    filter_chain_Reset( p_venc->p_scale_chain, p_fmt_in, p_fmt_out );
+
+    /* Scale first, then convert, as few converters do both */
+    if( p_fmt_in->video.i_width != p_fmt_out->video.i_width ||
+        p_fmt_in->video.i_height != p_fmt_out->video.i_height )
     {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
+        es_format_t fmt = *p_fmt_out;
+        fmt.i_codec = fmt.video.i_chroma = p_fmt_in->video.i_chroma;
+        if( !filter_chain_AppendFilter( p_venc->p_scale_chain, NULL, NULL,
+                                        p_fmt_in, &fmt ) )
+            goto error;
+        p_fmt_in = filter_chain_GetFmtOut( p_venc->p_scale_chain );
+    }
+    if( p_fmt_in->video.i_chroma != p_fmt_out->video.i_chroma &&
+        !filter_chain_AppendFilter( p_venc->p_scale_chain, NULL, NULL,
+                                    p_fmt_in, p_fmt_out ) )
+        goto error;
+    return VLC_SUCCESS;
 
-        vlc_join( p_stream->p_sys->thread, NULL );
+error:
+    msg_Err( p_stream, "cannot scale the video to %ix%i",
+             p_fmt_out->video.i_width, p_fmt_out->video.i_height );
+    filter_chain_Delete( p_venc->p_scale_chain );
+    p_venc->p_scale_chain = NULL;
+    return VLC_EGENERIC;
+}
 
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        block_ChainRelease( p_stream->p_sys->p_buffers );
+/* Opens the encoder of a rendition, once the main one knows its input */
+static int transcode_video_rendition_open( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id,
+                                           transcode_video_enc_t *p_venc )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const video_format_t *p_src = &transcode_video_filters_fmt_out( id )->video;
+    encoder_t *p_enc = p_venc->p_encoder;
+
+    unsigned i_src_width = p_src->i_visible_width ? p_src->i_visible_width
+                                                  : p_src->i_width;
+    unsigned i_src_height = p_src->i_visible_height ? p_src->i_visible_height
+                                                    : p_src->i_height;
+    unsigned i_width = p_venc->p_cfg->i_width;
+    unsigned i_height = p_venc->p_cfg->i_height;
+
+    /* Keep the aspect ratio if only one dimension is given */
+    if( !i_width )
+        i_width = (uint64_t)i_src_width * i_height / i_src_height;
+    else if( !i_height )
+        i_height = (uint64_t)i_src_height * i_width / i_src_width;
+    i_width = __MAX( 2, i_width & ~1 );
+    i_height = __MAX( 2, i_height & ~1 );
+
+    es_format_Init( &p_enc->fmt_in, VIDEO_ES, p_src->i_chroma );
+    p_enc->fmt_in.video = *p_src;
+    p_enc->fmt_in.video.p_palette = NULL;
+    p_enc->fmt_in.video.i_width = p_enc->fmt_in.video.i_visible_width = i_width;
+    p_enc->fmt_in.video.i_height = p_enc->fmt_in.video.i_visible_height = i_height;
+    p_enc->fmt_in.video.i_x_offset = p_enc->fmt_in.video.i_y_offset = 0;
+    vlc_ureduce( &p_enc->fmt_in.video.i_sar_num,
+                 &p_enc->fmt_in.video.i_sar_den,
+                 (uint64_t)p_src->i_sar_num * i_src_width * i_height,
+                 (uint64_t)p_src->i_sar_den * i_src_height * i_width,
+                 0 );
+
+    p_enc->fmt_out.video.i_width =
+        p_enc->fmt_out.video.i_visible_width = i_width;
+    p_enc->fmt_out.video.i_height =
+        p_enc->fmt_out.video.i_visible_height = i_height;
+    p_enc->fmt_out.video.i_sar_num = p_enc->fmt_in.video.i_sar_num;
+    p_enc->fmt_out.video.i_sar_den = p_enc->fmt_in.video.i_sar_den;
+    p_enc->fmt_in.video.i_frame_rate = p_enc->fmt_out.video.i_frame_rate =
+        id->p_encoder->fmt_in.video.i_frame_rate;
+    p_enc->fmt_in.video.i_frame_rate_base =
+        p_enc->fmt_out.video.i_frame_rate_base =
+        id->p_encoder->fmt_in.video.i_frame_rate_base;
+    p_enc->fmt_out.video.orientation = p_src->orientation;
+
+    p_enc->i_threads = p_sys->i_threads;
+    p_enc->i_iframes = id->p_encoder->i_iframes;
+    p_enc->p_cfg = p_sys->p_video_cfg;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( !p_enc->p_module )
+    {
+        msg_Err( p_stream, "cannot find video encoder for the %ix%i rendition",
+                 i_width, i_height );
+        return VLC_EGENERIC;
     }
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    p_enc->fmt_out.i_codec = vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
 
-    vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-    vlc_cond_destroy( &p_stream->p_sys->cond );
+    if( transcode_video_rendition_scale_init( p_stream, id, p_venc ) )
+    {
+        module_unneed( p_enc, p_enc->p_module );
+        p_enc->p_module = NULL;
+        return VLC_EGENERIC;
+    }
+
+    /* Encode on the calling thread if the encoder thread cannot start */
+    if( p_sys->i_threads > 0 )
+        EncoderThreadStart( p_stream, p_venc );
+
+    msg_Dbg( p_stream, "video rendition %ix%i %dkb/s", i_width, i_height,
+             p_enc->fmt_out.i_bitrate / 1000 );
+    EncoderPublish( p_venc );
+    return VLC_SUCCESS;
+}
+
+void transcode_video_close( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_venc; i++ )
+        if( id->p_venc[i].pp_pics != NULL )
+            EncoderThreadStop( &id->p_venc[i] );
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -609,17 +864,20 @@ void transcode_video_close( sout_stream_t *p_stream,
         filter_chain_Delete( id->p_f_chain );
     if( id->p_uf_chain )
         filter_chain_Delete( id->p_uf_chain );
+
+    /* Close renditions */
+    transcode_video_encoders_delete( p_stream, id );
 }
 
-static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
+static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    picture_t *p_pic2 = NULL;
 
     /*
      * Encoding
      */
     /* Check if we have a subpicture to overlay */
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu )
     {
         video_format_t fmt = id->p_encoder->fmt_in.video;
@@ -657,27 +915,22 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
             subpicture_Delete( p_subpic );
         }
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
-    if( p_sys->i_threads == 0 )
+    /* The renditions are scaled from the picture of the main one */
+    for( unsigned i = 1; i < id->i_venc; i++ )
     {
-        block_t *p_block;
-
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        block_ChainAppend( out, p_block );
+        transcode_video_enc_t *p_venc = &id->p_venc[i];
+        if( !p_venc->p_scale_chain )
+            continue;
+
+        picture_t *p_scaled = filter_chain_VideoFilter( p_venc->p_scale_chain,
+                                                        picture_Hold( p_pic ) );
+        if( p_scaled )
+            EncodePicture( p_venc, p_scaled );
     }
 
-    if( p_sys->i_threads )
-    {
-        vlc_mutex_lock( &p_sys->lock_out );
-        picture_fifo_Push( p_sys->pp_pics, p_pic );
-        vlc_cond_signal( &p_sys->cond );
-        vlc_mutex_unlock( &p_sys->lock_out );
-    }
-
-    if( p_sys->i_threads && p_pic2 )
-        picture_Release( p_pic2 );
-    else if ( p_sys->i_threads == 0 )
-        picture_Release( p_pic );
+    EncodePicture( &id->p_venc[0], p_pic );
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -689,34 +942,11 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
-        {
-            block_t *p_block;
-            do {
-                p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-                block_ChainAppend( out, p_block );
-            } while( p_block );
-        }
-        else
-        {
-            msg_Dbg( p_stream, "Flushing thread and waiting that");
-            vlc_mutex_lock( &p_stream->p_sys->lock_out );
-            p_stream->p_sys->b_abort = true;
-            vlc_cond_signal( &p_stream->p_sys->cond );
-            vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-            vlc_join( p_stream->p_sys->thread, NULL );
-            vlc_mutex_lock( &p_sys->lock_out );
-            *out = p_sys->p_buffers;
-            p_sys->p_buffers = NULL;
-            vlc_mutex_unlock( &p_sys->lock_out );
-
-            msg_Dbg( p_stream, "Flushing done");
-        }
+        for( unsigned i = 0; i < id->i_venc; i++ )
+            EncoderFlush( &id->p_venc[i] );
         return VLC_SUCCESS;
     }
 
-
     while( (p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in )) )
     {
 
@@ -747,6 +977,11 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             transcode_video_encoder_init( p_stream, id );
             conversion_video_filter_append( id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
+
+            for( unsigned i = 1; i < id->i_venc; i++ )
+                if( id->p_venc[i].p_scale_chain )
+                    transcode_video_rendition_scale_init( p_stream, id,
+                                                          &id->p_venc[i] );
         }
 
 
@@ -766,10 +1001,12 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
             {
                 picture_Release( p_pic );
-                transcode_video_close( p_stream, id );
-                id->b_transcode = false;
+                id->b_error = true;
                 return VLC_EGENERIC;
             }
+
+            for( unsigned i = 1; i < id->i_venc; i++ )
+                transcode_video_rendition_open( p_stream, id, &id->p_venc[i] );
         }
 
         /* Run the filter and output chains; first with the picture,
@@ -794,7 +1031,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 if( !p_user_filtered_pic )
                     break;
 
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
+                OutputFrame( p_stream, p_user_filtered_pic, id );
 
                 p_filtered_pic = NULL;
             }
@@ -803,15 +1040,6 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         }
     }
 
-    if( p_sys->i_threads >= 1 )
-    {
-        /* Pick up any return data the encoder thread wants to output. */
-        vlc_mutex_lock( &p_sys->lock_out );
-        *out = p_sys->p_buffers;
-        p_sys->p_buffers = NULL;
-        vlc_mutex_unlock( &p_sys->lock_out );
-    }
-
     return VLC_SUCCESS;
 }
 
@@ -830,10 +1058,35 @@ bool transcode_video_add( sout_stream_t *p_stream, es_format_t *p_fmt,
     id->p_encoder->fmt_out.video.i_visible_height = p_sys->i_height & ~1;
     id->p_encoder->fmt_out.i_bitrate = p_sys->i_vbitrate;
 
+    /* Renditions, encoded from the same pictures */
+    id->p_venc = calloc( 1 + p_sys->i_renditions, sizeof( *id->p_venc ) );
+    if( !id->p_venc )
+        return false;
+    EncoderInit( &id->p_venc[id->i_venc++], id->p_encoder, NULL );
+    for( unsigned i = 0; i < p_sys->i_renditions; i++ )
+    {
+        encoder_t *p_enc = sout_EncoderCreate( p_stream );
+        if( !p_enc )
+        {
+            transcode_video_encoders_delete( p_stream, id );
+            return false;
+        }
+        p_enc->p_module = NULL;
+        es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+        p_enc->fmt_out.i_group = p_fmt->i_group;
+        p_enc->fmt_out.i_bitrate = p_sys->p_renditions[i].i_bitrate;
+        if( id->p_encoder->fmt_out.psz_language )
+            p_enc->fmt_out.psz_language =
+                strdup( id->p_encoder->fmt_out.psz_language );
+        EncoderInit( &id->p_venc[id->i_venc++], p_enc,
+                     &p_sys->p_renditions[i] );
+    }
+
     /* Build decoder -> filter -> encoder chain */
     if( transcode_video_new( p_stream, id ) )
     {
         msg_Err( p_stream, "cannot create video chain" );
+        transcode_video_encoders_delete( p_stream, id );
         return false;
     }
 
@@ -850,3 +1103,46 @@ bool transcode_video_add( sout_stream_t *p_stream, es_format_t *p_fmt,
     return true;
 }
 
+/* Adds the output ES of the encoders opened since the last call, and sends
+ * what they have encoded. This runs on the thread calling Send(). */
+int transcode_video_send( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    int i_ret = VLC_SUCCESS;
+
+    for( unsigned i = 0; i < id->i_venc; i++ )
+    {
+        transcode_video_enc_t *p_venc = &id->p_venc[i];
+
+        vlc_mutex_lock( &p_venc->lock_out );
+        bool b_opened = p_venc->b_opened;
+        block_t *p_out = p_venc->p_buffers;
+        p_venc->p_buffers = NULL;
+        vlc_mutex_unlock( &p_venc->lock_out );
+
+        if( b_opened && !p_venc->id )
+        {
+            p_venc->id = sout_StreamIdAdd( p_stream->p_next, &p_venc->fmt_out );
+            if( !p_venc->id )
+            {
+                msg_Err( p_stream, "cannot add this stream" );
+                vlc_mutex_lock( &p_venc->lock_out );
+                p_venc->b_opened = false;
+                vlc_mutex_unlock( &p_venc->lock_out );
+                i_ret = VLC_EGENERIC;
+            }
+            if( i == 0 )
+                id->id = p_venc->id;
+        }
+
+        if( !p_out )
+            continue;
+        if( p_venc->id )
+        {
+            if( sout_StreamIdSend( p_stream->p_next, p_venc->id, p_out ) )
+                i_ret = VLC_EGENERIC;
+        }
+        else
+            block_ChainRelease( p_out );
+    }
+    return i_ret;
+}
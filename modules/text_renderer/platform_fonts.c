@@ -64,6 +64,18 @@
 #ifdef HAVE_FONTCONFIG
 void FontConfig_BuildCache( filter_t *p_filter )
 {
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+    static bool b_built = false;
+
+    /* The databases are per process: only the first filter of all the
+     * LibVLC instances builds them, the others wait for it */
+    vlc_mutex_lock( &lock );
+    if( b_built )
+    {
+        vlc_mutex_unlock( &lock );
+        return;
+    }
+
     /* */
     msg_Dbg( p_filter, "Building font databases.");
     mtime_t t1, t2;
@@ -104,6 +116,9 @@ void FontConfig_BuildCache( filter_t *p_filter )
 #endif
     t2 = mdate();
     msg_Dbg( p_filter, "Took %ld microseconds", (long)((t2 - t1)) );
+
+    b_built = true;
+    vlc_mutex_unlock( &lock );
 }
 
 /***
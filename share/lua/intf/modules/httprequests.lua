@@ -536,6 +536,8 @@ getstatus = function (includecategories)
             s.stats[tag]=v
         end
 
+        s.clock=vlc.input.clock_stats()
+
         s.information.chapter=vlc.var.get(input, "chapter")
         s.information.title=vlc.var.get(input, "title")
 
@@ -29,6 +29,10 @@
 /* Max input rate factor (1/4 -> 4) */
 # define AOUT_MAX_INPUT_RATE (4)
 
+/* Drift tolerated in low delay mode, beyond which the playback catches up
+ * by resampling */
+# define AOUT_LOW_DELAY_TOLERANCE (CLOCK_FREQ / 100)
+
 enum {
     AOUT_RESAMPLING_NONE=0,
     AOUT_RESAMPLING_UP,
@@ -73,6 +77,7 @@ typedef struct
         unsigned resamp_start_drift; /**< Resampler drift absolute value */
         int resamp_type; /**< Resampler mode (FIXME: redundant / resampling) */
         bool discontinuity;
+        bool low_delay; /**< Catch up by resampling, within a tighter tolerance */
     } sync;
 
     audio_sample_format_t input_format;
@@ -81,6 +86,7 @@ typedef struct
     aout_request_vout_t request_vout;
 
     atomic_uint buffers_lost;
+    atomic_uint resamplings; /**< Resampling adjustments, with "stats" */
     atomic_uchar restart;
 } aout_owner_t;
 
@@ -134,10 +140,12 @@ bool aout_ChangeFilterString( vlc_object_t *manager, vlc_object_t *aout,
 
 /* From dec.c */
 int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
-                const audio_replay_gain_t *, const aout_request_vout_t *);
+                const audio_replay_gain_t *, const aout_request_vout_t *,
+                bool low_delay);
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 int aout_DecGetResetLost(audio_output_t *);
+unsigned aout_DecGetResetResamplings(audio_output_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
 void aout_DecFlush(audio_output_t *);
 bool aout_DecIsEmpty(audio_output_t *);
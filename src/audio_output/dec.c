@@ -36,6 +36,7 @@
 
 #include "aout_internal.h"
 #include "libvlc.h"
+#include "../misc/trace.h"
 
 /**
  * Creates an audio output
@@ -43,7 +44,8 @@
 int aout_DecNew( audio_output_t *p_aout,
                  const audio_sample_format_t *p_format,
                  const audio_replay_gain_t *p_replay_gain,
-                 const aout_request_vout_t *p_request_vout )
+                 const aout_request_vout_t *p_request_vout,
+                 bool b_low_delay )
 {
     /* Sanitize audio format */
     if( p_format->i_channels != aout_FormatNbChannels( p_format ) )
@@ -99,9 +101,11 @@ error:
     owner->sync.end = VLC_TS_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
     owner->sync.discontinuity = true;
+    owner->sync.low_delay = b_low_delay;
     aout_OutputUnlock (p_aout);
 
     atomic_init (&owner->buffers_lost, 0);
+    atomic_init (&owner->resamplings, 0);
     return 0;
 }
 
@@ -239,6 +243,17 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
         return; /* nothing can be done if timing is unknown */
     drift += mdate () - dec_pts;
 
+    /* In low delay mode, the tolerance is tighter and the early playback is
+     * slowed down by resampling rather than delayed with silence, unless it
+     * is as far as the late playback that is flushed. */
+    const bool low_delay = owner->sync.low_delay;
+    const mtime_t max_advance = low_delay ? AOUT_LOW_DELAY_TOLERANCE
+                                          : AOUT_MAX_PTS_ADVANCE;
+    const mtime_t max_delay = low_delay ? AOUT_LOW_DELAY_TOLERANCE
+                                        : AOUT_MAX_PTS_DELAY;
+    const mtime_t max_silence = low_delay ? AOUT_MAX_PTS_DELAY
+                                          : AOUT_MAX_PTS_ADVANCE;
+
     /* Late audio output.
      * This can happen due to insufficient caching, scheduling jitter
      * or bug in the decoder. Ideally, the output would seek backward. But that
@@ -269,7 +284,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
     /* Early audio output.
      * This is rare except at startup when the buffers are still empty. */
     if (drift < (owner->sync.discontinuity ? 0
-                : -3 * input_rate * AOUT_MAX_PTS_ADVANCE / INPUT_RATE_DEFAULT))
+                : -3 * input_rate * max_silence / INPUT_RATE_DEFAULT))
     {
         if (!owner->sync.discontinuity)
             msg_Warn (aout, "playback way too early (%"PRId64"): "
@@ -282,7 +297,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
     }
 
     /* Resampling */
-    if (drift > +AOUT_MAX_PTS_DELAY
+    if (drift > +max_delay
      && owner->sync.resamp_type != AOUT_RESAMPLING_UP)
     {
         msg_Warn (aout, "playback too late (%"PRId64"): up-sampling",
@@ -290,7 +305,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
         owner->sync.resamp_type = AOUT_RESAMPLING_UP;
         owner->sync.resamp_start_drift = +drift;
     }
-    if (drift < -AOUT_MAX_PTS_ADVANCE
+    if (drift < -max_advance
      && owner->sync.resamp_type != AOUT_RESAMPLING_DOWN)
     {
         msg_Warn (aout, "playback too early (%"PRId64"): down-sampling",
@@ -313,14 +328,20 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
 
     /* Resampling has been triggered earlier. This checks if it needs to be
      * increased or decreased. Resampling rate changes must be kept slow for
-     * the comfort of listeners. */
-    int adj = (owner->sync.resamp_type == AOUT_RESAMPLING_UP) ? +2 : -2;
+     * the comfort of listeners, but the low delay mode favours catching
+     * up: it changes it by 0.2% at a time. */
+    int adj = low_delay ? __MAX(owner->input_format.i_rate / 500, 2) : 2;
+    if (owner->sync.resamp_type == AOUT_RESAMPLING_DOWN)
+        adj = -adj;
 
     if (2 * llabs (drift) <= owner->sync.resamp_start_drift)
         /* If the drift has been reduced from more than half its initial
          * value, then it is time to switch back the resampling direction. */
         adj *= -1;
 
+    if (libvlc_stats (aout))
+        atomic_fetch_add (&owner->resamplings, 1);
+
     if (!aout_FiltersAdjustResampling (owner->filters, adj))
     {   /* Everything is back to normal: stop resampling. */
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
@@ -334,6 +355,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
 int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
 {
     aout_owner_t *owner = aout_owner (aout);
+    mtime_t trace = vlc_trace_Begin (aout);
 
     assert (input_rate >= INPUT_RATE_DEFAULT / AOUT_MAX_INPUT_RATE);
     assert (input_rate <= INPUT_RATE_DEFAULT * AOUT_MAX_INPUT_RATE);
@@ -379,6 +401,7 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     aout_OutputPlay (aout, block);
 out:
     aout_OutputUnlock (aout);
+    vlc_trace_End (aout, "audio play", trace);
     return 0;
 drop:
     owner->sync.discontinuity = true;
@@ -394,6 +417,12 @@ int aout_DecGetResetLost (audio_output_t *aout)
     return atomic_exchange(&owner->buffers_lost, 0);
 }
 
+unsigned aout_DecGetResetResamplings (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    return atomic_exchange(&owner->resamplings, 0);
+}
+
 void aout_DecChangePause (audio_output_t *aout, bool paused, mtime_t date)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -506,7 +506,16 @@ bool aout_FiltersAdjustResampling (aout_filters_t *filters, int adjust)
         return false;
 
     if (adjust)
+    {
+        const int max = filters->resampler->fmt_in.audio.i_rate
+                        * AOUT_MAX_RESAMPLING / 100;
+
         filters->resampling += adjust;
+        if (filters->resampling > max)
+            filters->resampling = max;
+        else if (filters->resampling < -max)
+            filters->resampling = -max;
+    }
     else
         filters->resampling = 0;
     return filters->resampling != 0;
@@ -40,6 +40,7 @@ bool config_PrintHelp (vlc_object_t *);
 
 int config_SortConfig (void);
 void config_UnsortConfig (void);
+void config_ForgetConfigFile (void);
 
 #define CONFIG_CLASS(x) ((x) & ~0x1F)
 
@@ -633,6 +633,8 @@ void config_ResetAll( vlc_object_t *p_this )
             }
         }
     }
+    /* The configuration file has to be parsed again */
+    config_ForgetConfigFile ();
     vlc_rwlock_unlock (&config_lock);
 
     module_list_free (list);
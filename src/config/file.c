@@ -53,6 +53,62 @@ static inline char *strdupnull (const char *src)
     return src ? strdup (src) : NULL;
 }
 
+/**
+ * Identity of the configuration file last loaded into, or saved from, the
+ * in-memory configuration. The configuration is shared by all LibVLC
+ * instances using the module bank, so the same unmodified file need not be
+ * parsed again for each instance. Protected by config_lock.
+ */
+static struct
+{
+    bool valid;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+} config_file = { false, 0, 0, 0, 0, 0 };
+
+static long config_FileNsec (const struct stat *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return st->st_mtim.tv_nsec;
+#else
+    (void) st;
+    return 0;
+#endif
+}
+
+static bool config_FileMatches (const struct stat *st)
+{
+    /* Values changed since are overwritten by the file, as before */
+    return config_file.valid && !config_dirty
+        && config_file.dev == st->st_dev && config_file.ino == st->st_ino
+        && config_file.size == st->st_size
+        && config_file.mtime == st->st_mtime
+        && config_file.mtime_nsec == config_FileNsec (st);
+}
+
+static void config_FileRemember (const struct stat *st)
+{
+    config_file.valid = true;
+    config_file.dev = st->st_dev;
+    config_file.ino = st->st_ino;
+    config_file.size = st->st_size;
+    config_file.mtime = st->st_mtime;
+    config_file.mtime_nsec = config_FileNsec (st);
+}
+
+/**
+ * Forgets which configuration file is loaded, e.g. when the configuration
+ * items are destroyed along with the module bank, or reset.
+ * \note The caller must hold config_lock for writing.
+ */
+void config_ForgetConfigFile (void)
+{
+    config_file.valid = false;
+}
+
 /**
  * Get the user's configuration file
  */
@@ -174,6 +230,23 @@ int config_LoadConfigFile( vlc_object_t *p_this )
     if (file == NULL)
         return VLC_EGENERIC;
 
+    struct stat st;
+    bool known = fstat (fileno (file), &st) == 0;
+
+    if (known)
+    {
+        vlc_rwlock_rdlock (&config_lock);
+        bool loaded = config_FileMatches (&st);
+        vlc_rwlock_unlock (&config_lock);
+
+        if (loaded)
+        {
+            msg_Dbg (p_this, "configuration file already loaded");
+            fclose (file);
+            return 0;
+        }
+    }
+
     /* Look for UTF-8 Byte Order Mark */
     char * (*convert) (const char *) = strdupnull;
     char bom[3];
@@ -247,6 +320,8 @@ int config_LoadConfigFile( vlc_object_t *p_this )
                 break;
         }
     }
+    if (known && !ferror (file))
+        config_FileRemember (&st);
     vlc_rwlock_unlock (&config_lock);
     free (line);
 
@@ -516,7 +591,8 @@ int config_SaveConfigFile (vlc_object_t *p_this)
     vlc_unlink (permanent);
 #endif
     /* Atomically replace the file... */
-    if (vlc_rename (temporary, permanent))
+    bool replaced = vlc_rename (temporary, permanent) == 0;
+    if (!replaced)
         vlc_unlink (temporary);
     /* (...then synchronize the directory, err, TODO...) */
     /* ...and finally close the file */
@@ -525,6 +601,15 @@ int config_SaveConfigFile (vlc_object_t *p_this)
     fclose (file);
 #endif
 
+    /* The file now matches the in-memory configuration */
+    struct stat st;
+    if (replaced && vlc_stat (permanent, &st) == 0)
+    {
+        vlc_rwlock_wrlock (&config_lock);
+        config_FileRemember (&st);
+        vlc_rwlock_unlock (&config_lock);
+    }
+
     free (temporary);
     free (permanent);
     return 0;
@@ -165,6 +165,17 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Largest lateness of the references since the last query */
+    mtime_t i_jitter_peak;
+
+    /* Statistics, if enabled */
+    bool     b_stats;
+    uint64_t i_references;
+    uint64_t pi_jitter[INPUT_CLOCK_JITTER_BINS];
+    mtime_t  i_jitter_max;
+    mtime_t  i_drift_base_stream;
+    mtime_t  i_drift_base;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
@@ -188,7 +199,7 @@ static mtime_t ClockGetTsOffset( input_clock_t * );
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( int i_rate )
+input_clock_t *input_clock_New( int i_rate, bool b_stats )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
@@ -212,6 +223,16 @@ input_clock_t *input_clock_New( int i_rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    cl->i_jitter_peak = 0;
+
+    cl->b_stats = b_stats;
+    cl->i_references = 0;
+    for( int i = 0; i < INPUT_CLOCK_JITTER_BINS; i++ )
+        cl->pi_jitter[i] = 0;
+    cl->i_jitter_max = 0;
+    cl->i_drift_base_stream = VLC_TS_INVALID;
+    cl->i_drift_base = 0;
+
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
     cl->b_paused = false;
@@ -272,6 +293,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        cl->i_drift_base_stream = VLC_TS_INVALID;
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -288,6 +310,15 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
         AvgUpdate( &cl->drift, i_converted - i_ck_stream );
 
+        /* The drift rate is measured from a point past the start-up
+         * transient, which would otherwise dominate the offset */
+        if( cl->b_stats && cl->i_drift_base_stream <= VLC_TS_INVALID &&
+            i_ck_stream - cl->ref.i_stream >= CLOCK_FREQ )
+        {
+            cl->i_drift_base_stream = i_ck_stream;
+            cl->i_drift_base = AvgGet( &cl->drift );
+        }
+
         cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
     }
 
@@ -323,6 +354,24 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
     }
 
+    if( i_ck_system - i_system_expected > cl->i_jitter_peak )
+        cl->i_jitter_peak = i_ck_system - i_system_expected;
+
+    if( cl->b_stats )
+    {
+        const mtime_t i_jitter = llabs( i_ck_system - i_system_expected );
+        unsigned i_bin = 0;
+
+        while( i_bin < INPUT_CLOCK_JITTER_BINS - 1 &&
+               ( (CLOCK_FREQ / 1000) << i_bin ) <= i_jitter )
+            i_bin++;
+
+        cl->i_references++;
+        cl->pi_jitter[i_bin]++;
+        if( i_jitter > cl->i_jitter_max )
+            cl->i_jitter_max = i_jitter;
+    }
+
     vlc_mutex_unlock( &cl->lock );
 }
 
@@ -537,8 +586,8 @@ void input_clock_GetSystemOrigin( input_clock_t *cl, mtime_t *pi_system, mtime_t
 }
 
 #warning "input_clock_SetJitter needs more work"
-void input_clock_SetJitter( input_clock_t *cl,
-                            mtime_t i_pts_delay, int i_cr_average )
+static void ClockSetJitter( input_clock_t *cl, mtime_t i_pts_delay,
+                            int i_cr_average, bool b_force )
 {
     vlc_mutex_lock( &cl->lock );
 
@@ -563,7 +612,7 @@ void input_clock_SetJitter( input_clock_t *cl,
     /* TODO always save the value, and when rebuffering use the new one if smaller
      * TODO when increasing -> force rebuffering
      */
-    if( cl->i_pts_delay < i_pts_delay )
+    if( cl->i_pts_delay < i_pts_delay || b_force )
         cl->i_pts_delay = i_pts_delay;
 
     /* */
@@ -576,6 +625,18 @@ void input_clock_SetJitter( input_clock_t *cl,
     vlc_mutex_unlock( &cl->lock );
 }
 
+void input_clock_SetJitter( input_clock_t *cl,
+                            mtime_t i_pts_delay, int i_cr_average )
+{
+    ClockSetJitter( cl, i_pts_delay, i_cr_average, false );
+}
+
+void input_clock_ForceJitter( input_clock_t *cl,
+                              mtime_t i_pts_delay, int i_cr_average )
+{
+    ClockSetJitter( cl, i_pts_delay, i_cr_average, true );
+}
+
 mtime_t input_clock_GetJitter( input_clock_t *cl )
 {
     vlc_mutex_lock( &cl->lock );
@@ -598,6 +659,38 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+mtime_t input_clock_GetResetJitterPeak( input_clock_t *cl )
+{
+    vlc_mutex_lock( &cl->lock );
+    const mtime_t i_peak = cl->i_jitter_peak;
+    cl->i_jitter_peak = 0;
+    vlc_mutex_unlock( &cl->lock );
+
+    return i_peak;
+}
+
+void input_clock_GetStats( input_clock_t *cl, input_clock_stats_t *p_stats )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    p_stats->i_references = cl->i_references;
+    for( int i = 0; i < INPUT_CLOCK_JITTER_BINS; i++ )
+        p_stats->pi_jitter[i] = cl->pi_jitter[i];
+    p_stats->i_jitter_max = cl->i_jitter_max;
+    p_stats->i_pts_delay = cl->i_pts_delay;
+
+    /* The averaged drift is the offset from the reference point, its rate
+     * the drift between the clocks */
+    const mtime_t i_duration = cl->last.i_stream - cl->i_drift_base_stream;
+    if( cl->i_drift_base_stream > VLC_TS_INVALID && i_duration > 0 )
+        p_stats->f_drift = 1000000. *
+            ( AvgGet( &cl->drift ) - cl->i_drift_base ) / i_duration;
+    else
+        p_stats->f_drift = 0.;
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
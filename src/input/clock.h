@@ -39,8 +39,10 @@ typedef struct input_clock_t input_clock_t;
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
+ * \param b_stats tells if the statistics returned by input_clock_GetStats
+ * are gathered.
  */
-input_clock_t *input_clock_New( int i_rate );
+input_clock_t *input_clock_New( int i_rate, bool b_stats );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -130,10 +132,32 @@ int input_clock_GetState( input_clock_t *,
 void input_clock_SetJitter( input_clock_t *,
                             mtime_t i_pts_delay, int i_cr_average );
 
+/**
+ * This function is like input_clock_SetJitter, but it also decreases the
+ * pts_delay: the outputs then have to catch up with the clock.
+ */
+void input_clock_ForceJitter( input_clock_t *,
+                              mtime_t i_pts_delay, int i_cr_average );
+
 /**
  * This function returns an estimation of the pts_delay needed to avoid rebufferization.
  * XXX in the current implementation, the pts_delay will never be decreased.
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the largest lateness of the clock references
+ * against their expected date since its last call, and resets it.
+ *
+ * It measures the pts_delay needed to absorb the jitter, whereas
+ * input_clock_GetJitter only follows its increases.
+ */
+mtime_t input_clock_GetResetJitterPeak( input_clock_t * );
+
+/**
+ * This function fills the clock fields of an input_clock_stats_t (they are
+ * zeroed if the clock does not gather statistics).
+ */
+void input_clock_GetStats( input_clock_t *, input_clock_stats_t * );
+
 #endif
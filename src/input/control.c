@@ -494,6 +494,16 @@ int input_vaControl( input_thread_t *p_input, int i_query, va_list args )
             return es_out_ControlModifyPcrSystem( p_input->p->p_es_out_display, b_absolute, i_system );
         }
 
+        case INPUT_GET_CLOCK_STATS:
+        {
+            input_clock_stats_t **pp_stats = va_arg( args, input_clock_stats_t ** );
+            return es_out_Control( p_input->p->p_es_out_display, ES_OUT_GET_CLOCK_STATS, pp_stats );
+        }
+
+        case INPUT_JOIN:
+            input_ControlPush( p_input, INPUT_CONTROL_JOIN, NULL );
+            return VLC_SUCCESS;
+
         default:
             msg_Err( p_input, "unknown query in input_vaControl" );
             return VLC_EGENERIC;
@@ -52,6 +52,7 @@
 #include "resource.h"
 
 #include "../video_output/vout_control.h"
+#include "../misc/trace.h"
 
 static decoder_t *CreateDecoder( vlc_object_t *, input_thread_t *,
                                  es_format_t *, bool, input_resource_t *,
@@ -142,12 +143,47 @@ struct decoder_owner_sys_t
 
     /* Delay */
     mtime_t i_ts_delay;
+
+    /* Clock statistics */
+    struct
+    {
+        uint64_t i_late;
+        uint64_t i_early;
+        uint64_t i_resamplings;
+    } clock_stats;
+
+    /* Low delay */
+    bool b_low_delay;
+    bool b_late_dropped;
+
+    /* Latencies of audio and video, averaged, in low delay mode or with
+     * "stats" */
+    bool b_latency;
+    mtime_t i_decoding_ts; /* of the block dequeued last, or of the first
+                              one queued into an empty fifo */
+    struct
+    {
+        mtime_t i_decoder;
+        mtime_t i_output;
+        bool    b_output;
+    } latency;
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((mtime_t)(DEFAULT_PTS_DELAY * 30))
 
+/* In low delay mode, the fifo is emptied when it holds more than
+ * DECODER_LOW_DELAY_BACKLOG of stream, and the pictures late by more than
+ * DECODER_LOW_DELAY_LATE are dropped before reaching the video output */
+#define DECODER_LOW_DELAY_BACKLOG                (CLOCK_FREQ/5)
+#define DECODER_LOW_DELAY_LATE                   (CLOCK_FREQ/100)
+
+static inline void DecoderAverageLatency( mtime_t *pi_average, mtime_t i_value )
+{
+    *pi_average += ( i_value - *pi_average ) / 8;
+}
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
@@ -346,6 +382,11 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    /* Decoders and packetizers may modify their input in place */
+    p_block = block_Writable( p_block );
+    if( unlikely(p_block == NULL) )
+        return;
+
     if( b_do_pace )
     {
         /* The fifo is not consumed when waiting and so will
@@ -368,6 +409,36 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
         block_FifoEmpty( p_owner->p_fifo );
     }
 
+    const mtime_t i_ts = p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts
+                                                         : p_block->i_pts;
+    if( p_owner->b_latency && i_ts > VLC_TS_INVALID )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+
+        /* Amount of stream queued ahead of the decoder, from the first
+         * queued block */
+        if( block_FifoCount( p_owner->p_fifo ) == 0 )
+            p_owner->i_decoding_ts = i_ts;
+
+        mtime_t i_backlog = 0;
+        if( p_owner->i_decoding_ts > VLC_TS_INVALID )
+            i_backlog = i_ts - p_owner->i_decoding_ts;
+        if( i_backlog < 0 || i_backlog > DECODER_BOGUS_VIDEO_DELAY )
+            i_backlog = 0; /* discontinuity */
+        DecoderAverageLatency( &p_owner->latency.i_decoder, i_backlog );
+
+        if( p_owner->b_low_delay && !b_do_pace && !p_owner->b_waiting &&
+            !p_owner->b_paused && i_backlog > DECODER_LOW_DELAY_BACKLOG )
+        {
+            msg_Warn( p_dec, "decoder/packetizer late (%"PRId64" ms queued), "
+                      "resetting fifo!", i_backlog / 1000 );
+            block_FifoEmpty( p_owner->p_fifo );
+            p_owner->i_decoding_ts = i_ts;
+            p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        }
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
     block_FifoPut( p_owner->p_fifo, p_block );
 }
 
@@ -630,6 +701,32 @@ void input_DecoderGetObjects( decoder_t *p_dec,
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+void input_DecoderGetClockStats( decoder_t *p_dec,
+                                 input_clock_es_stats_t *p_stats )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_stats->i_late = p_owner->clock_stats.i_late;
+    p_stats->i_early = p_owner->clock_stats.i_early;
+    p_stats->i_resamplings = p_owner->clock_stats.i_resamplings;
+    p_stats->i_decoder_delay = p_owner->latency.i_decoder;
+    p_stats->i_output_delay = p_owner->latency.i_output;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
+bool input_DecoderGetOutputDelay( decoder_t *p_dec, mtime_t *pi_delay )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    const bool b_output = p_owner->latency.b_output;
+    *pi_delay = p_owner->latency.i_output;
+    vlc_mutex_unlock( &p_owner->lock );
+
+    return b_output;
+}
+
 /*****************************************************************************
  * Internal functions
  *****************************************************************************/
@@ -856,6 +953,22 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         p_owner->cc.pp_decoder[i] = NULL;
     }
     p_owner->i_ts_delay = 0;
+    p_owner->clock_stats.i_late = 0;
+    p_owner->clock_stats.i_early = 0;
+    p_owner->clock_stats.i_resamplings = 0;
+
+    /* Catching up only makes sense if the source cannot wait for us */
+    p_owner->b_low_delay = var_InheritBool( p_dec, "low-delay" ) &&
+                           p_input != NULL &&
+                           !p_input->p->b_can_pace_control;
+    p_owner->b_late_dropped = false;
+    /* The other streams are sparse: their fifo time span is meaningless */
+    p_owner->b_latency = ( fmt->i_cat == AUDIO_ES || fmt->i_cat == VIDEO_ES )
+                      && ( p_owner->b_low_delay || libvlc_stats( p_dec ) );
+    p_owner->i_decoding_ts = VLC_TS_INVALID;
+    p_owner->latency.i_decoder = 0;
+    p_owner->latency.i_output = 0;
+    p_owner->latency.b_output = false;
     return p_dec;
 }
 
@@ -881,6 +994,18 @@ static void *DecoderThread( void *p_data )
         if (end_wait)
             input_DecoderStopWait( p_dec );
 
+        if( p_block && p_owner->b_latency )
+        {
+            const mtime_t i_ts = p_block->i_dts > VLC_TS_INVALID ?
+                                 p_block->i_dts : p_block->i_pts;
+            if( i_ts > VLC_TS_INVALID )
+            {
+                vlc_mutex_lock( &p_owner->lock );
+                p_owner->i_decoding_ts = i_ts;
+                vlc_mutex_unlock( &p_owner->lock );
+            }
+        }
+
         if( p_block )
         {
             int canc = vlc_savecancel();
@@ -893,7 +1018,9 @@ static void *DecoderThread( void *p_data )
                 p_block = NULL;
             }
 
+            mtime_t trace = vlc_trace_Begin( p_dec );
             DecoderProcess( p_dec, p_block );
+            vlc_trace_End( p_dec, "decoder", trace );
 
             vlc_restorecancel( canc );
         }
@@ -1136,6 +1263,9 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
         DecoderFixTs( p_dec, &p_audio->i_pts, NULL, &p_audio->i_length,
                       &i_rate, AOUT_MAX_ADVANCE_TIME );
 
+        /* The date was valid: it could not be converted as too early */
+        const bool b_early = p_audio->i_pts <= VLC_TS_INVALID;
+
         if( p_audio->i_pts <= VLC_TS_INVALID
          || i_rate < INPUT_RATE_DEFAULT/AOUT_MAX_INPUT_RATE
          || i_rate > INPUT_RATE_DEFAULT*AOUT_MAX_INPUT_RATE )
@@ -1152,14 +1282,30 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
         if( !b_reject )
         {
             assert( !p_owner->b_paused );
+            if( p_owner->b_latency )
+            {
+                DecoderAverageLatency( &p_owner->latency.i_output,
+                                       p_audio->i_pts - mdate() );
+                p_owner->latency.b_output = true;
+            }
             if( !aout_DecPlay( p_aout, p_audio, i_rate ) )
                 *pi_played_sum += 1;
-            *pi_lost_sum += aout_DecGetResetLost( p_aout );
+
+            const int i_lost = aout_DecGetResetLost( p_aout );
+            *pi_lost_sum += i_lost;
+            if( libvlc_stats( p_dec ) )
+            {
+                p_owner->clock_stats.i_late += i_lost;
+                p_owner->clock_stats.i_resamplings +=
+                    aout_DecGetResetResamplings( p_aout );
+            }
         }
         else
         {
             msg_Dbg( p_dec, "discarded audio buffer" );
             *pi_lost_sum += 1;
+            if( b_early && libvlc_stats( p_dec ) )
+                p_owner->clock_stats.i_early++;
             block_Release( p_audio );
         }
 
@@ -1306,13 +1452,41 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     DecoderFixTs( p_dec, &p_picture->date, NULL, NULL,
                   &i_rate, DECODER_BOGUS_VIDEO_DELAY );
 
+    /* In low delay mode, the late pictures are dropped here to catch up
+     * with the clock, but never two in a row so that the display goes on
+     * if the decoder is too slow */
+    bool b_late = false;
+    if( p_picture->date > VLC_TS_INVALID )
+    {
+        const mtime_t i_output = p_picture->date - mdate();
+
+        if( p_owner->b_latency )
+        {
+            DecoderAverageLatency( &p_owner->latency.i_output, i_output );
+            p_owner->latency.b_output = true;
+        }
+        if( p_owner->b_low_delay && !b_reject )
+        {
+            b_late = !p_picture->b_force && !b_first_after_wait &&
+                     !p_owner->b_late_dropped &&
+                     i_output < -DECODER_LOW_DELAY_LATE;
+            p_owner->b_late_dropped = b_late;
+        }
+    }
+
     vlc_mutex_unlock( &p_owner->lock );
 
     /* */
     if( !p_picture->b_force && p_picture->date <= VLC_TS_INVALID ) // FIXME --VLC_TS_INVALID verify video_output/*
         b_reject = true;
 
-    if( !b_reject )
+    if( b_late )
+    {
+        msg_Dbg( p_dec, "late picture dropped" );
+        *pi_lost_sum += 1;
+        picture_Release( p_picture );
+    }
+    else if( !b_reject )
     {
         if( i_rate != p_owner->i_last_rate || b_first_after_wait )
         {
@@ -1338,6 +1512,17 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
     *pi_played_sum += i_tmp_display;
     *pi_lost_sum += i_tmp_lost;
+
+    /* The video output drops the late pictures */
+    if( ( i_tmp_lost > 0 || b_late || ( b_reject && b_dated ) ) &&
+        libvlc_stats( p_dec ) )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        p_owner->clock_stats.i_late += i_tmp_lost + b_late;
+        if( b_reject && b_dated )
+            p_owner->clock_stats.i_early++;
+        vlc_mutex_unlock( &p_owner->lock );
+    }
 }
 
 static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
@@ -1966,7 +2151,7 @@ static int aout_update_format( decoder_t *p_dec )
         {
             if( aout_DecNew( p_aout, &format,
                              &p_dec->fmt_out.audio_replay_gain,
-                             &request_vout ) )
+                             &request_vout, p_owner->b_low_delay ) )
             {
                 input_resource_PutAout( p_owner->p_resource, p_aout );
                 p_aout = NULL;
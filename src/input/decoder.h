@@ -111,4 +111,21 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec );
  */
 void input_DecoderGetObjects( decoder_t *, vout_thread_t **, audio_output_t ** );
 
+/**
+ * This function fills the counters and latencies of an
+ * input_clock_es_stats_t
+ *
+ * They are only updated when the "stats" option is set.
+ */
+void input_DecoderGetClockStats( decoder_t *, input_clock_es_stats_t * );
+
+/**
+ * This function returns the averaged delay between the hand-over of the
+ * decoded data to the output and their date.
+ *
+ * It is measured in low delay mode or when the "stats" option is set, and
+ * returns false if no data reached the output yet.
+ */
+bool input_DecoderGetOutputDelay( decoder_t *, mtime_t * );
+
 #endif
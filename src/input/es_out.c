@@ -104,6 +104,19 @@ struct es_out_id_t
     int         i_meta_id;
 };
 
+/* Data received while pre-joined, decoded when the input is joined */
+typedef struct
+{
+    es_out_id_t   *p_es;    /* NULL for a PCR */
+    block_t       *p_block;
+    es_out_pgrm_t *p_pgrm;
+    mtime_t        i_pcr;   /* Last PCR received */
+    mtime_t        i_date;  /* Reception date of a PCR */
+} es_out_prejoin_t;
+
+/* Longest group of pictures kept while pre-joined */
+#define ES_OUT_PREJOIN_GOP_MAX (INT64_C(10000000))
+
 struct es_out_sys_t
 {
     input_thread_t *p_input;
@@ -153,6 +166,11 @@ struct es_out_sys_t
     int         i_cr_average;
     int         i_rate;
 
+    /* Low delay mode */
+    bool        b_low_delay;
+    mtime_t     i_low_delay_date;
+    mtime_t     i_low_delay_peak;
+
     /* */
     bool        b_paused;
     mtime_t     i_pause_date;
@@ -168,6 +186,15 @@ struct es_out_sys_t
 
     /* Record */
     sout_instance_t *p_sout_record;
+
+    /* Pre-joined input: nothing is decoded, the data needed to start at
+     * once are kept instead */
+    bool             b_prejoined;
+    bool             b_prejoin_rap;
+    mtime_t          i_prejoin_pcr;
+    size_t           i_prejoin;
+    size_t           i_prejoin_max;
+    es_out_prejoin_t *p_prejoin;
 };
 
 static es_out_id_t *EsOutAdd    ( es_out_t *, const es_format_t * );
@@ -189,6 +216,8 @@ static void EsOutDecodersChangePause( es_out_t *out, bool b_paused, mtime_t i_da
 static void EsOutProgramChangePause( es_out_t *out, bool b_paused, mtime_t i_date );
 static void EsOutProgramsChangeRate( es_out_t *out );
 static void EsOutDecodersStopBuffering( es_out_t *out, bool b_forced );
+static void EsOutSetPcr( es_out_t *out, es_out_pgrm_t *p_pgrm, mtime_t i_pcr, mtime_t i_date );
+static void EsOutPrejoinFlush( es_out_t *out, es_out_id_t *es );
 
 static char *LanguageGetName( const char *psz_code );
 static char *LanguageGetCode( const char *psz_lang );
@@ -292,9 +321,16 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
 
     p_sys->i_rate = i_rate;
 
+    p_sys->b_low_delay = var_InheritBool( p_input, "low-delay" );
+    p_sys->i_low_delay_date = VLC_TS_INVALID;
+    p_sys->i_low_delay_peak = 0;
+
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
 
+    p_sys->b_prejoined = p_input->p->b_prejoined;
+    p_sys->i_prejoin_pcr = VLC_TS_INVALID;
+
     return out;
 }
 
@@ -332,6 +368,11 @@ static void EsOutTerminate( es_out_t *out )
     if( p_sys->p_sout_record )
         EsOutSetRecord( out, false );
 
+    EsOutPrejoinFlush( out, NULL );
+    free( p_sys->p_prejoin );
+    p_sys->p_prejoin = NULL;
+    p_sys->i_prejoin_max = 0;
+
     for( int i = 0; i < p_sys->i_es; i++ )
     {
         if( p_sys->es[i]->p_dec )
@@ -590,6 +631,7 @@ static void EsOutChangePosition( es_out_t *out )
     p_sys->i_buffering_extra_stream = 0;
     p_sys->i_buffering_extra_system = 0;
     p_sys->i_preroll_end = -1;
+    p_sys->i_low_delay_date = VLC_TS_INVALID;
 }
 
 
@@ -982,6 +1024,7 @@ static void EsOutProgramSelect( es_out_t *out, es_out_pgrm_t *p_pgrm )
         p_sys->p_es_sub = NULL;
         p_sys->p_es_video = NULL;
     }
+    EsOutPrejoinFlush( out, NULL );
 
     msg_Dbg( p_input, "selecting program id=%d", p_pgrm->i_id );
 
@@ -1038,7 +1081,8 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->psz_name = NULL;
     p_pgrm->psz_now_playing = NULL;
     p_pgrm->psz_publisher = NULL;
-    p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
+    p_pgrm->p_clock = input_clock_New( p_sys->i_rate,
+                                       libvlc_stats( p_sys->p_input ) );
     if( !p_pgrm->p_clock )
     {
         free( p_pgrm );
@@ -1094,7 +1138,10 @@ static int EsOutProgramDel( es_out_t *out, int i_group )
 
     /* If program is selected we need to unselect it */
     if( p_sys->p_pgrm == p_pgrm )
+    {
         p_sys->p_pgrm = NULL;
+        EsOutPrejoinFlush( out, NULL );
+    }
 
     input_clock_Delete( p_pgrm->p_clock );
 
@@ -1701,7 +1748,7 @@ static void EsOutSelect( es_out_t *out, es_out_id_t *es, bool b_force )
 
     int i_cat = es->fmt.i_cat;
 
-    if( !p_sys->b_active ||
+    if( !p_sys->b_active || p_sys->b_prejoined ||
         ( !b_force && es->fmt.i_priority < ES_PRIORITY_SELECTABLE_MIN ) )
     {
         return;
@@ -1892,58 +1939,16 @@ static void EsOutSelect( es_out_t *out, es_out_id_t *es, bool b_force )
     }
 }
 
-/**
- * Send a block for the given es_out
- *
- * \param out the es_out to send from
- * \param es the es_out_id
- * \param p_block the data block to send
- */
-static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+/* Sends a block to the decoder of an ES, with the lock held */
+static void EsOutDecode( es_out_t *out, es_out_id_t *es, block_t *p_block )
 {
     es_out_sys_t   *p_sys = out->p_sys;
     input_thread_t *p_input = p_sys->p_input;
 
-    if( libvlc_stats( p_input ) )
-    {
-        uint64_t i_total;
-
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
-        stats_Update( p_input->p->counters.p_demux_read,
-                      p_block->i_buffer, &i_total );
-        stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
-
-        /* Update number of corrupted data packats */
-        if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
-        {
-            stats_Update( p_input->p->counters.p_demux_corrupted, 1, NULL );
-        }
-        /* Update number of discontinuities */
-        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
-        {
-            stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
-        }
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-    }
-
-    vlc_mutex_lock( &p_sys->lock );
-
-    /* Mark preroll blocks */
-    if( p_sys->i_preroll_end >= 0 )
-    {
-        int64_t i_date = p_block->i_pts;
-        if( p_block->i_pts <= VLC_TS_INVALID )
-            i_date = p_block->i_dts;
-
-        if( i_date < p_sys->i_preroll_end )
-            p_block->i_flags |= BLOCK_FLAG_PREROLL;
-    }
-
     if( !es->p_dec )
     {
         block_Release( p_block );
-        vlc_mutex_unlock( &p_sys->lock );
-        return VLC_SUCCESS;
+        return;
     }
 
     /* Check for sout mode */
@@ -2014,6 +2019,256 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         if (p_sys->i_sub_last == i)
             EsOutSelect(out, es->pp_cc_es[i], true);
     }
+}
+
+/*****************************************************************************
+ * Pre-joined input
+ *****************************************************************************/
+static void EsOutPrejoinFlush( es_out_t *out, es_out_id_t *es )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    size_t j = 0;
+
+    for( size_t i = 0; i < p_sys->i_prejoin; i++ )
+    {
+        es_out_prejoin_t *p_data = &p_sys->p_prejoin[i];
+
+        if( es && p_data->p_es != es )
+            p_sys->p_prejoin[j++] = *p_data;
+        else if( p_data->p_block )
+            block_Release( p_data->p_block );
+    }
+    p_sys->i_prejoin = j;
+
+    if( !es )
+        p_sys->i_prejoin_pcr = VLC_TS_INVALID;
+}
+
+static int EsOutPrejoinAppend( es_out_t *out, const es_out_prejoin_t *p_data )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_sys->i_prejoin >= p_sys->i_prejoin_max )
+    {
+        const size_t i_max = __MAX( 2 * p_sys->i_prejoin_max, 256 );
+        es_out_prejoin_t *p_prejoin = realloc( p_sys->p_prejoin,
+                                               i_max * sizeof( *p_prejoin ) );
+        if( !p_prejoin )
+            return VLC_ENOMEM;
+        p_sys->p_prejoin = p_prejoin;
+        p_sys->i_prejoin_max = i_max;
+    }
+    p_sys->p_prejoin[p_sys->i_prejoin++] = *p_data;
+    return VLC_SUCCESS;
+}
+
+/* Drops the data not needed to start at once: the cache begins with the PCR
+ * preceding the last video random access point older than the pts delay */
+static void EsOutPrejoinTrim( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    const mtime_t i_limit = p_sys->i_prejoin_pcr - p_sys->i_pts_delay;
+
+    size_t i_pcr = 0;
+    size_t i_start = 0;
+    bool b_pcr = false;
+    bool b_rap = false;
+    for( size_t i = 0; i < p_sys->i_prejoin; i++ )
+    {
+        const es_out_prejoin_t *p_data = &p_sys->p_prejoin[i];
+
+        if( p_data->i_pcr >= i_limit )
+            break;
+
+        if( !p_data->p_es )
+        {
+            i_pcr = i;
+            b_pcr = true;
+        }
+        else if( b_pcr && p_data->p_es->fmt.i_cat == VIDEO_ES &&
+                 ( p_data->p_block->i_flags & BLOCK_FLAG_TYPE_I ) )
+        {
+            i_start = i_pcr;
+            b_rap = true;
+        }
+    }
+
+    /* Without random access point, keep only a pts delay worth of data */
+    if( !b_rap && b_pcr &&
+        ( !p_sys->b_prejoin_rap ||
+          p_sys->p_prejoin[0].i_pcr < i_limit - ES_OUT_PREJOIN_GOP_MAX ) )
+        i_start = i_pcr;
+
+    if( i_start == 0 )
+        return;
+
+    for( size_t i = 0; i < i_start; i++ )
+    {
+        if( p_sys->p_prejoin[i].p_block )
+            block_Release( p_sys->p_prejoin[i].p_block );
+    }
+    p_sys->i_prejoin -= i_start;
+    memmove( p_sys->p_prejoin, &p_sys->p_prejoin[i_start],
+             p_sys->i_prejoin * sizeof( *p_sys->p_prejoin ) );
+}
+
+static void EsOutPrejoinBlock( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( es->p_pgrm != p_sys->p_pgrm || es->p_master )
+    {
+        block_Release( p_block );
+        return;
+    }
+
+    const es_out_prejoin_t data = {
+        .p_es = es,
+        .p_block = p_block,
+        .p_pgrm = es->p_pgrm,
+        .i_pcr = p_sys->i_prejoin_pcr,
+        .i_date = VLC_TS_INVALID,
+    };
+    if( EsOutPrejoinAppend( out, &data ) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
+    if( es->fmt.i_cat == VIDEO_ES && ( p_block->i_flags & BLOCK_FLAG_TYPE_I ) )
+        p_sys->b_prejoin_rap = true;
+}
+
+static void EsOutPrejoinPcr( es_out_t *out, es_out_pgrm_t *p_pgrm, mtime_t i_pcr )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_pgrm != p_sys->p_pgrm )
+        return;
+
+    /* The cached data cannot be played across a discontinuity */
+    if( p_sys->i_prejoin_pcr > VLC_TS_INVALID &&
+        ( i_pcr < p_sys->i_prejoin_pcr ||
+          i_pcr > p_sys->i_prejoin_pcr + ES_OUT_PREJOIN_GOP_MAX ) )
+        EsOutPrejoinFlush( out, NULL );
+
+    const es_out_prejoin_t data = {
+        .p_es = NULL,
+        .p_block = NULL,
+        .p_pgrm = p_pgrm,
+        .i_pcr = i_pcr,
+        .i_date = mdate(),
+    };
+    if( EsOutPrejoinAppend( out, &data ) )
+        return;
+    p_sys->i_prejoin_pcr = i_pcr;
+
+    EsOutPrejoinTrim( out );
+}
+
+/* Selects the ES and feeds them with the cached data, as if they had been
+ * decoded from the start: the buffering ends as soon as it is done */
+static void EsOutJoin( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( !p_sys->b_prejoined )
+        return;
+    p_sys->b_prejoined = false;
+
+    mtime_t i_first = VLC_TS_INVALID;
+    for( size_t i = 0; i < p_sys->i_prejoin && i_first <= VLC_TS_INVALID; i++ )
+    {
+        if( !p_sys->p_prejoin[i].p_es )
+            i_first = p_sys->p_prejoin[i].i_pcr;
+    }
+    const mtime_t i_cached = i_first > VLC_TS_INVALID ?
+                             p_sys->i_prejoin_pcr - i_first : 0;
+
+    msg_Dbg( p_sys->p_input, "joining with %d ms of cached data",
+             (int)(i_cached / 1000) );
+
+    /* Starting on the cached random access point delays the playback:
+     * the pts delay is raised as for a late stream */
+    if( i_cached > p_sys->i_pts_delay )
+    {
+        const mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
+        const mtime_t i_pts_delay = __MIN( i_cached, INPUT_PTS_DELAY_MAX );
+
+        es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base,
+                          p_sys->i_cr_average );
+    }
+
+    for( int i = 0; i < p_sys->i_es; i++ )
+        EsOutSelect( out, p_sys->es[i], false );
+
+    for( size_t i = 0; i < p_sys->i_prejoin; i++ )
+    {
+        const es_out_prejoin_t *p_data = &p_sys->p_prejoin[i];
+
+        if( p_data->p_es )
+            EsOutDecode( out, p_data->p_es, p_data->p_block );
+        else
+            EsOutSetPcr( out, p_data->p_pgrm, p_data->i_pcr, p_data->i_date );
+    }
+    p_sys->i_prejoin = 0;
+
+    free( p_sys->p_prejoin );
+    p_sys->p_prejoin = NULL;
+    p_sys->i_prejoin_max = 0;
+}
+
+/**
+ * Send a block for the given es_out
+ *
+ * \param out the es_out to send from
+ * \param es the es_out_id
+ * \param p_block the data block to send
+ */
+static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t   *p_sys = out->p_sys;
+    input_thread_t *p_input = p_sys->p_input;
+
+    if( libvlc_stats( p_input ) )
+    {
+        uint64_t i_total;
+
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_Update( p_input->p->counters.p_demux_read,
+                      p_block->i_buffer, &i_total );
+        stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
+
+        /* Update number of corrupted data packats */
+        if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
+        {
+            stats_Update( p_input->p->counters.p_demux_corrupted, 1, NULL );
+        }
+        /* Update number of discontinuities */
+        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        {
+            stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
+        }
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+
+    /* Mark preroll blocks */
+    if( p_sys->i_preroll_end >= 0 )
+    {
+        int64_t i_date = p_block->i_pts;
+        if( p_block->i_pts <= VLC_TS_INVALID )
+            i_date = p_block->i_dts;
+
+        if( i_date < p_sys->i_preroll_end )
+            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+    }
+
+    if( p_sys->b_prejoined )
+        EsOutPrejoinBlock( out, es, p_block );
+    else
+        EsOutDecode( out, es, p_block );
 
     vlc_mutex_unlock( &p_sys->lock );
 
@@ -2031,6 +2286,8 @@ static void EsOutDel( es_out_t *out, es_out_id_t *es )
 
     vlc_mutex_lock( &p_sys->lock );
 
+    EsOutPrejoinFlush( out, es );
+
     /* We don't try to reselect */
     if( es->p_dec )
     {
@@ -2100,6 +2357,149 @@ static void EsOutDel( es_out_t *out, es_out_id_t *es )
     free( es );
 }
 
+static void EsOutLowDelayUpdate( es_out_t *out, es_out_pgrm_t *p_pgrm )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    const mtime_t i_now = mdate();
+
+    if( p_sys->i_low_delay_date > i_now )
+        return;
+
+    /* The jitter is the peak of the last two periods, but the first one
+     * after buffering would only measure the start-up transient */
+    const mtime_t i_peak = input_clock_GetResetJitterPeak( p_pgrm->p_clock );
+    const bool b_first = p_sys->i_low_delay_date <= VLC_TS_INVALID;
+    const mtime_t i_jitter = __MAX( i_peak, p_sys->i_low_delay_peak );
+
+    p_sys->i_low_delay_date = i_now + INPUT_LOW_DELAY_PERIOD;
+    p_sys->i_low_delay_peak = b_first ? 0 : i_peak;
+    if( b_first )
+        return;
+
+    /* The smallest advance of the decoded data on their date when reaching
+     * the outputs is the part of the pts_delay left unused by the decoders */
+    mtime_t i_slack = INT64_MAX;
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_id_t *es = p_sys->es[i];
+        mtime_t i_delay;
+
+        if( es->p_dec && es->p_pgrm == p_pgrm &&
+            ( es->fmt.i_cat == AUDIO_ES || es->fmt.i_cat == VIDEO_ES ) &&
+            input_DecoderGetOutputDelay( es->p_dec, &i_delay ) )
+            i_slack = __MIN( i_slack, i_delay );
+    }
+    if( i_slack == INT64_MAX )
+        return;
+
+    /* Grow at once if the outputs are late, shrink by half of what both
+     * the jitter and the outputs allow so that they catch up smoothly */
+    mtime_t i_pts_delay = p_sys->i_pts_delay;
+    if( i_slack < 0 )
+    {
+        i_pts_delay += INPUT_LOW_DELAY_MARGIN - i_slack;
+    }
+    else
+    {
+        const mtime_t i_excess =
+            __MIN( p_sys->i_pts_delay - i_jitter, i_slack ) - INPUT_LOW_DELAY_MARGIN;
+        if( i_excess > 0 )
+            i_pts_delay -= ( i_excess + 1 ) / 2;
+    }
+    i_pts_delay = __MIN( i_pts_delay, INPUT_PTS_DELAY_MAX );
+    if( i_pts_delay == p_sys->i_pts_delay )
+        return;
+
+    msg_Dbg( p_sys->p_input, "pts_delay %s to %d ms (jitter %d ms, "
+             "output slack %d ms)",
+             i_pts_delay > p_sys->i_pts_delay ? "increased" : "decreased",
+             (int)(i_pts_delay / 1000), (int)(i_jitter / 1000),
+             (int)(i_slack / 1000) );
+
+    mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
+    if( i_pts_delay < i_pts_delay_base )
+        i_pts_delay_base = i_pts_delay;
+
+    if( i_pts_delay > p_sys->i_pts_delay )
+    {
+        es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base,
+                          p_sys->i_cr_average );
+        return;
+    }
+
+    /* The clocks never lower their pts_delay on their own, force it as the
+     * input is live (it cannot pace the stream to refill the buffers) */
+    p_sys->i_pts_delay  = i_pts_delay;
+    p_sys->i_pts_jitter = i_pts_delay - i_pts_delay_base;
+    for( int i = 0; i < p_sys->i_pgrm; i++ )
+        input_clock_ForceJitter( p_sys->pgrm[i]->p_clock, i_pts_delay,
+                                 p_sys->i_cr_average );
+}
+
+static void EsOutSetPcr( es_out_t *out, es_out_pgrm_t *p_pgrm,
+                         mtime_t i_pcr, mtime_t i_date )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    bool b_late;
+    input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
+                        &b_late,
+                        p_sys->p_input->p->b_can_pace_control || p_sys->b_buffering,
+                        EsOutIsExtraBufferingAllowed( out ),
+                        i_pcr, i_date );
+
+    if( !p_sys->p_pgrm )
+        return;
+
+    if( p_sys->b_buffering )
+    {
+        /* Check buffering state on master clock update */
+        EsOutDecodersStopBuffering( out, false );
+    }
+    else if( p_pgrm == p_sys->p_pgrm )
+    {
+        if( b_late && ( !p_sys->p_input->p->p_sout ||
+                             !p_sys->p_input->p->b_out_pace_control ) )
+        {
+            const mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
+            mtime_t i_pts_delay = input_clock_GetJitter( p_pgrm->p_clock );
+
+            /* Avoid dangerously high value */
+            const mtime_t i_jitter_max = INT64_C(1000) * var_InheritInteger( p_sys->p_input, "clock-jitter" );
+            if( i_pts_delay > __MIN( i_pts_delay_base + i_jitter_max, INPUT_PTS_DELAY_MAX ) )
+            {
+                msg_Err( p_sys->p_input,
+                         "ES_OUT_SET_(GROUP_)PCR  is called too late (jitter of %d ms ignored)",
+                         (int)(i_pts_delay - i_pts_delay_base) / 1000 );
+                i_pts_delay = p_sys->i_pts_delay;
+
+                /* reset clock */
+                for( int i = 0; i < p_sys->i_pgrm; i++ )
+                  input_clock_Reset( p_sys->pgrm[i]->p_clock );
+            }
+            else
+            {
+                msg_Err( p_sys->p_input,
+                         "ES_OUT_SET_(GROUP_)PCR  is called too late (pts_delay increased to %d ms)",
+                         (int)(i_pts_delay/1000) );
+
+                /* Force a rebufferization when we are too late */
+
+                /* It is not really good, as we throw away already buffered data
+                 * TODO have a mean to correctly reenter bufferization */
+                es_out_Control( out, ES_OUT_RESET_PCR );
+            }
+
+            es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base, p_sys->i_cr_average );
+            p_sys->i_low_delay_date = VLC_TS_INVALID;
+        }
+        else if( p_sys->b_low_delay && !p_sys->p_input->p->b_can_pace_control )
+        {
+            EsOutLowDelayUpdate( out, p_pgrm );
+        }
+    }
+}
+
 /**
  * Control query handler
  *
@@ -2154,7 +2554,8 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
                 i_mode == ES_OUT_MODE_AUTO || i_mode == ES_OUT_MODE_PARTIAL ||
                 i_mode == ES_OUT_MODE_END );
 
-        if( i_mode != ES_OUT_MODE_NONE && !p_sys->b_active && p_sys->i_es > 0 )
+        if( i_mode != ES_OUT_MODE_NONE && !p_sys->b_active && p_sys->i_es > 0 &&
+            !p_sys->b_prejoined )
         {
             /* XXX Terminate vout if there are tracks but no video one.
              * This one is not mandatory but is he earliest place where it
@@ -2304,64 +2705,21 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             return VLC_EGENERIC;
         }
 
-        /* TODO do not use mdate() but proper stream acquisition date */
-        bool b_late;
-        input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
-                            &b_late,
-                            p_sys->p_input->p->b_can_pace_control || p_sys->b_buffering,
-                            EsOutIsExtraBufferingAllowed( out ),
-                            i_pcr, mdate() );
-
-        if( !p_sys->p_pgrm )
-            return VLC_SUCCESS;
-
-        if( p_sys->b_buffering )
+        if( p_sys->b_prejoined )
         {
-            /* Check buffering state on master clock update */
-            EsOutDecodersStopBuffering( out, false );
+            EsOutPrejoinPcr( out, p_pgrm, i_pcr );
+            return VLC_SUCCESS;
         }
-        else if( p_pgrm == p_sys->p_pgrm )
-        {
-            if( b_late && ( !p_sys->p_input->p->p_sout ||
-                                 !p_sys->p_input->p->b_out_pace_control ) )
-            {
-                const mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
-                mtime_t i_pts_delay = input_clock_GetJitter( p_pgrm->p_clock );
-
-                /* Avoid dangerously high value */
-                const mtime_t i_jitter_max = INT64_C(1000) * var_InheritInteger( p_sys->p_input, "clock-jitter" );
-                if( i_pts_delay > __MIN( i_pts_delay_base + i_jitter_max, INPUT_PTS_DELAY_MAX ) )
-                {
-                    msg_Err( p_sys->p_input,
-                             "ES_OUT_SET_(GROUP_)PCR  is called too late (jitter of %d ms ignored)",
-                             (int)(i_pts_delay - i_pts_delay_base) / 1000 );
-                    i_pts_delay = p_sys->i_pts_delay;
-
-                    /* reset clock */
-                    for( int i = 0; i < p_sys->i_pgrm; i++ )
-                      input_clock_Reset( p_sys->pgrm[i]->p_clock );
-                }
-                else
-                {
-                    msg_Err( p_sys->p_input,
-                             "ES_OUT_SET_(GROUP_)PCR  is called too late (pts_delay increased to %d ms)",
-                             (int)(i_pts_delay/1000) );
-
-                    /* Force a rebufferization when we are too late */
 
-                    /* It is not really good, as we throw away already buffered data
-                     * TODO have a mean to correctly reenter bufferization */
-                    es_out_Control( out, ES_OUT_RESET_PCR );
-                }
-
-                es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base, p_sys->i_cr_average );
-            }
-        }
+        /* TODO do not use mdate() but proper stream acquisition date */
+        EsOutSetPcr( out, p_pgrm, i_pcr, mdate() );
         return VLC_SUCCESS;
     }
 
     case ES_OUT_RESET_PCR:
         msg_Err( p_sys->p_input, "ES_OUT_RESET_PCR called" );
+        if( p_sys->b_prejoined )
+            EsOutPrejoinFlush( out, NULL );
         EsOutChangePosition( out );
         return VLC_SUCCESS;
 
@@ -2694,6 +3052,44 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_JOIN:
+        EsOutJoin( out );
+        return VLC_SUCCESS;
+
+    case ES_OUT_GET_CLOCK_STATS:
+    {
+        input_clock_stats_t **pp_stats = va_arg( args, input_clock_stats_t ** );
+
+        if( !libvlc_stats( p_sys->p_input ) || !p_sys->p_pgrm )
+            return VLC_EGENERIC;
+
+        /* The ES statistics are allocated with the structure */
+        input_clock_stats_t *p_stats =
+            malloc( sizeof(*p_stats) + p_sys->i_es * sizeof(*p_stats->p_es) );
+        if( !p_stats )
+            return VLC_ENOMEM;
+
+        input_clock_GetStats( p_sys->p_pgrm->p_clock, p_stats );
+        p_stats->i_resamplings = 0;
+        p_stats->i_es = 0;
+        p_stats->p_es = (input_clock_es_stats_t *)&p_stats[1];
+
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+            if( !es->p_dec )
+                continue;
+
+            input_clock_es_stats_t *p_es = &p_stats->p_es[p_stats->i_es++];
+            p_es->i_id = es->i_id;
+            p_es->i_cat = es->fmt.i_cat;
+            input_DecoderGetClockStats( es->p_dec, p_es );
+            p_stats->i_resamplings += p_es->i_resamplings;
+        }
+        *pp_stats = p_stats;
+        return VLC_SUCCESS;
+    }
+
     default:
         msg_Err( p_sys->p_input, "unknown query in es_out_Control" );
         return VLC_EGENERIC;
@@ -82,6 +82,12 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Start decoding a pre-joined input from its cached data */
+    ES_OUT_JOIN,                                    /* res=cannot fail */
+
+    /* Get the clock statistics, to be released with free() */
+    ES_OUT_GET_CLOCK_STATS,                         /* arg1=input_clock_stats_t ** res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -167,6 +173,11 @@ static inline void es_out_Eos( es_out_t *p_out )
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
     assert( !i_ret );
 }
+static inline void es_out_Join( es_out_t *p_out )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_JOIN );
+    assert( !i_ret );
+}
 
 es_out_t  *input_EsOutNew( input_thread_t *, int i_rate );
 
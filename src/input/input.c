@@ -46,6 +46,7 @@
 #include "stream.h"
 #include "item.h"
 #include "resource.h"
+#include "../misc/trace.h"
 
 #include <vlc_sout.h>
 #include <vlc_dialog.h>
@@ -63,7 +64,7 @@ static void Destructor( input_thread_t * p_input );
 static  void *Run            ( void * );
 
 static input_thread_t * Create  ( vlc_object_t *, input_item_t *,
-                                  const char *, bool, input_resource_t * );
+                                  const char *, bool, bool, input_resource_t * );
 static  int             Init    ( input_thread_t *p_input );
 static void             End     ( input_thread_t *p_input );
 static void             MainLoop( input_thread_t *p_input, bool b_interactive );
@@ -90,6 +91,7 @@ static void InputSourceMeta( input_thread_t *, input_source_t *, vlc_meta_t * );
 //static void InputGetAttachments( input_thread_t *, input_source_t * );
 static void SlaveDemux( input_thread_t *p_input, bool *pb_demux_polled );
 static void SlaveSeek( input_thread_t *p_input );
+static void SlaveStop( input_source_t * );
 
 static void InputMetaUser( input_thread_t *p_input, vlc_meta_t *p_meta );
 static void InputUpdateMeta( input_thread_t *p_input, demux_t *p_demux );
@@ -127,7 +129,7 @@ input_thread_t *input_Create( vlc_object_t *p_parent,
                               input_item_t *p_item,
                               const char *psz_log, input_resource_t *p_resource )
 {
-    return Create( p_parent, p_item, psz_log, false, p_resource );
+    return Create( p_parent, p_item, psz_log, false, false, p_resource );
 }
 
 #undef input_CreateAndStart
@@ -151,6 +153,25 @@ input_thread_t *input_CreateAndStart( vlc_object_t *p_parent,
     return p_input;
 }
 
+#undef input_CreatePrejoined
+/**
+ * Create a new pre-joined input_thread_t.
+ *
+ * Once started, it opens and demuxes the item without decoding it, keeping
+ * the data needed to start playing at once. It does not use the resource
+ * until it is joined with INPUT_JOIN, so that it can share the one of a
+ * playing input.
+ *
+ * \see input_Create
+ */
+input_thread_t *input_CreatePrejoined( vlc_object_t *p_parent,
+                                       input_item_t *p_item,
+                                       const char *psz_log,
+                                       input_resource_t *p_resource )
+{
+    return Create( p_parent, p_item, psz_log, false, true, p_resource );
+}
+
 #undef input_Read
 /**
  * Initialize an input thread and run it until it stops by itself.
@@ -161,7 +182,7 @@ input_thread_t *input_CreateAndStart( vlc_object_t *p_parent,
  */
 int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
 {
-    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL );
+    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, false, NULL );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -188,7 +209,7 @@ int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
     input_thread_t *p_input;
 
     /* Allocate descriptor */
-    p_input = Create( p_parent, p_item, NULL, true, NULL );
+    p_input = Create( p_parent, p_item, NULL, true, false, NULL );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -288,7 +309,7 @@ input_item_t *input_GetItem( input_thread_t *p_input )
  *****************************************************************************/
 static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
                                const char *psz_header, bool b_quick,
-                               input_resource_t *p_resource )
+                               bool b_prejoined, input_resource_t *p_resource )
 {
     input_thread_t *p_input = NULL;                 /* thread descriptor */
     int i;
@@ -339,6 +360,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->i_state = INIT_S;
     p_input->p->i_rate = INPUT_RATE_DEFAULT;
     p_input->p->b_recording = false;
+    p_input->p->b_prejoined = b_prejoined;
     memset( &p_input->p->bookmark, 0, sizeof(p_input->p->bookmark) );
     TAB_INIT( p_input->p->i_bookmark, p_input->p->pp_bookmark );
     TAB_INIT( p_input->p->i_attachment, p_input->p->attachment );
@@ -381,7 +403,8 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         p_input->p->p_resource_private = input_resource_New( VLC_OBJECT( p_input ) );
         p_input->p->p_resource = input_resource_Hold( p_input->p->p_resource_private );
     }
-    input_resource_SetInput( p_input->p->p_resource, p_input );
+    if( !b_prejoined )
+        input_resource_SetInput( p_input->p->p_resource, p_input );
 
     /* Init control buffer */
     vlc_mutex_init( &p_input->p->lock_control );
@@ -549,7 +572,11 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, bool *pb_d
         ( p_input->p->i_run > 0 && i_start_mdate+p_input->p->i_run < mdate() ) )
         i_ret = 0; /* EOF */
     else
+    {
+        mtime_t trace = vlc_trace_Begin( p_input );
         i_ret = demux_Demux( p_input->p->input.p_demux );
+        vlc_trace_End( p_input, "demux", trace );
+    }
 
     if( i_ret > 0 )
     {
@@ -944,6 +971,7 @@ static void StartTitle( input_thread_t * p_input )
         p_input->p->i_stop = 0;
     }
     p_input->p->b_fast_seek = var_GetBool( p_input, "input-fast-seek" );
+    p_input->p->b_slave_threads = var_GetBool( p_input, "input-slave-threads" );
 }
 
 static void LoadSubtitles( input_thread_t *p_input )
@@ -1182,7 +1210,7 @@ static int Init( input_thread_t * p_input )
 
     InitStatistics( p_input );
 #ifdef ENABLE_SOUT
-    if( InitSout( p_input ) )
+    if( !p_input->p->b_prejoined && InitSout( p_input ) )
         goto error;
 #endif
 
@@ -1280,7 +1308,8 @@ error:
         if( p_input->p->p_sout )
             input_resource_RequestSout( p_input->p->p_resource,
                                          p_input->p->p_sout, NULL );
-        input_resource_SetInput( p_input->p->p_resource, NULL );
+        if( !p_input->p->b_prejoined )
+            input_resource_SetInput( p_input->p->p_resource, NULL );
         if( p_input->p->p_resource_private )
             input_resource_Terminate( p_input->p->p_resource_private );
     }
@@ -1398,10 +1427,13 @@ static void End( input_thread_t * p_input )
     }
     vlc_mutex_unlock( &p_input->p->p_item->lock );
 
-    /* */
-    input_resource_RequestSout( p_input->p->p_resource,
-                                 p_input->p->p_sout, NULL );
-    input_resource_SetInput( p_input->p->p_resource, NULL );
+    /* A pre-joined input never used the resource */
+    if( !p_input->p->b_prejoined )
+    {
+        input_resource_RequestSout( p_input->p->p_resource,
+                                     p_input->p->p_sout, NULL );
+        input_resource_SetInput( p_input->p->p_resource, NULL );
+    }
     if( p_input->p->p_resource_private )
         input_resource_Terminate( p_input->p->p_resource_private );
 }
@@ -2002,6 +2034,26 @@ static bool Control( input_thread_t *p_input,
             }
             break;
 
+        case INPUT_CONTROL_JOIN:
+            if( !p_input->p->b_prejoined )
+                break;
+            p_input->p->b_prejoined = false;
+            input_resource_SetInput( p_input->p->p_resource, p_input );
+#ifdef ENABLE_SOUT
+            if( InitSout( p_input ) )
+            {
+                /* The error state is set, do not keep caching for nothing */
+                input_ControlPush( p_input, INPUT_CONTROL_SET_DIE, NULL );
+                break;
+            }
+            if( p_input->p->p_sout )
+                p_input->p->b_out_pace_control =
+                    p_input->p->p_sout->i_out_pace_nocontrol > 0;
+#endif
+            es_out_Join( p_input->p->p_es_out_display );
+            b_force_update = true;
+            break;
+
         case INPUT_CONTROL_SET_FRAME_NEXT:
             if( p_input->p->i_state == PAUSE_S )
             {
@@ -2465,6 +2517,12 @@ static int InputSourceInit( input_thread_t *p_input,
     if( var_GetInteger( p_input, "clock-synchro" ) != -1 )
         in->b_can_pace_control = !var_GetInteger( p_input, "clock-synchro" );
 
+    /* In low delay mode, the caching of live sources is only the starting
+     * point of its adaptation by the es_out */
+    if( !in->b_can_pace_control && var_InheritBool( p_input, "low-delay" ) &&
+        in->i_pts_delay > INPUT_LOW_DELAY_PTS_DELAY_MAX )
+        in->i_pts_delay = INPUT_LOW_DELAY_PTS_DELAY_MAX;
+
     return VLC_SUCCESS;
 
 error:
@@ -2484,6 +2542,9 @@ static void InputSourceClean( input_source_t *in )
 {
     int i;
 
+    if( in->b_thread )
+        SlaveStop( in );
+
     if( in->p_demux )
         demux_Delete( in->p_demux );
 
@@ -2550,6 +2611,119 @@ static void InputSourceMeta( input_thread_t *p_input,
 }
 
 
+/* Demuxes a slave until it reaches i_time, the time of the master.
+ * Returns false at EOF */
+static bool SlaveDemuxSource( input_source_t *in, int64_t i_time )
+{
+    int i_ret;
+
+    /* Call demux_Demux until we have read enough data */
+    if( demux_Control( in->p_demux, DEMUX_SET_NEXT_DEMUX_TIME, i_time ) )
+    {
+        for( ;; )
+        {
+            int64_t i_stime;
+            if( demux_Control( in->p_demux, DEMUX_GET_TIME, &i_stime ) )
+            {
+                msg_Err( in->p_demux, "slave doesn't like "
+                         "DEMUX_GET_TIME -> EOF" );
+                i_ret = 0;
+                break;
+            }
+
+            if( i_stime >= i_time )
+            {
+                i_ret = 1;
+                break;
+            }
+
+            if( ( i_ret = demux_Demux( in->p_demux ) ) <= 0 )
+                break;
+        }
+    }
+    else
+    {
+        i_ret = demux_Demux( in->p_demux );
+    }
+    return i_ret > 0;
+}
+
+/* Slave demuxing thread: it follows the time of the master given by
+ * SlaveDemux(), while the input thread goes on with the master and the
+ * controls. The es_out and the clocks of the programs keep them in sync. */
+static void *SlaveThread( void *data )
+{
+    input_source_t *in = data;
+    int canc = vlc_savecancel();
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &in->lock );
+        while( !in->b_stop && ( in->b_eof || !in->b_demux ) )
+            vlc_cond_wait( &in->wait, &in->lock );
+        const bool b_stop = in->b_stop;
+        vlc_mutex_unlock( &in->lock );
+
+        if( b_stop )
+            break;
+
+        vlc_mutex_lock( &in->demux_lock );
+
+        /* A seek may have happened meanwhile */
+        vlc_mutex_lock( &in->lock );
+        const bool b_demux = in->b_demux && !in->b_eof;
+        const int64_t i_time = in->i_demux_time;
+        in->b_demux = false;
+        vlc_mutex_unlock( &in->lock );
+
+        if( b_demux && !SlaveDemuxSource( in, i_time ) )
+        {
+            msg_Dbg( in->p_demux, "slave EOF" );
+            vlc_mutex_lock( &in->lock );
+            in->b_eof = true;
+            vlc_mutex_unlock( &in->lock );
+        }
+        vlc_mutex_unlock( &in->demux_lock );
+    }
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static int SlaveStart( input_thread_t *p_input, input_source_t *in )
+{
+    vlc_mutex_init( &in->demux_lock );
+    vlc_mutex_init( &in->lock );
+    vlc_cond_init( &in->wait );
+    in->b_demux = false;
+    in->b_stop = false;
+
+    if( vlc_clone( &in->thread, SlaveThread, in, VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        msg_Err( p_input, "cannot create the slave thread" );
+        vlc_cond_destroy( &in->wait );
+        vlc_mutex_destroy( &in->lock );
+        vlc_mutex_destroy( &in->demux_lock );
+        return VLC_EGENERIC;
+    }
+    in->b_thread = true;
+    return VLC_SUCCESS;
+}
+
+static void SlaveStop( input_source_t *in )
+{
+    vlc_mutex_lock( &in->lock );
+    in->b_stop = true;
+    vlc_cond_signal( &in->wait );
+    vlc_mutex_unlock( &in->lock );
+
+    vlc_join( in->thread, NULL );
+    vlc_cond_destroy( &in->wait );
+    vlc_mutex_destroy( &in->lock );
+    vlc_mutex_destroy( &in->demux_lock );
+    in->b_thread = false;
+}
+
 static void SlaveDemux( input_thread_t *p_input, bool *pb_demux_polled )
 {
     int64_t i_time;
@@ -2565,7 +2739,21 @@ static void SlaveDemux( input_thread_t *p_input, bool *pb_demux_polled )
     for( i = 0; i < p_input->p->i_slave; i++ )
     {
         input_source_t *in = p_input->p->slave[i];
-        int i_ret;
+
+        if( !in->b_thread && !in->b_eof && in->p_demux->pf_demux != NULL &&
+            p_input->p->b_slave_threads && !SlaveStart( p_input, in ) )
+            msg_Dbg( p_input, "slave %d demuxed by its own thread", i );
+
+        if( in->b_thread )
+        {
+            /* Never waits for the slave */
+            vlc_mutex_lock( &in->lock );
+            in->i_demux_time = i_time;
+            in->b_demux = true;
+            vlc_cond_signal( &in->wait );
+            vlc_mutex_unlock( &in->lock );
+            continue;
+        }
 
         if( in->b_eof )
             continue;
@@ -2576,36 +2764,7 @@ static void SlaveDemux( input_thread_t *p_input, bool *pb_demux_polled )
 
         *pb_demux_polled = true;
 
-        /* Call demux_Demux until we have read enough data */
-        if( demux_Control( in->p_demux, DEMUX_SET_NEXT_DEMUX_TIME, i_time ) )
-        {
-            for( ;; )
-            {
-                int64_t i_stime;
-                if( demux_Control( in->p_demux, DEMUX_GET_TIME, &i_stime ) )
-                {
-                    msg_Err( p_input, "slave[%d] doesn't like "
-                             "DEMUX_GET_TIME -> EOF", i );
-                    i_ret = 0;
-                    break;
-                }
-
-                if( i_stime >= i_time )
-                {
-                    i_ret = 1;
-                    break;
-                }
-
-                if( ( i_ret = demux_Demux( in->p_demux ) ) <= 0 )
-                    break;
-            }
-        }
-        else
-        {
-            i_ret = demux_Demux( in->p_demux );
-        }
-
-        if( i_ret <= 0 )
+        if( !SlaveDemuxSource( in, i_time ) )
         {
             msg_Dbg( p_input, "slave %d EOF", i );
             in->b_eof = true;
@@ -2628,16 +2787,24 @@ static void SlaveSeek( input_thread_t *p_input )
     {
         input_source_t *in = p_input->p->slave[i];
 
-        if( demux_Control( in->p_demux, DEMUX_SET_TIME, i_time, true ) )
+        /* Waits for the current demux of the slave thread, if any */
+        if( in->b_thread )
+            vlc_mutex_lock( &in->demux_lock );
+
+        bool b_eof = demux_Control( in->p_demux, DEMUX_SET_TIME, i_time, true );
+        if( b_eof && !in->b_eof )
+            msg_Err( p_input, "seek failed for slave %d -> EOF", i );
+
+        if( in->b_thread )
         {
-            if( !in->b_eof )
-                msg_Err( p_input, "seek failed for slave %d -> EOF", i );
-            in->b_eof = true;
+            vlc_mutex_lock( &in->lock );
+            in->b_eof = b_eof;
+            in->b_demux = false;
+            vlc_mutex_unlock( &in->lock );
+            vlc_mutex_unlock( &in->demux_lock );
         }
         else
-        {
-            in->b_eof = false;
-        }
+            in->b_eof = b_eof;
     }
 }
 
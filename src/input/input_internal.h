@@ -66,6 +66,16 @@ typedef struct
 
     bool       b_eof;   /* eof of demuxer */
 
+    /* Slave demuxing on its own thread (input-slave-threads) */
+    bool         b_thread;
+    vlc_thread_t thread;
+    vlc_mutex_t  demux_lock; /* held while calling the demuxer */
+    vlc_mutex_t  lock;       /* protects b_eof and the fields below */
+    vlc_cond_t   wait;
+    bool         b_demux;    /* demux up to i_demux_time */
+    int64_t      i_demux_time;
+    bool         b_stop;
+
 } input_source_t;
 
 typedef struct
@@ -86,6 +96,7 @@ struct input_thread_private_t
 
     /* Current state */
     bool        b_recording;
+    bool        b_prejoined; /* demuxed but not decoded until joined */
     int         i_rate;
 
     /* Playtime configuration and state */
@@ -94,6 +105,7 @@ struct input_thread_private_t
     int64_t     i_run;      /* :run-time, 0 if none */
     int64_t     i_time;     /* Current time */
     bool        b_fast_seek;/* :input-fast-seek */
+    bool        b_slave_threads; /* :input-slave-threads */
 
     /* Output */
     bool            b_out_pace_control; /* XXX Move it ot es_sout ? */
@@ -211,6 +223,8 @@ enum input_control_e
     INPUT_CONTROL_SET_RECORD_STATE,
 
     INPUT_CONTROL_SET_FRAME_NEXT,
+
+    INPUT_CONTROL_JOIN,
 };
 
 /* Internal helpers */
@@ -223,6 +237,13 @@ void input_ControlPush( input_thread_t *, int i_type, vlc_value_t * );
 /* Bound pts_delay */
 #define INPUT_PTS_DELAY_MAX INT64_C(60000000)
 
+/* Low delay mode: the caching requested by the access is capped, then
+ * adapted every period to the clock jitter and the slack of the outputs,
+ * keeping a margin */
+#define INPUT_LOW_DELAY_PTS_DELAY_MAX (CLOCK_FREQ/10)
+#define INPUT_LOW_DELAY_PERIOD        (2*CLOCK_FREQ)
+#define INPUT_LOW_DELAY_MARGIN        (CLOCK_FREQ/50)
+
 /**********************************************************************
  * Item metadata
  **********************************************************************/
@@ -36,6 +36,7 @@
 
 #include "access.h"
 #include "stream.h"
+#include "stream_cache.h"
 
 #include "input_internal.h"
 
@@ -95,6 +96,17 @@
 #define STREAM_READ_ATONCE 1024
 #define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
 
+/* Range cache, under the tracks of method 2, for the seekable accesses
+ * without fast seek (http, ftp, ...), where every seek is a new request:
+ *  - the access seeks are delayed until some data is not in the cache,
+ *  - we read more than asked for, so that the reads around, from any
+ *    track, are served from the cache,
+ *  - we read through small gaps instead of seeking,
+ *  - the demuxers can ask for a range ahead of time (STREAM_HINT_RANGE).
+ */
+#define STREAM_CACHE_FETCH (256*1024)
+#define STREAM_CACHE_GAP   (64*1024)
+
 typedef struct
 {
     int64_t i_date;
@@ -157,6 +169,20 @@ struct stream_sys_t
 
     } stream;
 
+    /* Range cache for method 2 */
+    struct
+    {
+        stream_cache_t *p_cache;
+        uint64_t i_size;        /* Budget */
+
+        uint64_t i_pos;         /* Offset of the next read */
+        uint64_t i_access_pos;  /* Offset of the access */
+
+        uint8_t *p_buffer;      /* STREAM_CACHE_FETCH bytes */
+
+        uint64_t i_bytes;       /* Read from the cache */
+    } cache;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -198,6 +224,12 @@ static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
+/* Range cache */
+static void ACacheInit( stream_t *s );
+static void ACacheClean( stream_t *s );
+static int  ACacheRead( stream_t *s, void *p_read, unsigned int i_read );
+static int  ACacheHint( stream_t *s, uint64_t i_start, uint64_t i_length );
+
 /* ReadDir */
 static int  AStreamReadDir( stream_t *s, input_item_node_t *p_node );
 
@@ -371,6 +403,9 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     p_sys->i_peek = 0;
     p_sys->p_peek = NULL;
 
+    p_sys->cache.p_cache = NULL;
+    p_sys->cache.p_buffer = NULL;
+
     if( p_sys->method == STREAM_METHOD_BLOCK )
     {
         msg_Dbg( s, "Using block method for AStream*" );
@@ -424,6 +459,8 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
                 &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
         }
 
+        ACacheInit( s );
+
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
 
@@ -450,6 +487,7 @@ error:
     }
     else if( p_sys->method == STREAM_METHOD_STREAM )
     {
+        ACacheClean( s );
         free( p_sys->stream.p_buffer );
     }
     while( p_sys->i_list > 0 )
@@ -471,7 +509,13 @@ static void AStreamDestroy( stream_t *s )
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else if( p_sys->method == STREAM_METHOD_STREAM )
+    {
+        msg_Dbg( s, "%u access seek(s), %"PRIu64" bytes read, %"PRIu64
+                 " of them from the range cache", p_sys->stat.i_seek_count,
+                 p_sys->stat.i_bytes, p_sys->cache.i_bytes );
+        ACacheClean( s );
         free( p_sys->stream.p_buffer );
+    }
 
     free( p_sys->p_peek );
 
@@ -532,6 +576,11 @@ static void AStreamControlReset( stream_t *s )
             p_sys->stream.tk[i].i_end   = p_sys->i_pos;
         }
 
+        /* The offsets are the ones of another title now */
+        if( p_sys->cache.p_cache )
+            stream_CacheFlush( p_sys->cache.p_cache );
+        p_sys->cache.i_pos = p_sys->cache.i_access_pos = p_sys->i_pos;
+
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
     }
@@ -544,7 +593,10 @@ static void AStreamControlUpdate( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    p_sys->i_pos = p_sys->p_access->info.i_pos;
+    if( p_sys->cache.p_cache )
+        p_sys->i_pos = p_sys->cache.i_pos;
+    else
+        p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->i_list )
     {
@@ -642,6 +694,22 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
             AStreamControlUpdate( s );
             return VLC_SUCCESS;
 
+        case STREAM_HINT_RANGE:
+        {
+            uint64_t i_start = va_arg( args, uint64_t );
+            uint64_t i_length = va_arg( args, uint64_t );
+
+            if( p_sys->method != STREAM_METHOD_STREAM || !p_sys->cache.p_cache )
+                return VLC_EGENERIC;
+            return ACacheHint( s, i_start, i_length );
+        }
+
+        case STREAM_CLEAR_HINTS:
+            if( p_sys->method != STREAM_METHOD_STREAM || !p_sys->cache.p_cache )
+                return VLC_EGENERIC;
+            stream_CacheClearHints( p_sys->cache.p_cache );
+            return VLC_SUCCESS;
+
         case STREAM_SET_TITLE:
         case STREAM_SET_SEEKPOINT:
         {
@@ -1672,6 +1740,167 @@ error:
     return NULL;
 }
 
+/****************************************************************************
+ * Range cache
+ ****************************************************************************/
+static void ACacheInit( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    bool b_seek;
+
+    p_sys->cache.i_size = 0;
+    p_sys->cache.i_pos = p_sys->cache.i_access_pos = p_sys->i_pos;
+    p_sys->cache.i_bytes = 0;
+
+    access_Control( p_sys->p_access, ACCESS_CAN_SEEK, &b_seek );
+    if( !b_seek || p_sys->stat.b_fastseek || p_sys->i_list )
+        return;
+
+    int64_t i_size = var_InheritInteger( s, "input-cache-size" );
+    if( i_size <= 0 )
+        return;
+
+    p_sys->cache.p_buffer = malloc( STREAM_CACHE_FETCH );
+    if( !p_sys->cache.p_buffer )
+        return;
+
+    char *psz_dir = var_InheritString( s, "input-cache-path" );
+    if( psz_dir && !*psz_dir )
+    {
+        free( psz_dir );
+        psz_dir = NULL;
+    }
+
+    p_sys->cache.p_cache = stream_CacheNew( VLC_OBJECT(s), i_size * 1024,
+                                            psz_dir );
+    if( p_sys->cache.p_cache )
+    {
+        p_sys->cache.i_size = i_size * 1024;
+        msg_Dbg( s, "caching up to %"PRId64" KiB of byte ranges in %s",
+                 i_size, psz_dir ? psz_dir : "memory" );
+    }
+    else
+    {
+        free( p_sys->cache.p_buffer );
+        p_sys->cache.p_buffer = NULL;
+    }
+    free( psz_dir );
+}
+
+static void ACacheClean( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->cache.p_cache )
+        stream_CacheDelete( p_sys->cache.p_cache );
+    free( p_sys->cache.p_buffer );
+}
+
+/* Reads from the access into the cache, until the data at i_pos, or at
+ * least i_size bytes from there, are in */
+static int ACacheFill( stream_t *s, uint64_t i_pos, uint64_t i_size,
+                       bool b_hint )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    access_t *p_access = p_sys->p_access;
+    const uint64_t i_end = i_pos + __MAX( i_size, 1 );
+
+    if( i_pos < p_sys->cache.i_access_pos ||
+        i_pos - p_sys->cache.i_access_pos > STREAM_CACHE_GAP )
+    {
+        if( p_access->pf_seek( p_access, i_pos ) )
+            return VLC_EGENERIC;
+        p_sys->cache.i_access_pos = i_pos;
+        p_sys->stat.i_seek_count++;
+    }
+
+    while( p_sys->cache.i_access_pos < i_end )
+    {
+        if( !vlc_object_alive(s) )
+            return VLC_EGENERIC;
+
+        ssize_t i_read = p_access->pf_read( p_access, p_sys->cache.p_buffer,
+                                            STREAM_CACHE_FETCH );
+        if( i_read < 0 )
+            continue;
+        if( i_read == 0 )
+            return VLC_EGENERIC; /* EOF */
+
+        stream_CachePut( p_sys->cache.p_cache, p_sys->cache.i_access_pos,
+                         p_sys->cache.p_buffer, i_read,
+                         b_hint && p_sys->cache.i_access_pos >= i_pos );
+        p_sys->cache.i_access_pos += i_read;
+    }
+    return VLC_SUCCESS;
+}
+
+static int ACacheReadDirect( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    access_t *p_access = p_sys->p_access;
+
+    if( p_sys->cache.i_access_pos != p_sys->cache.i_pos )
+    {
+        if( p_access->pf_seek( p_access, p_sys->cache.i_pos ) )
+            return 0;
+        p_sys->cache.i_access_pos = p_sys->cache.i_pos;
+        p_sys->stat.i_seek_count++;
+    }
+
+    ssize_t i_ret;
+    do
+    {
+        if( !vlc_object_alive(s) )
+            return 0;
+        i_ret = p_access->pf_read( p_access, p_read, i_read );
+    }
+    while( i_ret < 0 );
+
+    p_sys->cache.i_access_pos += i_ret;
+    p_sys->cache.i_pos += i_ret;
+    return i_ret;
+}
+
+static int ACacheRead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    size_t i_copy;
+
+    i_copy = stream_CacheGet( p_sys->cache.p_cache, p_sys->cache.i_pos,
+                              p_read, i_read );
+    if( i_copy > 0 )
+        p_sys->cache.i_bytes += i_copy;
+    else
+    {
+        if( ACacheFill( s, p_sys->cache.i_pos, 0, false ) )
+            return 0;
+        i_copy = stream_CacheGet( p_sys->cache.p_cache, p_sys->cache.i_pos,
+                                  p_read, i_read );
+        if( i_copy == 0 )
+            /* Not kept by the cache: read from the access */
+            return ACacheReadDirect( s, p_read, i_read );
+    }
+    p_sys->cache.i_pos += i_copy;
+    return i_copy;
+}
+
+static int ACacheHint( stream_t *s, uint64_t i_start, uint64_t i_length )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    /* Keep room for what is read meanwhile */
+    i_length = __MIN( i_length, p_sys->cache.i_size / 2 );
+
+    /* The missing data are read in one pass, along with the cached ones in
+     * between, to issue a single request */
+    uint64_t i_missing = stream_CacheGet( p_sys->cache.p_cache, i_start,
+                                          NULL, i_length );
+    if( i_missing >= i_length )
+        return VLC_SUCCESS;
+
+    return ACacheFill( s, i_start + i_missing, i_length - i_missing, true );
+}
+
 /****************************************************************************
  * Access reading/seeking wrappers to handle concatenated streams.
  ****************************************************************************/
@@ -1684,7 +1913,10 @@ static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
 
     if( !p_sys->i_list )
     {
-        i_read = p_access->pf_read( p_access, p_read, i_read );
+        if( p_sys->cache.p_cache )
+            i_read = ACacheRead( s, p_read, i_read );
+        else
+            i_read = p_access->pf_read( p_access, p_read, i_read );
         if( p_input )
         {
             uint64_t total;
@@ -1809,6 +2041,18 @@ static int ASeek( stream_t *s, uint64_t i_pos )
     stream_sys_t *p_sys = s->p_sys;
     access_t *p_access = p_sys->p_access;
 
+    if( p_sys->method == STREAM_METHOD_STREAM )
+    {
+        if( p_sys->cache.p_cache )
+        {
+            /* Done by the next read if the data is not cached. The hinted
+             * data are kept, as the demuxers seek between their tracks. */
+            p_sys->cache.i_pos = i_pos;
+            return VLC_SUCCESS;
+        }
+        p_sys->stat.i_seek_count++;
+    }
+
     /* Check which stream we need to access */
     if( p_sys->i_list )
     {
@@ -0,0 +1,341 @@
+/*****************************************************************************
+ * stream_cache.c: byte range cache for the seekable streams
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+
+#include "stream_cache.h"
+
+/* Chunks are aligned on their size: the chunk of an offset is known */
+#define CACHE_CHUNK_SIZE (64 * 1024)
+
+/* So that a whole read of the stream is never evicted by itself */
+#define CACHE_CHUNK_MIN  16
+
+typedef struct
+{
+    uint64_t i_index;   /* Offset / CACHE_CHUNK_SIZE */
+    uint32_t i_start;   /* Valid data [i_start, i_end) within the chunk */
+    uint32_t i_end;
+    uint64_t i_date;    /* Last use */
+    bool     b_hint;    /* Stored for a hint and not read yet */
+
+    uint8_t *p_data;    /* In memory */
+    size_t   i_slot;    /* or in the file */
+} cache_chunk_t;
+
+struct stream_cache_t
+{
+    vlc_object_t  *p_obj;
+
+    /* Sorted by index */
+    cache_chunk_t *p_chunk;
+    size_t         i_chunk;
+    size_t         i_max;
+
+    uint64_t       i_date;
+    size_t         i_hint;  /* Chunks with b_hint set */
+
+    /* Temporary file, if not in memory */
+    int            fd;
+    char          *psz_file;
+};
+
+stream_cache_t *stream_CacheNew( vlc_object_t *p_obj, uint64_t i_size,
+                                 const char *psz_dir )
+{
+    stream_cache_t *c = malloc( sizeof( *c ) );
+    if( !c )
+        return NULL;
+
+    c->p_obj = p_obj;
+    c->i_chunk = 0;
+    c->i_max = __MAX( i_size / CACHE_CHUNK_SIZE, CACHE_CHUNK_MIN );
+    c->i_date = 0;
+    c->i_hint = 0;
+    c->fd = -1;
+    c->psz_file = NULL;
+
+    c->p_chunk = malloc( c->i_max * sizeof( *c->p_chunk ) );
+    if( !c->p_chunk )
+        goto error;
+
+    if( psz_dir )
+    {
+        if( asprintf( &c->psz_file, "%s"DIR_SEP"vlc-cache.XXXXXX",
+                      psz_dir ) < 0 )
+        {
+            c->psz_file = NULL;
+            goto error;
+        }
+        c->fd = vlc_mkstemp( c->psz_file );
+        if( c->fd < 0 )
+        {
+            msg_Err( p_obj, "cannot create the cache file in %s", psz_dir );
+            goto error;
+        }
+    }
+    return c;
+
+error:
+    free( c->psz_file );
+    free( c->p_chunk );
+    free( c );
+    return NULL;
+}
+
+void stream_CacheFlush( stream_cache_t *c )
+{
+    for( size_t i = 0; i < c->i_chunk; i++ )
+        free( c->p_chunk[i].p_data );
+    c->i_chunk = 0;
+    c->i_hint = 0;
+}
+
+void stream_CacheClearHints( stream_cache_t *c )
+{
+    for( size_t i = 0; i < c->i_chunk; i++ )
+        c->p_chunk[i].b_hint = false;
+    c->i_hint = 0;
+}
+
+void stream_CacheDelete( stream_cache_t *c )
+{
+    stream_CacheFlush( c );
+    if( c->fd >= 0 )
+    {
+        close( c->fd );
+        vlc_unlink( c->psz_file );
+    }
+    free( c->psz_file );
+    free( c->p_chunk );
+    free( c );
+}
+
+/* Returns the position of the chunk of index i_index, or where to insert it */
+static size_t CacheSearch( const stream_cache_t *c, uint64_t i_index,
+                           bool *pb_found )
+{
+    size_t i_low = 0, i_high = c->i_chunk;
+
+    while( i_low < i_high )
+    {
+        size_t i_mid = i_low + (i_high - i_low) / 2;
+
+        if( c->p_chunk[i_mid].i_index < i_index )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    *pb_found = i_low < c->i_chunk && c->p_chunk[i_low].i_index == i_index;
+    return i_low;
+}
+
+static void CacheRemove( stream_cache_t *c, size_t i )
+{
+    if( c->p_chunk[i].b_hint )
+        c->i_hint--;
+    memmove( &c->p_chunk[i], &c->p_chunk[i + 1],
+             (c->i_chunk - i - 1) * sizeof( *c->p_chunk ) );
+    c->i_chunk--;
+}
+
+/* Creates the chunk of index i_index at position i, reusing the storage of
+ * the least recently used one if the budget is used up */
+static cache_chunk_t *CacheInsert( stream_cache_t *c, size_t i,
+                                   uint64_t i_index )
+{
+    uint8_t *p_data = NULL;
+    size_t i_slot = c->i_chunk;
+
+    if( c->i_chunk >= c->i_max )
+    {
+        size_t i_victim = 0;
+
+        for( size_t j = 1; j < c->i_chunk; j++ )
+        {
+            const cache_chunk_t *v = &c->p_chunk[i_victim];
+            const cache_chunk_t *ck = &c->p_chunk[j];
+
+            if( ck->b_hint != v->b_hint ? !ck->b_hint : ck->i_date < v->i_date )
+                i_victim = j;
+        }
+        p_data = c->p_chunk[i_victim].p_data;
+        i_slot = c->p_chunk[i_victim].i_slot;
+        CacheRemove( c, i_victim );
+        if( i_victim < i )
+            i--;
+    }
+    else if( c->fd < 0 )
+    {
+        p_data = malloc( CACHE_CHUNK_SIZE );
+        if( !p_data )
+            return NULL;
+    }
+
+    memmove( &c->p_chunk[i + 1], &c->p_chunk[i],
+             (c->i_chunk - i) * sizeof( *c->p_chunk ) );
+    c->i_chunk++;
+
+    cache_chunk_t *ck = &c->p_chunk[i];
+    ck->i_index = i_index;
+    ck->i_start = ck->i_end = 0;
+    ck->i_date = 0;
+    ck->b_hint = false;
+    ck->p_data = p_data;
+    ck->i_slot = i_slot;
+    return ck;
+}
+
+static int CacheWrite( stream_cache_t *c, const cache_chunk_t *ck,
+                       unsigned i_offset, const void *p_data, size_t i_size )
+{
+    if( ck->p_data )
+    {
+        memcpy( &ck->p_data[i_offset], p_data, i_size );
+        return VLC_SUCCESS;
+    }
+
+    off_t i_pos = (off_t)ck->i_slot * CACHE_CHUNK_SIZE + i_offset;
+    if( lseek( c->fd, i_pos, SEEK_SET ) != i_pos ||
+        write( c->fd, p_data, i_size ) != (ssize_t)i_size )
+    {
+        msg_Err( c->p_obj, "cannot write the cache file: %s",
+                 vlc_strerror_c(errno) );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int CacheRead( stream_cache_t *c, const cache_chunk_t *ck,
+                      unsigned i_offset, void *p_data, size_t i_size )
+{
+    if( ck->p_data )
+    {
+        memcpy( p_data, &ck->p_data[i_offset], i_size );
+        return VLC_SUCCESS;
+    }
+
+    off_t i_pos = (off_t)ck->i_slot * CACHE_CHUNK_SIZE + i_offset;
+    if( lseek( c->fd, i_pos, SEEK_SET ) != i_pos ||
+        read( c->fd, p_data, i_size ) != (ssize_t)i_size )
+    {
+        msg_Err( c->p_obj, "cannot read the cache file: %s",
+                 vlc_strerror_c(errno) );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+void stream_CachePut( stream_cache_t *c, uint64_t i_pos,
+                      const void *p_data, size_t i_size, bool b_hint )
+{
+    const uint8_t *p = p_data;
+
+    while( i_size > 0 )
+    {
+        const uint64_t i_index = i_pos / CACHE_CHUNK_SIZE;
+        const unsigned i_start = i_pos % CACHE_CHUNK_SIZE;
+        const unsigned i_end = __MIN( CACHE_CHUNK_SIZE, i_start + i_size );
+        bool b_found;
+
+        size_t i = CacheSearch( c, i_index, &b_found );
+        cache_chunk_t *ck = b_found ? &c->p_chunk[i]
+                                    : CacheInsert( c, i, i_index );
+        if( !ck )
+            return;
+
+        if( CacheWrite( c, ck, i_start, p, i_end - i_start ) )
+        {
+            ck->i_start = ck->i_end = 0;
+            return;
+        }
+
+        /* A chunk holds a single interval: the new data replace the old
+         * ones if they are not contiguous */
+        if( i_end < ck->i_start || i_start > ck->i_end || ck->i_start == ck->i_end )
+        {
+            ck->i_start = i_start;
+            ck->i_end = i_end;
+        }
+        else
+        {
+            ck->i_start = __MIN( ck->i_start, i_start );
+            ck->i_end = __MAX( ck->i_end, i_end );
+        }
+        ck->i_date = ++c->i_date;
+        /* At most half of the budget is kept for hints, so that the reads
+         * meanwhile are not evicted by themselves */
+        if( b_hint && !ck->b_hint && c->i_hint < c->i_max / 2 )
+        {
+            ck->b_hint = true;
+            c->i_hint++;
+        }
+
+        p += i_end - i_start;
+        i_pos += i_end - i_start;
+        i_size -= i_end - i_start;
+    }
+}
+
+size_t stream_CacheGet( stream_cache_t *c, uint64_t i_pos,
+                        void *p_data, size_t i_size )
+{
+    uint8_t *p = p_data;
+    size_t i_done = 0;
+    bool b_found;
+
+    for( size_t i = CacheSearch( c, i_pos / CACHE_CHUNK_SIZE, &b_found );
+         b_found && i_done < i_size && i < c->i_chunk; i++ )
+    {
+        cache_chunk_t *ck = &c->p_chunk[i];
+        const uint64_t i_base = ck->i_index * CACHE_CHUNK_SIZE;
+        const uint64_t i_cur = i_pos + i_done;
+
+        /* The extent goes on in the next chunk only if it is full */
+        if( i_cur < i_base + ck->i_start || i_cur >= i_base + ck->i_end )
+            break;
+
+        size_t i_copy = __MIN( i_base + ck->i_end - i_cur, i_size - i_done );
+        if( p )
+        {
+            if( CacheRead( c, ck, i_cur - i_base, p, i_copy ) )
+                break;
+            p += i_copy;
+            ck->i_date = ++c->i_date;
+            if( ck->b_hint )
+            {
+                ck->b_hint = false;
+                c->i_hint--;
+            }
+        }
+        i_done += i_copy;
+    }
+    return i_done;
+}
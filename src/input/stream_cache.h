@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * stream_cache.h: byte range cache for the seekable streams
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_STREAM_CACHE_H
+#define LIBVLC_INPUT_STREAM_CACHE_H 1
+
+#include <vlc_common.h>
+
+/** @struct stream_cache_t
+ * This structure keeps byte ranges of a stream, at any offset, within a
+ * memory or temporary file budget.
+ *
+ * The cached extents are made of fixed size chunks, each holding one valid
+ * interval. When the budget is used up, the least recently used chunks are
+ * dropped first, and the ones fetched for a hint but not read yet last.
+ * At most half of the budget is kept for hints.
+ *
+ * XXX It is not thread safe.
+ */
+typedef struct stream_cache_t stream_cache_t;
+
+/**
+ * This function creates a new stream_cache_t of i_size bytes.
+ *
+ * The data are kept in a temporary file in the psz_dir directory, or in
+ * memory if psz_dir is NULL.
+ */
+stream_cache_t *stream_CacheNew( vlc_object_t *, uint64_t i_size,
+                                 const char *psz_dir );
+
+/**
+ * This function destroys a stream_cache_t created by stream_CacheNew.
+ */
+void stream_CacheDelete( stream_cache_t * );
+
+/**
+ * This function drops all the cached data.
+ */
+void stream_CacheFlush( stream_cache_t * );
+
+/**
+ * This function makes the data fetched for hints ordinary cached data, to
+ * be dropped in least recently used order.
+ */
+void stream_CacheClearHints( stream_cache_t * );
+
+/**
+ * This function stores i_size bytes read at offset i_pos.
+ *
+ * b_hint marks them as asked for ahead of time, so they are kept until read
+ * or until stream_CacheClearHints() is called.
+ */
+void stream_CachePut( stream_cache_t *, uint64_t i_pos,
+                      const void *p_data, size_t i_size, bool b_hint );
+
+/**
+ * This function copies at most i_size bytes cached from offset i_pos, up to
+ * the first missing one, and returns how many there were.
+ *
+ * If p_data is NULL, it only returns how many bytes could be copied.
+ */
+size_t stream_CacheGet( stream_cache_t *, uint64_t i_pos,
+                        void *p_data, size_t i_size );
+
+#endif
@@ -467,6 +467,8 @@ void input_ConfigVarInit ( input_thread_t *p_input )
 
         var_Create( p_input, "input-slave",
                     VLC_VAR_STRING | VLC_VAR_DOINHERIT );
+        var_Create( p_input, "input-slave-threads",
+                    VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
 
         var_Create( p_input, "audio-desync",
                     VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
@@ -85,6 +85,18 @@ static const char *const ppsz_snap_formats[] =
     "This is the verbosity level (0=only errors and " \
     "standard messages, 1=warnings, 2=debug).")
 
+#define VERBOSE_MODULES_TEXT N_("Per-module verbosity")
+#define VERBOSE_MODULES_LONGTEXT N_( \
+    "Comma-separated list of module=level pairs overriding the verbosity " \
+    "level for the given modules, e.g. \"ts=0,avcodec=2\". Messages " \
+    "filtered out are discarded before being formatted.")
+
+#define LOG_ASYNC_TEXT N_("Asynchronous logging")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Format messages into per-thread buffers and output them from a " \
+    "dedicated thread, so that emitting threads never wait for the log " \
+    "output. Messages are dropped (and counted) if the buffers overflow.")
+
 #define QUIET_TEXT N_("Be quiet")
 #define QUIET_LONGTEXT N_( \
     "Turn off all warning and information messages.")
@@ -404,6 +416,12 @@ static const char *const ppsz_pos_descriptions[] =
 #define SNAP_SEQUENTIAL_LONGTEXT N_( \
     "Use sequential numbers instead of timestamps for snapshot numbering")
 
+#define SNAP_ASYNC_TEXT N_("Write video snapshots in the background")
+#define SNAP_ASYNC_LONGTEXT N_( \
+    "Encode and write video snapshots in a background thread. The " \
+    "snapshot request returns as soon as the picture is grabbed, before " \
+    "the file is written.")
+
 #define SNAP_WIDTH_TEXT N_("Video snapshot width")
 #define SNAP_WIDTH_LONGTEXT N_( \
     "You can enforce the width of the video snapshot. By default " \
@@ -528,6 +546,13 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define LOW_DELAY_TEXT N_("Low delay")
+#define LOW_DELAY_LONGTEXT N_( \
+    "This keeps the delay of live streams as low as their jitter allows: " \
+    "the caching is lowered to what the measured jitter requires, late " \
+    "pictures and decoder backlogs are dropped, and the audio catches up " \
+    "by resampling instead of inserting silence." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -656,6 +681,11 @@ static const char *const ppsz_prefres[] = {
     "the same time. This feature is experimental, not all formats " \
     "are supported. Use a '#' separated list of inputs.")
 
+#define INPUT_SLAVE_THREADS_TEXT N_("Demux the slaves on their own threads")
+#define INPUT_SLAVE_THREADS_LONGTEXT N_( \
+    "Each input slave and subtitle file is demuxed by a thread of its " \
+    "own, so that a slow one does not delay the main input.")
+
 #define BOOKMARKS_TEXT N_("Bookmarks list for a stream")
 #define BOOKMARKS_LONGTEXT N_( \
     "You can manually give a list of bookmarks for a stream in " \
@@ -680,6 +710,17 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_CACHE_SIZE_TEXT N_("Byte range cache size (KiB)")
+#define INPUT_CACHE_SIZE_LONGTEXT N_( \
+    "Amount of data read from the seekable network streams that is kept, " \
+    "so that the demuxers can move back and forth within them without " \
+    "new requests. 0 disables the cache." )
+
+#define INPUT_CACHE_PATH_TEXT N_("Byte range cache directory")
+#define INPUT_CACHE_PATH_LONGTEXT N_( \
+    "Directory of the temporary files where the byte range cache is " \
+    "kept. If empty, it is kept in memory." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -1032,6 +1073,16 @@ static const char *const ppsz_prefres[] = {
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
 
+#define TRACE_TEXT N_("Record trace events")
+#define TRACE_LONGTEXT N_( \
+     "Record timestamped spans of the demux, decoder, video filter, " \
+     "display and audio output processing, for performance analysis.")
+
+#define TRACE_FILE_TEXT N_("Trace file")
+#define TRACE_FILE_LONGTEXT N_( \
+     "Write the recorded trace events to this file when exiting, in " \
+     "Chrome/Perfetto trace event JSON format. This implies --trace.")
+
 #define DAEMON_TEXT N_("Run as daemon process")
 #define DAEMON_LONGTEXT N_( \
      "Runs VLC as a background daemon process.")
@@ -1546,6 +1597,8 @@ vlc_module_begin ()
               SNAP_PREVIEW_LONGTEXT, false )
     add_bool( "snapshot-sequential", false, SNAP_SEQUENTIAL_TEXT,
               SNAP_SEQUENTIAL_LONGTEXT, false )
+    add_bool( "snapshot-async", false, SNAP_ASYNC_TEXT,
+              SNAP_ASYNC_LONGTEXT, true )
     add_integer( "snapshot-width", -1, SNAP_WIDTH_TEXT,
                  SNAP_WIDTH_LONGTEXT, true )
     add_integer( "snapshot-height", -1, SNAP_HEIGHT_TEXT,
@@ -1703,6 +1756,8 @@ vlc_module_begin ()
                  INPUT_LIST_TEXT, INPUT_LIST_LONGTEXT, true )
     add_string( "input-slave", NULL,
                  INPUT_SLAVE_TEXT, INPUT_SLAVE_LONGTEXT, true )
+    add_bool( "input-slave-threads", false,
+              INPUT_SLAVE_THREADS_TEXT, INPUT_SLAVE_THREADS_LONGTEXT, true )
 
     add_string( "bookmarks", NULL,
                  BOOKMARKS_TEXT, BOOKMARKS_LONGTEXT, true )
@@ -1833,6 +1888,9 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "low-delay", false, LOW_DELAY_TEXT,
+              LOW_DELAY_LONGTEXT, true )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1847,6 +1905,12 @@ vlc_module_begin ()
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
 
+    add_integer( "input-cache-size", 0, INPUT_CACHE_SIZE_TEXT,
+                 INPUT_CACHE_SIZE_LONGTEXT, true )
+        change_integer_range( 0, 4 * 1024 * 1024 )
+    add_directory( "input-cache-path", NULL, INPUT_CACHE_PATH_TEXT,
+                INPUT_CACHE_PATH_LONGTEXT, true )
+
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
 /* Decoder options */
@@ -2034,6 +2098,11 @@ vlc_module_begin ()
         change_short('v')
         change_volatile ()
     add_obsolete_string( "verbose-objects" ) /* since 2.1.0 */
+    add_string( "verbose-modules", NULL, VERBOSE_MODULES_TEXT,
+                VERBOSE_MODULES_LONGTEXT, true )
+        change_volatile ()
+    add_bool( "log-async", false, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
+        change_volatile ()
     add_bool( "quiet", 0, QUIET_TEXT, QUIET_LONGTEXT, false )
         change_short('q')
         change_volatile ()
@@ -2065,6 +2134,9 @@ vlc_module_begin ()
               INTERACTION_LONGTEXT, false )
 
     add_bool ( "stats", false, STATS_TEXT, STATS_LONGTEXT, true )
+    add_bool ( "trace", false, TRACE_TEXT, TRACE_LONGTEXT, true )
+    add_savefile( "trace-file", NULL, TRACE_FILE_TEXT, TRACE_FILE_LONGTEXT,
+                  true )
 
     set_subcategory( SUBCAT_INTERFACE_MAIN )
     add_module_cat( "intf", SUBCAT_INTERFACE_MAIN, NULL, INTF_TEXT,
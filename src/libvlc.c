@@ -69,6 +69,7 @@
 #include "libvlc.h"
 #include "playlist/playlist_internal.h"
 #include "misc/variables.h"
+#include "misc/trace.h"
 
 #include <vlc_vlm.h>
 
@@ -100,6 +101,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
 
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
+    priv->executor = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
 
@@ -349,12 +351,18 @@ dbus_out:
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    vlc_trace_Init( p_libvlc );
 
     /*
      * Initialize hotkey handling
      */
     priv->actions = vlc_InitActions( p_libvlc );
 
+    /*
+     * Background tasks
+     */
+    priv->executor = vlc_executor_New( 0 );
+
     /*
      * Meta data handling
      */
@@ -544,6 +552,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
+    if (priv->executor != NULL)
+        vlc_executor_Delete(priv->executor);
 
     vlc_DeinitActions( p_libvlc, priv->actions );
 
@@ -551,6 +561,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    vlc_trace_Deinit( p_libvlc );
+
     /* Free module bank. It is refcounted, so we call this each time  */
     module_EndBank (true);
     vlc_LogDeinit (p_libvlc);
@@ -25,6 +25,8 @@
 #ifndef LIBVLC_LIBVLC_H
 # define LIBVLC_LIBVLC_H 1
 
+#include <vlc_atomic.h>
+
 extern const char psz_vlc_changeset[];
 
 typedef struct variable_t variable_t;
@@ -151,8 +153,15 @@ typedef struct libvlc_priv_t
         void *opaque;
         signed char verbose;
         vlc_rwlock_t lock;
+        atomic_int sink_verbose; /**< Verbosity of the message callback */
+        atomic_int threshold; /**< Highest verbosity of any module */
+        struct vlc_log_filter *filters; /**< Per-module verbosity */
+        size_t filters_count;
+        struct vlc_log_async *async; /**< Deferred sink or NULL */
     } log;
     bool               b_stats;     ///< Whether to collect stats
+    struct vlc_tracer *tracer;      ///< Trace events recorder (or NULL)
+    vlc_executor_t    *executor;    ///< Shared thread pool (or NULL)
 
     /* Singleton objects */
     vlm_t             *p_vlm;  ///< the VLM singleton (or NULL)
@@ -37,6 +37,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 
 /**
  * @section Block handling functions.
@@ -148,6 +149,141 @@ block_t *block_Alloc (size_t size)
     return b;
 }
 
+/**
+ * @section Shared payloads
+ *
+ * A shared block is a header of its own pointing to the payload of another
+ * block, the owner, which is released with the last reference.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *owner;
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub (&payload->refs, 1) == 1)
+    {
+        block_Release (payload->owner);
+        free (payload);
+    }
+}
+
+/* Whether other blocks refer to the same payload */
+static bool block_IsShared (const block_t *block)
+{
+    return block->pf_release == block_shared_Release
+        && atomic_load (&((const block_shared_t *)block)->payload->refs) > 1;
+}
+
+static block_t *block_shared_New (block_payload_t *payload, const block_t *from)
+{
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+        return NULL;
+
+    block_t *block = &shared->self;
+    block_Init (block, payload->owner->p_start, payload->owner->i_size);
+    BlockMetaCopy (block, from);
+    block->p_next = NULL;
+    block->p_buffer = from->p_buffer;
+    block->i_buffer = from->i_buffer;
+    block->pf_release = block_shared_Release;
+    shared->payload = payload;
+    return block;
+}
+
+/**
+ * Makes the payload of a block shareable.
+ *
+ * The block is replaced by one with the same payload and properties, from
+ * which block_Share() can then create references without copying.
+ * This is a no-op if the block is already shareable.
+ *
+ * @return the shareable block, or NULL on error (the block is then released)
+ */
+block_t *block_Shareable (block_t *block)
+{
+    block_Check (block);
+    if (block->pf_release == block_shared_Release)
+        return block;
+
+    block_payload_t *payload = malloc (sizeof (*payload));
+    if (unlikely(payload == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+    atomic_init (&payload->refs, 1);
+    payload->owner = block;
+
+    block_t *shared = block_shared_New (payload, block);
+    if (unlikely(shared == NULL))
+    {
+        free (payload);
+        block_Release (block);
+        return NULL;
+    }
+    shared->p_next = block->p_next;
+    block->p_next = NULL;
+    return shared;
+}
+
+/**
+ * Creates another reference to the payload of a shareable block.
+ *
+ * The new block has a copy of the properties of the given one, and may
+ * change them freely. The payload must not be modified in place as long as
+ * it is shared, see block_Writable().
+ *
+ * @param block a block returned by block_Shareable() or block_Share()
+ * @return the new block, or NULL on error
+ */
+block_t *block_Share (block_t *block)
+{
+    assert (block->pf_release == block_shared_Release);
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+
+    atomic_fetch_add (&payload->refs, 1);
+    block_t *dup = block_shared_New (payload, block);
+    if (unlikely(dup == NULL))
+        atomic_fetch_sub (&payload->refs, 1); /* cannot be the last one */
+    return dup;
+}
+
+/**
+ * Gets a block whose payload can be modified in place.
+ *
+ * @return the block itself if its payload is not shared, else a private
+ * copy of it (the block is then released), or NULL on error
+ */
+block_t *block_Writable (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *copy = block_Alloc (block->i_buffer);
+    if (likely(copy != NULL))
+    {
+        BlockMetaCopy (copy, block);
+        memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+    }
+    block_Release (block);
+    return copy;
+}
+
 block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
 {
     size_t requested = i_prebody + i_body;
@@ -170,7 +306,7 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
          p_block->i_buffer = 0; /* discard current payload */
     if( p_block->i_buffer == 0 )
     {
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !block_IsShared( p_block ) )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -205,11 +341,13 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     uint8_t *p_start = p_block->p_start;
     uint8_t *p_end = p_start + p_block->i_size;
 
-    /* Second, reallocate the buffer if we lack space. This is done now to
-     * minimize the payload size for memory copy. */
+    /* Second, reallocate the buffer if we lack space, or if the payload is
+     * shared and must thus not be modified. This is done now to minimize the
+     * payload size for memory copy. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || block_IsShared( p_block ) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
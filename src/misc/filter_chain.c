@@ -30,6 +30,7 @@
 #include <vlc_spu.h>
 #include <libvlc.h>
 #include <assert.h>
+#include "trace.h"
 
 typedef struct chained_filter_t
 {
@@ -385,7 +386,8 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
-picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
+static picture_t *FilterChainVideoFilterPending( filter_chain_t *p_chain,
+                                                 picture_t *p_pic )
 {
     if( p_pic )
     {
@@ -408,6 +410,18 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
+{
+    if( p_chain->first == NULL )
+        return FilterChainVideoFilterPending( p_chain, p_pic );
+
+    filter_t *p_first = &p_chain->first->filter;
+    mtime_t trace = vlc_trace_Begin( p_first );
+    p_pic = FilterChainVideoFilterPending( p_chain, p_pic );
+    vlc_trace_End( p_first, "video filter", trace );
+    return p_pic;
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
@@ -68,6 +68,308 @@ static void Win32DebugOutputMsg (void *, int , const vlc_log_t *,
                                  const char *, va_list);
 #endif
 
+/**
+ * Per-module verbosity override (see --verbose-modules).
+ */
+struct vlc_log_filter
+{
+    char module[32];
+    signed char verbose;
+};
+
+static bool LogVerbosityAllows (int verbose, int type)
+{
+    return verbose >= 0 && verbose >= (type - VLC_MSG_ERR);
+}
+
+/*** Deferred (asynchronous) message delivery ***/
+
+#define LOG_RING_SIZE  64 /* must be a power of two */
+#define LOG_TEXT_SIZE 384
+
+/**
+ * One formatted message, waiting to be passed to the message callback.
+ * Everything is copied, as the emitter may be gone by the time the message
+ * is delivered.
+ */
+typedef struct
+{
+    uintptr_t object_id;
+    int type;
+    char object_type[24];
+    char module[32];
+    char header[48];
+    char text[LOG_TEXT_SIZE];
+} vlc_log_slot_t;
+
+/**
+ * Single producer, single consumer messages ring. There is one such ring per
+ * emitting thread and per LibVLC instance, so the emitter never takes a lock.
+ */
+typedef struct vlc_log_ring
+{
+    struct vlc_log_ring *next;
+    atomic_uint head; /**< Written by the emitting thread only */
+    atomic_uint tail; /**< Written by the delivery thread only */
+    atomic_bool dead; /**< The emitting thread has exited */
+    vlc_log_slot_t slots[LOG_RING_SIZE];
+} vlc_log_ring_t;
+
+struct vlc_log_async
+{
+    vlc_threadvar_t key; /**< Ring of the calling thread */
+    vlc_mutex_t list_lock; /**< Protects the rings list linkage */
+    vlc_mutex_t drain_lock; /**< Serializes the consumers */
+    vlc_log_ring_t *rings;
+    vlc_sem_t wait;
+    vlc_thread_t thread;
+    atomic_bool stop;
+    atomic_uint dropped; /**< Messages dropped since last report */
+    unsigned long dropped_total;
+};
+
+static void LogRingRelease (void *data)
+{
+    vlc_log_ring_t *ring = data;
+
+    /* The ring is freed by the consumer once it has been drained */
+    atomic_store_explicit (&ring->dead, true, memory_order_release);
+}
+
+static vlc_log_ring_t *LogRingGet (struct vlc_log_async *async)
+{
+    vlc_log_ring_t *ring = vlc_threadvar_get (async->key);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc (sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+    atomic_init (&ring->head, 0);
+    atomic_init (&ring->tail, 0);
+    atomic_init (&ring->dead, false);
+
+    vlc_mutex_lock (&async->list_lock);
+    ring->next = async->rings;
+    async->rings = ring;
+    vlc_mutex_unlock (&async->list_lock);
+
+    vlc_threadvar_set (async->key, ring);
+    return ring;
+}
+
+static void LogStrCopy (char *dst, const char *src, size_t size)
+{
+    if (src == NULL)
+        src = "";
+    strncpy (dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+/**
+ * Formats a message into the calling thread ring.
+ * This never blocks: if the ring is full, the message is counted and dropped.
+ */
+static void LogQueue (struct vlc_log_async *async, int type,
+                      const vlc_log_t *msg, const char *format, va_list args)
+{
+    vlc_log_ring_t *ring = LogRingGet (async);
+    if (unlikely(ring == NULL))
+        goto drop;
+
+    unsigned head = atomic_load_explicit (&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit (&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SIZE)
+        goto drop;
+
+    vlc_log_slot_t *slot = &ring->slots[head & (LOG_RING_SIZE - 1)];
+    slot->object_id = msg->i_object_id;
+    slot->type = type;
+    LogStrCopy (slot->object_type, msg->psz_object_type,
+                sizeof (slot->object_type));
+    LogStrCopy (slot->module, msg->psz_module, sizeof (slot->module));
+    if (msg->psz_header != NULL)
+        LogStrCopy (slot->header, msg->psz_header, sizeof (slot->header));
+    else
+        slot->header[0] = '\0';
+    if (vsnprintf (slot->text, sizeof (slot->text), format, args)
+                                                  >= (int)sizeof (slot->text))
+    {   /* Mark the truncation, without splitting an UTF-8 sequence */
+        size_t len = sizeof (slot->text) - 4;
+
+        while (len > 0 && (slot->text[len] & 0xC0) == 0x80)
+            len--;
+        strcpy (slot->text + len, "...");
+    }
+
+    atomic_store_explicit (&ring->head, head + 1, memory_order_release);
+    vlc_sem_post (&async->wait);
+    return;
+drop:
+    atomic_fetch_add_explicit (&async->dropped, 1, memory_order_relaxed);
+}
+
+static void LogDeliver (libvlc_priv_t *priv, int type, const vlc_log_t *msg,
+                        const char *format, ...)
+{
+    va_list ap;
+
+    va_start (ap, format);
+    priv->log.cb (priv->log.opaque, type, msg, format, ap);
+    va_end (ap);
+}
+
+/**
+ * Passes all queued messages to the message callback.
+ * \note The caller must hold the log lock, for reading or writing.
+ */
+static void LogDrain (libvlc_priv_t *priv)
+{
+    struct vlc_log_async *async = priv->log.async;
+
+    vlc_mutex_lock (&async->drain_lock);
+    vlc_mutex_lock (&async->list_lock);
+    vlc_log_ring_t *ring = async->rings;
+    vlc_mutex_unlock (&async->list_lock);
+
+    while (ring != NULL)
+    {
+        bool dead = atomic_load_explicit (&ring->dead, memory_order_acquire);
+        unsigned head = atomic_load_explicit (&ring->head,
+                                              memory_order_acquire);
+        unsigned tail = atomic_load_explicit (&ring->tail,
+                                              memory_order_relaxed);
+
+        while (tail != head)
+        {
+            const vlc_log_slot_t *slot =
+                &ring->slots[tail & (LOG_RING_SIZE - 1)];
+            vlc_log_t msg = {
+                .i_object_id = slot->object_id,
+                .psz_object_type = slot->object_type,
+                .psz_module = slot->module,
+                .psz_header = slot->header[0] ? slot->header : NULL,
+            };
+
+            LogDeliver (priv, slot->type, &msg, "%s", slot->text);
+            atomic_store_explicit (&ring->tail, ++tail, memory_order_release);
+        }
+
+        vlc_mutex_lock (&async->list_lock);
+        vlc_log_ring_t *next = ring->next;
+        if (dead)
+        {   /* The owner thread is gone: nobody can write there anymore.
+             * New rings may have been prepended meanwhile, so look for the
+             * predecessor again. */
+            vlc_log_ring_t **pp = &async->rings;
+
+            while (*pp != ring)
+                pp = &(*pp)->next;
+            *pp = next;
+            free (ring);
+        }
+        ring = next;
+        vlc_mutex_unlock (&async->list_lock);
+    }
+
+    unsigned dropped = atomic_exchange_explicit (&async->dropped, 0,
+                                                 memory_order_relaxed);
+    if (dropped > 0)
+    {
+        vlc_log_t msg = {
+            .i_object_id = (uintptr_t)&priv->public_data,
+            .psz_object_type = "libvlc",
+            .psz_module = "core",
+            .psz_header = NULL,
+        };
+
+        async->dropped_total += dropped;
+        LogDeliver (priv, VLC_MSG_WARN, &msg,
+                    "%u log message(s) dropped (%lu in total)", dropped,
+                    async->dropped_total);
+    }
+    vlc_mutex_unlock (&async->drain_lock);
+}
+
+static void *LogThread (void *data)
+{
+    libvlc_priv_t *priv = data;
+    struct vlc_log_async *async = priv->log.async;
+
+    for (;;)
+    {
+        vlc_sem_wait (&async->wait);
+        if (atomic_load_explicit (&async->stop, memory_order_acquire))
+            break;
+
+        int canc = vlc_savecancel ();
+        vlc_rwlock_rdlock (&priv->log.lock);
+        LogDrain (priv);
+        vlc_rwlock_unlock (&priv->log.lock);
+        vlc_restorecancel (canc);
+    }
+    return NULL;
+}
+
+static struct vlc_log_async *LogAsyncCreate (libvlc_priv_t *priv)
+{
+    struct vlc_log_async *async = malloc (sizeof (*async));
+    if (unlikely(async == NULL))
+        return NULL;
+
+    if (vlc_threadvar_create (&async->key, LogRingRelease))
+    {
+        free (async);
+        return NULL;
+    }
+    vlc_mutex_init (&async->list_lock);
+    vlc_mutex_init (&async->drain_lock);
+    async->rings = NULL;
+    vlc_sem_init (&async->wait, 0);
+    atomic_init (&async->stop, false);
+    atomic_init (&async->dropped, 0);
+    async->dropped_total = 0;
+
+    priv->log.async = async;
+    if (vlc_clone (&async->thread, LogThread, priv, VLC_THREAD_PRIORITY_LOW))
+    {
+        priv->log.async = NULL;
+        vlc_sem_destroy (&async->wait);
+        vlc_mutex_destroy (&async->drain_lock);
+        vlc_mutex_destroy (&async->list_lock);
+        vlc_threadvar_delete (&async->key);
+        free (async);
+        return NULL;
+    }
+    return async;
+}
+
+static void LogAsyncDestroy (libvlc_priv_t *priv)
+{
+    struct vlc_log_async *async = priv->log.async;
+
+    atomic_store_explicit (&async->stop, true, memory_order_release);
+    vlc_sem_post (&async->wait);
+    vlc_join (async->thread, NULL);
+
+    /* Flush whatever is left, then stop deferring. */
+    vlc_rwlock_wrlock (&priv->log.lock);
+    LogDrain (priv);
+    priv->log.async = NULL;
+    vlc_rwlock_unlock (&priv->log.lock);
+
+    for (vlc_log_ring_t *ring = async->rings, *next; ring != NULL; ring = next)
+    {
+        next = ring->next;
+        free (ring);
+    }
+    vlc_threadvar_delete (&async->key);
+    vlc_sem_destroy (&async->wait);
+    vlc_mutex_destroy (&async->drain_lock);
+    vlc_mutex_destroy (&async->list_lock);
+    free (async);
+}
+
 /**
  * Emit a log message. This function is the variable argument list equivalent
  * to vlc_Log().
@@ -78,6 +380,15 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
     if (obj != NULL && obj->i_flags & OBJECT_FLAGS_QUIET)
         return;
 
+    libvlc_priv_t *priv = obj ? libvlc_priv (obj->p_libvlc) : NULL;
+
+    /* Discard unwanted messages before doing anything costly */
+    if (priv != NULL
+     && !LogVerbosityAllows (atomic_load_explicit (&priv->log.threshold,
+                                                   memory_order_relaxed),
+                             type))
+        return;
+
     /* Get basename from the module filename */
     char *p = strrchr(module, '/');
     if (p != NULL)
@@ -93,6 +404,21 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
         module = modulebuf;
     }
 
+    if (priv != NULL)
+    {
+        int verbose = atomic_load_explicit (&priv->log.sink_verbose,
+                                            memory_order_relaxed);
+
+        for (size_t i = 0; i < priv->log.filters_count; i++)
+            if (!strcmp (priv->log.filters[i].module, module))
+            {
+                verbose = priv->log.filters[i].verbose;
+                break;
+            }
+        if (!LogVerbosityAllows (verbose, type))
+            return;
+    }
+
     /* Fill message information fields */
     vlc_log_t msg;
 
@@ -108,9 +434,6 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
             break;
         }
 
-    /* Pass message to the callback */
-    libvlc_priv_t *priv = obj ? libvlc_priv (obj->p_libvlc) : NULL;
-
 #ifdef _WIN32
     va_list ap;
 
@@ -119,11 +442,20 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
     va_end (ap);
 #endif
 
-    if (priv) {
-        vlc_rwlock_rdlock (&priv->log.lock);
-        priv->log.cb (priv->log.opaque, type, &msg, format, args);
-        vlc_rwlock_unlock (&priv->log.lock);
+    if (priv == NULL)
+        return;
+
+    /* Defer formatting and output to the logging thread if requested */
+    if (priv->log.async != NULL)
+    {
+        LogQueue (priv->log.async, type, &msg, format, args);
+        return;
     }
+
+    /* Pass message to the callback */
+    vlc_rwlock_rdlock (&priv->log.lock);
+    priv->log.cb (priv->log.opaque, type, &msg, format, args);
+    vlc_rwlock_unlock (&priv->log.lock);
 }
 
 static const char msg_type[4][9] = { "", " error", " warning", " debug" };
@@ -142,11 +474,8 @@ static void PrintColorMsg (void *d, int type, const vlc_log_t *p_item,
                            const char *format, va_list ap)
 {
     FILE *stream = stderr;
-    int verbose = (intptr_t)d;
-
-    if (verbose < 0 || verbose < (type - VLC_MSG_ERR))
-        return;
 
+    VLC_UNUSED(d);
     int canc = vlc_savecancel ();
 
     flockfile (stream);
@@ -168,11 +497,8 @@ static void PrintMsg (void *d, int type, const vlc_log_t *p_item,
                       const char *format, va_list ap)
 {
     FILE *stream = stderr;
-    int verbose = (intptr_t)d;
-
-    if (verbose < 0 || verbose < (type - VLC_MSG_ERR))
-        return;
 
+    VLC_UNUSED(d);
     int canc = vlc_savecancel ();
 
     flockfile (stream);
@@ -235,12 +561,9 @@ static void Win32DebugOutputMsg (void* d, int type, const vlc_log_t *p_item,
 static void AndroidPrintMsg (void *d, int type, const vlc_log_t *p_item,
                              const char *format, va_list ap)
 {
-    int verbose = (intptr_t)d;
     int prio;
 
-    if (verbose < 0 || verbose < (type - VLC_MSG_ERR))
-        return;
-
+    VLC_UNUSED(d);
     int canc = vlc_savecancel ();
 
     char *format2;
@@ -276,6 +599,7 @@ static void AndroidPrintMsg (void *d, int type, const vlc_log_t *p_item,
 void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
+    int verbose = 2; /* custom callbacks do their own filtering */
 
     if (cb == NULL)
     {
@@ -290,11 +614,24 @@ void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
             cb = PrintMsg;
 #endif // __ANDROID__
         opaque = (void *)(intptr_t)priv->log.verbose;
+        verbose = priv->log.verbose;
     }
 
+    int threshold = verbose;
+    for (size_t i = 0; i < priv->log.filters_count; i++)
+        if (priv->log.filters[i].verbose > threshold)
+            threshold = priv->log.filters[i].verbose;
+
     vlc_rwlock_wrlock (&priv->log.lock);
+    /* Messages queued so far belong to the previous callback */
+    if (priv->log.async != NULL)
+        LogDrain (priv);
     priv->log.cb = cb;
     priv->log.opaque = opaque;
+    atomic_store_explicit (&priv->log.sink_verbose, verbose,
+                           memory_order_relaxed);
+    atomic_store_explicit (&priv->log.threshold, threshold,
+                           memory_order_relaxed);
     vlc_rwlock_unlock (&priv->log.lock);
 
     /* Announce who we are */
@@ -304,6 +641,42 @@ void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     msg_Dbg (vlc, "configured with %s", CONFIGURE_LINE);
 }
 
+/**
+ * Parses the per-module verbosity list, e.g. "ts=0,avcodec=2".
+ */
+static void LogFiltersInit (libvlc_priv_t *priv, const char *list)
+{
+    priv->log.filters = NULL;
+    priv->log.filters_count = 0;
+
+    if (list == NULL)
+        return;
+
+    char *dup = strdup (list), *saveptr;
+    if (unlikely(dup == NULL))
+        return;
+
+    for (char *item = strtok_r (dup, ",", &saveptr); item != NULL;
+         item = strtok_r (NULL, ",", &saveptr))
+    {
+        char *eq = strchr (item, '=');
+        if (eq == NULL || eq == item)
+            continue;
+        *eq = '\0';
+
+        struct vlc_log_filter *tab = realloc (priv->log.filters,
+                    (priv->log.filters_count + 1) * sizeof (*tab));
+        if (unlikely(tab == NULL))
+            break;
+
+        struct vlc_log_filter *f = &tab[priv->log.filters_count++];
+        LogStrCopy (f->module, item, sizeof (f->module));
+        f->verbose = atoi (eq + 1);
+        priv->log.filters = tab;
+    }
+    free (dup);
+}
+
 void vlc_LogInit (libvlc_int_t *vlc)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
@@ -317,7 +690,16 @@ void vlc_LogInit (libvlc_int_t *vlc)
     else
         priv->log.verbose = var_InheritInteger (vlc, "verbose");
 
+    char *filters = var_InheritString (vlc, "verbose-modules");
+    LogFiltersInit (priv, filters);
+    free (filters);
+
     vlc_rwlock_init (&priv->log.lock);
+    atomic_init (&priv->log.sink_verbose, priv->log.verbose);
+    atomic_init (&priv->log.threshold, priv->log.verbose);
+    priv->log.async = NULL;
+    if (var_InheritBool (vlc, "log-async"))
+        LogAsyncCreate (priv);
     vlc_LogSet (vlc, NULL, NULL);
 }
 
@@ -325,5 +707,8 @@ void vlc_LogDeinit (libvlc_int_t *vlc)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
 
+    if (priv->log.async != NULL)
+        LogAsyncDestroy (priv);
     vlc_rwlock_destroy (&priv->log.lock);
+    free (priv->log.filters);
 }
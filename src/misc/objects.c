@@ -386,6 +386,14 @@ void ObjectKillChildrens( vlc_object_t *p_obj )
     /* FIXME ObjectKillChildrens seems a very bad idea in fact */
     /*if( p_obj == VLC_OBJECT(p_input->p->p_sout) ) return;*/
 
+    /* The children are killed first: a thread woken up by the waitpipe of
+     * an object (e.g. an access) must find the objects it reads for (e.g. the
+     * stream) dead already, or it would wait again */
+    vlc_list_t *p_list = vlc_list_children( p_obj );
+    for( int i = 0; i < p_list->i_count; i++ )
+        ObjectKillChildrens( p_list->p_values[i].p_object );
+    vlc_list_release( p_list );
+
     vlc_object_internals_t *priv = vlc_internals (p_obj);
     if (atomic_exchange (&priv->alive, false))
     {
@@ -400,11 +408,6 @@ void ObjectKillChildrens( vlc_object_t *p_obj )
             msg_Dbg (p_obj, "object waitpipe triggered");
         }
     }
-
-    vlc_list_t *p_list = vlc_list_children( p_obj );
-    for( int i = 0; i < p_list->i_count; i++ )
-        ObjectKillChildrens( p_list->p_values[i].p_object );
-    vlc_list_release( p_list );
 }
 
 
@@ -23,8 +23,11 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
 
 #include <vlc_common.h>
+#include "../libvlc.h"
 
 /*** Global locks ***/
 
@@ -173,3 +176,333 @@ void vlc_sem_wait (vlc_sem_t *sem)
     vlc_cleanup_run ();
 }
 #endif /* LIBVLC_NEED_SEMAPHORE */
+
+/*** Thread pool ***/
+
+/* How long an idle worker thread waits for a task before exiting */
+#define EXECUTOR_IDLE_TIMEOUT (5 * CLOCK_FREQ)
+
+struct vlc_executor
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /**< Signaled when a task is queued */
+    vlc_cond_t done; /**< Signaled when a task or a thread completes */
+    vlc_task_t *ready[VLC_TASK_PRIORITY_COUNT]; /**< Ready tasks FIFOs */
+    vlc_task_t **ready_tail[VLC_TASK_PRIORITY_COUNT];
+    vlc_task_t *timers; /**< Delayed tasks, sorted by date */
+    unsigned threads; /**< Live worker threads */
+    unsigned idle; /**< Worker threads waiting for a task */
+    unsigned max_threads;
+    bool closing;
+};
+
+static void vlc_executor_QueueReady(vlc_executor_t *ex, vlc_task_t *task)
+{
+    task->next = NULL;
+    *(ex->ready_tail[task->priority]) = task;
+    ex->ready_tail[task->priority] = &task->next;
+}
+
+static bool vlc_executor_HasReady(const vlc_executor_t *ex)
+{
+    for (unsigned i = 0; i < VLC_TASK_PRIORITY_COUNT; i++)
+        if (ex->ready[i] != NULL)
+            return true;
+    return false;
+}
+
+static vlc_task_t *vlc_executor_DequeueReady(vlc_executor_t *ex)
+{
+    for (int prio = VLC_TASK_PRIORITY_COUNT - 1; prio >= 0; prio--)
+    {
+        vlc_task_t *task = ex->ready[prio];
+        if (task == NULL)
+            continue;
+
+        ex->ready[prio] = task->next;
+        if (task->next == NULL)
+            ex->ready_tail[prio] = &ex->ready[prio];
+        return task;
+    }
+    return NULL;
+}
+
+/* Removes a task from a singly linked list; returns false if not found */
+static bool vlc_executor_Unlink(vlc_task_t **pp, vlc_task_t ***tailp,
+                                vlc_task_t *task)
+{
+    for (; *pp != NULL; pp = &(*pp)->next)
+        if (*pp == task)
+        {
+            *pp = task->next;
+            if (tailp != NULL && *tailp == &task->next)
+                *tailp = pp;
+            return true;
+        }
+    return false;
+}
+
+static void *vlc_executor_Thread(void *data)
+{
+    vlc_executor_t *ex = data;
+
+    vlc_mutex_lock(&ex->lock);
+    for (;;)
+    {
+        mtime_t now = mdate();
+
+        /* Promote due timers */
+        while (ex->timers != NULL && ex->timers->date <= now)
+        {
+            vlc_task_t *task = ex->timers;
+
+            ex->timers = task->next;
+            vlc_executor_QueueReady(ex, task);
+        }
+
+        vlc_task_t *task = vlc_executor_DequeueReady(ex);
+        if (task != NULL)
+        {
+            task->queued = false;
+            task->running++;
+            vlc_mutex_unlock(&ex->lock);
+
+            task->run(task->opaque);
+
+            vlc_mutex_lock(&ex->lock);
+            assert(task->running > 0);
+
+            void (*release)(void *) = task->release;
+            void *opaque = task->opaque;
+            /* If the task was submitted again, the last run releases it */
+            bool requeued = task->queued || task->running > 1;
+
+            /* The task may be freed as soon as it is no longer running */
+            task->running--;
+            vlc_cond_broadcast(&ex->done);
+
+            if (release != NULL && !requeued)
+            {
+                vlc_mutex_unlock(&ex->lock);
+                release(opaque);
+                vlc_mutex_lock(&ex->lock);
+            }
+            continue;
+        }
+
+        if (ex->closing)
+            break;
+
+        mtime_t deadline = (ex->timers != NULL) ? ex->timers->date
+                                                : now + EXECUTOR_IDLE_TIMEOUT;
+        ex->idle++;
+        int val = vlc_cond_timedwait(&ex->wait, &ex->lock, deadline);
+        ex->idle--;
+
+        if (val == ETIMEDOUT && ex->timers == NULL
+         && !vlc_executor_HasReady(ex))
+            break; /* idle for too long */
+    }
+
+    assert(ex->threads > 0);
+    ex->threads--;
+    vlc_cond_broadcast(&ex->done);
+    vlc_mutex_unlock(&ex->lock);
+    return NULL;
+}
+
+/**
+ * Creates a thread pool.
+ * \param max_threads maximum number of concurrent worker threads
+ *                    (0 means as many as CPUs)
+ */
+vlc_executor_t *vlc_executor_New(unsigned max_threads)
+{
+    vlc_executor_t *ex = malloc(sizeof (*ex));
+    if (unlikely(ex == NULL))
+        return NULL;
+
+    vlc_mutex_init(&ex->lock);
+    vlc_cond_init(&ex->wait);
+    vlc_cond_init(&ex->done);
+    for (unsigned i = 0; i < VLC_TASK_PRIORITY_COUNT; i++)
+    {
+        ex->ready[i] = NULL;
+        ex->ready_tail[i] = &ex->ready[i];
+    }
+    ex->timers = NULL;
+    ex->threads = 0;
+    ex->idle = 0;
+    ex->max_threads = max_threads ? max_threads : vlc_GetCPUCount();
+    ex->closing = false;
+    return ex;
+}
+
+/**
+ * Destroys a thread pool.
+ * Tasks that have not started yet are canceled and released (see
+ * vlc_task_t.release); this function waits for the running ones to complete.
+ */
+void vlc_executor_Delete(vlc_executor_t *ex)
+{
+    vlc_task_t *discarded = NULL, **tail = &discarded;
+
+    vlc_mutex_lock(&ex->lock);
+    ex->closing = true;
+
+    vlc_task_t *task;
+    while ((task = vlc_executor_DequeueReady(ex)) != NULL)
+    {
+        *tail = task;
+        tail = &task->next;
+    }
+    *tail = ex->timers;
+    ex->timers = NULL;
+
+    for (vlc_task_t **pp = &discarded; (task = *pp) != NULL;)
+    {
+        task->queued = false;
+        task->canceled = true;
+        if (task->running > 0)
+            *pp = task->next; /* submitted again while running, the worker
+                                 releases it */
+        else
+            pp = &task->next;
+    }
+
+    vlc_cond_broadcast(&ex->wait);
+    while (ex->threads > 0)
+        vlc_cond_wait(&ex->done, &ex->lock);
+    vlc_mutex_unlock(&ex->lock);
+
+    while (discarded != NULL)
+    {
+        task = discarded;
+        discarded = task->next;
+        if (task->release != NULL)
+            task->release(task->opaque);
+    }
+
+    vlc_cond_destroy(&ex->done);
+    vlc_cond_destroy(&ex->wait);
+    vlc_mutex_destroy(&ex->lock);
+    free(ex);
+}
+
+/**
+ * Queues a task for execution.
+ *
+ * A task can be submitted again once it has started running, including from
+ * its own procedure. It is then released only once after its last run.
+ *
+ * \param priority VLC_TASK_PRIORITY_* value; higher priority tasks are
+ *                 dequeued first
+ * \param date earliest execution date, or VLC_TS_INVALID for immediate
+ * \return 0 on success, EBUSY if the task is already queued, ECANCELED if
+ * the pool is being destroyed, or an error code if no worker thread could be
+ * created. On error, the task is not released and remains owned by the
+ * caller.
+ */
+int vlc_executor_Submit(vlc_executor_t *ex, vlc_task_t *task, int priority,
+                        mtime_t date)
+{
+    assert(priority >= 0 && priority < VLC_TASK_PRIORITY_COUNT);
+
+    vlc_mutex_lock(&ex->lock);
+    if (task->queued || ex->closing)
+    {
+        int ret = task->queued ? EBUSY : ECANCELED;
+        vlc_mutex_unlock(&ex->lock);
+        return ret;
+    }
+
+    task->priority = priority;
+    task->date = date;
+    task->queued = true;
+    task->canceled = false;
+
+    if (date > VLC_TS_INVALID)
+    {
+        vlc_task_t **pp = &ex->timers;
+
+        while (*pp != NULL && (*pp)->date <= date)
+            pp = &(*pp)->next;
+        task->next = *pp;
+        *pp = task;
+    }
+    else
+        vlc_executor_QueueReady(ex, task);
+
+    int ret = 0;
+
+    if (ex->idle > 0)
+        vlc_cond_signal(&ex->wait);
+    else if (ex->threads < ex->max_threads)
+    {
+        ret = vlc_clone_detach(NULL, vlc_executor_Thread, ex,
+                               VLC_THREAD_PRIORITY_LOW);
+        if (likely(ret == 0))
+            ex->threads++;
+        else if (ex->threads > 0)
+            ret = 0; /* the task will run on an existing thread */
+        else
+        {
+            vlc_executor_Unlink(&ex->ready[priority], &ex->ready_tail[priority],
+                                task);
+            vlc_executor_Unlink(&ex->timers, NULL, task);
+            task->queued = false;
+        }
+    }
+    vlc_mutex_unlock(&ex->lock);
+    return ret;
+}
+
+/**
+ * Cancels a task.
+ *
+ * If the task has not started yet, it is removed from the queue and released.
+ * Otherwise, it is flagged as canceled (see vlc_task_IsCanceled()) and this
+ * function waits for it to complete.
+ *
+ * \warning This function must not be called from the task procedure.
+ * \return true if the task was removed before it could run.
+ */
+bool vlc_executor_Cancel(vlc_executor_t *ex, vlc_task_t *task)
+{
+    bool removed = false;
+
+    vlc_mutex_lock(&ex->lock);
+    if (task->queued)
+    {
+        int prio = task->priority;
+
+        removed = vlc_executor_Unlink(&ex->ready[prio], &ex->ready_tail[prio],
+                                      task)
+               || vlc_executor_Unlink(&ex->timers, NULL, task);
+        assert(removed);
+        task->queued = false;
+    }
+
+    task->canceled = true;
+    /* If it was submitted again while running, the worker releases it */
+    bool release = removed && task->running == 0;
+    while (task->running > 0)
+        vlc_cond_wait(&ex->done, &ex->lock);
+    vlc_mutex_unlock(&ex->lock);
+
+    if (release && task->release != NULL)
+        task->release(task->opaque);
+    return removed;
+}
+
+/**
+ * Checks whether a running task was requested to stop.
+ * Long-running task procedures should call this regularly.
+ */
+bool vlc_task_IsCanceled(vlc_executor_t *ex, const vlc_task_t *task)
+{
+    vlc_mutex_lock(&ex->lock);
+    bool canceled = task->canceled;
+    vlc_mutex_unlock(&ex->lock);
+    return canceled;
+}
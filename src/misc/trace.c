@@ -0,0 +1,258 @@
+/*****************************************************************************
+ * trace.c: timestamped trace events
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+#include <vlc_interface.h>
+#include <vlc_fs.h>
+#include "../libvlc.h"
+#include "trace.h"
+
+#define TRACE_RING_SIZE 4096 /* must be a power of two */
+
+typedef struct
+{
+    atomic_uint seq; /**< Odd while the event is being written */
+    const char *name;
+    uintptr_t object_id;
+    mtime_t start;
+    mtime_t end;
+} vlc_trace_event_t;
+
+/**
+ * Events ring of one thread. Only the owner thread writes to it, the oldest
+ * events are overwritten. The ring of a terminated thread is kept so that its
+ * events can still be exported, until a new thread reuses it.
+ */
+typedef struct vlc_trace_ring
+{
+    struct vlc_trace_ring *next;
+    unsigned id; /**< Trace thread identifier */
+    atomic_uint head;
+    atomic_bool dead; /**< The owner thread has exited */
+    vlc_trace_event_t events[TRACE_RING_SIZE];
+} vlc_trace_ring_t;
+
+struct vlc_tracer
+{
+    vlc_threadvar_t key;
+    vlc_mutex_t lock;
+    vlc_trace_ring_t *rings;
+    unsigned count;
+    char *path; /**< File to write at exit or NULL */
+};
+
+static void TraceRingRelease(void *data)
+{
+    vlc_trace_ring_t *ring = data;
+
+    atomic_store_explicit(&ring->dead, true, memory_order_release);
+}
+
+static vlc_trace_ring_t *TraceRingGet(struct vlc_tracer *tracer)
+{
+    vlc_trace_ring_t *ring = vlc_threadvar_get(tracer->key);
+    if (likely(ring != NULL))
+        return ring;
+
+    vlc_mutex_lock(&tracer->lock);
+    for (ring = tracer->rings; ring != NULL; ring = ring->next)
+        if (atomic_load_explicit(&ring->dead, memory_order_acquire))
+            break;
+
+    if (ring == NULL)
+    {
+        ring = malloc(sizeof (*ring));
+        if (unlikely(ring == NULL))
+        {
+            vlc_mutex_unlock(&tracer->lock);
+            return NULL;
+        }
+        ring->next = tracer->rings;
+        tracer->rings = ring;
+    }
+
+    /* Nobody reads the ring while the lock is held */
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->dead, false);
+    for (unsigned i = 0; i < TRACE_RING_SIZE; i++)
+        atomic_init(&ring->events[i].seq, 0);
+    ring->id = ++tracer->count;
+    vlc_mutex_unlock(&tracer->lock);
+
+    vlc_threadvar_set(tracer->key, ring);
+    return ring;
+}
+
+void vlc_trace_Record(vlc_object_t *obj, const char *name, mtime_t start)
+{
+    mtime_t end = mdate();
+    struct vlc_tracer *tracer = libvlc_priv(obj->p_libvlc)->tracer;
+    vlc_trace_ring_t *ring = TraceRingGet(tracer);
+    if (unlikely(ring == NULL))
+        return;
+
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    vlc_trace_event_t *ev = &ring->events[head & (TRACE_RING_SIZE - 1)];
+    unsigned seq = atomic_load_explicit(&ev->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&ev->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    ev->name = name;
+    ev->object_id = (uintptr_t)obj;
+    ev->start = start;
+    ev->end = end;
+    atomic_store_explicit(&ev->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * Copies an event consistently, i.e. unless it is being overwritten.
+ */
+static bool TraceEventRead(vlc_trace_event_t *ev, vlc_trace_event_t *out)
+{
+    unsigned seq = atomic_load_explicit(&ev->seq, memory_order_acquire);
+    if (seq == 0 || (seq & 1))
+        return false;
+
+    out->name = ev->name;
+    out->object_id = ev->object_id;
+    out->start = ev->start;
+    out->end = ev->end;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&ev->seq, memory_order_relaxed) == seq;
+}
+
+static int TraceWrite(struct vlc_tracer *tracer, FILE *stream)
+{
+    bool first = true;
+
+    fputs("{\"traceEvents\":[", stream);
+
+    vlc_mutex_lock(&tracer->lock);
+    for (vlc_trace_ring_t *ring = tracer->rings; ring; ring = ring->next)
+    {
+        unsigned head = atomic_load_explicit(&ring->head,
+                                             memory_order_acquire);
+        unsigned i = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+
+        for (; i != head; i++)
+        {
+            vlc_trace_event_t ev;
+
+            if (!TraceEventRead(&ring->events[i & (TRACE_RING_SIZE - 1)],
+                                &ev))
+                continue;
+
+            fprintf(stream, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                    "\"tid\":%u,\"ts\":%"PRId64",\"dur\":%"PRId64","
+                    "\"args\":{\"object\":\"%#"PRIxPTR"\"}}",
+                    first ? "" : ",", ev.name, ring->id, ev.start,
+                    ev.end - ev.start, ev.object_id);
+            first = false;
+        }
+    }
+    vlc_mutex_unlock(&tracer->lock);
+
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", stream);
+    return ferror(stream) ? -1 : 0;
+}
+
+/**
+ * Writes the recorded trace events to a file, in Chrome trace event format
+ * (as loaded by chrome://tracing or Perfetto).
+ * \param path file path to (over)write
+ * \return 0 on success, -1 on error or if tracing is not enabled.
+ */
+int vlc_trace_Export(libvlc_int_t *libvlc, const char *path)
+{
+    struct vlc_tracer *tracer = libvlc_priv(libvlc)->tracer;
+    if (tracer == NULL)
+        return -1;
+
+    FILE *stream = vlc_fopen(path, "wt");
+    if (stream == NULL)
+    {
+        msg_Err(libvlc, "cannot write trace to %s: %s", path,
+                vlc_strerror_c(errno));
+        return -1;
+    }
+
+    int ret = TraceWrite(tracer, stream);
+    if (fclose(stream))
+        ret = -1;
+    if (ret == 0)
+        msg_Dbg(libvlc, "trace written to %s", path);
+    return ret;
+}
+
+void vlc_trace_Init(libvlc_int_t *libvlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(libvlc);
+    char *path = var_InheritString(libvlc, "trace-file");
+
+    priv->tracer = NULL;
+    if (path == NULL && !var_InheritBool(libvlc, "trace"))
+        return;
+
+    struct vlc_tracer *tracer = malloc(sizeof (*tracer));
+    if (unlikely(tracer == NULL)
+     || vlc_threadvar_create(&tracer->key, TraceRingRelease))
+    {
+        free(tracer);
+        free(path);
+        return;
+    }
+    vlc_mutex_init(&tracer->lock);
+    tracer->rings = NULL;
+    tracer->count = 0;
+    tracer->path = path;
+    priv->tracer = tracer;
+}
+
+void vlc_trace_Deinit(libvlc_int_t *libvlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(libvlc);
+    struct vlc_tracer *tracer = priv->tracer;
+
+    if (tracer == NULL)
+        return;
+
+    if (tracer->path != NULL)
+        vlc_trace_Export(libvlc, tracer->path);
+    priv->tracer = NULL;
+
+    for (vlc_trace_ring_t *ring = tracer->rings, *next; ring; ring = next)
+    {
+        next = ring->next;
+        free(ring);
+    }
+    vlc_threadvar_delete(&tracer->key);
+    vlc_mutex_destroy(&tracer->lock);
+    free(tracer->path);
+    free(tracer);
+}
@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * trace.h: timestamped trace events
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_TRACE_H
+# define LIBVLC_TRACE_H 1
+
+# include "../libvlc.h"
+
+/**
+ * \defgroup trace Trace events
+ * Spans of the hot paths (demux, decode, filter, display, audio play) are
+ * recorded into per-thread rings when --trace is enabled, and can be
+ * exported in the Chrome/Perfetto trace event JSON format.
+ * @{
+ */
+
+struct vlc_tracer;
+
+void vlc_trace_Init(libvlc_int_t *);
+void vlc_trace_Deinit(libvlc_int_t *);
+
+void vlc_trace_Record(vlc_object_t *, const char *name, mtime_t start);
+
+/**
+ * Starts a span.
+ * \return the span start date, or 0 if tracing is disabled
+ */
+static inline mtime_t vlc_trace_Begin(vlc_object_t *obj)
+{
+    if (likely(libvlc_priv(obj->p_libvlc)->tracer == NULL))
+        return 0;
+    return mdate();
+}
+
+/**
+ * Ends a span started with vlc_trace_Begin().
+ * \param name span name (must be a static string)
+ */
+static inline void vlc_trace_End(vlc_object_t *obj, const char *name,
+                                 mtime_t start)
+{
+    if (likely(start == 0))
+        return;
+    vlc_trace_Record(obj, name, start);
+}
+
+#define vlc_trace_Begin(o) vlc_trace_Begin(VLC_OBJECT(o))
+#define vlc_trace_End(o, n, s) vlc_trace_End(VLC_OBJECT(o), n, s)
+
+/** @} */
+#endif
@@ -143,6 +143,9 @@ void module_EndBank (bool b_plugins)
     if (--modules.usage == 0)
     {
         config_UnsortConfig ();
+        vlc_rwlock_wrlock (&config_lock);
+        config_ForgetConfigFile ();
+        vlc_rwlock_unlock (&config_lock);
         head = modules.head;
         modules.head = NULL;
     }
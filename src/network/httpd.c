@@ -1226,6 +1226,18 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(cl->fd, ip, port) ? NULL : ip;
 }
 
+/**
+ * Sends the answer to the client progressively: the URL callback is called
+ * again whenever the previous data was sent and then regularly, until it
+ * resets the body offset of the answer to zero. The callback returns an
+ * answer of type HTTPD_MSG_NONE while it has nothing new to send.
+ * This must be called from the URL callback.
+ */
+void httpd_ClientModeStream(httpd_client_t *cl)
+{
+    cl->b_stream_mode = true;
+}
+
 static void httpd_ClientClean(httpd_client_t *cl)
 {
     if (cl->fd >= 0) {
@@ -1937,6 +1949,7 @@ static void httpdLoop(httpd_host_t *host)
                         httpd_MsgClean(&cl->query);
                         httpd_MsgInit(&cl->query);
 
+                        cl->b_stream_mode = false;
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
                         free(cl->p_buffer);
@@ -72,8 +72,9 @@ struct fetcher_entry_t
 struct playlist_fetcher_t
 {
     vlc_object_t   *object;
+    vlc_executor_t *executor;
+    vlc_task_t      task;
     vlc_mutex_t     lock;
-    vlc_cond_t      wait;
     bool            b_live;
 
     fetcher_entry_t *p_waiting_head[PASS_COUNT];
@@ -83,7 +84,7 @@ struct playlist_fetcher_t
     meta_fetcher_scope_t e_scope;
 };
 
-static void *Thread( void * );
+static void Run( void * );
 
 
 /*****************************************************************************
@@ -96,8 +97,16 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *parent )
         return NULL;
 
     p_fetcher->object = parent;
+    /* Fetching can block on the network for long: keep it off the
+     * shared pool */
+    p_fetcher->executor = vlc_executor_New( 1 );
+    if( unlikely(p_fetcher->executor == NULL) )
+    {
+        free( p_fetcher );
+        return NULL;
+    }
+    vlc_task_Init( &p_fetcher->task, Run, p_fetcher );
     vlc_mutex_init( &p_fetcher->lock );
-    vlc_cond_init( &p_fetcher->wait );
     p_fetcher->b_live = false;
 
     bool b_access = var_InheritBool( parent, "metadata-network-access" );
@@ -135,8 +144,8 @@ void playlist_fetcher_Push( playlist_fetcher_t *p_fetcher, input_item_t *p_item,
     if( !p_fetcher->b_live )
     {
         assert( p_fetcher->p_waiting_head[PASS1_LOCAL] );
-        if( vlc_clone_detach( NULL, Thread, p_fetcher,
-                              VLC_THREAD_PRIORITY_LOW ) )
+        if( vlc_executor_Submit( p_fetcher->executor, &p_fetcher->task,
+                                 VLC_TASK_PRIORITY_LOW, VLC_TS_INVALID ) )
             msg_Err( p_fetcher->object,
                      "cannot spawn secondary preparse thread" );
         else
@@ -162,11 +171,12 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
         p_fetcher->p_waiting_head[i_queue] = NULL;
     }
 
-    while( p_fetcher->b_live )
-        vlc_cond_wait( &p_fetcher->wait, &p_fetcher->lock );
     vlc_mutex_unlock( &p_fetcher->lock );
 
-    vlc_cond_destroy( &p_fetcher->wait );
+    /* Wait for the task to return */
+    vlc_executor_Cancel( p_fetcher->executor, &p_fetcher->task );
+    vlc_executor_Delete( p_fetcher->executor );
+
     vlc_mutex_destroy( &p_fetcher->lock );
 
     free( p_fetcher );
@@ -424,7 +434,7 @@ static void FetchMeta( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     vlc_object_release( p_finder );
 }
 
-static void *Thread( void *p_data )
+static void Run( void *p_data )
 {
     playlist_fetcher_t *p_fetcher = p_data;
     vlc_object_t *obj = p_fetcher->object;
@@ -454,7 +464,6 @@ static void *Thread( void *p_data )
         else
         {
             p_fetcher->b_live = false;
-            vlc_cond_signal( &p_fetcher->wait );
         }
         vlc_mutex_unlock( &p_fetcher->lock );
 
@@ -547,5 +556,4 @@ static void *Thread( void *p_data )
             free( p_entry );
         }
     }
-    return NULL;
 }
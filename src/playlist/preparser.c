@@ -46,15 +46,16 @@ struct playlist_preparser_t
 {
     vlc_object_t        *object;
     playlist_fetcher_t  *p_fetcher;
+    vlc_executor_t      *executor;
+    vlc_task_t          task;
 
     vlc_mutex_t     lock;
-    vlc_cond_t      wait;
     bool            b_live;
     preparser_entry_t  **pp_waiting;
     int             i_waiting;
 };
 
-static void *Thread( void * );
+static void Run( void * );
 
 /*****************************************************************************
  * Public functions
@@ -66,12 +67,20 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
         return NULL;
 
     p_preparser->object = parent;
+    /* The task loops as long as there are items: it gets its own worker
+     * thread, rather than holding one of the shared pool */
+    p_preparser->executor = vlc_executor_New( 1 );
+    if( unlikely(p_preparser->executor == NULL) )
+    {
+        free( p_preparser );
+        return NULL;
+    }
+    vlc_task_Init( &p_preparser->task, Run, p_preparser );
     p_preparser->p_fetcher = playlist_fetcher_New( parent );
     if( unlikely(p_preparser->p_fetcher == NULL) )
         msg_Err( parent, "cannot create fetcher" );
 
     vlc_mutex_init( &p_preparser->lock );
-    vlc_cond_init( &p_preparser->wait );
     p_preparser->b_live = false;
     p_preparser->i_waiting = 0;
     p_preparser->pp_waiting = NULL;
@@ -95,8 +104,8 @@ void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p
                  p_preparser->i_waiting, p_entry );
     if( !p_preparser->b_live )
     {
-        if( vlc_clone_detach( NULL, Thread, p_preparser,
-                              VLC_THREAD_PRIORITY_LOW ) )
+        if( vlc_executor_Submit( p_preparser->executor, &p_preparser->task,
+                                 VLC_TASK_PRIORITY_NORMAL, VLC_TS_INVALID ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
             p_preparser->b_live = true;
@@ -123,12 +132,13 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
         REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
     }
 
-    while( p_preparser->b_live )
-        vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
+    /* Wait for the task to return */
+    vlc_executor_Cancel( p_preparser->executor, &p_preparser->task );
+    vlc_executor_Delete( p_preparser->executor );
+
     /* Destroy the item preparser */
-    vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
 
     if( p_preparser->p_fetcher != NULL )
@@ -224,7 +234,7 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 /**
  * This function does the preparsing and issues the art fetching requests
  */
-static void *Thread( void *data )
+static void Run( void *data )
 {
     playlist_preparser_t *p_preparser = data;
     vlc_object_t *obj = p_preparser->object;
@@ -248,7 +258,6 @@ static void *Thread( void *data )
         {
             p_current = NULL;
             p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
         }
         vlc_mutex_unlock( &p_preparser->lock );
 
@@ -260,6 +269,5 @@ static void *Thread( void *data )
         Art( p_preparser, p_current );
         vlc_gc_decref(p_current);
     }
-    return NULL;
 }
 
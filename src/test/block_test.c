@@ -84,10 +84,64 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block = block_Shareable (block);
+    assert (block != NULL);
+    assert (block_Shareable (block) == block);
+
+    block_t *dup = block_Share (block);
+    assert (dup != NULL);
+    assert (dup->p_buffer == block->p_buffer);
+    assert (dup->i_buffer == sizeof (text));
+    assert (dup->i_pts == 42);
+
+    /* Headers are private */
+    dup->i_pts = 43;
+    dup->p_buffer += 5;
+    dup->i_buffer -= 5;
+    assert (block->i_pts == 42);
+    assert (block->i_buffer == sizeof (text));
+
+    /* Prepending to a shared payload copies it */
+    dup = block_Realloc (dup, 5, dup->i_buffer);
+    assert (dup != NULL);
+    assert (dup->p_buffer != block->p_buffer);
+    memset (dup->p_buffer, 'x', 5);
+    assert (!memcmp (dup->p_buffer + 5, text + 5, sizeof (text) - 5));
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (dup);
+
+    dup = block_Share (block);
+    assert (dup != NULL);
+    block_t *copy = block_Writable (dup);
+    assert (copy != NULL);
+    assert (copy->p_buffer != block->p_buffer);
+    assert (!memcmp (copy->p_buffer, text, sizeof (text)));
+    block_Release (copy);
+
+    /* The last reference owns the payload */
+    dup = block_Share (block);
+    assert (dup != NULL);
+    uint8_t *payload = block->p_buffer;
+    block_Release (block);
+    dup = block_Writable (dup);
+    assert (dup != NULL);
+    assert (dup->p_buffer == payload);
+    assert (!memcmp (dup->p_buffer, text, sizeof (text)));
+    block_Release (dup);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_Share ();
     return 0;
 }
 
@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * stream_cache.c: Test for the byte range cache
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "../input/stream_cache.h"
+
+#define KIB 1024
+#define BUDGET (1024 * KIB) /* 16 chunks of 64 KiB */
+#define FETCH  (256 * KIB)
+
+static uint8_t buf[FETCH];
+
+/* Content of the stream at each offset */
+static uint8_t Byte (uint64_t pos)
+{
+    return (pos * 7 + (pos >> 16)) & 0xFF;
+}
+
+static void Put (stream_cache_t *c, uint64_t pos, size_t size, bool hint)
+{
+    assert (size <= sizeof (buf));
+    for (size_t i = 0; i < size; i++)
+        buf[i] = Byte (pos + i);
+    stream_CachePut (c, pos, buf, size, hint);
+}
+
+/* Checks that [pos, pos + size) is cached, reading it if read is true */
+static bool Has (stream_cache_t *c, uint64_t pos, size_t size, bool read)
+{
+    if (!read)
+        return stream_CacheGet (c, pos, NULL, size) == size;
+
+    assert (size <= sizeof (buf));
+    memset (buf, 0, size);
+    if (stream_CacheGet (c, pos, buf, size) != size)
+        return false;
+    for (size_t i = 0; i < size; i++)
+        assert (buf[i] == Byte (pos + i));
+    return true;
+}
+
+static void test_basic (void)
+{
+    stream_cache_t *c = stream_CacheNew (NULL, BUDGET, NULL);
+    assert (c != NULL);
+
+    Put (c, 1000, 100 * KIB, false);
+    assert (Has (c, 1000, 100 * KIB, true));
+    assert (Has (c, 5000, 1000, true));
+    assert (!Has (c, 0, 1000, false));
+    assert (stream_CacheGet (c, 990, NULL, 100) == 0);
+    assert (stream_CacheGet (c, 1000 + 100 * KIB - 10, NULL, 100) == 10);
+
+    /* Non contiguous data replace the old ones within a chunk */
+    Put (c, 50 * KIB, 1000, false);
+    assert (Has (c, 50 * KIB, 1000, true));
+
+    stream_CacheFlush (c);
+    assert (!Has (c, 1000, 1, false));
+    stream_CacheDelete (c);
+}
+
+static void test_lru (void)
+{
+    stream_cache_t *c = stream_CacheNew (NULL, BUDGET, NULL);
+    assert (c != NULL);
+
+    for (uint64_t pos = 0; pos < BUDGET; pos += FETCH)
+        Put (c, pos, FETCH, false);
+    assert (Has (c, 0, BUDGET / 4, true)); /* now the most recently used */
+
+    Put (c, 10 * BUDGET, FETCH, false);
+    assert (Has (c, 10 * BUDGET, FETCH, true));
+    assert (Has (c, 0, BUDGET / 4, true));
+    assert (!Has (c, FETCH, 1, false));
+    stream_CacheDelete (c);
+}
+
+static void test_hint (void)
+{
+    stream_cache_t *c = stream_CacheNew (NULL, BUDGET, NULL);
+    assert (c != NULL);
+
+    /* Hinted data are kept until read, even if the least recently used */
+    Put (c, 0, FETCH, true);
+    for (uint64_t pos = BUDGET; pos < 4 * BUDGET; pos += FETCH)
+        Put (c, pos, FETCH, false);
+    assert (Has (c, 0, FETCH, true));
+
+    /* Once read, they are dropped like the others */
+    for (uint64_t pos = 4 * BUDGET; pos < 6 * BUDGET; pos += FETCH)
+        Put (c, pos, FETCH, false);
+    assert (!Has (c, 0, 1, false));
+
+    /* Or once the hints are cleared */
+    Put (c, 0, FETCH, true);
+    stream_CacheClearHints (c);
+    for (uint64_t pos = BUDGET; pos < 3 * BUDGET; pos += FETCH)
+        Put (c, pos, FETCH, false);
+    assert (!Has (c, 0, 1, false));
+    stream_CacheDelete (c);
+}
+
+static void test_hint_budget (void)
+{
+    stream_cache_t *c = stream_CacheNew (NULL, BUDGET, NULL);
+    assert (c != NULL);
+
+    /* A hint of the whole budget must leave room for a fetch */
+    for (uint64_t pos = 0; pos < BUDGET; pos += FETCH)
+        Put (c, pos, FETCH, true);
+
+    Put (c, 10 * BUDGET, FETCH, false);
+    assert (Has (c, 10 * BUDGET, FETCH, true));
+
+    /* Half of the budget is still hinted */
+    assert (Has (c, 0, BUDGET / 2, false));
+    stream_CacheDelete (c);
+}
+
+int main (void)
+{
+    test_basic ();
+    test_lru ();
+    test_hint ();
+    test_hint_budget ();
+    return 0;
+}
@@ -50,16 +50,13 @@ void vout_snapshot_Init(vout_snapshot_t *snap)
 
     snap->is_available = true;
     snap->request_count = 0;
+    snap->picture_count = 0;
     snap->picture = NULL;
 }
 void vout_snapshot_Clean(vout_snapshot_t *snap)
 {
-    picture_t *picture = snap->picture;
-    while (picture) {
-        picture_t *next = picture->p_next;
-        picture_Release(picture);
-        picture = next;
-    }
+    if (snap->picture)
+        picture_Release(snap->picture);
 
     vlc_cond_destroy(&snap->wait);
     vlc_mutex_destroy(&snap->lock);
@@ -85,14 +82,19 @@ picture_t *vout_snapshot_Get(vout_snapshot_t *snap, mtime_t timeout)
 
     /* */
     const mtime_t deadline = mdate() + timeout;
-    while (snap->is_available && !snap->picture && mdate() < deadline)
+    while (snap->is_available && snap->picture_count == 0 && mdate() < deadline)
         vlc_cond_timedwait(&snap->wait, &snap->lock, deadline);
 
     /* */
-    picture_t *picture = snap->picture;
-    if (picture)
-        snap->picture = picture->p_next;
-    else if (snap->request_count > 0)
+    picture_t *picture = NULL;
+    if (snap->picture_count > 0) {
+        /* All the pending requests share the same read-only copy */
+        picture = picture_Hold(snap->picture);
+        if (--snap->picture_count == 0) {
+            picture_Release(snap->picture);
+            snap->picture = NULL;
+        }
+    } else if (snap->request_count > 0)
         snap->request_count--;
 
     vlc_mutex_unlock(&snap->lock);
@@ -118,16 +120,20 @@ void vout_snapshot_Set(vout_snapshot_t *snap,
         fmt = &picture->format;
 
     vlc_mutex_lock(&snap->lock);
-    while (snap->request_count > 0) {
+    if (snap->request_count > 0) {
+        /* The source picture belongs to a pool and must be given back
+         * quickly, so it is copied once; the copy is then shared by all the
+         * requests, including the ones still waiting for the previous one. */
         picture_t *dup = picture_NewFromFormat(fmt);
-        if (!dup)
-            break;
-
-        picture_Copy(dup, picture);
+        if (dup) {
+            picture_Copy(dup, picture);
 
-        dup->p_next = snap->picture;
-        snap->picture = dup;
-        snap->request_count--;
+            if (snap->picture)
+                picture_Release(snap->picture);
+            snap->picture = dup;
+            snap->picture_count += snap->request_count;
+            snap->request_count = 0;
+        }
     }
     vlc_cond_broadcast(&snap->wait);
     vlc_mutex_unlock(&snap->lock);
@@ -138,10 +144,8 @@ char *vout_snapshot_GetDirectory(void)
     return config_GetUserDir(VLC_PICTURES_DIR);
 }
 /* */
-int vout_snapshot_SaveImage(char **name, int *sequential,
-                             const block_t *image,
-                             vout_thread_t *p_vout,
-                             const vout_snapshot_save_cfg_t *cfg)
+char *vout_snapshot_MakeFilename(int *sequential, vout_thread_t *p_vout,
+                                 const vout_snapshot_save_cfg_t *cfg)
 {
     /* */
     char *filename;
@@ -202,23 +206,43 @@ int vout_snapshot_SaveImage(char **name, int *sequential,
         path_sanitize(filename);
     }
 
-    if (!filename)
-        goto error;
+    return filename;
 
-    /* Save the snapshot */
+error:
+    return NULL;
+}
+
+int vout_snapshot_WriteImage(vlc_object_t *obj, const char *filename,
+                             const block_t *image)
+{
     FILE *file = vlc_fopen(filename, "wb");
     if (!file) {
-        msg_Err(p_vout, "Failed to open '%s'", filename);
-        free(filename);
-        goto error;
+        msg_Err(obj, "Failed to open '%s'", filename);
+        return VLC_EGENERIC;
     }
     if (fwrite(image->p_buffer, image->i_buffer, 1, file) != 1) {
-        msg_Err(p_vout, "Failed to write to '%s'", filename);
+        msg_Err(obj, "Failed to write to '%s'", filename);
         fclose(file);
+        return VLC_EGENERIC;
+    }
+    fclose(file);
+    return VLC_SUCCESS;
+}
+
+int vout_snapshot_SaveImage(char **name, int *sequential,
+                             const block_t *image,
+                             vout_thread_t *p_vout,
+                             const vout_snapshot_save_cfg_t *cfg)
+{
+    char *filename = vout_snapshot_MakeFilename(sequential, p_vout, cfg);
+    if (!filename)
+        goto error;
+
+    /* Save the snapshot */
+    if (vout_snapshot_WriteImage(VLC_OBJECT(p_vout), filename, image)) {
         free(filename);
         goto error;
     }
-    fclose(file);
 
     /* */
     if (name)
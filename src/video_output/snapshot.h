@@ -32,6 +32,7 @@ typedef struct {
 
 	bool        is_available;
 	int         request_count;
+	int         picture_count; /* requests served by picture */
 	picture_t   *picture;
 
 } vout_snapshot_t;
@@ -53,7 +54,8 @@ bool vout_snapshot_IsRequested(vout_snapshot_t *);
 /**
  * It set the picture used to create the snapshots.
  *
- * The given picture is only copied and not released.
+ * The given picture is copied once and not released; the copy is shared
+ * (read-only) by all pending requests.
  * If p_fmt is non NULL it will override the format of the p_picture (mainly
  * used because of aspect/crop problems).
  */
@@ -72,6 +74,18 @@ typedef struct {
     char *prefix_fmt;
 } vout_snapshot_save_cfg_t;
 
+/**
+ * This function will compute the file name of the next snapshot.
+ */
+char *vout_snapshot_MakeFilename(int *sequential, vout_thread_t *p_vout,
+                                 const vout_snapshot_save_cfg_t *cfg);
+
+/**
+ * This function will write an image to the given file.
+ */
+int vout_snapshot_WriteImage(vlc_object_t *, const char *filename,
+                             const block_t *image);
+
 /**
  * This function will write an image to the disk an return the file name created.
  */
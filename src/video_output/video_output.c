@@ -51,6 +51,7 @@
 #include "interlacing.h"
 #include "display.h"
 #include "window.h"
+#include "../misc/trace.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -1090,7 +1091,9 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
 
     /* display the picture immediately */
     bool is_forced = frame_by_frame || force_refresh || vout->p->displayed.current->b_force;
+    mtime_t trace = vlc_trace_Begin(vout);
     int ret = ThreadDisplayRenderPicture(vout, is_forced);
+    vlc_trace_End(vout, "display", trace);
     return force_refresh ? VLC_EGENERIC : ret;
 }
 
@@ -41,7 +41,9 @@
 #include <vlc_vout_osd.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_image.h>
 #include "vout_internal.h"
+#include "../libvlc.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -362,6 +364,95 @@ static void VoutOsdSnapshot( vout_thread_t *p_vout, picture_t *p_pic, const char
     }
 }
 
+/**
+ * Deferred snapshot encoding and writing
+ */
+typedef struct
+{
+    vlc_task_t     task;
+    vout_thread_t *p_vout;
+    picture_t     *p_picture;
+    char          *psz_filename;
+    vlc_fourcc_t   i_codec;
+    int            i_width;
+    int            i_height;
+} vout_snapshot_job_t;
+
+static void VoutSnapshotRun( void *data )
+{
+    vout_snapshot_job_t *p_job = data;
+    vout_thread_t *p_vout = p_job->p_vout;
+    block_t *p_image;
+    video_format_t fmt;
+
+    if( picture_Export( VLC_OBJECT(p_vout), &p_image, &fmt, p_job->p_picture,
+                        p_job->i_codec, p_job->i_width, p_job->i_height ) )
+        msg_Err( p_vout, "Failed to convert image for snapshot" );
+    else
+    {
+        if( vout_snapshot_WriteImage( VLC_OBJECT(p_vout), p_job->psz_filename,
+                                      p_image ) == VLC_SUCCESS )
+        {
+            VoutOsdSnapshot( p_vout, p_job->p_picture, p_job->psz_filename );
+
+            /* signal creation of a new snapshot file */
+            var_SetString( p_vout->p_libvlc, "snapshot-file",
+                           p_job->psz_filename );
+        }
+        else
+            msg_Err( p_vout, "could not save snapshot" );
+        block_Release( p_image );
+    }
+}
+
+static void VoutSnapshotRelease( void *data )
+{
+    vout_snapshot_job_t *p_job = data;
+    vout_thread_t *p_vout = p_job->p_vout;
+
+    picture_Release( p_job->p_picture );
+    free( p_job->psz_filename );
+    vlc_object_release( p_vout );
+    free( p_job );
+}
+
+/**
+ * This function queues the encoding and writing of a grabbed snapshot, so
+ * that the caller does not wait for the image encoder.
+ * The picture is shared read-only with the job, it is not copied.
+ */
+static void VoutSnapshotQueue( vout_thread_t *p_vout, picture_t *p_picture,
+                               char *psz_filename, const char *psz_format )
+{
+    vout_snapshot_job_t *p_job = malloc( sizeof(*p_job) );
+    if( unlikely(p_job == NULL) )
+    {
+        picture_Release( p_picture );
+        free( psz_filename );
+        return;
+    }
+
+    p_job->p_vout = vlc_object_hold( p_vout );
+    p_job->p_picture = p_picture;
+    p_job->psz_filename = psz_filename;
+    p_job->i_codec = VLC_CODEC_PNG;
+    if( psz_format && image_Type2Fourcc( psz_format ) )
+        p_job->i_codec = image_Type2Fourcc( psz_format );
+    p_job->i_width = var_InheritInteger( p_vout, "snapshot-width" );
+    p_job->i_height = var_InheritInteger( p_vout, "snapshot-height" );
+    vlc_task_Init( &p_job->task, VoutSnapshotRun, p_job );
+    p_job->task.release = VoutSnapshotRelease;
+
+    vlc_executor_t *p_executor = libvlc_priv( p_vout->p_libvlc )->executor;
+    if( p_executor == NULL
+     || vlc_executor_Submit( p_executor, &p_job->task,
+                             VLC_TASK_PRIORITY_NORMAL, VLC_TS_INVALID ) )
+    {
+        VoutSnapshotRun( p_job );
+        VoutSnapshotRelease( p_job );
+    }
+}
+
 /**
  * This function will handle a snapshot request
  */
@@ -370,6 +461,7 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
     char *psz_path = var_InheritString( p_vout, "snapshot-path" );
     char *psz_format = var_InheritString( p_vout, "snapshot-format" );
     char *psz_prefix = var_InheritString( p_vout, "snapshot-prefix" );
+    const bool b_async = var_InheritBool( p_vout, "snapshot-async" );
 
     /* */
     picture_t *p_picture;
@@ -378,12 +470,15 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
 
     /* 500ms timeout
      * XXX it will cause trouble with low fps video (< 2fps) */
-    if( vout_GetSnapshot( p_vout, &p_image, &p_picture, &fmt, psz_format, 500*1000 ) )
+    if( vout_GetSnapshot( p_vout, b_async ? NULL : &p_image, &p_picture,
+                          &fmt, psz_format, 500*1000 ) )
     {
         p_picture = NULL;
         p_image = NULL;
         goto exit;
     }
+    if( b_async )
+        p_image = NULL;
 
     if( !psz_path )
     {
@@ -405,6 +500,22 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
 
     char *psz_filename;
     int  i_sequence;
+    if( b_async )
+    {
+        psz_filename = vout_snapshot_MakeFilename( &i_sequence, p_vout, &cfg );
+        if( !psz_filename )
+        {
+            msg_Err( p_vout, "could not save snapshot" );
+            goto exit;
+        }
+        if( cfg.is_sequential )
+            var_SetInteger( p_vout, "snapshot-num", i_sequence + 1 );
+
+        VoutSnapshotQueue( p_vout, p_picture, psz_filename, psz_format );
+        p_picture = NULL;
+        goto exit;
+    }
+
     if (vout_snapshot_SaveImage( &psz_filename, &i_sequence,
                                  p_image, p_vout, &cfg ) )
         goto exit;
@@ -22,8 +22,12 @@
  **********************************************************************/
 
 #include "test.h"
+#include "../lib/libvlc_internal.h"
 
 #include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 static void test_core (const char ** argv, int argc)
 {
@@ -97,6 +101,121 @@ static void test_audio_output (void)
     libvlc_release (vlc);
 }
 
+/* Resident set size in kiB, or -1 if unknown */
+static long test_rss (void)
+{
+    long pages = -1;
+    FILE *stream = fopen ("/proc/self/statm", "rt");
+
+    if (stream != NULL)
+    {
+        if (fscanf (stream, "%*s %ld", &pages) != 1)
+            pages = -1;
+        fclose (stream);
+    }
+    return (pages >= 0) ? pages * (sysconf (_SC_PAGESIZE) / 1024) : -1;
+}
+
+/* Writes the playback rate to the configuration file, keeping its size and
+ * changing its modification time by less than a second */
+static void test_config_write (const char *path, int rate)
+{
+    struct stat st;
+    bool exists = stat (path, &st) == 0;
+    FILE *stream = fopen (path, "wt");
+
+    assert (stream != NULL);
+    fprintf (stream, "[core]\nrate=%d.000000\n", rate);
+    fclose (stream);
+
+    if (exists)
+    {
+        struct timespec ts[2] = { st.st_atim, st.st_mtim };
+
+        ts[1].tv_nsec = (ts[1].tv_nsec + 500000000) % 1000000000;
+        assert (utimensat (AT_FDCWD, path, ts, 0) == 0);
+    }
+}
+
+/* Playback rate of new media players, from the configuration */
+static float test_config_rate (libvlc_instance_t *vlc)
+{
+    libvlc_media_player_t *mp = libvlc_media_player_new (vlc);
+    assert (mp != NULL);
+
+    float rate = libvlc_media_player_get_rate (mp);
+    libvlc_media_player_release (mp);
+    return rate;
+}
+
+static void test_instances (const char ** argv, int argc)
+{
+    enum { COUNT = 16 };
+    libvlc_instance_t *vlc[COUNT];
+    struct timespec start, end;
+    char path[] = "/tmp/vlc-core-vlcrc-XXXXXX";
+    char config[sizeof (path) + 9];
+    const char *args[argc + 2];
+    int n = 0;
+
+    log ("Testing %d concurrent instances\n", COUNT);
+
+    int fd = mkstemp (path);
+    assert (fd != -1);
+    close (fd);
+    test_config_write (path, 2);
+
+    /* Same as the defaults, but using the configuration file */
+    for (int i = 0; i < argc; i++)
+        if (strcmp (argv[i], "--ignore-config"))
+            args[n++] = argv[i];
+    snprintf (config, sizeof (config), "--config=%s", path);
+    args[n++] = "--no-ignore-config";
+    args[n++] = config;
+
+    /* The first instance loads the shared module bank and configuration */
+    libvlc_instance_t *first = libvlc_new (n, args);
+    assert (first != NULL);
+    assert (test_config_rate (first) == 2.f);
+
+    long before = test_rss ();
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        vlc[i] = libvlc_new (n, args);
+        assert (vlc[i] != NULL);
+    }
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    long after = test_rss ();
+
+    double ms = (end.tv_sec - start.tv_sec) * 1e3
+              + (end.tv_nsec - start.tv_nsec) / 1e6;
+    log ("  %.3f ms per instance\n", ms / COUNT);
+    if (before >= 0 && after >= 0)
+        log ("  %ld kiB per instance\n", (after - before) / COUNT);
+    assert (test_config_rate (vlc[COUNT - 1]) == 2.f);
+
+    /* A file rewritten within the same second is loaded again */
+    test_config_write (path, 3);
+    libvlc_release (vlc[0]);
+    vlc[0] = libvlc_new (n, args);
+    assert (vlc[0] != NULL);
+    assert (test_config_rate (first) == 3.f);
+
+    /* So is an unchanged file after the configuration was reset */
+    config_ResetAll (first->p_libvlc_int);
+    assert (test_config_rate (first) == 1.f);
+    libvlc_release (vlc[0]);
+    vlc[0] = libvlc_new (n, args);
+    assert (vlc[0] != NULL);
+    assert (test_config_rate (first) == 3.f);
+
+    for (unsigned i = 0; i < COUNT; i++)
+        libvlc_release (vlc[i]);
+    libvlc_release (first);
+    unlink (path);
+}
+
 int main (void)
 {
     test_init();
@@ -104,6 +223,7 @@ int main (void)
     test_core (test_defaults_args, test_defaults_nargs);
     test_audiovideofilterlists (test_defaults_args, test_defaults_nargs);
     test_audio_output ();
+    test_instances (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
@@ -0,0 +1,292 @@
+/*
+ * prejoin.c - libvlc pre-joined input (channel zapping) test
+ *
+ * $Id$
+ */
+
+/**********************************************************************
+ *  Copyright (C) 2016 VLC authors and VideoLAN                       *
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+#include "test.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Live MPEG-2 video PS channels, sent to a multicast group of the host */
+#define GROUP       "239.255.42.42"
+#define PORT        5004
+#define CHANNELS    2
+#define FPS         25
+#define GOP         12
+#define CACHING     1000 /* ms */
+
+static int OpenSender (void)
+{
+    int fd = socket (AF_INET, SOCK_DGRAM, 0);
+    unsigned char ttl = 0, loop = 1;
+
+    if (fd == -1)
+        return -1;
+    /* Never leave the host, but loop back to the local receivers */
+    setsockopt (fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof (ttl));
+    setsockopt (fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof (loop));
+    return fd;
+}
+
+static ssize_t SendTo (int fd, const void *data, size_t len, unsigned port)
+{
+    struct sockaddr_in addr;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = inet_addr (GROUP);
+    return sendto (fd, data, len, 0, (struct sockaddr *)&addr, sizeof (addr));
+}
+
+/* Checks that multicast is looped back on this host */
+static bool ProbeMulticast (void)
+{
+    struct sockaddr_in addr;
+    struct ip_mreq mreq;
+    struct timeval tv = { 1, 0 };
+    char c;
+    bool ok = false;
+
+    int rx = socket (AF_INET, SOCK_DGRAM, 0);
+    int tx = OpenSender ();
+    if (rx == -1 || tx == -1)
+        goto out;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (PORT + CHANNELS);
+    addr.sin_addr.s_addr = inet_addr (GROUP);
+    mreq.imr_multiaddr.s_addr = inet_addr (GROUP);
+    mreq.imr_interface.s_addr = htonl (INADDR_ANY);
+    if (bind (rx, (struct sockaddr *)&addr, sizeof (addr))
+     || setsockopt (rx, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof (mreq))
+     || setsockopt (rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv)))
+        goto out;
+
+    ok = SendTo (tx, "", 1, PORT + CHANNELS) == 1
+      && recv (rx, &c, 1, 0) == 1;
+out:
+    if (tx != -1)
+        close (tx);
+    if (rx != -1)
+        close (rx);
+    return ok;
+}
+
+static size_t PackHeader (uint8_t *p, uint64_t scr)
+{
+    static const uint8_t start[] = { 0x00, 0x00, 0x01, 0xBA };
+
+    memcpy (p, start, 4);
+    p[4] = 0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 3);
+    p[5] = scr >> 20;
+    p[6] = 0x04 | ((scr >> 12) & 0xF8) | ((scr >> 13) & 3);
+    p[7] = scr >> 5;
+    p[8] = 0x04 | ((scr << 3) & 0xF8);
+    p[9] = 0x01;
+    p[10] = 0x01; p[11] = 0x89; p[12] = 0xC3; p[13] = 0xF8; /* mux rate */
+    return 14;
+}
+
+/* One I-frame every GOP pictures, the others are P-frames */
+static size_t Frame (uint8_t *p, unsigned n)
+{
+    static const uint8_t seq[] = {
+        0x00, 0x00, 0x01, 0xB3, 0x16, 0x01, 0x20, 0x13,
+        0xFF, 0xFF, 0xE0, 0x18, 0x00, 0x00, 0x01, 0xB8,
+        0x00, 0x08, 0x00, 0x00,
+    };
+    const unsigned type = (n % GOP) ? 2 : 1, tr = n % GOP;
+    const size_t size = (type == 1) ? 3000 : 1000;
+    size_t i = 0;
+
+    if (type == 1)
+    {
+        memcpy (p, seq, sizeof (seq));
+        i += sizeof (seq);
+    }
+    p[i++] = 0x00; p[i++] = 0x00; p[i++] = 0x01; p[i++] = 0x00;
+    p[i++] = tr >> 2;
+    p[i++] = ((tr & 3) << 6) | (type << 3) | 0x7;
+    p[i++] = 0xFF; p[i++] = 0xF8;
+    p[i++] = 0x00; p[i++] = 0x00; p[i++] = 0x01; p[i++] = 0x01; /* slice */
+    for (size_t j = 0; j < size; j++)
+        p[i++] = (j * 7 + n) % 251 + 1;
+    return i;
+}
+
+static size_t Pes (uint8_t *p, uint64_t pts, unsigned n)
+{
+    size_t len = Frame (p + 14, n) + 8;
+
+    p[0] = 0x00; p[1] = 0x00; p[2] = 0x01; p[3] = 0xE0;
+    p[4] = len >> 8; p[5] = len;
+    p[6] = 0x80; p[7] = 0x80; p[8] = 0x05;
+    p[9] = 0x21 | ((pts >> 29) & 0xE);
+    p[10] = pts >> 22;
+    p[11] = 0x01 | ((pts >> 14) & 0xFE);
+    p[12] = pts >> 7;
+    p[13] = 0x01 | ((pts << 1) & 0xFE);
+    return 6 + len;
+}
+
+/* Sends the channels in real time, until killed */
+static void Sender (void)
+{
+    static uint8_t buf[4096];
+    int fd = OpenSender ();
+    assert (fd != -1);
+
+    const libvlc_time_t start = libvlc_clock ();
+    for (unsigned n = 0;; n++)
+    {
+        libvlc_time_t delay = start + n * (INT64_C(1000000) / FPS)
+                            - libvlc_clock ();
+        if (delay > 0)
+            usleep (delay);
+
+        for (unsigned i = 0; i < CHANNELS; i++)
+        {
+            /* the channels are not GOP aligned */
+            const unsigned f = n + 5 * i;
+            const uint64_t scr = 90000 + f * 3600;
+            size_t len = PackHeader (buf, scr);
+
+            len += Pes (buf + len, scr + 36000, f);
+            for (size_t k = 0; k < len; k += 1316)
+                SendTo (fd, buf + k, (len - k < 1316) ? len - k : 1316,
+                        PORT + i);
+        }
+    }
+}
+
+static atomic_llong buffered;
+
+static void OnBuffering (const libvlc_event_t *ev, void *data)
+{
+    (void) data;
+    if (ev->u.media_player_buffering.new_cache >= 100.f)
+    {
+        long long zero = 0;
+        atomic_compare_exchange_strong (&buffered, &zero, libvlc_clock ());
+    }
+}
+
+/* Plays a medium, returns how long it took to buffer it, in ms */
+static int Zap (libvlc_media_player_t *mp, libvlc_media_t *md)
+{
+    atomic_store (&buffered, 0);
+
+    const libvlc_time_t start = libvlc_clock ();
+    libvlc_media_player_set_media (mp, md);
+    libvlc_media_player_play (mp);
+
+    while (atomic_load (&buffered) == 0)
+    {
+        assert (libvlc_media_player_get_state (mp) != libvlc_Error);
+        usleep (10000);
+    }
+    return (atomic_load (&buffered) - start) / 1000;
+}
+
+static void test_prejoin (pid_t sender)
+{
+    const char *argv[test_defaults_nargs + 2];
+    libvlc_media_t *md[CHANNELS];
+
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = "--codec=ddummy";
+    argv[test_defaults_nargs + 1] = "--network-caching=1000";
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs + 2, argv);
+    assert (vlc != NULL);
+
+    for (int i = 0; i < CHANNELS; i++)
+    {
+        char url[64];
+
+        snprintf (url, sizeof (url), "udp://@" GROUP ":%d", PORT + i);
+        md[i] = libvlc_media_new_location (vlc, url);
+        assert (md[i] != NULL);
+    }
+
+    libvlc_media_player_t *mp = libvlc_media_player_new (vlc);
+    assert (mp != NULL);
+    libvlc_event_attach (libvlc_media_player_event_manager (mp),
+                         libvlc_MediaPlayerBuffering, OnBuffering, NULL);
+
+    int normal = Zap (mp, md[0]);
+    log ("zap to a channel: %d ms\n", normal);
+
+    /* Give the other channel time to cache more than a GOP */
+    assert (libvlc_media_player_set_prejoined_media (mp, &md[1], 1) == 0);
+    usleep (1500000);
+
+    int prejoined = Zap (mp, md[1]);
+    log ("zap to a pre-joined channel: %d ms\n", prejoined);
+
+    /* Without pre-joining, the whole network caching is buffered */
+    assert (normal >= CACHING / 2);
+    assert (prejoined < CACHING / 2);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    for (int i = 0; i < CHANNELS; i++)
+        libvlc_media_release (md[i]);
+    libvlc_release (vlc);
+
+    kill (sender, SIGTERM);
+    waitpid (sender, NULL, 0);
+}
+
+int main (void)
+{
+    test_init ();
+
+    if (!ProbeMulticast ())
+    {
+        log ("multicast loopback not available, skipping\n");
+        return 77;
+    }
+
+    pid_t sender = fork ();
+    assert (sender != -1);
+    if (sender == 0)
+    {
+        alarm (15); /* in case the test dies first */
+        Sender ();
+        return 0;
+    }
+
+    test_prejoin (sender);
+    return 0;
+}
@@ -0,0 +1,265 @@
+/*****************************************************************************
+ * rtp_session.c: test the RTP re-ordering queue and FEC recovery
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../modules/access/rtp/session.c"
+#include "../modules/access/rtp/fec.c"
+
+/* After the module sources, as they include config.h and assert.h */
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+/* Sequence numbers from BASE, wrapping around */
+#define BASE    65530
+#define PACKETS 64
+#define L       4 /* FEC columns */
+#define D       3 /* FEC rows */
+
+static block_t *sent[PACKETS];
+static unsigned decoded[PACKETS];
+static unsigned decoded_count;
+static bool discontinuity[PACKETS];
+
+static block_t *Packet (unsigned i)
+{
+    block_t *block = block_Alloc (12 + 2 + i);
+    assert (block != NULL);
+
+    uint8_t *p = block->p_buffer;
+    p[0] = 0x80;
+    p[1] = 33; /* MP2T */
+    SetWBE (p + 2, BASE + i);
+    SetDWBE (p + 4, 90 * i);
+    SetDWBE (p + 8, 0xdeadbeef);
+    SetWBE (p + 12, i);
+    memset (p + 14, i, i); /* different lengths */
+
+    if (sent[i] != NULL)
+        block_Release (sent[i]);
+    sent[i] = block_Duplicate (block);
+    assert (sent[i] != NULL);
+    return block;
+}
+
+/* Sends a packet, or drops it on the way */
+static void Send (demux_t *demux, rtp_session_t *session, unsigned i,
+                  bool received)
+{
+    block_t *block = Packet (i);
+
+    if (received)
+        rtp_queue (demux, session, block);
+    else
+        block_Release (block);
+}
+
+/* Protects count packets from first, offset apart */
+static block_t *Fec (unsigned first, unsigned offset, unsigned count)
+{
+    size_t len = 0;
+    for (unsigned k = 0; k < count; k++)
+    {
+        const block_t *m = sent[first + k * offset];
+        if (m->i_buffer - 12 > len)
+            len = m->i_buffer - 12;
+    }
+
+    block_t *block = block_Alloc (12 + 16 + len);
+    assert (block != NULL);
+    uint8_t *p = block->p_buffer;
+    memset (p, 0, block->i_buffer);
+
+    uint16_t length = 0;
+    uint8_t pt = 0;
+    uint32_t ts = 0;
+    for (unsigned k = 0; k < count; k++)
+    {
+        const block_t *m = sent[first + k * offset];
+        p[0] ^= m->p_buffer[0] & 0x3F;
+        p[1] ^= m->p_buffer[1] & 0x80;
+        pt ^= m->p_buffer[1] & 0x7F;
+        ts ^= GetDWBE (m->p_buffer + 4);
+        length ^= m->i_buffer - 12;
+        for (size_t j = 12; j < m->i_buffer; j++)
+            p[16 + j] ^= m->p_buffer[j];
+    }
+    p[0] |= 0x80;
+    p[1] |= 96;
+
+    uint8_t *h = p + 12;
+    SetWBE (h, BASE + first);
+    SetWBE (h + 2, length);
+    h[4] = 0x80 | pt;
+    SetDWBE (h + 8, ts);
+    h[12] = (offset == 1) ? 0x40 : 0x00; /* D */
+    h[13] = offset;
+    h[14] = count;
+    return block;
+}
+
+static void Decode (demux_t *demux, void *opaque, block_t *block)
+{
+    unsigned i = GetWBE (block->p_buffer);
+
+    assert (decoded_count < PACKETS);
+    assert (block->i_buffer == 2 + i);
+    assert (!memcmp (block->p_buffer + 2, sent[i]->p_buffer + 14, i));
+    discontinuity[i] = (block->i_flags & BLOCK_FLAG_DISCONTINUITY) != 0;
+    decoded[decoded_count++] = i;
+    block_Release (block);
+    (void) demux; (void) opaque;
+}
+
+/* Checks that the given packets were decoded in order since the last call */
+static void Decoded (unsigned first, unsigned last)
+{
+    assert (decoded_count == last + 1 - first);
+    for (unsigned i = 0; i < decoded_count; i++)
+        assert (decoded[i] == first + i);
+    decoded_count = 0;
+}
+
+static void test_reorder (demux_t *demux, rtp_session_t *session)
+{
+    static const unsigned order[] = { 0, 1, 3, 2, 4, 4, 6, 6, 5 };
+    mtime_t deadline;
+
+    for (size_t i = 0; i < ARRAY_SIZE (order); i++)
+        rtp_queue (demux, session, Packet (order[i]));
+    assert (!rtp_dequeue (demux, session, &deadline));
+    Decoded (0, 6);
+    for (unsigned i = 0; i <= 6; i++)
+        assert (!discontinuity[i]);
+
+    /* Too late, after the next packets were decoded */
+    rtp_queue (demux, session, Packet (3));
+    assert (!rtp_dequeue (demux, session, &deadline));
+    assert (decoded_count == 0);
+    assert (session->lost == 0);
+}
+
+static void test_loss (demux_t *demux, rtp_session_t *session)
+{
+    mtime_t deadline;
+
+    /* 7 is lost: wait for it, then give up */
+    rtp_queue (demux, session, Packet (8));
+    rtp_queue (demux, session, Packet (9));
+    assert (rtp_dequeue (demux, session, &deadline));
+    assert (deadline > mdate ());
+    assert (decoded_count == 0);
+
+    mwait (deadline);
+    assert (!rtp_dequeue (demux, session, &deadline));
+    Decoded (8, 9);
+    assert (discontinuity[8] && !discontinuity[9]);
+    assert (session->lost == 1);
+
+    rtp_queue (demux, session, Packet (7));
+    assert (!rtp_dequeue (demux, session, &deadline));
+    assert (decoded_count == 0);
+}
+
+static void test_fec (demux_t *demux, rtp_session_t *session)
+{
+    const unsigned first = 10;
+    rtp_source_t *src = session->srcv[0];
+    mtime_t deadline;
+
+    /* FEC packets come along from now on, the decoded packets are kept */
+    rtp_queue_fec (demux, session, Fec (0, 1, L));
+    assert (session->fec != NULL);
+
+    /* The first matrix loses a packet, which its columns recover */
+    for (unsigned i = first; i < first + L * D; i++)
+        Send (demux, session, i, i != first + 5);
+    assert (rtp_dequeue (demux, session, &deadline));
+    Decoded (first, first + 4);
+
+    for (unsigned c = 0; c < L; c++)
+        rtp_queue_fec (demux, session, Fec (first + c, L, D));
+    assert (rtp_fec_span (session->fec) == 2 * L * D);
+    assert (!rtp_dequeue (demux, session, &deadline));
+    Decoded (first + 5, first + L * D - 1);
+    assert (!discontinuity[first + 5]);
+    assert (session->recovered == 1 && session->lost == 1);
+
+    /* The next one waits longer for its FEC packets, as they are known to
+     * come. The packets come at a steady pace for the interval estimate. */
+    const unsigned next = first + L * D;
+    const unsigned missing = next + L + 1;
+    for (unsigned i = next; i < next + L * D; i++)
+    {
+        Send (demux, session, i, i != missing);
+        usleep (1000);
+    }
+    assert (rtp_dequeue (demux, session, &deadline));
+    Decoded (next, missing - 1);
+
+    const block_t *after = rtp_source_get (src, (uint16_t)(BASE + missing + 1));
+    assert (after != NULL);
+    assert (src->interval > 0);
+    assert (deadline >= after->i_pts + CLOCK_FREQ / 40
+                        + rtp_fec_span (session->fec) * src->interval);
+
+    /* The row of the missing packet recovers it */
+    rtp_queue_fec (demux, session, Fec (next + L, 1, L));
+    assert (!rtp_dequeue (demux, session, &deadline));
+    Decoded (missing, next + L * D - 1);
+    assert (!discontinuity[missing]);
+    assert (session->recovered == 2 && session->lost == 1);
+}
+
+int main (void)
+{
+    test_init ();
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    demux_t *demux = vlc_object_create (vlc->p_libvlc_int, sizeof (*demux));
+    assert (demux != NULL);
+
+    demux_sys_t sys = {
+        .timeout = 60 * CLOCK_FREQ,
+        .max_dropout = 3000,
+        .max_misorder = 100,
+        .max_src = 1,
+    };
+    demux->p_sys = &sys;
+
+    rtp_session_t *session = rtp_session_create (demux);
+    assert (session != NULL);
+
+    const rtp_pt_t pt = { .decode = Decode, .frequency = 90000, .number = 33 };
+    assert (rtp_add_type (demux, session, &pt) == 0);
+
+    test_reorder (demux, session);
+    test_loss (demux, session);
+    test_fec (demux, session);
+
+    rtp_session_destroy (demux, session);
+    for (unsigned i = 0; i < PACKETS; i++)
+        if (sent[i] != NULL)
+            block_Release (sent[i]);
+    vlc_object_release (demux);
+    libvlc_release (vlc);
+    return 0;
+}
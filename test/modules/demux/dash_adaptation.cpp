@@ -0,0 +1,366 @@
+/*****************************************************************************
+ * dash_adaptation.cpp: replay bandwidth traces against the DASH adaptation
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_dash_adaptation [mpd trace]
+ * The trace has one "<duration in s> <bandwidth in kbps>" step per line.
+ * Without arguments, built-in traces are replayed and checked. The given
+ * trace is replayed against the buffer and the rate based logics. */
+
+#define __STDC_FORMAT_MACROS 1
+#define __STDC_CONSTANT_MACROS 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+#include <vlc_common.h>
+#include "../modules/demux/dash/adaptationlogic/BufferBasedRule.cpp"
+
+using namespace dash::logic;
+
+#define TARGET      (10 * CLOCK_FREQ)   /* dash-buffer default */
+#define READ_SIZE   32768               /* as the downloader */
+#define CONTENT     (120 * CLOCK_FREQ)
+
+struct step
+{
+    mtime_t  duration;
+    uint64_t bps;
+};
+
+struct result
+{
+    mtime_t  startup;
+    mtime_t  rebuffer;
+    uint64_t bitrate; /* average */
+    unsigned switches;
+};
+
+static const char sample_mpd[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\"\n"
+    "     mediaPresentationDuration=\"PT120S\" minBufferTime=\"PT2S\"\n"
+    "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\">\n"
+    " <Period><AdaptationSet mimeType=\"video/mp4\">\n"
+    "  <SegmentTemplate timescale=\"1000\" duration=\"2000\"\n"
+    "                   media=\"$RepresentationID$/$Number$.m4s\"/>\n"
+    "  <Representation id=\"1\" bandwidth=\"300000\"/>\n"
+    "  <Representation id=\"2\" bandwidth=\"750000\"/>\n"
+    "  <Representation id=\"3\" bandwidth=\"1500000\"/>\n"
+    "  <Representation id=\"4\" bandwidth=\"3000000\"/>\n"
+    "  <Representation id=\"5\" bandwidth=\"6000000\"/>\n"
+    " </AdaptationSet></Period>\n"
+    "</MPD>\n";
+
+/* Only what the simulation needs: the bandwidths and segment duration */
+static mtime_t parse_mpd(const std::string &mpd, std::vector<uint64_t> &rates)
+{
+    for(size_t pos = mpd.find("bandwidth=\""); pos != std::string::npos;
+        pos = mpd.find("bandwidth=\"", pos + 1))
+        rates.push_back(strtoull(mpd.c_str() + pos + 11, NULL, 10));
+
+    uint64_t timescale = 1, duration = 0;
+    size_t pos = mpd.find("timescale=\"");
+    if(pos != std::string::npos)
+        timescale = strtoull(mpd.c_str() + pos + 11, NULL, 10);
+    pos = mpd.find(" duration=\"");
+    if(pos != std::string::npos)
+        duration = strtoull(mpd.c_str() + pos + 11, NULL, 10);
+    if(timescale == 0)
+        timescale = 1;
+
+    /* ascending, as the adaptation logic sorts them */
+    for(size_t i = 1; i < rates.size(); i++)
+        for(size_t j = i; j > 0 && rates[j - 1] > rates[j]; j--)
+            std::swap(rates[j - 1], rates[j]);
+
+    return CLOCK_FREQ * duration / timescale;
+}
+
+static uint64_t trace_at(const std::vector<step> &trace, mtime_t t)
+{
+    mtime_t total = 0;
+    for(size_t i = 0; i < trace.size(); i++)
+        total += trace[i].duration;
+    t %= total; /* loops */
+    for(size_t i = 0; i < trace.size(); i++)
+    {
+        if(t < trace[i].duration)
+            return trace[i].bps;
+        t -= trace[i].duration;
+    }
+    return trace.back().bps;
+}
+
+/* The logics under test, as seen by the downloader */
+class Logic
+{
+    public:
+        virtual ~Logic() {}
+        virtual unsigned select(mtime_t buffer) = 0;
+        virtual void push(size_t size, mtime_t time) = 0;
+};
+
+class BufferBased : public Logic
+{
+    public:
+        BufferBased(const std::vector<uint64_t> &rates) : rule(TARGET)
+        {
+            rule.setBitrates(rates);
+        }
+        virtual unsigned select(mtime_t buffer)
+        {
+            return rule.select(buffer, estimator.get());
+        }
+        virtual void push(size_t size, mtime_t time)
+        {
+            estimator.push(size, time);
+        }
+
+    private:
+        ThroughputEstimator estimator;
+        BufferBasedRule     rule;
+};
+
+/* Replica of RateBasedAdaptationLogic: the running average of all the
+ * samples, refreshed every 5 samples, and the highest bitrate under it */
+class RateBased : public Logic
+{
+    public:
+        RateBased(const std::vector<uint64_t> &rates_) :
+            rates(rates_), avg(0), count(0), current(0) {}
+        virtual unsigned select(mtime_t)
+        {
+            unsigned index = 0;
+            for(unsigned i = 0; i < rates.size(); i++)
+                if(rates[i] < current)
+                    index = i;
+            return index;
+        }
+        virtual void push(size_t size, mtime_t time)
+        {
+            uint64_t bps = size * 8 * CLOCK_FREQ / time;
+            if(bps >= avg)
+                avg += (bps - avg) / (count + 1);
+            else
+                avg -= (avg - bps) / (count + 1);
+            if(++count % 5 == 0)
+                current = avg;
+        }
+
+    private:
+        std::vector<uint64_t> rates;
+        uint64_t avg;
+        unsigned count;
+        uint64_t current;
+};
+
+static result simulate(const std::vector<uint64_t> &rates, mtime_t segment,
+                       const std::vector<step> &trace, Logic &logic)
+{
+    result res = { 0, 0, 0, 0 };
+    mtime_t now = 0, buffer = 0;
+    bool playing = false;
+    unsigned count = CONTENT / segment, last = 0;
+    uint64_t total = 0;
+
+    for(unsigned n = 0; n < count; n++)
+    {
+        /* the downloader waits while the buffer is full */
+        if(buffer > TARGET)
+        {
+            now += buffer - TARGET;
+            buffer = TARGET;
+        }
+
+        unsigned index = logic.select(buffer);
+        if(n > 0 && index != last)
+            res.switches++;
+        last = index;
+        total += rates[index];
+
+        uint64_t size = rates[index] * segment / CLOCK_FREQ / 8;
+        while(size > 0)
+        {
+            uint64_t read = size > READ_SIZE ? READ_SIZE : size;
+            mtime_t time = read * 8 * CLOCK_FREQ / trace_at(trace, now);
+            if(time == 0)
+                time = 1;
+            logic.push(read, time);
+            size -= read;
+            now += time;
+
+            if(!playing)
+                continue;
+            if(buffer >= time)
+                buffer -= time;
+            else
+            {
+                res.rebuffer += time - buffer;
+                buffer = 0;
+            }
+        }
+
+        buffer += segment;
+        if(!playing)
+        {
+            playing = true;
+            res.startup = now;
+        }
+    }
+
+    res.bitrate = total / count;
+    return res;
+}
+
+static result simulate(const std::vector<uint64_t> &rates, mtime_t segment,
+                       const std::vector<step> &trace)
+{
+    BufferBased logic(rates);
+    return simulate(rates, segment, trace, logic);
+}
+
+static void report(const char *name, const result &res)
+{
+    printf("%-12s startup %5.2fs rebuffer %6.2fs bitrate %5" PRIu64 " kbps"
+           " switches %u\n", name, (double) res.startup / CLOCK_FREQ,
+           (double) res.rebuffer / CLOCK_FREQ, res.bitrate / 1000,
+           res.switches);
+}
+
+static std::vector<step> make_trace(const uint64_t *kbps, size_t count,
+                                    mtime_t duration)
+{
+    std::vector<step> trace;
+    for(size_t i = 0; i < count; i++)
+    {
+        step s = { duration, kbps[i] * 1000 };
+        trace.push_back(s);
+    }
+    return trace;
+}
+
+static int replay(const char *mpdpath, const char *tracepath)
+{
+    FILE *f = fopen(mpdpath, "r");
+    if(f == NULL)
+    {
+        perror(mpdpath);
+        return 1;
+    }
+    std::string mpd;
+    char buf[4096];
+    size_t len;
+    while((len = fread(buf, 1, sizeof(buf), f)) > 0)
+        mpd.append(buf, len);
+    fclose(f);
+
+    f = fopen(tracepath, "r");
+    if(f == NULL)
+    {
+        perror(tracepath);
+        return 1;
+    }
+    std::vector<step> trace;
+    double seconds;
+    unsigned long long kbps;
+    while(fscanf(f, "%lf %llu", &seconds, &kbps) == 2)
+    {
+        step s = { (mtime_t)(seconds * CLOCK_FREQ), kbps * 1000 };
+        if(s.duration > 0 && s.bps > 0)
+            trace.push_back(s);
+    }
+    fclose(f);
+
+    std::vector<uint64_t> rates;
+    mtime_t segment = parse_mpd(mpd, rates);
+    if(rates.empty() || segment <= 0 || trace.empty())
+    {
+        fprintf(stderr, "nothing to replay\n");
+        return 1;
+    }
+    report("buffer based", simulate(rates, segment, trace));
+    RateBased ratebased(rates);
+    report("rate based", simulate(rates, segment, trace, ratebased));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc == 3)
+        return replay(argv[1], argv[2]);
+
+    std::vector<uint64_t> rates;
+    mtime_t segment = parse_mpd(sample_mpd, rates);
+    assert(rates.size() == 5 && segment == 2 * CLOCK_FREQ);
+
+    /* steady link: converge on the highest bitrate it sustains */
+    static const uint64_t steady[] = { 4000 };
+    result res = simulate(rates, segment, make_trace(steady, 1, CLOCK_FREQ));
+    report("steady", res);
+    assert(res.rebuffer == 0);
+    assert(res.bitrate >= 2500000);
+    assert(res.switches <= 4);
+
+    /* oscillating link: do not follow each swing */
+    static const uint64_t swing[] = { 5000, 1200 };
+    res = simulate(rates, segment, make_trace(swing, 2, 5 * CLOCK_FREQ));
+    report("oscillating", res);
+    assert(res.rebuffer == 0);
+    assert(res.switches <= 12);
+
+    /* sudden drop below the current bitrate, then recovery */
+    static const uint64_t drop[] = { 8000, 8000, 8000, 1500, 1500, 8000 };
+    res = simulate(rates, segment, make_trace(drop, 6, 10 * CLOCK_FREQ));
+    report("drop", res);
+    assert(res.rebuffer < 2 * CLOCK_FREQ);
+    assert(res.bitrate >= 1500000);
+
+    /* the rate based logic keeps the bitrate from before the drop */
+    RateBased ratebased(rates);
+    result rate = simulate(rates, segment, make_trace(drop, 6, 10 * CLOCK_FREQ),
+                           ratebased);
+    report("drop (rate)", rate);
+    assert(rate.rebuffer > res.rebuffer + 5 * CLOCK_FREQ);
+
+    /* noisy link, from a fixed seed */
+    uint64_t noisy[120];
+    unsigned seed = 1;
+    for(unsigned i = 0; i < 120; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        noisy[i] = 500 + (seed >> 16) % 4000;
+    }
+    res = simulate(rates, segment, make_trace(noisy, 120, CLOCK_FREQ));
+    report("noisy", res);
+    assert(res.rebuffer < CLOCK_FREQ);
+    assert(res.bitrate >= 750000);
+
+    return 0;
+}
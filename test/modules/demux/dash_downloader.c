@@ -0,0 +1,363 @@
+/*****************************************************************************
+ * dash_downloader.c: test the DASH segment downloaders
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Two adaptation sets of one second segments, served with some latency */
+#define SEGMENTS    8
+#define SEGSIZE     4096
+#define LATENCY     100     /* ms */
+#define MAXCONN     8
+
+enum { VIDEO, AUDIO };
+static const char *const sets[2] = { "video", "audio" };
+
+/* Lists the segments, as templates do not end with the presentation */
+static size_t WriteMpd (char *buf, size_t size)
+{
+    size_t len = snprintf (buf, size,
+        "<?xml version=\"1.0\"?>\n"
+        "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\"\n"
+        "     mediaPresentationDuration=\"PT%uS\" minBufferTime=\"PT1S\"\n"
+        "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\">\n"
+        " <Period>\n", SEGMENTS);
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        len += snprintf (buf + len, size - len,
+            "  <AdaptationSet mimeType=\"%s/mp4\">\n"
+            "   <Representation id=\"%u\" bandwidth=\"32768\">\n"
+            "    <SegmentList timescale=\"1000\" duration=\"1000\">\n",
+            sets[i], i);
+        for (unsigned n = 1; n <= SEGMENTS; n++)
+            len += snprintf (buf + len, size - len,
+                "     <SegmentURL media=\"%s/%u.m4s\"/>\n", sets[i], n);
+        len += snprintf (buf + len, size - len,
+            "    </SegmentList>\n"
+            "   </Representation>\n"
+            "  </AdaptationSet>\n");
+    }
+    len += snprintf (buf + len, size - len, " </Period>\n</MPD>\n");
+    assert (len < size);
+    return len;
+}
+
+/*** HTTP server ***/
+
+/* Shared with the server process */
+static struct
+{
+    atomic_uint requests[2][SEGMENTS + 2];
+    atomic_uint pending, max_pending;
+} *stats;
+
+typedef struct
+{
+    int           fd;
+    char          buf[1024];
+    size_t        len;
+    char          path[256];
+    libvlc_time_t due; /* when to answer, 0 if idle */
+} conn_t;
+
+static void Reply (int fd, const char *type, const void *data, size_t len)
+{
+    char hdr[256];
+    int hlen = snprintf (hdr, sizeof (hdr), "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                         type, len);
+
+    send (fd, hdr, hlen, MSG_NOSIGNAL);
+    send (fd, data, len, MSG_NOSIGNAL);
+}
+
+static void Answer (conn_t *c)
+{
+    static uint8_t segment[SEGSIZE];
+    unsigned n;
+
+    atomic_fetch_sub (&stats->pending, 1);
+    if (!strcmp (c->path, "/sample.mpd"))
+    {
+        char mpd[4096];
+
+        Reply (c->fd, "application/dash+xml", mpd,
+               WriteMpd (mpd, sizeof (mpd)));
+        return;
+    }
+
+    int set = strncmp (c->path, "/video/", 7) ? AUDIO : VIDEO;
+    if (sscanf (c->path + 7, "%u.m4s", &n) != 1 || n > SEGMENTS)
+        n = SEGMENTS + 1; /* unexpected */
+
+    /* An empty MP4 box */
+    memset (segment, 0, sizeof (segment));
+    segment[2] = (SEGSIZE >> 8) & 0xFF;
+    segment[3] = SEGSIZE & 0xFF;
+    memcpy (segment + 4, "free", 4);
+    Reply (c->fd, "video/mp4", segment, sizeof (segment));
+    atomic_fetch_add (&stats->requests[set][n], 1);
+}
+
+/* Reads a request, and schedules its answer */
+static bool Receive (conn_t *c)
+{
+    ssize_t val = recv (c->fd, c->buf + c->len, sizeof (c->buf) - 1 - c->len,
+                        0);
+    if (val <= 0)
+        return false;
+    c->len += val;
+    c->buf[c->len] = '\0';
+
+    char *end = strstr (c->buf, "\r\n\r\n");
+    if (end == NULL)
+        return c->len < sizeof (c->buf) - 1;
+    if (sscanf (c->buf, "GET %255s", c->path) != 1)
+        return false;
+
+    end += 4;
+    c->len -= end - c->buf;
+    memmove (c->buf, end, c->len);
+    c->due = libvlc_clock () + LATENCY * 1000;
+
+    unsigned pending = atomic_fetch_add (&stats->pending, 1) + 1;
+    unsigned max = atomic_load (&stats->max_pending);
+    while (pending > max
+        && !atomic_compare_exchange_weak (&stats->max_pending, &max, pending));
+    return true;
+}
+
+/* Serves until killed, answering each request after the latency */
+static void Server (int lfd)
+{
+    conn_t conns[MAXCONN];
+    unsigned count = 0;
+
+    for (;;)
+    {
+        struct pollfd ufd[MAXCONN + 1];
+        int timeout = -1;
+        libvlc_time_t now = libvlc_clock ();
+
+        ufd[0].fd = lfd;
+        ufd[0].events = (count < MAXCONN) ? POLLIN : 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            ufd[1 + i].fd = conns[i].fd;
+            ufd[1 + i].events = conns[i].due ? 0 : POLLIN;
+            if (conns[i].due)
+            {
+                int delay = (conns[i].due - now + 999) / 1000;
+                if (delay < 0)
+                    delay = 0;
+                if (timeout == -1 || delay < timeout)
+                    timeout = delay;
+            }
+        }
+
+        poll (ufd, 1 + count, timeout);
+        now = libvlc_clock ();
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            conn_t *c = &conns[i];
+            bool ok = true;
+
+            if (c->due && c->due <= now)
+            {
+                c->due = 0;
+                Answer (c);
+            }
+            else if (ufd[1 + i].revents)
+                ok = Receive (c);
+
+            if (!ok)
+            {
+                close (c->fd);
+                conns[i] = conns[--count];
+                ufd[1 + i] = ufd[1 + count];
+                i--;
+            }
+        }
+
+        if (ufd[0].revents & POLLIN)
+        {
+            int fd = accept (lfd, NULL, NULL);
+            if (fd != -1)
+                conns[count++] = (conn_t){ .fd = fd, .len = 0, .due = 0 };
+        }
+    }
+}
+
+/*** Playback ***/
+static libvlc_media_player_t *Play (libvlc_instance_t *vlc, unsigned port)
+{
+    char url[64];
+
+    memset (stats, 0, sizeof (*stats));
+    snprintf (url, sizeof (url), "http://127.0.0.1:%u/sample.mpd", port);
+
+    libvlc_media_t *md = libvlc_media_new_location (vlc, url);
+    assert (md != NULL);
+    libvlc_media_add_option (md, ":demux=dash");
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (md);
+    assert (mp != NULL);
+    libvlc_media_release (md);
+    libvlc_media_player_play (mp);
+    return mp;
+}
+
+static unsigned Requested (int set)
+{
+    unsigned count = 0;
+
+    for (unsigned n = 1; n <= SEGMENTS; n++)
+    {
+        unsigned val = atomic_load (&stats->requests[set][n]);
+
+        assert (val <= 1); /* never downloaded twice */
+        count += val;
+    }
+    assert (atomic_load (&stats->requests[set][0]) == 0);
+    assert (atomic_load (&stats->requests[set][SEGMENTS + 1]) == 0);
+    return count;
+}
+
+static libvlc_instance_t *Create (const char *buffer)
+{
+    const char *argv[test_defaults_nargs + 1];
+
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = buffer;
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs + 1, argv);
+    assert (vlc != NULL);
+    return vlc;
+}
+
+/* Everything is downloaded ahead, both adaptation sets at once */
+static void test_parallel (unsigned port)
+{
+    libvlc_instance_t *vlc = Create ("--dash-buffer=60000");
+    libvlc_media_player_t *mp = Play (vlc, port);
+
+    const libvlc_time_t start = libvlc_clock ();
+    libvlc_state_t state;
+    /* The input stops at the end of the segments */
+    while ((state = libvlc_media_player_get_state (mp)) != libvlc_Ended
+        && state != libvlc_Stopped)
+    {
+        assert (state != libvlc_Error);
+        usleep (10000);
+    }
+    const libvlc_time_t duration = libvlc_clock () - start;
+
+    log ("%u+%u segments in %"PRId64" ms, %u at once\n", Requested (VIDEO),
+         Requested (AUDIO), duration / 1000,
+         atomic_load (&stats->max_pending));
+    assert (Requested (VIDEO) == SEGMENTS);
+    assert (Requested (AUDIO) == SEGMENTS);
+    assert (atomic_load (&stats->max_pending) >= 2);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
+
+/* The segments carry no media, so the playback time never advances and
+ * the downloads stop at the buffer target */
+static void test_target (unsigned port)
+{
+    libvlc_instance_t *vlc = Create ("--dash-buffer=3000");
+    libvlc_media_player_t *mp = Play (vlc, port);
+
+    /* The buffer fills up within a few latencies, wait longer on slow hosts */
+    const libvlc_time_t deadline = libvlc_clock () + 5000000;
+    while (Requested (VIDEO) < 3 || Requested (AUDIO) < 3)
+    {
+        assert (libvlc_clock () < deadline);
+        usleep (10000);
+    }
+
+    /* Then nothing more is requested. A slow host may miss an overshoot,
+     * but cannot fail this. */
+    usleep (5 * LATENCY * 1000);
+    log ("%u+%u segments buffered\n", Requested (VIDEO), Requested (AUDIO));
+    assert (Requested (VIDEO) == 3);
+    assert (Requested (AUDIO) == 3);
+    assert (libvlc_media_player_get_state (mp) == libvlc_Playing);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
+
+int main (void)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof (addr);
+
+    test_init ();
+
+    stats = mmap (NULL, sizeof (*stats), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert (stats != MAP_FAILED);
+
+    int lfd = socket (AF_INET, SOCK_STREAM, 0);
+    assert (lfd != -1);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    assert (bind (lfd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert (listen (lfd, MAXCONN) == 0);
+    assert (getsockname (lfd, (struct sockaddr *)&addr, &addrlen) == 0);
+
+    pid_t server = fork ();
+    assert (server != -1);
+    if (server == 0)
+    {
+        alarm (15); /* in case the test dies first */
+        Server (lfd);
+        return 0;
+    }
+    close (lfd);
+
+    test_parallel (ntohs (addr.sin_port));
+    test_target (ntohs (addr.sin_port));
+
+    kill (server, SIGTERM);
+    waitpid (server, NULL, 0);
+    munmap (stats, sizeof (*stats));
+    return 0;
+}
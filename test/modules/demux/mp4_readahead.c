@@ -0,0 +1,345 @@
+/*****************************************************************************
+ * mp4_readahead.c: test and measure the MP4 demuxer read-ahead
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/* One chunk of each track per second, video first */
+#define SECONDS     20
+#define FPS         25
+#define RATE        8000 /* 16-bit mono PCM */
+
+/*** MP4 writer ***/
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    size_t   i_alloc;
+    size_t   stack[8];
+    unsigned i_depth;
+} box_t;
+
+static void Put (box_t *b, const void *data, size_t len)
+{
+    if (b->i_size + len > b->i_alloc)
+    {
+        b->i_alloc = 2 * (b->i_size + len);
+        b->p = realloc (b->p, b->i_alloc);
+        assert (b->p != NULL);
+    }
+    if (data != NULL)
+        memcpy (b->p + b->i_size, data, len);
+    else
+        memset (b->p + b->i_size, 0, len);
+    b->i_size += len;
+}
+
+static void Put8 (box_t *b, uint8_t v)
+{
+    Put (b, &v, 1);
+}
+
+static void Put16 (box_t *b, uint16_t v)
+{
+    Put8 (b, v >> 8);
+    Put8 (b, v);
+}
+
+static void Put32 (box_t *b, uint32_t v)
+{
+    Put16 (b, v >> 16);
+    Put16 (b, v);
+}
+
+static void Begin (box_t *b, const char *type)
+{
+    assert (b->i_depth < 8);
+    b->stack[b->i_depth++] = b->i_size;
+    Put32 (b, 0);
+    Put (b, type, 4);
+}
+
+static void BeginFull (box_t *b, const char *type, uint32_t flags)
+{
+    Begin (b, type);
+    Put32 (b, flags);
+}
+
+static void End (box_t *b)
+{
+    size_t start = b->stack[--b->i_depth];
+    uint32_t size = b->i_size - start;
+
+    b->p[start] = size >> 24;
+    b->p[start + 1] = size >> 16;
+    b->p[start + 2] = size >> 8;
+    b->p[start + 3] = size;
+}
+
+static void Matrix (box_t *b)
+{
+    static const uint32_t m[9] = { 0x10000, 0, 0, 0, 0x10000, 0, 0, 0,
+                                   0x40000000 };
+    for (unsigned i = 0; i < 9; i++)
+        Put32 (b, m[i]);
+}
+
+static uint32_t VideoSize (unsigned n)
+{
+    return 6000 + (n % 7) * 1000;
+}
+
+static void Track (box_t *b, unsigned id, const uint32_t *offsets)
+{
+    const bool video = id == 1;
+    const uint32_t scale = video ? FPS : RATE;
+
+    Begin (b, "trak");
+    BeginFull (b, "tkhd", 7);
+    Put32 (b, 0); Put32 (b, 0); Put32 (b, id); Put32 (b, 0);
+    Put32 (b, SECONDS * 1000);
+    Put (b, NULL, 8);
+    Put16 (b, 0); Put16 (b, 0); Put16 (b, video ? 0 : 0x100); Put16 (b, 0);
+    Matrix (b);
+    Put32 (b, video ? 320 << 16 : 0); Put32 (b, video ? 240 << 16 : 0);
+    End (b);
+
+    Begin (b, "mdia");
+    BeginFull (b, "mdhd", 0);
+    Put32 (b, 0); Put32 (b, 0); Put32 (b, scale); Put32 (b, SECONDS * scale);
+    Put16 (b, 0x55C4); Put16 (b, 0);
+    End (b);
+    BeginFull (b, "hdlr", 0);
+    Put32 (b, 0);
+    Put (b, video ? "vide" : "soun", 4);
+    Put (b, NULL, 12 + 1);
+    End (b);
+
+    Begin (b, "minf");
+    if (video)
+    {
+        BeginFull (b, "vmhd", 1);
+        Put (b, NULL, 8);
+    }
+    else
+    {
+        BeginFull (b, "smhd", 0);
+        Put32 (b, 0);
+    }
+    End (b);
+    Begin (b, "dinf");
+    BeginFull (b, "dref", 0);
+    Put32 (b, 1);
+    BeginFull (b, "url ", 1);
+    End (b);
+    End (b);
+    End (b);
+
+    Begin (b, "stbl");
+    BeginFull (b, "stsd", 0);
+    Put32 (b, 1);
+    if (video)
+    {
+        Begin (b, "jpeg");
+        Put (b, NULL, 6); Put16 (b, 1);
+        Put (b, NULL, 16);
+        Put16 (b, 320); Put16 (b, 240);
+        Put32 (b, 72 << 16); Put32 (b, 72 << 16); Put32 (b, 0);
+        Put16 (b, 1);
+        Put (b, NULL, 32);
+        Put16 (b, 24); Put16 (b, 0xFFFF);
+    }
+    else
+    {
+        Begin (b, "sowt");
+        Put (b, NULL, 6); Put16 (b, 1);
+        Put16 (b, 0); Put16 (b, 0); Put32 (b, 0);
+        Put16 (b, 1); Put16 (b, 16); Put16 (b, 0); Put16 (b, 0);
+        Put32 (b, RATE << 16);
+    }
+    End (b);
+    End (b);
+
+    BeginFull (b, "stts", 0);
+    Put32 (b, 1); Put32 (b, SECONDS * scale); Put32 (b, 1);
+    End (b);
+    BeginFull (b, "stsc", 0);
+    Put32 (b, 1); Put32 (b, 1); Put32 (b, scale); Put32 (b, 1);
+    End (b);
+    BeginFull (b, "stsz", 0);
+    if (video)
+    {
+        Put32 (b, 0); Put32 (b, SECONDS * FPS);
+        for (unsigned n = 0; n < SECONDS * FPS; n++)
+            Put32 (b, VideoSize (n));
+    }
+    else
+    {
+        Put32 (b, 2); Put32 (b, SECONDS * RATE);
+    }
+    End (b);
+    BeginFull (b, "stco", 0);
+    Put32 (b, SECONDS);
+    for (unsigned i = 0; i < SECONDS; i++)
+        Put32 (b, offsets[i]);
+    End (b);
+    End (b); /* stbl */
+    End (b); /* minf */
+    End (b); /* mdia */
+    End (b); /* trak */
+}
+
+/* Writes an interleaved movie, returns the size of its samples */
+static size_t WriteMovie (const char *path)
+{
+    box_t b = { .i_depth = 0 };
+    uint32_t video[SECONDS], audio[SECONDS];
+
+    Begin (&b, "ftyp");
+    Put (&b, "isom", 4); Put32 (&b, 0x200); Put (&b, "isommp41", 8);
+    End (&b);
+
+    Begin (&b, "mdat");
+    for (unsigned i = 0; i < SECONDS; i++)
+    {
+        video[i] = b.i_size;
+        for (unsigned n = i * FPS; n < (i + 1) * FPS; n++)
+        {
+            size_t pos = b.i_size;
+
+            Put (&b, NULL, VideoSize (n));
+            memset (b.p + pos, n, VideoSize (n));
+        }
+        audio[i] = b.i_size;
+        Put (&b, NULL, 2 * RATE);
+    }
+    End (&b);
+    const size_t samples = b.i_size - video[0];
+
+    Begin (&b, "moov");
+    BeginFull (&b, "mvhd", 0);
+    Put32 (&b, 0); Put32 (&b, 0); Put32 (&b, 1000); Put32 (&b, SECONDS * 1000);
+    Put32 (&b, 0x10000); Put16 (&b, 0x100); Put (&b, NULL, 10);
+    Matrix (&b);
+    Put (&b, NULL, 24);
+    Put32 (&b, 3);
+    End (&b);
+    Track (&b, 1, video);
+    Track (&b, 2, audio);
+    End (&b);
+    assert (b.i_depth == 0);
+
+    FILE *stream = fopen (path, "wb");
+    assert (stream != NULL);
+    assert (fwrite (b.p, 1, b.i_size, stream) == b.i_size);
+    fclose (stream);
+    free (b.p);
+    return samples;
+}
+
+/*** Playback ***/
+static uint64_t bytes, reads, seeks;
+static atomic_bool closed;
+
+/* Catches the statistics logged by the demuxer when closing */
+static void Log (void *data, int level, const libvlc_log_t *ctx,
+                 const char *fmt, va_list ap)
+{
+    char msg[256];
+
+    vsnprintf (msg, sizeof (msg), fmt, ap);
+    if (sscanf (msg, "read %"SCNu64" bytes with %"SCNu64" reads and "
+                "%"SCNu64" seeks", &bytes, &reads, &seeks) == 3)
+        atomic_store (&closed, true);
+    (void) data; (void) level; (void) ctx;
+}
+
+/* Demuxes the whole movie, returns how long it took in microseconds */
+static libvlc_time_t Play (const char *path, const char *readahead)
+{
+    const char *argv[test_defaults_nargs + 1];
+
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = readahead;
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs + 1, argv);
+    assert (vlc != NULL);
+    libvlc_log_set (vlc, Log, NULL);
+    atomic_store (&closed, false);
+
+    libvlc_media_t *md = libvlc_media_new_path (vlc, path);
+    assert (md != NULL);
+    libvlc_media_add_option (md, ":demux=mp4");
+    /* Not paced by the clock */
+    libvlc_media_add_option (md, ":sout=#dummy");
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (md);
+    assert (mp != NULL);
+    libvlc_media_release (md);
+
+    const libvlc_time_t start = libvlc_clock ();
+    libvlc_media_player_play (mp);
+    while (!atomic_load (&closed))
+    {
+        assert (libvlc_media_player_get_state (mp) != libvlc_Error);
+        usleep (10000);
+    }
+    const libvlc_time_t duration = libvlc_clock () - start;
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+    return duration;
+}
+
+int main (void)
+{
+    char path[] = "/tmp/vlc-mp4-readahead-XXXXXX";
+    int fd = mkstemp (path);
+
+    test_init ();
+    assert (fd != -1);
+    close (fd);
+
+    const size_t samples = WriteMovie (path);
+    log ("interleaved movie with %zu bytes of samples\n", samples);
+
+    libvlc_time_t direct = Play (path, "--mp4-readahead=0");
+    log ("without read-ahead: %"PRIu64" reads, %"PRIu64" seeks, %"PRId64
+         " ms\n", reads, seeks, direct / 1000);
+    /* Every video sample is read on its own */
+    assert (bytes == samples);
+    assert (reads >= SECONDS * FPS);
+
+    libvlc_time_t ahead = Play (path, "--mp4-readahead=4096");
+    log ("with read-ahead: %"PRIu64" reads, %"PRIu64" seeks, %"PRId64
+         " ms\n", reads, seeks, ahead / 1000);
+    /* Nothing is read twice, mostly by windows of a quarter of the budget */
+    assert (bytes == samples);
+    assert (reads > 0 && reads <= 2 * samples / (1024 * 1024) + 1);
+
+    unlink (path);
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*****************************************************************************
+ * csa.c: test the DVB common scrambling algorithm
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../modules/mux/mpeg/csa.c"
+
+#define N_PKT 1000
+
+static const uint8_t even_ck[8] = { 0x4a, 0x11, 0x23, 0x7e, 0x89, 0xa5, 0x31, 0x0f };
+static const uint8_t odd_ck[8]  = { 0xe3, 0x5b, 0x00, 0x3e, 0x10, 0x94, 0xf6, 0x9a };
+
+/* Payloads 0, 1, 2... scrambled with the even key (184 bytes) and with the
+ * odd key (27 bytes after an adaptation field) */
+static const uint8_t kat_full[184] =
+{
+    0xf0, 0xa4, 0x58, 0xd3, 0xa2, 0x58, 0x7c, 0xdd, 0x5c, 0x49, 0x3d, 0x5c,
+    0x70, 0xc3, 0x62, 0xc7, 0x57, 0x42, 0x9e, 0x58, 0x8b, 0xef, 0xde, 0x7e,
+    0x6d, 0x36, 0xe1, 0x16, 0x4a, 0xb4, 0xe3, 0x22, 0xb0, 0xd1, 0x88, 0x07,
+    0x33, 0x51, 0x37, 0x82, 0xc6, 0xcd, 0x59, 0x34, 0x5a, 0xd0, 0xc3, 0x40,
+    0xb6, 0x80, 0xbb, 0x5f, 0x8a, 0x15, 0xe1, 0xa7, 0xe9, 0x28, 0x6d, 0xf8,
+    0x8e, 0x9b, 0xe8, 0x6c, 0x62, 0xfa, 0xd1, 0x1d, 0x10, 0xef, 0x00, 0xf3,
+    0x26, 0x3b, 0x35, 0x6a, 0x8c, 0xdc, 0xa2, 0xde, 0xd6, 0x1e, 0x15, 0xfd,
+    0x37, 0x60, 0xb3, 0x03, 0x64, 0x06, 0xdb, 0x61, 0xc3, 0x9e, 0xd0, 0x4f,
+    0xae, 0xdf, 0x21, 0x26, 0xbc, 0xed, 0x8d, 0x4c, 0xa4, 0x58, 0x87, 0xe3,
+    0x4c, 0xf2, 0x5f, 0x73, 0xc5, 0x70, 0x3c, 0x54, 0xa0, 0x59, 0xed, 0x70,
+    0x33, 0xe0, 0x8e, 0xb9, 0x1a, 0x38, 0x78, 0xee, 0x68, 0xfc, 0xb5, 0xf5,
+    0x6a, 0x0d, 0xd4, 0xbe, 0xb0, 0x31, 0x8c, 0xf5, 0x4a, 0x58, 0xf7, 0xa2,
+    0xb1, 0xfd, 0x06, 0xce, 0x28, 0x65, 0x8d, 0xce, 0xed, 0x45, 0xef, 0x52,
+    0x63, 0xaf, 0xeb, 0x3b, 0x8e, 0x3e, 0x05, 0x44, 0x44, 0xda, 0x45, 0x01,
+    0xda, 0xc8, 0x51, 0xe6, 0x54, 0xae, 0x42, 0x81, 0x1a, 0x1b, 0x60, 0x5f,
+    0x44, 0x6b, 0x26, 0x66,
+};
+static const uint8_t kat_short[27] =
+{
+    0x73, 0xa4, 0xa6, 0xf3, 0x51, 0x95, 0x37, 0x24, 0xdf, 0xd7, 0x52, 0xcf,
+    0x04, 0xb4, 0xc4, 0xaa, 0xc3, 0x98, 0xb0, 0x89, 0x62, 0x9c, 0xf5, 0xb4,
+    0x75, 0x80, 0x47,
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Rand( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static void SetKeys( csa_t *c )
+{
+    /* as csa_SetCW, without the need of a VLC object */
+    memcpy( c->e_ck, even_ck, 8 );
+    csa_ComputeKey( c->e_kk, c->e_ck );
+    memcpy( c->o_ck, odd_ck, 8 );
+    csa_ComputeKey( c->o_kk, c->o_ck );
+}
+
+static void MakePacket( uint8_t *p, int i_payload )
+{
+    p[0] = 0x47;
+    p[1] = 0x00;
+    p[2] = 0x64;
+    if( i_payload == 184 )
+        p[3] = 0x10;
+    else
+    {
+        p[3] = 0x30;
+        p[4] = 183 - i_payload;
+        memset( &p[5], 0xff, 183 - i_payload );
+    }
+    for( int i = 0; i < i_payload; i++ )
+        p[188 - i_payload + i] = i;
+}
+
+static void test_known_answer( csa_t *c )
+{
+    uint8_t pkt[188], ref[188];
+    uint8_t *pp_pkt[1] = { pkt };
+
+    printf( "known answers\n" );
+
+    /* scalar */
+    MakePacket( pkt, 184 );
+    memcpy( ref, pkt, 188 );
+    c->use_odd = false;
+    csa_Encrypt( c, pkt, 188 );
+    assert( pkt[3] == 0x90 );
+    assert( !memcmp( &pkt[4], kat_full, 184 ) );
+    csa_Decrypt( c, pkt, 188 );
+    assert( !memcmp( pkt, ref, 188 ) );
+
+    /* batch */
+    MakePacket( pkt, 27 );
+    memcpy( ref, pkt, 188 );
+    c->use_odd = true;
+    csa_EncryptBatch( c, pp_pkt, 1, 188 );
+    assert( pkt[3] == 0xf0 );
+    assert( !memcmp( &pkt[161], kat_short, 27 ) );
+    csa_DecryptBatch( c, pp_pkt, 1, 188 );
+    assert( !memcmp( pkt, ref, 188 ) );
+}
+
+/* Compares the batch versions with the scalar ones on random packets, with
+ * random adaptation fields, keys and partial scrambling (i_pkt_size) */
+static void test_batch( csa_t *c )
+{
+    static uint8_t pkt[N_PKT][188], ref[N_PKT][188];
+    uint8_t *pp_pkt[N_PKT];
+
+    printf( "batch vs scalar\n" );
+
+    for( int i_pkt_size = 188; i_pkt_size >= 12; i_pkt_size -= 11 )
+    {
+        const int i_pkt = 1 + Rand() * N_PKT / 256;
+
+        for( int i = 0; i < i_pkt; i++ )
+        {
+            for( int j = 0; j < 188; j++ )
+                pkt[i][j] = Rand();
+            pkt[i][0] = 0x47;
+            pkt[i][3] = 0x10 | ( pkt[i][3]&0x2f );
+            if( pkt[i][3]&0x20 )
+                pkt[i][4] %= 184;
+            pp_pkt[i] = pkt[i];
+        }
+
+        /* scrambling */
+        c->use_odd = Rand()&1;
+        memcpy( ref, pkt, i_pkt * 188 );
+        csa_EncryptBatch( c, pp_pkt, i_pkt, i_pkt_size );
+        for( int i = 0; i < i_pkt; i++ )
+        {
+            csa_Encrypt( c, ref[i], i_pkt_size );
+            assert( !memcmp( ref[i], pkt[i], 188 ) );
+        }
+
+        /* descrambling, with both keys and some clear packets */
+        for( int i = 0; i < i_pkt; i++ )
+        {
+            const uint8_t r = Rand();
+            if( r&1 )
+                pkt[i][3] ^= 0x40;
+            if( r % 5 == 0 )
+                pkt[i][3] &= 0x3f;
+        }
+        memcpy( ref, pkt, i_pkt * 188 );
+        csa_DecryptBatch( c, pp_pkt, i_pkt, i_pkt_size );
+        for( int i = 0; i < i_pkt; i++ )
+        {
+            csa_Decrypt( c, ref[i], i_pkt_size );
+            assert( !memcmp( ref[i], pkt[i], 188 ) );
+        }
+    }
+}
+
+static void test_throughput( csa_t *c )
+{
+    static uint8_t pkt[N_PKT][188];
+    uint8_t *pp_pkt[N_PKT];
+    const int i_loop = 4;
+
+    for( int i = 0; i < N_PKT; i++ )
+    {
+        MakePacket( pkt[i], 184 );
+        pp_pkt[i] = pkt[i];
+    }
+    c->use_odd = false;
+
+    mtime_t i_start = mdate();
+    for( int k = 0; k < i_loop; k++ )
+        for( int i = 0; i < N_PKT; i++ )
+        {
+            csa_Encrypt( c, pkt[i], 188 );
+            csa_Decrypt( c, pkt[i], 188 );
+        }
+    mtime_t i_scalar = mdate() - i_start;
+
+    i_start = mdate();
+    for( int k = 0; k < i_loop; k++ )
+    {
+        csa_EncryptBatch( c, pp_pkt, N_PKT, 188 );
+        csa_DecryptBatch( c, pp_pkt, N_PKT, 188 );
+    }
+    mtime_t i_batch = mdate() - i_start;
+
+    const uint64_t i_bits = (uint64_t)2 * i_loop * N_PKT * 188 * 8;
+    printf( "throughput: scalar %"PRIu64" Mbit/s, batch %"PRIu64" Mbit/s\n",
+            i_bits / __MAX( i_scalar, 1 ), i_bits / __MAX( i_batch, 1 ) );
+}
+
+int main( void )
+{
+    csa_t *c = csa_New();
+    assert( c != NULL );
+    SetKeys( c );
+
+    test_known_answer( c );
+    test_batch( c );
+    test_throughput( c );
+
+    csa_Delete( c );
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*****************************************************************************
+ * startcode.c: test the Annex B start code search
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks every start code search version against a plain byte loop, within
+ * a buffer and across chained blocks.
+ * With "bench" as argument, measures their throughput instead, for streams
+ * of small slices up to large intra frames. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include "../modules/packetizer/startcode_helper.h"
+
+typedef struct
+{
+    const char *name;
+    block_startcode_helper_t find;
+    bool supported;
+} version_t;
+
+static version_t versions[] = {
+    { "C", startcode_FindAnnexB_C, true },
+    { "memchr", startcode_FindAnnexB_memchr, true },
+#ifdef CAN_COMPILE_SSE2
+    { "SSE2", startcode_FindAnnexB_SSE2, false },
+#endif
+#ifdef CAN_COMPILE_AVX2
+    { "AVX2", startcode_FindAnnexB_AVX2, false },
+#endif
+#ifdef STARTCODE_NEON
+    { "NEON", startcode_FindAnnexB_NEON, true },
+#endif
+    { "best", startcode_FindAnnexB, true },
+};
+
+#define VERSIONS (sizeof (versions) / sizeof (versions[0]))
+
+static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+
+static const uint8_t *find_ref(const uint8_t *p, const uint8_t *end)
+{
+    for (; end - p >= 3; p++)
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    return NULL;
+}
+
+/* Random bytes, from a small alphabet to have lots of partial matches */
+static void fill_noise(uint8_t *p, size_t size)
+{
+    static const uint8_t alphabet[] = { 0x00, 0x00, 0x00, 0x01, 0x02, 0xFF };
+
+    for (size_t i = 0; i < size; i++)
+        p[i] = alphabet[rand() % sizeof (alphabet)];
+}
+
+/* NAL units of about the given size, with emulation prevention */
+static size_t fill_nals(uint8_t *p, size_t size, size_t nal_size)
+{
+    size_t i = 0, nals = 0;
+
+    while (i + 4 <= size)
+    {
+        if (rand() & 1)
+            p[i++] = 0x00; /* 4 bytes start code */
+        memcpy(&p[i], startcode, 3);
+        i += 3;
+        nals++;
+
+        size_t end = i + nal_size / 2 + rand() % (nal_size + 1);
+        if (end > size)
+            end = size;
+        unsigned zeros = 0;
+        for (; i < end; i++)
+        {
+            uint8_t c = rand();
+            if (zeros >= 2 && c <= 3)
+            {
+                c = 0x03;
+                zeros = 0;
+            }
+            else
+                zeros = c ? 0 : zeros + 1;
+            p[i] = c;
+        }
+        if (i > 0 && p[i - 1] == 0x00)
+            p[i - 1] = 0x80; /* rbsp trailing bits */
+    }
+    return nals;
+}
+
+static void check_buffer(const uint8_t *buf, size_t size)
+{
+    for (unsigned n = 0; n < 2000; n++)
+    {
+        size_t a = rand() % (size + 1);
+        size_t b = a + rand() % (size - a + 1);
+        const uint8_t *ref = find_ref(&buf[a], &buf[b]);
+
+        for (size_t v = 0; v < VERSIONS; v++)
+            if (versions[v].supported)
+                assert(versions[v].find(&buf[a], &buf[b]) == ref);
+    }
+}
+
+/* All the start codes of the bytestream, from the packetizer helper */
+static void check_bytestream(const uint8_t *buf, size_t size,
+                             block_startcode_helper_t helper)
+{
+    block_bytestream_t bytestream;
+
+    block_BytestreamInit(&bytestream);
+    for (size_t i = 0; i < size;)
+    {
+        size_t len = 1 + rand() % (rand() % 2 ? 8 : 4096);
+        if (len > size - i)
+            len = size - i;
+
+        block_t *block = block_Alloc(len);
+        assert(block != NULL);
+        memcpy(block->p_buffer, &buf[i], len);
+        block_BytestreamPush(&bytestream, block);
+        i += len;
+    }
+
+    const uint8_t *ref = buf;
+    size_t offset = 0;
+    while (!block_FindStartcodeFromOffset(&bytestream, &offset,
+                                          startcode, 3, helper))
+    {
+        ref = find_ref(ref, &buf[size]);
+        assert(ref != NULL && offset == (size_t)(ref - buf));
+        ref++;
+        offset++;
+    }
+    assert(find_ref(ref, &buf[size]) == NULL);
+    block_BytestreamRelease(&bytestream);
+}
+
+static void check(void)
+{
+    size_t size = 1 << 16;
+    uint8_t *buf = malloc(size);
+    assert(buf != NULL);
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        if (i & 1)
+            fill_noise(buf, size);
+        else
+            fill_nals(buf, size, 16 << i);
+
+        check_buffer(buf, size);
+        for (size_t v = 0; v < VERSIONS; v++)
+            if (versions[v].supported)
+                check_bytestream(buf, size, versions[v].find);
+        check_bytestream(buf, size, NULL);
+    }
+    free(buf);
+}
+
+static void bench(void)
+{
+    static const size_t nal_sizes[] = { 100, 1400, 20000, 500000 };
+    size_t size = 64 << 20;
+    uint8_t *buf = malloc(size);
+    assert(buf != NULL);
+
+    for (size_t s = 0; s < sizeof (nal_sizes) / sizeof (nal_sizes[0]); s++)
+    {
+        size_t nals = fill_nals(buf, size, nal_sizes[s]);
+
+        printf("NAL size ~%zu bytes:", nal_sizes[s]);
+        for (size_t v = 0; v < VERSIONS; v++)
+        {
+            if (!versions[v].supported)
+                continue;
+
+            size_t found = 0;
+            mtime_t start = mdate();
+            for (const uint8_t *p = buf, *end = &buf[size];
+                 (p = versions[v].find(p, end)) != NULL; p += 3)
+                found++;
+            mtime_t duration = mdate() - start;
+
+            assert(found == nals);
+            printf(" %s %"PRId64" MB/s", versions[v].name,
+                   (int64_t)size / __MAX(duration, 1));
+        }
+        printf("\n");
+
+        /* As the packetizers do, with and without the helper */
+        for (unsigned helper = 0; helper < 2; helper++)
+        {
+            block_bytestream_t bytestream;
+
+            block_BytestreamInit(&bytestream);
+            for (size_t i = 0; i < size; i += 65536)
+            {
+                block_t *block = block_Alloc(65536);
+                assert(block != NULL);
+                memcpy(block->p_buffer, &buf[i], 65536);
+                block_BytestreamPush(&bytestream, block);
+            }
+
+            size_t found = 0, offset = 0;
+            mtime_t start = mdate();
+            while (!block_FindStartcodeFromOffset(&bytestream, &offset,
+                                   startcode, 3,
+                                   helper ? startcode_FindAnnexB : NULL))
+            {
+                /* Skips the searched data, as the packetizers do */
+                block_SkipBytes(&bytestream, offset + 1);
+                block_BytestreamFlush(&bytestream);
+                offset = 0;
+                found++;
+            }
+            mtime_t duration = mdate() - start;
+
+            assert(found == nals);
+            printf("  bytestream %s helper: %"PRId64" MB/s\n",
+                   helper ? "with" : "without",
+                   (int64_t)size / __MAX(duration, 1));
+            block_BytestreamRelease(&bytestream);
+        }
+    }
+    free(buf);
+}
+
+int main(int argc, char **argv)
+{
+#ifdef CAN_COMPILE_SSE2
+    for (size_t v = 0; v < VERSIONS; v++)
+        if (!strcmp(versions[v].name, "SSE2"))
+            versions[v].supported = vlc_CPU_SSE2();
+#endif
+#ifdef CAN_COMPILE_AVX2
+    for (size_t v = 0; v < VERSIONS; v++)
+        if (!strcmp(versions[v].name, "AVX2"))
+            versions[v].supported = vlc_CPU_AVX2();
+#endif
+    srand(42);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench();
+    else
+        check();
+    return 0;
+}
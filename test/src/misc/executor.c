@@ -0,0 +1,364 @@
+/*****************************************************************************
+ * executor.c: test for the thread pool
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+typedef struct
+{
+    vlc_task_t task;
+    vlc_sem_t *start; /* posted by the task when it starts, or NULL */
+    vlc_sem_t *resume; /* waited by the task before returning, or NULL */
+    atomic_uint *order; /* global completion counter, or NULL */
+    unsigned ran; /* completion rank, 0 if the task did not run */
+    unsigned released;
+} test_task_t;
+
+static void Run(void *data)
+{
+    test_task_t *t = data;
+
+    if (t->start != NULL)
+        vlc_sem_post(t->start);
+    if (t->resume != NULL)
+        vlc_sem_wait(t->resume);
+    t->ran = (t->order != NULL) ? atomic_fetch_add(t->order, 1) + 1 : 1;
+}
+
+static vlc_sem_t released;
+
+static void Release(void *data)
+{
+    test_task_t *t = data;
+
+    t->released++;
+    vlc_sem_post(&released);
+}
+
+static void Init(test_task_t *t)
+{
+    vlc_task_Init(&t->task, Run, t);
+    t->task.release = Release;
+    t->start = t->resume = NULL;
+    t->order = NULL;
+    t->ran = t->released = 0;
+}
+
+/* Waits for tasks to be released, i.e. to be no longer used by the pool */
+static void WaitReleased(unsigned count)
+{
+    while (count-- > 0)
+        vlc_sem_wait(&released);
+}
+
+static void test_submit(void)
+{
+    vlc_executor_t *ex = vlc_executor_New(2);
+    test_task_t tasks[16];
+
+    assert(ex != NULL);
+    for (unsigned i = 0; i < 16; i++)
+    {
+        Init(&tasks[i]);
+        assert(vlc_executor_Submit(ex, &tasks[i].task,
+                                   VLC_TASK_PRIORITY_NORMAL,
+                                   VLC_TS_INVALID) == 0);
+    }
+
+    WaitReleased(16);
+    for (unsigned i = 0; i < 16; i++)
+    {
+        assert(tasks[i].ran == 1);
+        assert(tasks[i].released == 1);
+    }
+    vlc_executor_Delete(ex);
+}
+
+static void test_priority(void)
+{
+    vlc_executor_t *ex = vlc_executor_New(1);
+    vlc_sem_t start, resume;
+    atomic_uint order = ATOMIC_VAR_INIT(0);
+    test_task_t blocker, low, high;
+
+    assert(ex != NULL);
+    vlc_sem_init(&start, 0);
+    vlc_sem_init(&resume, 0);
+
+    /* Occupy the single worker thread, then queue two tasks */
+    Init(&blocker);
+    blocker.start = &start;
+    blocker.resume = &resume;
+    assert(vlc_executor_Submit(ex, &blocker.task, VLC_TASK_PRIORITY_NORMAL,
+                               VLC_TS_INVALID) == 0);
+    vlc_sem_wait(&start);
+
+    Init(&low);
+    low.order = &order;
+    Init(&high);
+    high.order = &order;
+    assert(vlc_executor_Submit(ex, &low.task, VLC_TASK_PRIORITY_LOW,
+                               VLC_TS_INVALID) == 0);
+    assert(vlc_executor_Submit(ex, &high.task, VLC_TASK_PRIORITY_HIGH,
+                               VLC_TS_INVALID) == 0);
+    /* A queued task cannot be queued twice */
+    assert(vlc_executor_Submit(ex, &low.task, VLC_TASK_PRIORITY_LOW,
+                               VLC_TS_INVALID) == EBUSY);
+
+    vlc_sem_post(&resume);
+    WaitReleased(3);
+    assert(high.ran == 1 && low.ran == 2);
+
+    vlc_executor_Delete(ex);
+    vlc_sem_destroy(&resume);
+    vlc_sem_destroy(&start);
+}
+
+static void test_timer(void)
+{
+    vlc_executor_t *ex = vlc_executor_New(1);
+    test_task_t t;
+
+    assert(ex != NULL);
+    Init(&t);
+
+    mtime_t date = mdate() + CLOCK_FREQ / 20;
+    assert(vlc_executor_Submit(ex, &t.task, VLC_TASK_PRIORITY_NORMAL,
+                               date) == 0);
+    WaitReleased(1);
+    assert(t.ran == 1);
+    assert(mdate() >= date);
+    vlc_executor_Delete(ex);
+}
+
+static void test_cancel(void)
+{
+    vlc_executor_t *ex = vlc_executor_New(1);
+    vlc_sem_t start, resume;
+    test_task_t blocker, queued, timer;
+
+    assert(ex != NULL);
+    vlc_sem_init(&start, 0);
+    vlc_sem_init(&resume, 0);
+
+    Init(&blocker);
+    blocker.start = &start;
+    blocker.resume = &resume;
+    assert(vlc_executor_Submit(ex, &blocker.task, VLC_TASK_PRIORITY_NORMAL,
+                               VLC_TS_INVALID) == 0);
+    vlc_sem_wait(&start);
+
+    /* Pending tasks are removed and released without running */
+    Init(&queued);
+    Init(&timer);
+    assert(vlc_executor_Submit(ex, &queued.task, VLC_TASK_PRIORITY_NORMAL,
+                               VLC_TS_INVALID) == 0);
+    assert(vlc_executor_Submit(ex, &timer.task, VLC_TASK_PRIORITY_NORMAL,
+                               mdate() + 3600 * CLOCK_FREQ) == 0);
+    assert(vlc_executor_Cancel(ex, &queued.task));
+    assert(vlc_executor_Cancel(ex, &timer.task));
+    WaitReleased(2);
+    assert(queued.ran == 0 && queued.released == 1);
+    assert(timer.ran == 0 && timer.released == 1);
+
+    /* A running task is flagged, then waited for */
+    assert(!vlc_task_IsCanceled(ex, &blocker.task));
+    vlc_sem_post(&resume);
+    assert(!vlc_executor_Cancel(ex, &blocker.task));
+    assert(blocker.ran == 1);
+    assert(vlc_task_IsCanceled(ex, &blocker.task));
+    WaitReleased(1);
+
+    vlc_executor_Delete(ex);
+    vlc_sem_destroy(&resume);
+    vlc_sem_destroy(&start);
+}
+
+static vlc_executor_t *resubmit_ex;
+
+/* Submits itself again from its procedure, up to three runs */
+static void RunAgain(void *data)
+{
+    test_task_t *t = data;
+
+    assert(t->released == 0);
+    if (++t->ran < 3)
+        assert(vlc_executor_Submit(resubmit_ex, &t->task,
+                                   VLC_TASK_PRIORITY_NORMAL,
+                                   VLC_TS_INVALID) == 0);
+}
+
+static void test_resubmit(void)
+{
+    test_task_t t;
+
+    resubmit_ex = vlc_executor_New(2);
+    assert(resubmit_ex != NULL);
+    Init(&t);
+    t.task.run = RunAgain;
+    assert(vlc_executor_Submit(resubmit_ex, &t.task, VLC_TASK_PRIORITY_NORMAL,
+                               VLC_TS_INVALID) == 0);
+
+    /* Released once, after the last run only */
+    WaitReleased(1);
+    assert(t.ran == 3 && t.released == 1);
+    vlc_executor_Delete(resubmit_ex);
+    assert(t.released == 1);
+}
+
+static void *DeleteThread(void *data)
+{
+    vlc_executor_Delete(data);
+    return NULL;
+}
+
+static void test_delete(void)
+{
+    vlc_executor_t *ex = vlc_executor_New(1);
+    vlc_sem_t start, resume;
+    vlc_thread_t th;
+    test_task_t blocker, pending[4], probe;
+
+    assert(ex != NULL);
+    vlc_sem_init(&start, 0);
+    vlc_sem_init(&resume, 0);
+
+    Init(&blocker);
+    blocker.start = &start;
+    blocker.resume = &resume;
+    assert(vlc_executor_Submit(ex, &blocker.task, VLC_TASK_PRIORITY_NORMAL,
+                               VLC_TS_INVALID) == 0);
+    vlc_sem_wait(&start);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        Init(&pending[i]);
+        assert(vlc_executor_Submit(ex, &pending[i].task, i % 3,
+                                   (i & 1) ? mdate() + 3600 * CLOCK_FREQ
+                                           : VLC_TS_INVALID) == 0);
+    }
+
+    /* Delete discards the pending tasks while the worker is still busy */
+    assert(vlc_clone(&th, DeleteThread, ex, VLC_THREAD_PRIORITY_LOW) == 0);
+    Init(&probe);
+    /* The probe is discarded with the pending tasks if it was queued before
+     * Delete started; a rejected submission does not release it */
+    unsigned queued = 0;
+    for (;;)
+    {
+        int val = vlc_executor_Submit(ex, &probe.task,
+                                      VLC_TASK_PRIORITY_LOW, VLC_TS_INVALID);
+        if (val == ECANCELED)
+            break;
+        assert(val == 0 || val == EBUSY);
+        if (val == 0)
+            queued++;
+    }
+    assert(queued <= 1);
+
+    /* Delete then waits for the running task */
+    vlc_sem_post(&resume);
+    vlc_join(th, NULL);
+    assert(blocker.ran == 1 && blocker.released == 1);
+    for (unsigned i = 0; i < 4; i++)
+        assert(pending[i].ran == 0 && pending[i].released == 1);
+    assert(probe.ran == 0 && probe.released == queued);
+    WaitReleased(5 + queued);
+
+    vlc_sem_destroy(&resume);
+    vlc_sem_destroy(&start);
+}
+
+/* Measures how many worker threads serve a burst of blocking tasks */
+static atomic_uint running = ATOMIC_VAR_INIT(0);
+static atomic_uint peak = ATOMIC_VAR_INIT(0);
+
+static void RunCount(void *data)
+{
+    unsigned n = atomic_fetch_add(&running, 1) + 1;
+    unsigned p = atomic_load(&peak);
+
+    while (n > p && !atomic_compare_exchange_weak(&peak, &p, n));
+    Run(data);
+    atomic_fetch_sub(&running, 1);
+}
+
+static void test_threads(void)
+{
+    const unsigned max = 4, count = 256;
+    vlc_executor_t *ex = vlc_executor_New(max);
+    vlc_sem_t start, resume;
+    test_task_t tasks[256];
+
+    assert(ex != NULL);
+    vlc_sem_init(&start, 0);
+    vlc_sem_init(&resume, 0);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        Init(&tasks[i]);
+        tasks[i].task.run = RunCount;
+        tasks[i].start = &start;
+        tasks[i].resume = &resume;
+        assert(vlc_executor_Submit(ex, &tasks[i].task,
+                                   VLC_TASK_PRIORITY_NORMAL,
+                                   VLC_TS_INVALID) == 0);
+    }
+
+    /* The pool is saturated once every worker thread is blocked */
+    for (unsigned i = 0; i < max; i++)
+        vlc_sem_wait(&start);
+    assert(atomic_load(&running) == max);
+
+    for (unsigned i = 0; i < count; i++)
+        vlc_sem_post(&resume);
+    WaitReleased(count);
+
+    unsigned threads = atomic_load(&peak);
+    printf("%u blocking tasks ran on %u threads (limit %u)\n",
+           count, threads, max);
+    assert(threads == max);
+    vlc_executor_Delete(ex);
+    vlc_sem_destroy(&resume);
+    vlc_sem_destroy(&start);
+}
+
+int main(void)
+{
+    vlc_sem_init(&released, 0);
+    test_submit();
+    test_priority();
+    test_timer();
+    test_cancel();
+    test_resubmit();
+    test_delete();
+    test_threads();
+    vlc_sem_destroy(&released);
+    return 0;
+}